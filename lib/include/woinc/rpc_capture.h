@@ -0,0 +1,164 @@
+/* woinc/rpc_capture.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_RPC_CAPTURE_H_
+#define WOINC_RPC_CAPTURE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <woinc/defs.h>
+#include <woinc/rpc_connection.h>
+
+namespace woinc { namespace rpc {
+
+struct CapturedRpc {
+    std::string host;
+    std::uint16_t port = 0;
+    // from the start of the capture until the rpc was started
+    std::chrono::nanoseconds offset{0};
+    // from starting the rpc until its reply was received or it failed
+    std::chrono::nanoseconds duration{0};
+    ConnectionStatus status = ConnectionStatus::Ok;
+    std::string error;
+    std::string request;
+    std::string reply;
+};
+
+// Writes the rpcs of any number of connections to a capture file, threadsafe.
+//
+// The file starts with a magic and a version followed by one record per rpc.
+// The numbers are varint encoded and the hosts and requests are written only once and referenced afterwards,
+// so a poll mostly costs its reply.
+// The file is readable by its owner only and the password hash of an authorization is redacted.
+class CaptureWriter {
+    public:
+        // truncates or creates the file, see good()
+        explicit CaptureWriter(const std::string &path);
+        ~CaptureWriter();
+
+        CaptureWriter(const CaptureWriter &) = delete;
+        CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+        // false if the file couldn't be opened or a write failed
+        bool good() const;
+
+        // the offsets of the rpcs are relative to it
+        std::chrono::steady_clock::time_point start() const;
+
+        // the records are buffered, flush() or destroying the writer writes the remaining ones
+        void write(const CapturedRpc &rpc);
+        void flush();
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl_;
+};
+
+// The rpcs read from a capture file
+class Capture {
+    public:
+        // appends the rpcs of the file; returns false if it can't be read or is corrupt,
+        // the rpcs before the corruption are kept then
+        bool read(const std::string &path);
+        bool read(std::istream &in);
+
+        // in the order they were written
+        const std::vector<CapturedRpc> &rpcs() const { return rpcs_; }
+
+        // the indices of the rpcs to the host in their order, nullptr if there are none
+        const std::vector<std::size_t> *rpcs(const std::string &host, std::uint16_t port) const;
+
+    private:
+        std::vector<CapturedRpc> rpcs_;
+        std::map<std::pair<std::string, std::uint16_t>, std::vector<std::size_t>> hosts_;
+};
+
+// A connection recording its rpcs to the writer, e.g. to capture the replies of a production session
+class RecordingConnection : public Connection {
+    public:
+        explicit RecordingConnection(std::shared_ptr<CaptureWriter> writer);
+
+        Result open(const std::string &hostname, std::uint16_t port = DefaultBOINCPort) override;
+        Result do_rpc(const std::string &request, std::ostream &response) override;
+
+    private:
+        std::shared_ptr<CaptureWriter> writer_;
+        // reused to keep the capacity of the request and reply
+        CapturedRpc rpc_;
+};
+
+// Serves the rpcs of a capture instead of connecting to a client, e.g. to replay a session in benchmarks or tests.
+//
+// A request is answered by the next recorded rpc of the host with an identical request,
+// starting over once the recorded ones are used up; requests never recorded for the host fail.
+// As the password hash was redacted when capturing, an authorization is answered as recorded whatever the password is.
+// The replies are delayed by their recorded duration divided by the speed, a speed of zero replies immediately.
+class ReplayConnection : public Connection {
+    public:
+        explicit ReplayConnection(std::shared_ptr<const Capture> capture, double speed = 1);
+
+        // fails if the capture has no rpcs of the host
+        Result open(const std::string &hostname, std::uint16_t port = DefaultBOINCPort) override;
+        void close() override;
+
+        Result do_rpc(const std::string &request, std::ostream &response) override;
+
+        void deadline(std::chrono::steady_clock::time_point deadline) override;
+        void interrupt() override;
+
+        bool is_connected() const override;
+        bool is_localhost() const override;
+
+        const Timeline &timeline() const override;
+
+    private:
+        const CapturedRpc *find_(const std::string &request);
+        // returns false if interrupted or the deadline passed
+        bool wait_(std::chrono::steady_clock::duration duration);
+
+    private:
+        const std::shared_ptr<const Capture> capture_;
+        const double speed_;
+
+        std::string hostname_;
+        const std::vector<std::size_t> *rpcs_ = nullptr;
+        // per request the position in rpcs_ to continue the search for it at
+        std::map<std::string, std::size_t> cursors_;
+        bool connected_ = false;
+
+        std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+        Timeline timeline_;
+
+        std::mutex interrupt_mutex_;
+        std::condition_variable interrupt_condition_;
+        bool interrupted_ = false;
+};
+
+}}
+
+#endif
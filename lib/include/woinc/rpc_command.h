@@ -19,6 +19,8 @@
 #ifndef WOINC_RPC_COMMAND_H_
 #define WOINC_RPC_COMMAND_H_
 
+#include <cstdint>
+
 #include <woinc/defs.h>
 #include <woinc/types.h>
 #include <woinc/version.h>
@@ -27,6 +29,17 @@ namespace woinc { namespace rpc {
 
 struct Connection;
 
+// Measurements of the rpcs of a command, accumulated over all its executions
+struct RpcMetrics {
+    std::uint64_t rpcs = 0;
+    // from sending the request until the reply is received completely
+    std::uint64_t round_trip_ns = 0;
+    std::uint64_t bytes_out = 0;
+    std::uint64_t bytes_in = 0;
+    // the xml parsing and the conversion into the response
+    std::uint64_t parse_ns = 0;
+};
+
 struct Command {
     virtual ~Command() = default;
 
@@ -37,12 +50,14 @@ struct Command {
     }
 
     const std::string &error() const { return error_; }
+    const RpcMetrics &metrics() const { return metrics_; }
 
     // see gui_rpcs[] in BOINC/client/gui_rpc_server_ops.cpp
     virtual bool requires_local_authorization() const = 0;
 
     protected:
         std::string error_;
+        RpcMetrics metrics_;
 };
 
 template<typename RequestType, typename ResponseType, bool RequireLocalAuth>
@@ -82,6 +97,9 @@ struct AuthorizeResponse {
 
 typedef BOINCCommand<AuthorizeRequest, AuthorizeResponse, false> AuthorizeCommand;
 
+// the hash of the nonce and the password sent in the second step of the authorization, e.g. to mock a client
+std::string authorization_hash(const std::string &nonce, const std::string &password);
+
 // --- ExchangeVersionsCommand ---
 
 struct ExchangeVersionsRequest {
@@ -252,10 +270,17 @@ typedef BOINCCommand<GetResultsRequest, GetResultsResponse, false> GetResultsCom
 
 // --- GetStatistics ---
 
-struct GetStatisticsRequest {};
+struct GetStatisticsRequest {
+    // the days of a project before its day in here are skipped when parsing the reply,
+    // e.g. because they are known from a previous call; the day itself is parsed, because the client updates it
+    std::map<std::string, time_t> since;
+};
 
 struct GetStatisticsResponse {
     Statistics statistics;
+    // the first day reported by the client for each project in statistics, including a skipped one,
+    // or 0 if there isn't any day of the project
+    std::vector<time_t> first_days;
 };
 
 typedef BOINCCommand<GetStatisticsRequest, GetStatisticsResponse, false> GetStatisticsCommand;
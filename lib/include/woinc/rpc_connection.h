@@ -19,6 +19,7 @@
 #ifndef WOINC_RPC_CONNECTION_H_
 #define WOINC_RPC_CONNECTION_H_
 
+#include <chrono>
 #include <cstdint>
 #include <iosfwd>
 #include <memory>
@@ -35,6 +36,9 @@ class Connection {
         struct Result {
             ConnectionStatus status;
             std::string error;
+            // the reply doesn't have to be parsed, e.g. because it's known to be unchanged,
+            // the command discards it then and leaves its response as is
+            bool consumed = false;
 
             explicit Result(ConnectionStatus s = ConnectionStatus::Ok, std::string err = "")
                 : status(s), error(std::move(err)) {}
@@ -44,6 +48,16 @@ class Connection {
             }
         };
 
+        // The phases of the last rpc, points not reached by it are time_point::min()
+        struct Timeline {
+            typedef std::chrono::steady_clock::time_point TimePoint;
+
+            TimePoint started = TimePoint::min();    // before sending the request
+            TimePoint sent = TimePoint::min();       // the request was sent completely
+            TimePoint first_byte = TimePoint::min(); // the first part of the reply was received
+            TimePoint completed = TimePoint::min();  // the end of message marker was received
+        };
+
     public:
         Connection();
         virtual ~Connection();
@@ -53,8 +67,19 @@ class Connection {
 
         virtual Result do_rpc(const std::string &request, std::ostream &response);
 
+        // The following rpcs fail if they can't be completed until the deadline, pass time_point::max() to reset it.
+        // An rpc aborted after sending the request closes the connection, because the reply can't be resynced.
+        virtual void deadline(std::chrono::steady_clock::time_point deadline);
+
+        // Aborts a blocking open or rpc and lets all following ones fail immediately, e.g. to shut down.
+        // In contrast to the other methods it may be called by any thread.
+        virtual void interrupt();
+
+        virtual bool is_connected() const;
         virtual bool is_localhost() const;
 
+        virtual const Timeline &timeline() const;
+
     protected:
         struct Impl;
         std::unique_ptr<Impl> impl_;
@@ -0,0 +1,496 @@
+/* lib/rpc_capture.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include <woinc/rpc_capture.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <streambuf>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "visibility.h"
+
+namespace {
+
+constexpr char MAGIC__[] = {'W', 'O', 'I', 'N', 'C', 'C', 'A', 'P'};
+constexpr std::uint64_t VERSION__ = 1;
+// anything larger is treated as corruption
+constexpr std::uint64_t MAX_STRING_SIZE__ = std::uint64_t(1) << 30;
+// the records are written once this much is buffered
+constexpr std::size_t BUFFER_SIZE__ = 64 * 1024;
+
+void write_varint__(std::string &out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void write_string__(std::string &out, const std::string &value) {
+    write_varint__(out, value.size());
+    out.append(value);
+}
+
+std::uint64_t zigzag__(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag__(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+bool read_varint__(std::istream &in, std::uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        auto c = in.get();
+        if (c == std::istream::traits_type::eof())
+            return false;
+        value |= static_cast<std::uint64_t>(c & 0x7f) << shift;
+        if ((c & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool read_string__(std::istream &in, std::string &value) {
+    std::uint64_t size;
+    if (!read_varint__(in, size) || size > MAX_STRING_SIZE__)
+        return false;
+    value.resize(static_cast<std::size_t>(size));
+    return size == 0 || in.read(&value[0], static_cast<std::streamsize>(size));
+}
+
+// looks up the index of the value, adding it if it's unknown; returns true if it was added
+template<typename Key, typename Hash>
+bool intern__(std::unordered_map<Key, std::uint64_t, Hash> &table, const Key &value, std::uint64_t &index) {
+    auto inserted = table.emplace(value, table.size());
+    index = inserted.first->second;
+    return inserted.second;
+}
+
+struct HostKeyHash {
+    std::size_t operator()(const std::pair<std::string, std::uint16_t> &key) const {
+        return std::hash<std::string>()(key.first) ^ key.second;
+    }
+};
+
+// The hash of the nonce and the password sent by auth2 would allow to brute force the password offline,
+// so it's replaced before the request is captured and when a request is looked up in a capture.
+// Returns false if the request contains no hash.
+bool redact__(const std::string &request, std::string &redacted) {
+    constexpr char OPEN_TAG[] = "<nonce_hash>";
+
+    auto begin = request.find(OPEN_TAG);
+    if (begin == std::string::npos)
+        return false;
+    begin += std::strlen(OPEN_TAG);
+
+    auto end = request.find("</nonce_hash>", begin);
+    if (end == std::string::npos)
+        return false;
+
+    redacted = request;
+    redacted.replace(begin, end - begin, "redacted");
+    return true;
+}
+
+// passes the reply to the response while keeping a copy
+class TeeBuffer : public std::streambuf {
+    public:
+        TeeBuffer(std::string &copy, std::ostream &out) : copy_(copy), out_(out) {}
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (traits_type::eq_int_type(c, traits_type::eof()))
+                return traits_type::not_eof(c);
+            copy_.push_back(traits_type::to_char_type(c));
+            return out_.put(traits_type::to_char_type(c)) ? c : traits_type::eof();
+        }
+
+        std::streamsize xsputn(const char *s, std::streamsize n) override {
+            copy_.append(s, static_cast<std::size_t>(n));
+            return out_.write(s, n) ? n : 0;
+        }
+
+    private:
+        std::string &copy_;
+        std::ostream &out_;
+};
+
+}
+
+namespace woinc { namespace rpc {
+
+// ---- CaptureWriter ----
+
+struct WOINC_LOCAL CaptureWriter::Impl {
+    ~Impl();
+
+    // writes the buffered records
+    void write_buffer();
+
+    std::mutex mutex;
+    int fd = -1;
+    bool good = false;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::unordered_map<std::pair<std::string, std::uint16_t>, std::uint64_t, HostKeyHash> hosts;
+    std::unordered_map<std::string, std::uint64_t> requests;
+    // the offsets are written as the difference to the previous one
+    std::int64_t last_offset = 0;
+
+    // the records are encoded in here and written once it's full or flushed
+    std::string buffer;
+};
+
+CaptureWriter::Impl::~Impl() {
+    if (fd >= 0) {
+        write_buffer();
+        ::close(fd);
+    }
+}
+
+void CaptureWriter::Impl::write_buffer() {
+    for (std::size_t written = 0; good && written < buffer.size();) {
+        auto n = ::write(fd, buffer.data() + written, buffer.size() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            good = false;
+        else
+            written += static_cast<std::size_t>(n);
+    }
+    buffer.clear();
+}
+
+CaptureWriter::CaptureWriter(const std::string &path) : impl_(std::make_unique<Impl>()) {
+    // the replies contain e.g. the account names and host details, so the capture is readable by the owner only
+    impl_->fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    impl_->good = impl_->fd >= 0;
+
+    impl_->buffer.assign(MAGIC__, sizeof(MAGIC__));
+    write_varint__(impl_->buffer, VERSION__);
+}
+
+CaptureWriter::~CaptureWriter() = default;
+
+bool CaptureWriter::good() const {
+    std::lock_guard<std::mutex> guard(impl_->mutex);
+    return impl_->good;
+}
+
+std::chrono::steady_clock::time_point CaptureWriter::start() const {
+    return impl_->start;
+}
+
+void CaptureWriter::write(const CapturedRpc &rpc) {
+    std::lock_guard<std::mutex> guard(impl_->mutex);
+
+    auto &out = impl_->buffer;
+
+    std::uint64_t index;
+
+    if (intern__(impl_->hosts, std::make_pair(rpc.host, rpc.port), index)) {
+        write_varint__(out, index);
+        write_string__(out, rpc.host);
+        write_varint__(out, rpc.port);
+    } else {
+        write_varint__(out, index);
+    }
+
+    const std::int64_t offset = rpc.offset.count();
+    write_varint__(out, zigzag__(offset - impl_->last_offset));
+    impl_->last_offset = offset;
+    write_varint__(out, static_cast<std::uint64_t>(std::max<std::int64_t>(rpc.duration.count(), 0)));
+
+    write_varint__(out, static_cast<std::uint64_t>(rpc.status));
+    if (rpc.status != ConnectionStatus::Ok)
+        write_string__(out, rpc.error);
+
+    std::string redacted;
+    const auto &request = redact__(rpc.request, redacted) ? redacted : rpc.request;
+
+    if (intern__(impl_->requests, request, index)) {
+        write_varint__(out, index);
+        write_string__(out, request);
+    } else {
+        write_varint__(out, index);
+    }
+
+    write_string__(out, rpc.reply);
+
+    if (out.size() >= BUFFER_SIZE__)
+        impl_->write_buffer();
+}
+
+void CaptureWriter::flush() {
+    std::lock_guard<std::mutex> guard(impl_->mutex);
+    impl_->write_buffer();
+}
+
+// ---- Capture ----
+
+bool Capture::read(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return in && read(in);
+}
+
+bool Capture::read(std::istream &in) {
+    char magic[sizeof(MAGIC__)];
+    std::uint64_t version;
+
+    if (!in.read(magic, sizeof(magic))
+            || !std::equal(magic, magic + sizeof(magic), MAGIC__)
+            || !read_varint__(in, version)
+            || version != VERSION__)
+        return false;
+
+    std::vector<std::pair<std::string, std::uint16_t>> hosts;
+    std::vector<std::string> requests;
+    std::int64_t offset = 0;
+
+    while (in.peek() != std::istream::traits_type::eof()) {
+        CapturedRpc rpc;
+        std::uint64_t value;
+
+        if (!read_varint__(in, value) || value > hosts.size())
+            return false;
+        if (value == hosts.size()) {
+            std::string host;
+            std::uint64_t port;
+            if (!read_string__(in, host) || !read_varint__(in, port) || port > std::numeric_limits<std::uint16_t>::max())
+                return false;
+            hosts.emplace_back(std::move(host), static_cast<std::uint16_t>(port));
+        }
+        rpc.host = hosts[value].first;
+        rpc.port = hosts[value].second;
+
+        if (!read_varint__(in, value))
+            return false;
+        offset += unzigzag__(value);
+        rpc.offset = std::chrono::nanoseconds(offset);
+
+        if (!read_varint__(in, value) || value > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+            return false;
+        rpc.duration = std::chrono::nanoseconds(static_cast<std::int64_t>(value));
+
+        if (!read_varint__(in, value) || value > static_cast<std::uint64_t>(ConnectionStatus::Error))
+            return false;
+        rpc.status = static_cast<ConnectionStatus>(value);
+        if (rpc.status != ConnectionStatus::Ok && !read_string__(in, rpc.error))
+            return false;
+
+        if (!read_varint__(in, value) || value > requests.size())
+            return false;
+        if (value == requests.size()) {
+            std::string request;
+            if (!read_string__(in, request))
+                return false;
+            requests.push_back(std::move(request));
+        }
+        rpc.request = requests[value];
+
+        if (!read_string__(in, rpc.reply))
+            return false;
+
+        hosts_[std::make_pair(rpc.host, rpc.port)].push_back(rpcs_.size());
+        rpcs_.push_back(std::move(rpc));
+    }
+
+    return true;
+}
+
+const std::vector<std::size_t> *Capture::rpcs(const std::string &host, std::uint16_t port) const {
+    auto rpcs = hosts_.find(std::make_pair(host, port));
+    return rpcs == hosts_.end() ? nullptr : &rpcs->second;
+}
+
+// ---- RecordingConnection ----
+
+RecordingConnection::RecordingConnection(std::shared_ptr<CaptureWriter> writer)
+    : writer_(std::move(writer))
+{}
+
+Connection::Result RecordingConnection::open(const std::string &hostname, std::uint16_t port) {
+    rpc_.host = hostname;
+    rpc_.port = port;
+    return Connection::open(hostname, port);
+}
+
+Connection::Result RecordingConnection::do_rpc(const std::string &request, std::ostream &response) {
+    rpc_.request = request;
+    rpc_.reply.clear();
+
+    TeeBuffer tee(rpc_.reply, response);
+    std::ostream tee_stream(&tee);
+
+    auto result = Connection::do_rpc(request, tee_stream);
+
+    const auto &times = timeline();
+    const auto end = times.completed != Timeline::TimePoint::min() ? times.completed : std::chrono::steady_clock::now();
+
+    rpc_.offset = times.started - writer_->start();
+    rpc_.duration = end - times.started;
+    rpc_.status = result.status;
+    rpc_.error = result.error;
+
+    writer_->write(rpc_);
+
+    return result;
+}
+
+// ---- ReplayConnection ----
+
+ReplayConnection::ReplayConnection(std::shared_ptr<const Capture> capture, double speed)
+    : capture_(std::move(capture)), speed_(speed)
+{}
+
+Connection::Result ReplayConnection::open(const std::string &hostname, std::uint16_t port) {
+    {
+        std::lock_guard<std::mutex> guard(interrupt_mutex_);
+        if (interrupted_)
+            return Result(ConnectionStatus::Error, "Interrupted");
+    }
+
+    rpcs_ = capture_->rpcs(hostname, port);
+    if (rpcs_ == nullptr) {
+        connected_ = false;
+        return Result(ConnectionStatus::Error,
+                      "The capture has no rpcs of " + hostname + ":" + std::to_string(port));
+    }
+
+    // a reconnect continues with the following rpcs
+    if (hostname != hostname_)
+        cursors_.clear();
+
+    hostname_ = hostname;
+    connected_ = true;
+
+    return Result();
+}
+
+void ReplayConnection::close() {
+    connected_ = false;
+}
+
+Connection::Result ReplayConnection::do_rpc(const std::string &request, std::ostream &response) {
+    timeline_ = Timeline();
+    timeline_.started = std::chrono::steady_clock::now();
+
+    if (!connected_)
+        return Result(ConnectionStatus::Disconnected);
+
+    {
+        std::lock_guard<std::mutex> guard(interrupt_mutex_);
+        if (interrupted_)
+            return Result(ConnectionStatus::Error, "Interrupted");
+    }
+
+    if (timeline_.started >= deadline_)
+        return Result(ConnectionStatus::Error, "Deadline exceeded");
+
+    std::string redacted;
+    const auto *rpc = find_(redact__(request, redacted) ? redacted : request);
+    if (rpc == nullptr)
+        return Result(ConnectionStatus::Error, "The request isn't in the capture");
+
+    timeline_.sent = std::chrono::steady_clock::now();
+
+    if (speed_ > 0 && !wait_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(rpc->duration / speed_))) {
+        close();
+        return Result(ConnectionStatus::Error, std::chrono::steady_clock::now() >= deadline_ ? "Deadline exceeded" : "Interrupted");
+    }
+
+    if (rpc->status != ConnectionStatus::Ok) {
+        if (rpc->status == ConnectionStatus::Disconnected)
+            close();
+        return Result(rpc->status, rpc->error);
+    }
+
+    timeline_.first_byte = std::chrono::steady_clock::now();
+
+    if (!response.write(rpc->reply.data(), static_cast<std::streamsize>(rpc->reply.size())))
+        return Result(ConnectionStatus::Error);
+
+    timeline_.completed = std::chrono::steady_clock::now();
+
+    return Result();
+}
+
+void ReplayConnection::deadline(std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+}
+
+void ReplayConnection::interrupt() {
+    std::lock_guard<std::mutex> guard(interrupt_mutex_);
+    interrupted_ = true;
+    interrupt_condition_.notify_all();
+}
+
+bool ReplayConnection::is_connected() const {
+    return connected_;
+}
+
+bool ReplayConnection::is_localhost() const {
+    return hostname_ == "localhost" || hostname_ == "127.0.0.1" || hostname_ == "::1";
+}
+
+const Connection::Timeline &ReplayConnection::timeline() const {
+    return timeline_;
+}
+
+const CapturedRpc *ReplayConnection::find_(const std::string &request) {
+    const auto &rpcs = capture_->rpcs();
+    const auto count = rpcs_->size();
+
+    // each request continues after the rpc it was answered with the last time,
+    // so the polls of the periodic tasks progress independently of each other
+    auto &cursor = cursors_[request];
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto index = (cursor + i) % count;
+        const auto &rpc = rpcs[(*rpcs_)[index]];
+        if (rpc.request == request) {
+            cursor = index + 1;
+            return &rpc;
+        }
+    }
+
+    cursors_.erase(request);
+    return nullptr;
+}
+
+bool ReplayConnection::wait_(std::chrono::steady_clock::duration duration) {
+    const auto until = std::chrono::steady_clock::now() + duration;
+
+    std::unique_lock<std::mutex> lock(interrupt_mutex_);
+    if (interrupt_condition_.wait_until(lock, std::min(until, deadline_), [this]() { return interrupted_; }))
+        return false;
+
+    return until <= deadline_;
+}
+
+}}
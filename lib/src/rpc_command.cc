@@ -20,8 +20,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <set>
 #include <sstream>
+#include <utility>
 
 #ifndef NDEBUG
 #include <iostream>
@@ -54,20 +56,49 @@ constexpr CommandStatus map__(ConnectionStatus status) {
     return CommandStatus::LogicError;
 }
 
+std::uint64_t nanoseconds_since__(std::chrono::steady_clock::time_point start) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
 CommandStatus do_rpc__(Connection &connection,
                        const wxml::Tree &request_tree,
                        wxml::Tree &response_tree,
-                       std::string &error_holder) {
+                       std::string &error_holder,
+                       RpcMetrics &metrics,
+                       bool *consumed = nullptr) {
     std::stringstream response;
+    const auto request = request_tree.str();
+
+    auto start = std::chrono::steady_clock::now();
+    auto rpc_result = connection.do_rpc(request, response);
 
-    auto rpc_result = connection.do_rpc(request_tree.str(), response);
+    metrics.rpcs += 1;
+    metrics.round_trip_ns += nanoseconds_since__(start);
+    // including the end of message marker
+    metrics.bytes_out += request.size() + 1;
 
     if (!rpc_result) {
         error_holder = rpc_result.error;
         return map__(rpc_result.status);
     }
 
-    if (!wxml::parse_boinc_response(response_tree, response, error_holder))
+    metrics.bytes_in += static_cast<std::uint64_t>(std::max<std::streamoff>(response.tellp(), 0));
+
+    if (rpc_result.consumed) {
+        if (consumed != nullptr) {
+            *consumed = true;
+            return CommandStatus::Ok;
+        }
+        error_holder = "The reply was consumed by the connection";
+        return CommandStatus::LogicError;
+    }
+
+    start = std::chrono::steady_clock::now();
+    bool parsed = wxml::parse_boinc_response(response_tree, response, error_holder);
+    metrics.parse_ns += nanoseconds_since__(start);
+
+    if (!parsed)
         return CommandStatus::ParsingError;
 
     if (response_tree.root.children.size() == 1
@@ -210,9 +241,10 @@ bool parse__(const wxml::Tree &response_tree, GetResultsResponse &response) {
     return true;
 }
 
-bool parse__(const wxml::Tree &response_tree, GetStatisticsResponse &response) {
+bool parse__(const wxml::Tree &response_tree, GetStatisticsResponse &response, const GetStatisticsRequest &request) {
     auto statistics_node = response_tree.root.find_child("statistics");
-    return response_tree.root.found_child(statistics_node) && parse(*statistics_node, response.statistics);
+    return response_tree.root.found_child(statistics_node)
+        && parse(*statistics_node, response.statistics, request.since, response.first_days);
 }
 
 bool parse__(const wxml::Tree &response_tree, GetGlobalPreferencesResponse &response) {
@@ -225,28 +257,38 @@ bool parse__(const wxml::Tree &response_tree, LookupAccountPollResponse &respons
     return response_tree.root.found_child(account_out_node) && parse(*account_out_node, response.account_out);
 }
 
-template<typename Response>
+// the additional arguments are passed to the parsing of the response
+template<typename Response, typename... Args>
 CommandStatus do_cmd__(Connection &connection,
                        const wxml::Tree &request_tree,
                        std::string &error_holder,
-                       Response &response) {
+                       RpcMetrics &metrics,
+                       Response &response,
+                       Args &&... args) {
     wxml::Tree response_tree;
+    bool consumed = false;
 
-    auto status = do_rpc__(connection, request_tree, response_tree, error_holder);
-    if (status != CommandStatus::Ok)
+    auto status = do_rpc__(connection, request_tree, response_tree, error_holder, metrics, &consumed);
+    if (status != CommandStatus::Ok || consumed)
         return status;
 
-    return parse__(response_tree, response) ? CommandStatus::Ok : CommandStatus::ParsingError;
+    auto start = std::chrono::steady_clock::now();
+    bool parsed = parse__(response_tree, response, std::forward<Args>(args)...);
+    metrics.parse_ns += nanoseconds_since__(start);
+
+    return parsed ? CommandStatus::Ok : CommandStatus::ParsingError;
 }
 
-template<typename Response>
+template<typename Response, typename... Args>
 CommandStatus do_cmd__(Connection &connection,
                        const char *cmd,
                        std::string &error_holder,
-                       Response &response) {
+                       RpcMetrics &metrics,
+                       Response &response,
+                       Args &&... args) {
     wxml::Tree request_tree(wxml::create_boinc_request_tree());
     request_tree.root[cmd];
-    return do_cmd__(connection, request_tree, error_holder, response);
+    return do_cmd__(connection, request_tree, error_holder, metrics, response, std::forward<Args>(args)...);
 }
 
 wxml::Tree set_mode_request__(const char *cmd, woinc::RunMode m, double duration) {
@@ -272,6 +314,10 @@ wxml::Tree set_mode_request__(const char *cmd, woinc::RunMode m, double duration
 
 namespace woinc { namespace rpc {
 
+std::string authorization_hash(const std::string &nonce, const std::string &password) {
+    return md5(nonce + password);
+}
+
 template<>
 CommandStatus AuthorizeCommand::execute(Connection &connection) {
     response_.authorized = false;
@@ -288,7 +334,7 @@ CommandStatus AuthorizeCommand::execute(Connection &connection) {
 
         wxml::Tree response_tree;
 
-        auto status = do_rpc__(connection, request_tree, response_tree, error_);
+        auto status = do_rpc__(connection, request_tree, response_tree, error_, metrics_);
         if (status != CommandStatus::Ok)
             return status;
 
@@ -301,11 +347,11 @@ CommandStatus AuthorizeCommand::execute(Connection &connection) {
 
     { // send auth2
         wxml::Tree request_tree(wxml::create_boinc_request_tree());
-        request_tree.root["auth2"]["nonce_hash"] = md5(nonce + request_.password);
+        request_tree.root["auth2"]["nonce_hash"] = authorization_hash(nonce, request_.password);
 
         wxml::Tree response_tree;
 
-        auto status = do_rpc__(connection, request_tree, response_tree, error_);
+        auto status = do_rpc__(connection, request_tree, response_tree, error_, metrics_);
         if (status != CommandStatus::Ok)
             return status;
 
@@ -323,37 +369,37 @@ CommandStatus ExchangeVersionsCommand::execute(Connection &connection) {
     request_node["minor"]   = request_.version.minor;
     request_node["release"] = request_.version.release;
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetAllProjectsListCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_all_projects_list", error_, response());
+    return do_cmd__(connection, "get_all_projects_list", error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetCCConfigCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_cc_config", error_, response());
+    return do_cmd__(connection, "get_cc_config", error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetCCStatusCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_cc_status", error_, response());
+    return do_cmd__(connection, "get_cc_status", error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetClientStateCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_state", error_, response());
+    return do_cmd__(connection, "get_state", error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetDiskUsageCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_disk_usage", error_, response());
+    return do_cmd__(connection, "get_disk_usage", error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetFileTransfersCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_file_transfers", error_, response());
+    return do_cmd__(connection, "get_file_transfers", error_, metrics_, response());
 }
 
 GetGlobalPreferencesRequest::GetGlobalPreferencesRequest(GetGlobalPrefsMode m)
@@ -374,12 +420,12 @@ CommandStatus GetGlobalPreferencesCommand::execute(Connection &connection) {
     assert(mode);
     request_tree.root[std::string("get_global_prefs_") + mode];
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetHostInfoCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_host_info", error_, response());
+    return do_cmd__(connection, "get_host_info", error_, metrics_, response());
 }
 
 template<>
@@ -390,7 +436,7 @@ CommandStatus GetMessagesCommand::execute(Connection &connection) {
     if (request_.translatable)
         request_node["translatable"];
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 template<>
@@ -399,7 +445,7 @@ CommandStatus GetNoticesCommand::execute(Connection &connection) {
     auto &request_node = request_tree.root["get_notices"];
     request_node["seqno"] = request_.seqno;
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 template<>
@@ -407,17 +453,17 @@ CommandStatus GetProjectConfigCommand::execute(Connection &connection) {
     wxml::Tree request_tree(wxml::create_boinc_request_tree());
     request_tree.root["get_project_config"]["url"] = request().url;
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetProjectConfigPollCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_project_config_poll", error_, response());
+    return do_cmd__(connection, "get_project_config_poll", error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetProjectStatusCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_project_status", error_, response());
+    return do_cmd__(connection, "get_project_status", error_, metrics_, response());
 }
 
 template<>
@@ -425,12 +471,12 @@ CommandStatus GetResultsCommand::execute(Connection &connection) {
     wxml::Tree request_tree(wxml::create_boinc_request_tree());
     request_tree.root["get_results"]["active_only"] = request_.active_only ? 1 : 0;
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 template<>
 CommandStatus GetStatisticsCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "get_statistics", error_, response());
+    return do_cmd__(connection, "get_statistics", error_, metrics_, response(), request());
 }
 
 LookupAccountRequest::LookupAccountRequest(std::string url, std::string mail, std::string password)
@@ -452,17 +498,17 @@ CommandStatus LookupAccountCommand::execute(Connection &connection) {
     cmd_node["server_assigned_cookie"] = request().server_assigned_cookie ? 1 : 0;
     cmd_node["server_cookie"] = request().server_cookie;
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 template<>
 CommandStatus LookupAccountPollCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "lookup_account_poll", error_, response());
+    return do_cmd__(connection, "lookup_account_poll", error_, metrics_, response());
 }
 
 template<>
 CommandStatus NetworkAvailableCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "network_available", error_, response());
+    return do_cmd__(connection, "network_available", error_, metrics_, response());
 }
 
 ProjectAttachRequest::ProjectAttachRequest(std::string url, std::string auth, std::string project)
@@ -480,7 +526,7 @@ CommandStatus ProjectAttachCommand::execute(Connection &connection) {
     cmd_node["authenticator"] = request().authenticator;
     cmd_node["project_name"] = request().project_name;
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 ProjectOpRequest::ProjectOpRequest(ProjectOp o, std::string url)
@@ -509,27 +555,27 @@ CommandStatus ProjectOpCommand::execute(Connection &connection) {
     auto &cmd_node = request_tree.root[std::string("project_") + std::string(op)];
     cmd_node["project_url"] = request().master_url;
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 template<>
 CommandStatus QuitCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "quit", error_, response());
+    return do_cmd__(connection, "quit", error_, metrics_, response());
 }
 
 template<>
 CommandStatus ReadCCConfigCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "read_cc_config", error_, response());
+    return do_cmd__(connection, "read_cc_config", error_, metrics_, response());
 }
 
 template<>
 CommandStatus ReadGlobalPreferencesOverrideCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "read_global_prefs_override", error_, response());
+    return do_cmd__(connection, "read_global_prefs_override", error_, metrics_, response());
 }
 
 template<>
 CommandStatus RunBenchmarksCommand::execute(Connection &connection) {
-    return do_cmd__(connection, "run_benchmarks", error_, response());
+    return do_cmd__(connection, "run_benchmarks", error_, metrics_, response());
 }
 
 template<>
@@ -541,7 +587,7 @@ CommandStatus SetCCConfigCommand::execute(Connection &connection) {
     {
         wxml::Tree request_tree(wxml::create_boinc_request_tree());
         request_tree.root["get_cc_config"];
-        auto status = do_rpc__(connection, request_tree, current_ccc_tree, error_);
+        auto status = do_rpc__(connection, request_tree, current_ccc_tree, error_, metrics_);
         if (status != CommandStatus::Ok)
             return status;
     }
@@ -623,7 +669,7 @@ CommandStatus SetCCConfigCommand::execute(Connection &connection) {
         log_flags_tree[flag.name] = flag.value;
     }
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 SetGpuModeRequest::SetGpuModeRequest(RunMode m, double d)
@@ -634,6 +680,7 @@ CommandStatus SetGpuModeCommand::execute(Connection &connection) {
     return do_cmd__(connection,
                     set_mode_request__("set_gpu_mode", request().mode, request().duration),
                     error_,
+                    metrics_,
                     response());
 }
 
@@ -645,6 +692,7 @@ CommandStatus SetNetworkModeCommand::execute(Connection &connection) {
     return do_cmd__(connection,
                     set_mode_request__("set_network_mode", request().mode, request().duration),
                     error_,
+                    metrics_,
                     response());
 }
 
@@ -656,6 +704,7 @@ CommandStatus SetRunModeCommand::execute(Connection &connection) {
     return do_cmd__(connection,
                     set_mode_request__("set_run_mode", request().mode, request().duration),
                     error_,
+                    metrics_,
                     response());
 }
 
@@ -682,7 +731,7 @@ CommandStatus TaskOpCommand::execute(Connection &connection) {
     cmd_node["project_url"] = request().master_url;
     cmd_node["name"] = request().name;
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 FileTransferOpRequest::FileTransferOpRequest(FileTransferOp o, std::string url, std::string n)
@@ -707,7 +756,7 @@ CommandStatus FileTransferOpCommand::execute(Connection &connection) {
     cmd_node["project_url"] = request().master_url;
     cmd_node["filename"] = request().filename;
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 template<>
@@ -804,7 +853,7 @@ CommandStatus SetGlobalPreferencesCommand::execute(Connection &connection) {
         }
     }
 
-    return do_cmd__(connection, request_tree, error_, response());
+    return do_cmd__(connection, request_tree, error_, metrics_, response());
 }
 
 }}
@@ -18,7 +18,9 @@
 
 #include <woinc/rpc_connection.h>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <limits>
 #include <sstream>
 
@@ -32,6 +34,7 @@
 namespace {
     constexpr char EOM__ = 0x03;
     constexpr std::size_t BUFFER_SIZE__ = 32 * 1024;
+    constexpr std::chrono::milliseconds DEFAULT_TIMEOUT__ = std::chrono::seconds(10);
 }
 
 namespace woinc { namespace rpc {
@@ -45,43 +48,69 @@ class WOINC_LOCAL Connection::Impl {
 
         Connection::Result do_rpc(const std::string &request, std::ostream &response);
 
+        void deadline(std::chrono::steady_clock::time_point deadline);
+        void interrupt();
+
+        bool is_connected() const;
         bool is_localhost() const;
 
+        const Connection::Timeline &timeline() const { return timeline_; }
+
     private:
+        // limits the socket timeout to the deadline; returns false if the deadline has passed
+        bool arm_timeout_();
+        Connection::Result abort_(Connection::Result result);
+
+    private:
+        // declared before the socket which uses it
+        woinc::SocketInterrupter interrupter_;
         std::unique_ptr<woinc::Socket> socket_;
         bool connected_ = false;
+
+        std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+
+        Connection::Timeline timeline_;
 };
 
 Connection::Result Connection::Impl::open(const std::string &hostname, std::uint16_t port) {
     if (connected_)
         close();
 
+    if (interrupter_.triggered())
+        return Result(ConnectionStatus::Error, "Interrupted");
+
     // let the network stack decide which version to use
 
-    socket_ = Socket::create(Socket::Version::All);
+    socket_ = Socket::create(Socket::Version::All, &interrupter_);
 
-    if (socket_ && socket_->connect(hostname, port))
+    if (socket_ && socket_->connect(hostname, port)) {
+        connected_ = true;
         return Result();
+    }
 
     // network stack doesn't support Version::ALL, so let't try which one to use
 
-    socket_ = Socket::create(Socket::Version::IPv6);
+    socket_ = Socket::create(Socket::Version::IPv6, &interrupter_);
 
     std::string error_msg;
 
     if (socket_.get() != nullptr) {
         Socket::Result result_connect = socket_->connect(hostname, port);
-        if (result_connect)
+        if (result_connect) {
+            connected_ = true;
             return Result();
+        }
         error_msg = std::move(result_connect.error);
     }
 
-    socket_ = Socket::create(Socket::Version::IPv4);
+    socket_ = Socket::create(Socket::Version::IPv4, &interrupter_);
 
     if (socket_.get() != nullptr) {
         Socket::Result result_connect = socket_->connect(hostname, port);
-        if (result_connect)
+        if (result_connect) {
+            connected_ = true;
             return Result();
+        }
         error_msg = std::move(result_connect.error);
     }
 
@@ -103,14 +132,25 @@ Connection::Result Connection::Impl::do_rpc(const std::string &request, std::ost
         << "------------- END REQUEST ------------\n";
 #endif
 
+    timeline_ = Connection::Timeline();
+    timeline_.started = std::chrono::steady_clock::now();
+
+    if (!connected_)
+        return Result(ConnectionStatus::Disconnected);
+
+    if (!arm_timeout_())
+        return Result(ConnectionStatus::Error, "Deadline exceeded");
+
     {
         Socket::Result result = socket_->send(request.c_str(), request.size());
         if (!result)
-            return Result(ConnectionStatus::Error, std::move(result.error));
+            return abort_(Result(ConnectionStatus::Error, std::move(result.error)));
 
         result = socket_->send(&EOM__, sizeof(EOM__));
         if (!result)
-            return Result(ConnectionStatus::Error, std::move(result.error));
+            return abort_(Result(ConnectionStatus::Error, std::move(result.error)));
+
+        timeline_.sent = std::chrono::steady_clock::now();
     }
 
 #ifdef WOINC_LOG_RPC_CONNECTION
@@ -121,14 +161,20 @@ Connection::Result Connection::Impl::do_rpc(const std::string &request, std::ost
     while (!eom) {
         size_t bytes_read = 0;
 
+        if (!arm_timeout_())
+            return abort_(Result(ConnectionStatus::Error, "Deadline exceeded"));
+
         {
             Socket::Result result = socket_->receive(buffer, BUFFER_SIZE__, bytes_read);
             if (!result)
-                return Result(ConnectionStatus::Error, std::move(result.error));
+                return abort_(Result(ConnectionStatus::Error, std::move(result.error)));
         }
 
         if (bytes_read == 0)
-            return Result(ConnectionStatus::Disconnected);
+            return abort_(Result(ConnectionStatus::Disconnected));
+
+        if (timeline_.first_byte == std::chrono::steady_clock::time_point::min())
+            timeline_.first_byte = std::chrono::steady_clock::now();
 
 #ifdef WOINC_LOG_RPC_CONNECTION
         std::cerr.write(buffer, bytes_read);
@@ -150,9 +196,44 @@ Connection::Result Connection::Impl::do_rpc(const std::string &request, std::ost
     std::cerr << "------------- END RESPONSE ------------" << std::endl;
 #endif
 
+    timeline_.completed = std::chrono::steady_clock::now();
+
     return Result();
 }
 
+void Connection::Impl::deadline(std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+}
+
+void Connection::Impl::interrupt() {
+    interrupter_.trigger();
+}
+
+bool Connection::Impl::is_connected() const {
+    return connected_;
+}
+
+bool Connection::Impl::arm_timeout_() {
+    auto timeout = DEFAULT_TIMEOUT__;
+
+    if (deadline_ != std::chrono::steady_clock::time_point::max()) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline_ - std::chrono::steady_clock::now());
+        if (remaining <= std::chrono::milliseconds::zero())
+            return false;
+        timeout = std::min(timeout, remaining);
+    }
+
+    socket_->timeout(timeout);
+
+    return true;
+}
+
+Connection::Result Connection::Impl::abort_(Connection::Result result) {
+    // the rest of the reply may still arrive, so the connection is out of sync
+    close();
+    return result;
+}
+
 bool Connection::Impl::is_localhost() const {
     return socket_->is_localhost();
 }
@@ -179,6 +260,22 @@ Connection::Result Connection::do_rpc(const std::string &request, std::ostream &
     return impl_->do_rpc(request, response);
 }
 
+void Connection::deadline(std::chrono::steady_clock::time_point deadline) {
+    impl_->deadline(deadline);
+}
+
+void Connection::interrupt() {
+    impl_->interrupt();
+}
+
+bool Connection::is_connected() const {
+    return impl_->is_connected();
+}
+
+const Connection::Timeline &Connection::timeline() const {
+    return impl_->timeline();
+}
+
 bool Connection::is_localhost() const {
     return impl_->is_localhost();
 }
@@ -22,12 +22,14 @@
 #include <cassert>
 #include <cmath>
 #include <iterator>
+#include <map>
 #include <sstream>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #ifndef NDEBUG
 #include <iostream>
-#include <map>
 #endif
 
 /*
@@ -855,6 +857,35 @@ void parse_(const woinc::xml::Node &node, woinc::ProjectStatistics &project_stat
     }
 }
 
+void parse_(const woinc::xml::Node &node, woinc::ProjectStatistics &project_statistics,
+            const std::map<std::string, time_t> &since, time_t &first_day) {
+    WOINC_PARSE_CHILD_CONTENT(node, project_statistics, master_url);
+
+    auto known = since.find(project_statistics.master_url);
+    first_day = 0;
+    bool first = true;
+
+    for (const auto &child : node.children) {
+        if (child.tag != "daily_statistics")
+            continue;
+
+        // only the day of a skipped one is parsed
+        woinc::DailyStatistic stats;
+        WOINC_PARSE_CHILD_CONTENT(child, stats, day);
+
+        if (first) {
+            first_day = stats.day;
+            first = false;
+        }
+
+        if (known != since.end() && stats.day < known->second)
+            continue;
+
+        parse_(child, stats);
+        project_statistics.daily_statistics.push_back(std::move(stats));
+    }
+}
+
 void parse_(const woinc::xml::Node &node, woinc::ProxyInfo &proxy_info) {
     WOINC_PARSE_CHILD_CONTENT(node, proxy_info, socks5_remote_dns);
     WOINC_PARSE_CHILD_CONTENT(node, proxy_info, use_http_authentication);
@@ -881,6 +912,19 @@ void parse_(const woinc::xml::Node &node, woinc::Statistics &statistics) {
     }
 }
 
+void parse_(const woinc::xml::Node &node, woinc::Statistics &statistics,
+            const std::map<std::string, time_t> &since, std::vector<time_t> &first_days) {
+    for (const auto &child : node.children) {
+        if (child.tag == "project_statistics") {
+            woinc::ProjectStatistics stats;
+            time_t first_day;
+            parse_(child, stats, since, first_day);
+            statistics.push_back(std::move(stats));
+            first_days.push_back(first_day);
+        }
+    }
+}
+
 // see RESULT::write_gui() in BOINC/client/result.cpp
 void parse_(const wxml::Node &node, woinc::Task &task) {
     WOINC_PARSE_CHILD_CONTENT(node, task, state);
@@ -980,10 +1024,10 @@ void parse_(const wxml::Node &node, woinc::Workunit &workunit) {
 #endif // WOINC_EXPOSE_FULL_STRUCTURES
 }
 
-template<typename Type>
-bool wrapped_parse_(const woinc::xml::Node &node, Type &t) {
+template<typename Type, typename... Args>
+bool wrapped_parse_(const woinc::xml::Node &node, Type &t, Args &&... args) {
     try {
-        parse_(node, t);
+        parse_(node, t, std::forward<Args>(args)...);
     } catch (...) {
         return false;
     }
@@ -1008,6 +1052,9 @@ bool parse(const woinc::xml::Node &node, woinc::Notice &t) { return wrapped_pars
 bool parse(const woinc::xml::Node &node, woinc::Project &t) { return wrapped_parse_(node, t); }
 bool parse(const woinc::xml::Node &node, woinc::ProjectConfig &t) { return wrapped_parse_(node, t); }
 bool parse(const woinc::xml::Node &node, woinc::Statistics &t) { return wrapped_parse_(node, t); }
+bool parse(const woinc::xml::Node &node, woinc::Statistics &t, const std::map<std::string, time_t> &since, std::vector<time_t> &first_days) {
+    return wrapped_parse_(node, t, since, first_days);
+}
 bool parse(const woinc::xml::Node &node, woinc::Task &t) { return wrapped_parse_(node, t); }
 bool parse(const woinc::xml::Node &node, woinc::Version &t) { return wrapped_parse_(node, t); }
 bool parse(const woinc::xml::Node &node, woinc::Workunit &t) { return wrapped_parse_(node, t); }
@@ -19,6 +19,10 @@
 #ifndef WOINC_RPC_PARSING_H_
 #define WOINC_RPC_PARSING_H_
 
+#include <map>
+#include <string>
+#include <vector>
+
 #include <woinc/types.h>
 
 #include "visibility.h"
@@ -40,6 +44,9 @@ bool WOINC_LOCAL parse(const woinc::xml::Node &node, woinc::Notice &notice);
 bool WOINC_LOCAL parse(const woinc::xml::Node &node, woinc::Project &project);
 bool WOINC_LOCAL parse(const woinc::xml::Node &node, woinc::ProjectConfig &project_config);
 bool WOINC_LOCAL parse(const woinc::xml::Node &node, woinc::Statistics &statistics);
+// skips the days before the day of the project in since, see GetStatisticsRequest
+bool WOINC_LOCAL parse(const woinc::xml::Node &node, woinc::Statistics &statistics,
+                       const std::map<std::string, time_t> &since, std::vector<time_t> &first_days);
 bool WOINC_LOCAL parse(const woinc::xml::Node &node, woinc::Task &task);
 bool WOINC_LOCAL parse(const woinc::xml::Node &node, woinc::Version &version);
 bool WOINC_LOCAL parse(const woinc::xml::Node &node, woinc::Workunit &workunit);
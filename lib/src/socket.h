@@ -19,6 +19,8 @@
 #ifndef WOINC_SOCKET_H_
 #define WOINC_SOCKET_H_
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -32,11 +34,35 @@
 
 namespace woinc {
 
+// Wakes up the blocking calls of the sockets created with it and lets all their following calls fail
+// with Status::Interrupted. It's the only part of the sockets which may be used by any thread.
+class WOINC_LOCAL SocketInterrupter {
+    public:
+        SocketInterrupter();
+        ~SocketInterrupter();
+
+        SocketInterrupter(const SocketInterrupter &) = delete;
+        SocketInterrupter &operator=(const SocketInterrupter &) = delete;
+
+        void trigger();
+        bool triggered() const;
+
+    private:
+        friend struct Socket;
+
+        std::atomic<bool> triggered_;
+#ifdef WOINC_USE_POSIX_SOCKETS
+        // an eventfd or, where not available, a self-pipe; the sockets poll the read end
+        int read_fd_;
+        int write_fd_;
+#endif
+};
+
 // We only provide TCP sockets by this interface
 struct WOINC_LOCAL Socket {
     public:
         enum class Version { All, IPv4, IPv6 };
-        enum class Status { Ok, NotConnected, AlreadyConnected, ResolvingError, SocketError };
+        enum class Status { Ok, NotConnected, AlreadyConnected, ResolvingError, SocketError, Interrupted };
 
         struct Result {
             Status status;
@@ -52,7 +78,7 @@ struct WOINC_LOCAL Socket {
 
 #ifdef WOINC_USE_POSIX_SOCKETS
     protected:
-        explicit Socket(int version);
+        Socket(int version, const SocketInterrupter *interrupter);
 #endif
 
     public:
@@ -68,15 +94,25 @@ struct WOINC_LOCAL Socket {
         Result send(const void *data, std::size_t length);
         Result receive(void *buffer, std::size_t max_length, std::size_t &bytes_read);
 
+        // timeout for each following connect, send and receive call, at least one millisecond
+        Result timeout(std::chrono::milliseconds value);
+
         bool is_localhost() const;
 
     public:
-        static std::unique_ptr<Socket> create(Version v);
+        // the interrupter, if any, has to outlive the socket
+        static std::unique_ptr<Socket> create(Version v, const SocketInterrupter *interrupter = nullptr);
 
 #ifdef WOINC_USE_POSIX_SOCKETS
+    private:
+        // waits until the socket is ready for the events, the timeout passed or the interrupter got triggered
+        Result wait_(short events);
+
     private:
         const int version_;
+        const SocketInterrupter *interrupter_;
         int socket_ = -1;
+        std::chrono::milliseconds timeout_ = std::chrono::seconds(10);
 
         bool connected_ = false;
         bool is_localhost_ = false;
@@ -21,24 +21,94 @@
 #ifdef WOINC_USE_POSIX_SOCKETS
 
 extern "C" {
+#include <fcntl.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 } // extern "C"
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <cstdint>
 #include <cstring>
+#include <limits>
 
 #ifndef NDEBUG
 #include <iostream>
 #endif
 
+namespace {
+
+bool set_non_blocking__(int fd) {
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags != -1 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+bool would_block__() {
+#if EAGAIN != EWOULDBLOCK
+    if (errno == EWOULDBLOCK)
+        return true;
+#endif
+    return errno == EAGAIN || errno == EINTR;
+}
+
+}
+
 namespace woinc {
 
-Socket::Socket(int version) : version_(version) {}
+// ---- SocketInterrupter ----
+
+SocketInterrupter::SocketInterrupter() : triggered_(false), read_fd_(-1), write_fd_(-1) {
+#ifdef __linux__
+    // an eventfd needs only one descriptor, which matters with a few connections per host and many hosts
+    read_fd_ = write_fd_ = ::eventfd(0, EFD_CLOEXEC);
+    if (read_fd_ != -1)
+        return;
+#endif
+
+    // without the pipe the blocking calls wait for their timeout, but the following ones still fail fast
+    int fds[2];
+    if (::pipe(fds) == 0) {
+        ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        read_fd_ = fds[0];
+        write_fd_ = fds[1];
+    }
+}
+
+SocketInterrupter::~SocketInterrupter() {
+    if (read_fd_ != -1)
+        ::close(read_fd_);
+    if (write_fd_ != -1 && write_fd_ != read_fd_)
+        ::close(write_fd_);
+}
+
+void SocketInterrupter::trigger() {
+    // the value is never read, so the descriptor stays readable and wakes up all following polls as well;
+    // an eventfd requires writing 8 bytes, which is fine for the pipe as well
+    if (!triggered_.exchange(true) && write_fd_ != -1) {
+        const std::uint64_t value = 1;
+        while (::write(write_fd_, &value, sizeof(value)) == -1 && errno == EINTR);
+    }
+}
+
+bool SocketInterrupter::triggered() const {
+    return triggered_.load();
+}
+
+// ---- Socket ----
+
+Socket::Socket(int version, const SocketInterrupter *interrupter)
+    : version_(version), interrupter_(interrupter) {}
 
 Socket::~Socket() {
     close();
@@ -48,6 +118,9 @@ Socket::Result Socket::connect(const std::string &host, std::uint16_t port) {
     if (connected_)
         return Result(Status::AlreadyConnected);
 
+    if (interrupter_ != nullptr && interrupter_->triggered())
+        return Result(Status::Interrupted, "Interrupted");
+
     addrinfo hints;
     addrinfo *result;
 
@@ -67,13 +140,33 @@ Socket::Result Socket::connect(const std::string &host, std::uint16_t port) {
 
     // we got a list of addresses to connect to, try to connect to one of them
 
+    Result error(Status::SocketError, "Could not connect to " + host);
+
     for (auto *rp = result; rp != nullptr; rp = rp->ai_next) {
 
         if ((socket_ = ::socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol)) == -1)
             continue;
 
-        if (::connect(socket_, rp->ai_addr, rp->ai_addrlen) == -1) {
+        // connect non-blocking to be able to limit and interrupt the connect, the socket stays non-blocking
+        if (!set_non_blocking__(socket_)
+                || (::connect(socket_, rp->ai_addr, rp->ai_addrlen) == -1 && errno != EINPROGRESS)) {
+            ::close(socket_);
+            continue;
+        }
+
+        Result ready = wait_(POLLOUT);
+
+        int socket_error = 0;
+        socklen_t length = sizeof(socket_error);
+        if (ready && ::getsockopt(socket_, SOL_SOCKET, SO_ERROR, &socket_error, &length) == 0 && socket_error != 0)
+            ready = Result(Status::SocketError, strerror(socket_error));
+
+        if (!ready) {
             ::close(socket_);
+            if (ready.status == Status::Interrupted) {
+                error = std::move(ready);
+                break;
+            }
             continue;
         }
 
@@ -89,25 +182,18 @@ Socket::Result Socket::connect(const std::string &host, std::uint16_t port) {
                 is_localhost_ = std::string(addr) == "::1";
         }
 
+        // the request and its end of message marker are sent separately, so without disabling
+        // Nagle's algorithm the marker waits for the delayed ack of the client on a reused connection
+        int no_delay = 1;
+        ::setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
         connected_ = true;
         break;
     }
 
     ::freeaddrinfo(result);
 
-    if (!connected_) {
-        return Result(Status::SocketError, "Could not connect to " + host);
-    } else {
-        // set 10s timeouts for reads and writes
-        timeval timeout;
-        timeout.tv_sec = 10;
-        timeout.tv_usec = 0;
-
-        setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-        setsockopt(socket_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
-
-        return Result();
-    }
+    return connected_ ? Result() : error;
 }
 
 void Socket::close() {
@@ -122,13 +208,28 @@ Socket::Result Socket::send(const void *data, std::size_t length) {
     if (!connected_)
         return Result(Status::NotConnected);
 
-    ssize_t bytes_sent = ::send(socket_, data, length, MSG_NOSIGNAL);
+    const char *bytes = static_cast<const char *>(data);
 
-    if (bytes_sent < 0)
-        return Result(Status::SocketError, strerror(errno));
+    // only wait if the send buffer is full, so the common case costs a single syscall
+    while (length > 0) {
+        if (interrupter_ != nullptr && interrupter_->triggered())
+            return Result(Status::Interrupted, "Interrupted");
+
+        ssize_t bytes_sent = ::send(socket_, bytes, length, MSG_NOSIGNAL);
 
-    if (static_cast<size_t>(bytes_sent) != length)
-        return Result(Status::SocketError);
+        if (bytes_sent < 0) {
+            if (!would_block__())
+                return Result(Status::SocketError, strerror(errno));
+
+            Result ready = wait_(POLLOUT);
+            if (!ready)
+                return ready;
+            continue;
+        }
+
+        bytes += bytes_sent;
+        length -= static_cast<std::size_t>(bytes_sent);
+    }
 
     return Result();
 }
@@ -137,12 +238,61 @@ Socket::Result Socket::receive(void *buffer, std::size_t max_length, std::size_t
     if (!connected_)
         return Result(Status::NotConnected);
 
-    ssize_t read = ::recv(socket_, buffer, max_length, 0);
+    while (true) {
+        if (interrupter_ != nullptr && interrupter_->triggered())
+            return Result(Status::Interrupted, "Interrupted");
+
+        ssize_t read = ::recv(socket_, buffer, max_length, 0);
+
+        if (read >= 0) {
+            bytes_read = static_cast<size_t>(read);
+            return Result();
+        }
+
+        if (!would_block__())
+            return Result(Status::SocketError, strerror(errno));
+
+        Result ready = wait_(POLLIN);
+        if (!ready)
+            return ready;
+    }
+}
+
+Socket::Result Socket::timeout(std::chrono::milliseconds value) {
+    if (!connected_)
+        return Result(Status::NotConnected);
+
+    // a zero timeout wouldn't wait at all
+    timeout_ = std::max(value, std::chrono::milliseconds(1));
 
-    if (read < 0)
+    return Result();
+}
+
+Socket::Result Socket::wait_(short events) {
+    pollfd fds[2];
+    fds[0].fd = socket_;
+    fds[0].events = events;
+    fds[0].revents = 0;
+    // poll ignores negative descriptors, i.e. a missing interrupter or descriptor
+    fds[1].fd = interrupter_ != nullptr ? interrupter_->read_fd_ : -1;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    const auto timeout = static_cast<int>(std::min<std::chrono::milliseconds::rep>(
+        timeout_.count(), std::numeric_limits<int>::max()));
+
+    int ready;
+    while ((ready = ::poll(fds, 2, timeout)) == -1 && errno == EINTR);
+
+    if (ready == -1)
         return Result(Status::SocketError, strerror(errno));
 
-    bytes_read = static_cast<size_t>(read);
+    if (fds[1].revents != 0 || (interrupter_ != nullptr && interrupter_->triggered()))
+        return Result(Status::Interrupted, "Interrupted");
+
+    if (ready == 0)
+        return Result(Status::SocketError, "Timeout");
+
     return Result();
 }
 
@@ -150,14 +300,14 @@ bool Socket::is_localhost() const {
     return is_localhost_;
 }
 
-std::unique_ptr<Socket> Socket::create(Socket::Version v) {
+std::unique_ptr<Socket> Socket::create(Socket::Version v, const SocketInterrupter *interrupter) {
     switch (v) {
         case Version::All:
-            return std::unique_ptr<Socket>(new Socket(AF_UNSPEC));
+            return std::unique_ptr<Socket>(new Socket(AF_UNSPEC, interrupter));
         case Version::IPv4:
-            return std::unique_ptr<Socket>(new Socket(AF_INET));
+            return std::unique_ptr<Socket>(new Socket(AF_INET, interrupter));
         case Version::IPv6:
-            return std::unique_ptr<Socket>(new Socket(AF_INET6));
+            return std::unique_ptr<Socket>(new Socket(AF_INET6, interrupter));
         /* no default to get warnings on compile time when Version has been changed */
     }
     assert(false);
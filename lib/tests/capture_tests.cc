@@ -0,0 +1,227 @@
+/* tests/capture_tests.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "test.h"
+#include "woinc_assert.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include <sys/stat.h>
+
+#include <woinc/rpc_capture.h>
+
+static void test_round_trip();
+static void test_truncated();
+static void test_replay_order();
+static void test_replay_unknown();
+static void test_replay_deadline();
+static void test_authorization();
+
+void get_tests(Tests &tests) {
+    tests["001 - Write and read a capture"]     = test_round_trip;
+    tests["002 - Read a truncated capture"]     = test_truncated;
+    tests["003 - Replay in the recorded order"] = test_replay_order;
+    tests["004 - Replay unknown hosts/requests"] = test_replay_unknown;
+    tests["005 - Replay with a deadline"]       = test_replay_deadline;
+    tests["006 - Capture an authorization"]     = test_authorization;
+}
+
+namespace {
+
+const char *PATH__ = "capture_tests.capture";
+
+woinc::rpc::CapturedRpc rpc__(std::string host, std::uint16_t port, std::string request, std::string reply,
+                              std::chrono::milliseconds duration = std::chrono::milliseconds(1)) {
+    woinc::rpc::CapturedRpc rpc;
+    rpc.host = std::move(host);
+    rpc.port = port;
+    rpc.duration = duration;
+    rpc.request = std::move(request);
+    rpc.reply = std::move(reply);
+    return rpc;
+}
+
+std::shared_ptr<const woinc::rpc::Capture> capture__(const std::vector<woinc::rpc::CapturedRpc> &rpcs) {
+    {
+        woinc::rpc::CaptureWriter writer(PATH__);
+        for (const auto &rpc : rpcs)
+            writer.write(rpc);
+        assert_true("Writing the capture failed", writer.good());
+    }
+
+    auto capture = std::make_shared<woinc::rpc::Capture>();
+    assert_true("Reading the capture failed", capture->read(PATH__));
+    std::remove(PATH__);
+
+    return capture;
+}
+
+std::string replay__(woinc::rpc::Connection &connection, const std::string &request) {
+    std::ostringstream reply;
+    auto result = connection.do_rpc(request, reply);
+    assert_true("Replaying \"" + request + "\" failed: " + result.error, result);
+    return reply.str();
+}
+
+}
+
+void test_round_trip() {
+    std::vector<woinc::rpc::CapturedRpc> rpcs = {
+        rpc__("host1", 31416, "<get_cc_status/>", "<cc_status/>"),
+        rpc__("host2", 31417, "<get_cc_status/>", "<cc_status>2</cc_status>", std::chrono::milliseconds(3)),
+        rpc__("host1", 31416, "<get_results/>", std::string(100000, 'x')),
+        rpc__("host1", 31416, "<get_cc_status/>", ""),
+    };
+    rpcs[1].offset = std::chrono::milliseconds(5);
+    rpcs[2].offset = std::chrono::milliseconds(2);
+    rpcs[3].offset = std::chrono::milliseconds(7);
+    rpcs[3].status = woinc::rpc::ConnectionStatus::Error;
+    rpcs[3].error = "Connection reset";
+
+    auto capture = capture__(rpcs);
+
+    assert_equals("Number of rpcs", capture->rpcs().size(), 4);
+    for (std::size_t i = 0; i < rpcs.size(); ++i) {
+        const auto &rpc = capture->rpcs()[i];
+        assert_equals("Host", rpc.host, rpcs[i].host);
+        assert_equals("Port", rpc.port, rpcs[i].port);
+        assert_equals("Offset", rpc.offset.count(), rpcs[i].offset.count());
+        assert_equals("Duration", rpc.duration.count(), rpcs[i].duration.count());
+        assert_equals("Status", rpc.status, rpcs[i].status);
+        assert_equals("Error", rpc.error, rpcs[i].error);
+        assert_equals("Request", rpc.request, rpcs[i].request);
+        assert_equals("Reply", rpc.reply, rpcs[i].reply);
+    }
+
+    assert_equals("Rpcs of host1", capture->rpcs("host1", 31416)->size(), 3);
+    assert_equals("Rpcs of host2", capture->rpcs("host2", 31417)->size(), 1);
+    assert_true("Rpcs of an unknown port", capture->rpcs("host2", 31416) == nullptr);
+}
+
+void test_truncated() {
+    {
+        woinc::rpc::CaptureWriter writer(PATH__);
+        writer.write(rpc__("host", 31416, "<get_cc_status/>", "<cc_status/>"));
+        writer.write(rpc__("host", 31416, "<get_results/>", "<results/>"));
+    }
+
+    std::string content;
+    {
+        std::ifstream in(PATH__, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream out(PATH__, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), static_cast<std::streamsize>(content.size() - 3));
+    }
+
+    woinc::rpc::Capture capture;
+    assert_false("Reading a truncated capture succeeded", capture.read(PATH__));
+    assert_equals("Number of complete rpcs", capture.rpcs().size(), 1);
+
+    std::remove(PATH__);
+
+    std::istringstream garbage("not a capture");
+    assert_false("Reading garbage succeeded", capture.read(garbage));
+}
+
+void test_replay_order() {
+    auto capture = capture__({
+        rpc__("host", 31416, "<get_cc_status/>", "status1"),
+        rpc__("host", 31416, "<get_results/>", "results1"),
+        rpc__("host", 31416, "<get_cc_status/>", "status2"),
+        rpc__("host", 31416, "<get_results/>", "results2"),
+        rpc__("host", 31416, "<get_cc_status/>", "status3"),
+    });
+
+    woinc::rpc::ReplayConnection connection(capture, 0);
+    assert_true("Opening the connection failed", connection.open("host", 31416));
+
+    // the requests progress independently of each other and start over when used up
+    assert_equals("", replay__(connection, "<get_cc_status/>"), std::string("status1"));
+    assert_equals("", replay__(connection, "<get_cc_status/>"), std::string("status2"));
+    assert_equals("", replay__(connection, "<get_results/>"), std::string("results1"));
+    assert_equals("", replay__(connection, "<get_cc_status/>"), std::string("status3"));
+    assert_equals("", replay__(connection, "<get_cc_status/>"), std::string("status1"));
+    assert_equals("", replay__(connection, "<get_results/>"), std::string("results2"));
+    assert_equals("", replay__(connection, "<get_results/>"), std::string("results1"));
+}
+
+void test_replay_unknown() {
+    auto capture = capture__({rpc__("host", 31416, "<get_cc_status/>", "status")});
+
+    woinc::rpc::ReplayConnection connection(capture, 0);
+    assert_false("Opening an unknown host succeeded", connection.open("other", 31416));
+    assert_false("Opening an unknown port succeeded", connection.open("host", 1));
+
+    std::ostringstream reply;
+    assert_equals("Status without connection", connection.do_rpc("<get_cc_status/>", reply).status,
+                  woinc::rpc::ConnectionStatus::Disconnected);
+
+    assert_true("Opening the connection failed", connection.open("host", 31416));
+    assert_equals("Status of an unknown request", connection.do_rpc("<get_results/>", reply).status,
+                  woinc::rpc::ConnectionStatus::Error);
+
+    connection.interrupt();
+    assert_false("Rpc after interrupt succeeded", connection.do_rpc("<get_cc_status/>", reply));
+}
+
+void test_replay_deadline() {
+    auto capture = capture__({rpc__("host", 31416, "<get_cc_status/>", "status", std::chrono::seconds(10))});
+
+    // the recorded ten seconds are replayed within 10 ms
+    woinc::rpc::ReplayConnection fast(capture, 1000);
+    assert_true("Opening the connection failed", fast.open("host", 31416));
+    assert_equals("", replay__(fast, "<get_cc_status/>"), std::string("status"));
+
+    woinc::rpc::ReplayConnection slow(capture, 1);
+    assert_true("Opening the connection failed", slow.open("host", 31416));
+    slow.deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(10));
+
+    std::ostringstream reply;
+    auto result = slow.do_rpc("<get_cc_status/>", reply);
+    assert_false("Rpc beyond the deadline succeeded", result);
+    assert_equals("Error", result.error, std::string("Deadline exceeded"));
+    assert_false("Connection still open after an aborted rpc", slow.is_connected());
+}
+
+void test_authorization() {
+    {
+        woinc::rpc::CaptureWriter writer(PATH__);
+        writer.write(rpc__("host", 31416, "<auth1/>", "<nonce>1.2</nonce>"));
+        writer.write(rpc__("host", 31416, "<auth2>\n<nonce_hash>0123456789abcdef</nonce_hash>\n</auth2>", "<authorized/>"));
+        assert_true("Writing the capture failed", writer.good());
+    }
+
+    struct stat file_stat;
+    assert_true("Stat of the capture failed", ::stat(PATH__, &file_stat) == 0);
+    assert_equals("Permissions of the capture", static_cast<int>(file_stat.st_mode & 0777), 0600);
+
+    auto capture = std::make_shared<woinc::rpc::Capture>();
+    assert_true("Reading the capture failed", capture->read(PATH__));
+    std::remove(PATH__);
+
+    assert_equals("Redacted request", capture->rpcs()[1].request, std::string("<auth2>\n<nonce_hash>redacted</nonce_hash>\n</auth2>"));
+
+    woinc::rpc::ReplayConnection connection(capture, 0);
+    assert_true("Opening the replay failed", connection.open("host", 31416));
+    assert_equals("Replayed nonce", replay__(connection, "<auth1/>"), std::string("<nonce>1.2</nonce>"));
+    assert_equals("Replayed authorization", replay__(connection, "<auth2>\n<nonce_hash>fedcba9876543210</nonce_hash>\n</auth2>"),
+                  std::string("<authorized/>"));
+}
@@ -19,6 +19,10 @@
 #include "test.h"
 #include "woinc_assert.h"
 
+#include <map>
+#include <vector>
+
+#include "../src/rpc_parsing.h"
 #include "../src/xml.h"
 
 static void test_node_empty();
@@ -43,6 +47,11 @@ static void test_create_boinc_request_tree();
 static void test_parse_boinc_response_positive();
 static void test_parse_boinc_response_negative();
 
+static void test_parse_statistics_complete();
+static void test_parse_statistics_since();
+static void test_parse_statistics_unknown_project();
+static void test_parse_statistics_since_latest();
+
 void get_tests(Tests &tests) {
     tests["001 - Empty node"]                 = test_node_empty;
     tests["002 - Node with tag"]              = test_node_with_tag;
@@ -65,6 +74,11 @@ void get_tests(Tests &tests) {
 
     tests["300 - Parse response tree - positive"] = test_parse_boinc_response_positive;
     tests["301 - Parse response tree - negative"] = test_parse_boinc_response_negative;
+
+    tests["400 - Parse statistics - all days"]           = test_parse_statistics_complete;
+    tests["401 - Parse statistics - since a day"]        = test_parse_statistics_since;
+    tests["402 - Parse statistics - unknown project"]    = test_parse_statistics_unknown_project;
+    tests["403 - Parse statistics - since a later day"]  = test_parse_statistics_since_latest;
 }
 
 // ----------------------------------------------------------------
@@ -341,3 +355,92 @@ void test_parse_boinc_response_negative() {
     std::string error;
     assert_equals("Parsed invalid response", wxml::parse_boinc_response(tree, xml_stream, error), false);
 }
+
+// ------------- parse(..., since, first_days) --------------------
+
+namespace {
+
+const char *STATISTICS_XML__ =
+    "<statistics>"
+    "<project_statistics>"
+    "<master_url>https://a.example/</master_url>"
+    "<daily_statistics><day>86400</day><user_total_credit>1</user_total_credit><user_expavg_credit>2</user_expavg_credit>"
+    "<host_total_credit>3</host_total_credit><host_expavg_credit>4</host_expavg_credit></daily_statistics>"
+    "<daily_statistics><day>172800</day><user_total_credit>5</user_total_credit><user_expavg_credit>6</user_expavg_credit>"
+    "<host_total_credit>7</host_total_credit><host_expavg_credit>8</host_expavg_credit></daily_statistics>"
+    "<daily_statistics><day>259200</day><user_total_credit>9</user_total_credit><user_expavg_credit>10</user_expavg_credit>"
+    "<host_total_credit>11</host_total_credit><host_expavg_credit>12</host_expavg_credit></daily_statistics>"
+    "</project_statistics>"
+    "<project_statistics>"
+    "<master_url>https://b.example/</master_url>"
+    "<daily_statistics><day>172800</day><user_total_credit>13</user_total_credit><user_expavg_credit>14</user_expavg_credit>"
+    "<host_total_credit>15</host_total_credit><host_expavg_credit>16</host_expavg_credit></daily_statistics>"
+    "</project_statistics>"
+    "</statistics>";
+
+void parse_statistics(const std::map<std::string, time_t> &since,
+                      woinc::Statistics &statistics, std::vector<time_t> &first_days) {
+    std::istringstream xml_stream(STATISTICS_XML__);
+
+    wxml::Tree tree;
+    std::string error;
+    assert_true("Could not parse the xml", tree.parse(xml_stream, error));
+    assert_true("Could not parse the statistics", woinc::rpc::parse(tree.root, statistics, since, first_days));
+}
+
+}
+
+void test_parse_statistics_complete() {
+    woinc::Statistics statistics;
+    std::vector<time_t> first_days;
+    parse_statistics({}, statistics, first_days);
+
+    assert_equals("Wrong number of projects", statistics.size(), 2);
+    assert_equals("Wrong number of first days", first_days.size(), 2);
+
+    assert_equals("Wrong url", statistics[0].master_url, std::string("https://a.example/"));
+    assert_equals("Wrong number of days", statistics[0].daily_statistics.size(), 3);
+    assert_equals("Wrong first day", static_cast<long>(first_days[0]), 86400L);
+    assert_equals("Wrong day", static_cast<long>(statistics[0].daily_statistics[2].day), 259200L);
+    assert_equals("Wrong user total credit", statistics[0].daily_statistics[2].user_total_credit, 9.);
+    assert_equals("Wrong host expavg credit", statistics[0].daily_statistics[2].host_expavg_credit, 12.);
+
+    assert_equals("Wrong number of days", statistics[1].daily_statistics.size(), 1);
+    assert_equals("Wrong first day", static_cast<long>(first_days[1]), 172800L);
+}
+
+void test_parse_statistics_since() {
+    woinc::Statistics statistics;
+    std::vector<time_t> first_days;
+    parse_statistics({{"https://a.example/", 172800}, {"https://b.example/", 172800}}, statistics, first_days);
+
+    // the day given in since is parsed again, the client updates it until the day is over
+    assert_equals("Wrong number of days", statistics[0].daily_statistics.size(), 2);
+    assert_equals("Wrong day", static_cast<long>(statistics[0].daily_statistics[0].day), 172800L);
+    assert_equals("Wrong host total credit", statistics[0].daily_statistics[0].host_total_credit, 7.);
+    assert_equals("Wrong day", static_cast<long>(statistics[0].daily_statistics[1].day), 259200L);
+    // the first day still reported by the client, even though it's skipped
+    assert_equals("Wrong first day", static_cast<long>(first_days[0]), 86400L);
+
+    assert_equals("Wrong number of days", statistics[1].daily_statistics.size(), 1);
+    assert_equals("Wrong first day", static_cast<long>(first_days[1]), 172800L);
+}
+
+void test_parse_statistics_unknown_project() {
+    woinc::Statistics statistics;
+    std::vector<time_t> first_days;
+    parse_statistics({{"https://b.example/", 172800}}, statistics, first_days);
+
+    assert_equals("Wrong number of days of the unknown project", statistics[0].daily_statistics.size(), 3);
+    assert_equals("Wrong number of days", statistics[1].daily_statistics.size(), 1);
+}
+
+void test_parse_statistics_since_latest() {
+    woinc::Statistics statistics;
+    std::vector<time_t> first_days;
+    parse_statistics({{"https://a.example/", 345600}}, statistics, first_days);
+
+    assert_equals("Wrong number of projects", statistics.size(), 2);
+    assert_equals("Wrong number of days", statistics[0].daily_statistics.size(), 0);
+    assert_equals("Wrong first day", static_cast<long>(first_days[0]), 86400L);
+}
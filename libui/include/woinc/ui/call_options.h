@@ -0,0 +1,84 @@
+/* libui/include/woinc/ui/call_options.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_CALL_OPTIONS_H_
+#define WOINC_UI_CALL_OPTIONS_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace woinc { namespace ui {
+
+// Cancels the calls it was passed to. Copies share their state, so keep a copy to cancel the calls later.
+// A default constructed token can't be cancelled, use create() to get a cancellable one.
+class CancellationToken {
+    public:
+        CancellationToken() = default;
+
+        static CancellationToken create() {
+            CancellationToken token;
+            token.cancelled_ = std::make_shared<std::atomic<bool>>(false);
+            return token;
+        }
+
+        void cancel() {
+            if (cancelled_)
+                cancelled_->store(true);
+        }
+
+        bool cancelled() const {
+            return cancelled_ && cancelled_->load();
+        }
+
+        bool cancellable() const {
+            return cancelled_ != nullptr;
+        }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Options of the async commands of the controller:
+//  - a call not executed until the deadline fails with a DeadlineExceededException,
+//    a running call gets aborted when reaching the deadline
+//  - a cancelled call which isn't executed yet fails with a CancelledException
+// Calls with a deadline or cancellation token don't share their rpc with identical calls.
+struct CallOptions {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    CancellationToken cancellation;
+
+    CallOptions() = default;
+
+    explicit CallOptions(std::chrono::milliseconds timeout)
+        : deadline(std::chrono::steady_clock::now() + timeout) {}
+
+    explicit CallOptions(CancellationToken token)
+        : cancellation(std::move(token)) {}
+
+    CallOptions(std::chrono::milliseconds timeout, CancellationToken token)
+        : deadline(std::chrono::steady_clock::now() + timeout), cancellation(std::move(token)) {}
+
+    bool restricted() const {
+        return deadline != std::chrono::steady_clock::time_point::max() || cancellation.cancellable();
+    }
+};
+
+}}
+
+#endif
@@ -0,0 +1,153 @@
+/* libui/include/woinc/ui/completion.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_COMPLETION_H_
+#define WOINC_UI_COMPLETION_H_
+
+#include <exception>
+#include <functional>
+#include <utility>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define WOINC_UI_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef WOINC_UI_HAS_COROUTINES
+#include <atomic>
+#include <coroutine>
+#endif
+
+namespace woinc { namespace ui {
+
+// Runs the completions of the async commands, e.g. by posting them to the event loop of the gui.
+// It has to outlive the calls it was passed to.
+class Executor {
+    public:
+        virtual ~Executor() = default;
+
+        virtual void post(std::function<void()> work) = 0;
+};
+
+// The result of an async command, either its value or the error it failed with
+template<typename Result>
+class Outcome {
+    public:
+        Outcome() = default;
+
+        explicit Outcome(Result value) : value_(std::move(value)) {}
+        explicit Outcome(std::exception_ptr error) : error_(std::move(error)) {}
+
+        bool ok() const { return !error_; }
+        std::exception_ptr error() const { return error_; }
+
+        // rethrows the error if the command failed
+        Result &value() {
+            if (error_)
+                std::rethrow_exception(error_);
+            return value_;
+        }
+
+    private:
+        Result value_;
+        std::exception_ptr error_;
+};
+
+// Called exactly once with the outcome of an async command.
+// Without an executor it's called by the worker thread of the host, so don't block in there,
+// or by the calling thread if the command is answered immediately, e.g. from a snapshot.
+// The commands discarded by removing the host or shutting down the controller fail after
+// the controller released its lock, by the thread removing the host.
+// A command running while its host is removed completes on the worker thread, which the removal waits for,
+// so only call the controller from such a completion if it's passed to an executor.
+template<typename Result>
+class Completion {
+    public:
+        typedef std::function<void(Outcome<Result>)> Callback;
+
+        template<typename Function,
+                 typename = decltype(std::declval<Function &>()(std::declval<Outcome<Result>>()))>
+        Completion(Function callback, Executor *executor = nullptr)
+            : callback_(std::move(callback)), executor_(executor) {}
+
+        void operator()(Outcome<Result> outcome) {
+            if (executor_ == nullptr)
+                callback_(std::move(outcome));
+            else
+                executor_->post([callback = std::move(callback_), outcome = std::move(outcome)]() mutable {
+                    callback(std::move(outcome));
+                });
+        }
+
+    private:
+        Callback callback_;
+        Executor *executor_;
+};
+
+#ifdef WOINC_UI_HAS_COROUTINES
+
+// Awaits an async command started by passing a completion to the callback variant of the controller, e.g.
+//   auto tasks = co_await awaitable<Tasks>([&](auto done) { controller.tasks(host, max_age, std::move(done)); });
+// The coroutine is resumed by the executor or, without one, by the worker thread of the host.
+template<typename Result, typename Start>
+class Awaitable {
+    public:
+        Awaitable(Start start, Executor *executor)
+            : start_(std::move(start)), executor_(executor) {}
+
+        Awaitable(const Awaitable &) = delete;
+        Awaitable &operator=(const Awaitable &) = delete;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        // the command may complete before we are suspended, in which case we just continue
+        bool await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            start_(Completion<Result>([this](Outcome<Result> outcome) {
+                outcome_ = std::move(outcome);
+                if (completed_.exchange(true))
+                    handle_.resume();
+            }, executor_));
+            return !completed_.exchange(true);
+        }
+
+        Result await_resume() {
+            return std::move(outcome_.value());
+        }
+
+    private:
+        Start start_;
+        Executor *executor_;
+        std::coroutine_handle<> handle_;
+        std::atomic<bool> completed_{false};
+        Outcome<Result> outcome_;
+};
+
+template<typename Result, typename Start>
+Awaitable<Result, Start> awaitable(Start start, Executor *executor = nullptr) {
+    return Awaitable<Result, Start>(std::move(start), executor);
+}
+
+#endif
+
+}}
+
+#endif
@@ -20,17 +20,32 @@
 #define WOINC_UI_CONTROLLER_H_
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <ctime>
+#include <functional>
 #include <future>
+#include <iosfwd>
 #include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
+#include <woinc/ui/call_options.h>
+#include <woinc/ui/completion.h>
 #include <woinc/ui/defs.h>
 #include <woinc/ui/error.h>
 #include <woinc/ui/handler.h>
+#include <woinc/ui/metrics.h>
+#include <woinc/ui/snapshot.h>
+
+namespace woinc { namespace rpc { class Connection; }}
 
 namespace woinc { namespace ui {
 
+// Creates the connection to the client of the host instead of connecting directly, see Controller::connection_factory
+typedef std::function<std::unique_ptr<woinc::rpc::Connection>(const std::string &host)> ConnectionFactory;
+
 class Controller {
     public:
         Controller();
@@ -50,16 +65,38 @@ class Controller {
         virtual void deregister_handler(HostHandler *handler);
 
         virtual void register_handler(PeriodicTaskHandler *handler);
+        virtual void register_handler(PeriodicTaskHandler *handler, PeriodicTaskSubscription subscription);
         virtual void deregister_handler(PeriodicTaskHandler *handler);
 
+        // only called while the fleet aggregation is enabled
+        virtual void register_handler(FleetHandler *handler);
+        virtual void deregister_handler(FleetHandler *handler);
+
+        // see DispatchMode; may be switched at any time, pending updates are delivered in order
+        virtual void dispatch_mode(DispatchMode mode);
+        virtual DispatchMode dispatch_mode() const;
+
     public: // basic host handling
 
+        // Keep a second connection to the hosts for commands with large replies (client state, messages, statistics),
+        // so they don't delay the fast polls and the commands of the user. Applies to hosts added afterwards.
+        // The second connection is used once it was authorized with the password passed to authorize_host,
+        // so call it with an empty password for the hosts without one, which doesn't schedule an authorization.
+        virtual void bulk_connection(bool value);
+        virtual bool bulk_connection() const;
+
+        // The hosts are connected by a pool limited to this many concurrent name resolutions and connects,
+        // hosts with a higher connect priority first. Defaults to 8.
+        virtual void connect_concurrency(std::size_t value);
+        virtual std::size_t connect_concurrency() const;
+
         // TODO rename to (dis)connect_host? is host the correct name or would we connect to clients instead?
         //      there may be more than one client at a given host ..
         // TODO rename to async_add_host?
         virtual void add_host(const std::string &host,
                               const std::string &url,
-                              std::uint16_t port = 31416);
+                              std::uint16_t port = 31416,
+                              int connect_priority = 0);
 
         virtual void authorize_host(const std::string &host,
                                     const std::string &password);
@@ -69,6 +106,30 @@ class Controller {
         // use the async variant if you want to remove a host in one of the handlers
         virtual void async_remove_host(std::string host);
 
+        // Warm start: the client state, projects, statistics and tasks of the hosts and the seqnos of their
+        // messages and notices are saved to the file every save_interval and at shutdown.
+        // A host added afterwards gets its saved state restored immediately, i.e. it's delivered to the
+        // periodic task handlers and published as stale snapshots, which are replaced once the host delivers its own.
+        // The messages and notices are continued after the restored seqnos unless the client was restarted.
+        // A missing, corrupt or incompatible file is ignored. Can only be set once, before adding the hosts.
+        virtual void state_file(const std::string &path,
+                                std::chrono::seconds save_interval = std::chrono::minutes(5));
+        // saves the state now, throws a std::runtime_error if writing the file fails
+        virtual void save_state();
+
+        // Records the rpcs of the hosts added afterwards to the capture file, e.g. to reproduce a problem of a session
+        // with its real replies, see woinc/rpc_capture.h. Throws a std::runtime_error if the file can't be created.
+        virtual void record_rpcs(const std::string &path);
+        // The hosts added afterwards are served from the capture file instead of connecting to their clients,
+        // the url and port of a host have to match the recorded ones. The replies are delayed by their recorded
+        // duration divided by the speed, zero replies immediately. Throws a std::runtime_error if the file can't be read.
+        // Recording and replaying can only be set once and not together.
+        virtual void replay_rpcs(const std::string &path, double speed = 1);
+        // The connections of the hosts added afterwards are created by the factory, e.g. to observe, cache or
+        // share their rpcs; they are opened, authorized and used by the worker threads like the own ones.
+        // Can only be set once and not together with recording or replaying.
+        virtual void connection_factory(ConnectionFactory factory);
+
     public: // periodic tasks handling
 
         virtual void periodic_task_interval(PeriodicTask task, std::chrono::milliseconds interval);
@@ -80,49 +141,234 @@ class Controller {
 
         virtual void active_only_tasks(const std::string &host, bool value);
 
-    public: // commands to the client; all of those commands are async
+        // The periodic tasks scheduled for all hosts even if no handler is subscribed to them,
+        // so their snapshots and the answers of cc_status and tasks with a max_age stay up to date.
+        // Empty by default, i.e. only the tasks the handlers are subscribed to are scheduled,
+        // so the users of the snapshots, the fleet aggregates or the statistics history have to opt in.
+        virtual void snapshot_tasks(std::set<PeriodicTask> tasks);
+        virtual std::set<PeriodicTask> snapshot_tasks() const;
+
+        // number of replies which were byte-identical to the previous one of the task,
+        // for those neither the parsing nor the handlers are called
+        virtual std::uint64_t unchanged_replies(const std::string &host, PeriodicTask task) const;
+
+        // A copy of the metrics recorded since the host was added or its metrics were reset,
+        // empty if the host is unknown. Callable from any thread, including the handlers.
+        virtual HostMetrics metrics(const std::string &host) const;
+        virtual void reset_metrics(const std::string &host);
+
+        // Traces the steps of the jobs of all hosts, from the periodic task getting due over queueing,
+        // sending, receiving and parsing to the handlers. Disabled by default, but cheap enough to keep enabled.
+        // The latest trace_buffer_size events are kept per thread, changes apply to threads tracing afterwards.
+        virtual void tracing(bool value);
+        virtual bool tracing() const;
+        virtual void trace_buffer_size(std::size_t events);
+        virtual std::size_t trace_buffer_size() const;
+        // writes the kept events in the Chrome trace event format, e.g. for chrome://tracing or ui.perfetto.dev
+        virtual void write_trace(std::ostream &out) const;
+        virtual void clear_trace();
+
+    public: // the latest received state of the periodic tasks
+
+        // never blocked by the worker threads and callable from any thread, including the handlers;
+        // the pointer is empty if the host is unknown or the task didn't deliver a result yet,
+        // which it only does if it's subscribed to or one of the snapshot_tasks
+        virtual SnapshotPtr<CCStatus> cc_status_snapshot(const std::string &host) const;
+        virtual SnapshotPtr<ClientState> client_state_snapshot(const std::string &host) const;
+        virtual SnapshotPtr<DiskUsage> disk_usage_snapshot(const std::string &host) const;
+        virtual SnapshotPtr<FileTransfers> file_transfers_snapshot(const std::string &host) const;
+        virtual SnapshotPtr<Projects> projects_snapshot(const std::string &host) const;
+        virtual SnapshotPtr<Statistics> statistics_snapshot(const std::string &host) const;
+        virtual SnapshotPtr<Tasks> tasks_snapshot(const std::string &host) const;
+
+    public: // totals over all hosts
+
+        // Maintains the FleetAggregates from the cc status, tasks, projects and statistics updates of the hosts.
+        // Disabled by default; when enabled the aggregates start from the latest snapshots of the hosts.
+        virtual void aggregate_fleet(bool value);
+        virtual bool aggregate_fleet() const;
+        // tasks due within the horizon are counted as near their deadline, defaults to 24 hours
+        virtual void fleet_deadline_horizon(std::chrono::seconds horizon);
+        virtual std::chrono::seconds fleet_deadline_horizon() const;
+        // callable from any thread including the fleet handlers; only copied if they changed since the last call,
+        // zero if the aggregation is disabled
+        virtual SnapshotPtr<FleetAggregates> fleet_aggregates() const;
+
+    public: // the statistics beyond the days reported by the clients
+
+        // Records the daily statistics of the projects of the hosts into compressed series.
+        // Disabled by default; when enabled the recording starts from the latest snapshots of the hosts.
+        // Disabling stops the recording but keeps the recorded history, removing a host drops its history.
+        virtual void record_statistics_history(bool value);
+        virtual bool record_statistics_history() const;
+        // days older than the retention, relative to the latest day of a project, are dropped; defaults to a year
+        virtual void statistics_history_retention(std::chrono::hours retention);
+        virtual std::chrono::hours statistics_history_retention() const;
+        // the recorded days of the project within [from, to] in order; if max_points isn't zero and there are more days,
+        // the range is split into max_points buckets of equal length and only the last day of each bucket is returned
+        virtual DailyStatistics statistics_history(const std::string &host, const std::string &master_url,
+                                                   std::time_t from, std::time_t to, std::size_t max_points = 0) const;
+        virtual std::vector<std::string> statistics_history_projects(const std::string &host) const;
+        // the bytes used by the recorded history
+        virtual std::size_t statistics_history_memory() const;
+        // reading replaces the history of the hosts in the stream and throws a std::runtime_error if it's invalid
+        virtual void write_statistics_history(std::ostream &out) const;
+        virtual void read_statistics_history(std::istream &in);
+
+    public: // commands to the client; all of those commands are async, see CallOptions for their options
 
         virtual std::future<bool> file_transfer_op(const std::string &host, FileTransferOp op,
-                                                   const std::string &master_url, const std::string &filename);
-        virtual std::future<bool> project_op(const std::string &host, ProjectOp op, const std::string &master_url);
-        virtual std::future<bool> task_op(const std::string &host, TaskOp op, const std::string &master_url, const std::string &task_name);
+                                                   const std::string &master_url, const std::string &filename,
+                                                   const CallOptions &options = CallOptions());
+        virtual std::future<bool> project_op(const std::string &host, ProjectOp op, const std::string &master_url,
+                                             const CallOptions &options = CallOptions());
+        virtual std::future<bool> task_op(const std::string &host, TaskOp op, const std::string &master_url, const std::string &task_name,
+                                          const CallOptions &options = CallOptions());
+
+        // answered from the snapshot if it isn't older than max_age, otherwise requested from the client
+        virtual std::future<CCStatus> cc_status(const std::string &host,
+                                                std::chrono::milliseconds max_age = std::chrono::milliseconds::zero(),
+                                                const CallOptions &options = CallOptions());
+        virtual std::future<Tasks> tasks(const std::string &host,
+                                         std::chrono::milliseconds max_age = std::chrono::milliseconds::zero(),
+                                         const CallOptions &options = CallOptions());
 
         virtual std::future<GlobalPreferences> load_global_preferences(const std::string &host,
-                                                                       GetGlobalPrefsMode mode);
+                                                                       GetGlobalPrefsMode mode,
+                                                                       const CallOptions &options = CallOptions());
         virtual std::future<bool> save_global_preferences(const std::string &host,
                                                           const GlobalPreferences &prefs,
-                                                          const GlobalPreferencesMask &mask);
+                                                          const GlobalPreferencesMask &mask,
+                                                          const CallOptions &options = CallOptions());
 
-        virtual std::future<bool> read_global_prefs_override(const std::string &host);
+        virtual std::future<bool> read_global_prefs_override(const std::string &host,
+                                                             const CallOptions &options = CallOptions());
 
-        virtual std::future<CCConfig> cc_config(const std::string &host);
-        virtual std::future<bool> cc_config(const std::string &host, const CCConfig &cc_config);
+        virtual std::future<CCConfig> cc_config(const std::string &host,
+                                                const CallOptions &options = CallOptions());
+        virtual std::future<bool> cc_config(const std::string &host, const CCConfig &cc_config,
+                                            const CallOptions &options = CallOptions());
 
-        virtual std::future<bool> read_config_files(const std::string &host);
+        virtual std::future<bool> read_config_files(const std::string &host,
+                                                    const CallOptions &options = CallOptions());
 
-        virtual std::future<bool> run_mode(const std::string &host, RunMode mode);
-        virtual std::future<bool> gpu_mode(const std::string &host, RunMode mode);
-        virtual std::future<bool> network_mode(const std::string &host, RunMode mode);
+        virtual std::future<bool> run_mode(const std::string &host, RunMode mode,
+                                           const CallOptions &options = CallOptions());
+        virtual std::future<bool> gpu_mode(const std::string &host, RunMode mode,
+                                           const CallOptions &options = CallOptions());
+        virtual std::future<bool> network_mode(const std::string &host, RunMode mode,
+                                               const CallOptions &options = CallOptions());
 
-        virtual std::future<AllProjectsList> all_projects_list(const std::string &host);
+        virtual std::future<AllProjectsList> all_projects_list(const std::string &host,
+                                                               const CallOptions &options = CallOptions());
 
-        virtual std::future<bool> start_loading_project_config(const std::string &host, std::string master_url);
+        virtual std::future<bool> start_loading_project_config(const std::string &host, std::string master_url,
+                                                               const CallOptions &options = CallOptions());
         // if it's still loading the resulting config.error_num will be -204, poll again after some delay;
         // yep, that's not a nice interface, we'll use std::variant when switching to std-c++17
-        virtual std::future<ProjectConfig> poll_project_config(const std::string &host);
+        virtual std::future<ProjectConfig> poll_project_config(const std::string &host,
+                                                               const CallOptions &options = CallOptions());
 
         virtual std::future<bool> start_account_lookup(const std::string &host, std::string master_url,
-                                                       std::string email, std::string password);
+                                                       std::string email, std::string password,
+                                                       const CallOptions &options = CallOptions());
         // if it's still loading the resulting config.error_num will be -204, poll again after some delay;
-        virtual std::future<AccountOut> poll_account_lookup(const std::string &host);
+        virtual std::future<AccountOut> poll_account_lookup(const std::string &host,
+                                                            const CallOptions &options = CallOptions());
 
         virtual std::future<bool> attach_project(const std::string &host,
                                                  std::string master_url,
-                                                 std::string authenticator);
-
-        virtual std::future<bool> network_available(const std::string &host);
-        virtual std::future<bool> run_benchmarks(const std::string &host);
-        virtual std::future<bool> quit(const std::string &host);
+                                                 std::string authenticator,
+                                                 const CallOptions &options = CallOptions());
+
+        virtual std::future<bool> network_available(const std::string &host,
+                                                    const CallOptions &options = CallOptions());
+        virtual std::future<bool> run_benchmarks(const std::string &host,
+                                                 const CallOptions &options = CallOptions());
+        virtual std::future<bool> quit(const std::string &host,
+                                       const CallOptions &options = CallOptions());
+
+    public: // the commands with a completion instead of a future, see Completion for where it's called;
+            // like the future variants they throw if the controller is shut down or the host is unknown
+
+        virtual void file_transfer_op(const std::string &host, FileTransferOp op,
+                                      const std::string &master_url, const std::string &filename,
+                                      Completion<bool> completion,
+                                      const CallOptions &options = CallOptions());
+        virtual void project_op(const std::string &host, ProjectOp op, const std::string &master_url,
+                                Completion<bool> completion,
+                                const CallOptions &options = CallOptions());
+        virtual void task_op(const std::string &host, TaskOp op, const std::string &master_url, const std::string &task_name,
+                             Completion<bool> completion,
+                             const CallOptions &options = CallOptions());
+        virtual void cc_status(const std::string &host,
+                               std::chrono::milliseconds max_age,
+                               Completion<CCStatus> completion,
+                               const CallOptions &options = CallOptions());
+        virtual void tasks(const std::string &host,
+                           std::chrono::milliseconds max_age,
+                           Completion<Tasks> completion,
+                           const CallOptions &options = CallOptions());
+        virtual void load_global_preferences(const std::string &host,
+                                             GetGlobalPrefsMode mode,
+                                             Completion<GlobalPreferences> completion,
+                                             const CallOptions &options = CallOptions());
+        virtual void save_global_preferences(const std::string &host,
+                                             const GlobalPreferences &prefs,
+                                             const GlobalPreferencesMask &mask,
+                                             Completion<bool> completion,
+                                             const CallOptions &options = CallOptions());
+        virtual void read_global_prefs_override(const std::string &host,
+                                                Completion<bool> completion,
+                                                const CallOptions &options = CallOptions());
+        virtual void cc_config(const std::string &host,
+                               Completion<CCConfig> completion,
+                               const CallOptions &options = CallOptions());
+        virtual void cc_config(const std::string &host, const CCConfig &cc_config,
+                               Completion<bool> completion,
+                               const CallOptions &options = CallOptions());
+        virtual void read_config_files(const std::string &host,
+                                       Completion<bool> completion,
+                                       const CallOptions &options = CallOptions());
+        virtual void run_mode(const std::string &host, RunMode mode,
+                              Completion<bool> completion,
+                              const CallOptions &options = CallOptions());
+        virtual void gpu_mode(const std::string &host, RunMode mode,
+                              Completion<bool> completion,
+                              const CallOptions &options = CallOptions());
+        virtual void network_mode(const std::string &host, RunMode mode,
+                                  Completion<bool> completion,
+                                  const CallOptions &options = CallOptions());
+        virtual void all_projects_list(const std::string &host,
+                                       Completion<AllProjectsList> completion,
+                                       const CallOptions &options = CallOptions());
+        virtual void start_loading_project_config(const std::string &host, std::string master_url,
+                                                  Completion<bool> completion,
+                                                  const CallOptions &options = CallOptions());
+        virtual void poll_project_config(const std::string &host,
+                                         Completion<ProjectConfig> completion,
+                                         const CallOptions &options = CallOptions());
+        virtual void start_account_lookup(const std::string &host, std::string master_url,
+                                          std::string email, std::string password,
+                                          Completion<bool> completion,
+                                          const CallOptions &options = CallOptions());
+        virtual void poll_account_lookup(const std::string &host,
+                                         Completion<AccountOut> completion,
+                                         const CallOptions &options = CallOptions());
+        virtual void attach_project(const std::string &host,
+                                    std::string master_url,
+                                    std::string authenticator,
+                                    Completion<bool> completion,
+                                    const CallOptions &options = CallOptions());
+        virtual void network_available(const std::string &host,
+                                       Completion<bool> completion,
+                                       const CallOptions &options = CallOptions());
+        virtual void run_benchmarks(const std::string &host,
+                                    Completion<bool> completion,
+                                    const CallOptions &options = CallOptions());
+        virtual void quit(const std::string &host,
+                          Completion<bool> completion,
+                          const CallOptions &options = CallOptions());
 
     private:
         struct Impl;
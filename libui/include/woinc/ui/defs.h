@@ -19,8 +19,18 @@
 #ifndef WOINC_UI_DEFS_H_
 #define WOINC_UI_DEFS_H_
 
+#include <cstddef>
+
 namespace woinc { namespace ui {
 
+// Direct: the periodic task handlers are called by the host's worker thread right after the rpc
+// Coalesced: updates are stored per host and entity, newer updates replace pending older ones
+//            and a dedicated dispatcher thread delivers them to the periodic task handlers
+enum class DispatchMode {
+    Direct,
+    Coalesced
+};
+
 enum class Error {
     Disconnected,
     Unauthorized,
@@ -42,6 +52,9 @@ enum class PeriodicTask {
     GetTasks
 };
 
+// the number of periodic tasks, GetTasks has to stay the last one
+constexpr std::size_t PERIODIC_TASK_COUNT = static_cast<std::size_t>(PeriodicTask::GetTasks) + 1;
+
 }}
 
 #endif
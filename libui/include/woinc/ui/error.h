@@ -25,6 +25,8 @@ namespace woinc { namespace ui {
 
 struct ShutdownException {};
 struct UnknownHostException { std::string host; };
+struct CancelledException {};
+struct DeadlineExceededException {};
 
 }}
 
@@ -0,0 +1,65 @@
+/* libui/include/woinc/ui/fleet.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_FLEET_H_
+#define WOINC_UI_FLEET_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include <woinc/defs.h>
+
+namespace woinc { namespace ui {
+
+struct FleetProjectTotals {
+    std::string name;
+
+    // hosts attached to the project according to their project status
+    std::size_t hosts = 0;
+
+    std::size_t tasks = 0;
+    std::size_t running_tasks = 0;
+    std::size_t tasks_near_deadline = 0;
+
+    // the sum of the recent average credit of the hosts
+    double credit_per_day = 0;
+    // the sum of the credit the hosts got on the latest day of their statistics
+    double credit_last_day = 0;
+};
+
+// Totals over all hosts, maintained incrementally from the periodic updates of the hosts
+struct FleetAggregates {
+    std::size_t tasks = 0;
+    std::size_t running_tasks = 0;
+    std::size_t tasks_near_deadline = 0;
+
+    double credit_per_day = 0;
+    double credit_last_day = 0;
+
+    // by master url
+    std::map<std::string, FleetProjectTotals> projects;
+
+    // the hosts whose computing is suspended and why
+    std::map<std::string, SuspendReason> suspended_hosts;
+    std::map<SuspendReason, std::size_t> suspend_reasons;
+};
+
+}}
+
+#endif
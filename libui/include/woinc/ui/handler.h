@@ -19,10 +19,12 @@
 #ifndef WOINC_UI_HANDLER_H_
 #define WOINC_UI_HANDLER_H_
 
+#include <set>
 #include <string>
 
 #include <woinc/types.h>
 #include <woinc/ui/defs.h>
+#include <woinc/ui/fleet.h>
 
 namespace woinc { namespace ui {
 
@@ -58,6 +60,12 @@ struct HostHandler {
  *
  * This handler will not be called more than once at the same time
  * and not concurrently to HostHandler::on_host_removed().
+ *
+ * In DispatchMode::Coalesced the handler is called by the dispatcher thread
+ * and may skip intermediate updates if it's slower than the periodic tasks.
+ *
+ * With a state file the first update of an added host may be its restored state
+ * (see Controller::state_file), delivered by the thread adding the host in DispatchMode::Direct.
  */
 struct PeriodicTaskHandler {
     virtual ~PeriodicTaskHandler() = default;
@@ -70,9 +78,42 @@ struct PeriodicTaskHandler {
     virtual void on_update(const std::string & /*host*/, const woinc::Notices &       /*notices*/, bool /*refreshed*/) {};
     virtual void on_update(const std::string & /*host*/, const woinc::Projects &      /*projects*/) {};
     virtual void on_update(const std::string & /*host*/, const woinc::Statistics &    /*statistics*/) {};
+    // Called after the one above with the new days only, i.e. the new or changed days of each project, each replacing
+    // the known day of the same date; the days are complete if refreshed, e.g. after a reconnect.
+    // Projects not in here are gone. Not called at all if there are no new days.
+    virtual void on_update(const std::string & /*host*/, const woinc::Statistics &    /*days*/, bool /*refreshed*/) {};
     virtual void on_update(const std::string & /*host*/, const woinc::Tasks &         /*tasks*/) {};
 };
 
+/*
+ * Handles the changes of the fleet wide aggregates, see Controller::aggregate_fleet.
+ *
+ * Called after an update or the removal of the host changed the aggregates, with the same restrictions
+ * as the PeriodicTaskHandler. The passed aggregates are the latest ones, they may include newer changes
+ * of other hosts. Calling Controller::fleet_aggregates() in here is fine, (de)registering fleet handlers isn't.
+ */
+struct FleetHandler {
+    virtual ~FleetHandler() = default;
+
+    virtual void on_update(const std::string & /*host*/, const FleetAggregates & /*aggregates*/) {};
+};
+
+/*
+ * Restricts the updates a PeriodicTaskHandler is called for; an empty set matches everything.
+ *
+ * Periodic tasks no registered handler is interested in won't be scheduled for the host at all,
+ * unless they are kept up to date for the snapshots, see Controller::snapshot_tasks.
+ */
+struct PeriodicTaskSubscription {
+    std::set<std::string> hosts;
+    std::set<PeriodicTask> tasks;
+
+    bool matches(const std::string &host, PeriodicTask task) const {
+        return (hosts.empty() || hosts.find(host) != hosts.end())
+            && (tasks.empty() || tasks.find(task) != tasks.end());
+    }
+};
+
 }}
 
 #endif
@@ -0,0 +1,114 @@
+/* libui/include/woinc/ui/metrics.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_METRICS_H_
+#define WOINC_UI_METRICS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <woinc/ui/defs.h>
+
+namespace woinc { namespace ui {
+
+// A histogram of non-negative integers in the style of HdrHistogram:
+// the values are counted in power of two ranges, each split into SubBuckets linear buckets,
+// so the reported percentiles are within 1/SubBuckets of the real values, independent of their magnitude.
+// The buckets are allocated up to the largest recorded value only.
+class Histogram {
+    public:
+        static constexpr std::size_t SubBuckets = 16;
+
+        void record(std::uint64_t value);
+        void merge(const Histogram &other);
+        void clear();
+
+        std::uint64_t count() const { return count_; }
+        std::uint64_t sum() const { return sum_; }
+        std::uint64_t min() const { return count_ == 0 ? 0 : min_; }
+        std::uint64_t max() const { return max_; }
+        double mean() const;
+
+        // the value at or below which the given percentage (0 to 100) of the recorded values lie,
+        // reported as the upper bound of its bucket but never above the maximum
+        std::uint64_t percentile(double percentage) const;
+
+    private:
+        static std::size_t index_(std::uint64_t value);
+        static std::uint64_t upper_bound_(std::size_t index);
+
+    private:
+        std::vector<std::uint64_t> counts_;
+        std::uint64_t count_ = 0;
+        std::uint64_t sum_ = 0;
+        std::uint64_t min_ = 0;
+        std::uint64_t max_ = 0;
+};
+
+enum class MetricSeries {
+    RpcRoundTrip,    // nanoseconds from sending the request until the reply is received
+    BytesOut,        // bytes of the requests
+    BytesIn,         // bytes of the replies
+    ParseDuration,   // nanoseconds spent parsing the replies
+    QueueWait,       // nanoseconds a job waited in the queue of the host
+    HandlerDuration, // nanoseconds spent in the periodic task handlers for an update
+    QueueDepth,      // jobs already queued when a job was scheduled
+    UpdateLatency    // nanoseconds from the periodic task getting due until its update was passed to the handlers
+};
+
+// the number of metric series, UpdateLatency has to stay the last one
+constexpr std::size_t METRIC_SERIES_COUNT = static_cast<std::size_t>(MetricSeries::UpdateLatency) + 1;
+
+// The histograms of a host, kept per periodic task and for all other commands together
+class HostMetrics {
+    public:
+        const Histogram &periodic(MetricSeries series, PeriodicTask task) const {
+            return histograms_[slot(series, static_cast<std::size_t>(task))];
+        }
+
+        // the commands of the controller and the authorization
+        const Histogram &commands(MetricSeries series) const {
+            return histograms_[slot(series, COMMANDS)];
+        }
+
+        Histogram &at(MetricSeries series, std::size_t task_or_commands) {
+            return histograms_[slot(series, task_or_commands)];
+        }
+
+        void merge(const HostMetrics &other) {
+            for (std::size_t i = 0; i < histograms_.size(); ++i)
+                histograms_[i].merge(other.histograms_[i]);
+        }
+
+    public:
+        // the index after the periodic tasks
+        static constexpr std::size_t COMMANDS = PERIODIC_TASK_COUNT;
+
+        static constexpr std::size_t slot(MetricSeries series, std::size_t task_or_commands) {
+            return static_cast<std::size_t>(series) * (COMMANDS + 1) + task_or_commands;
+        }
+
+    private:
+        std::array<Histogram, METRIC_SERIES_COUNT * (COMMANDS + 1)> histograms_;
+};
+
+}}
+
+#endif
@@ -0,0 +1,44 @@
+/* libui/include/woinc/ui/snapshot.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_SNAPSHOT_H_
+#define WOINC_UI_SNAPSHOT_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace woinc { namespace ui {
+
+// An immutable copy of the latest received state of an entity of a host.
+// The snapshot stays valid as long as it's referenced, newer states are published as new snapshots.
+template<typename T>
+struct Snapshot {
+    T value;
+    // when the value was received, it's moved on in place when the host confirms the value to be unchanged
+    std::atomic<std::chrono::steady_clock::time_point> time;
+    // restored from the state file and not yet replaced by a reply of the host, see Controller::state_file
+    bool stale = false;
+};
+
+template<typename T>
+using SnapshotPtr = std::shared_ptr<const Snapshot<T>>;
+
+}}
+
+#endif
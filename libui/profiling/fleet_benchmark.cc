@@ -0,0 +1,583 @@
+/* libui/profiling/fleet_benchmark.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+// Polls many hosts with a Controller for a fixed duration and reports the throughput, the cost per rpc
+// and the latency of the updates, e.g. against the clients simulated by mock_clients. See usage() for the options.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <woinc/ui/controller.h>
+
+// counts the allocations of the whole process, including the ones of libwoincui
+static std::atomic<std::uint64_t> allocations__{0};
+
+void *operator new(std::size_t size) {
+    allocations__.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using namespace woinc::ui;
+
+typedef std::chrono::steady_clock Clock;
+
+const std::map<std::string, PeriodicTask> TASKS__ = {
+    {"cc_status",      PeriodicTask::GetCCStatus},
+    {"client_state",   PeriodicTask::GetClientState},
+    {"disk_usage",     PeriodicTask::GetDiskUsage},
+    {"file_transfers", PeriodicTask::GetFileTransfers},
+    {"messages",       PeriodicTask::GetMessages},
+    {"notices",        PeriodicTask::GetNotices},
+    {"projects",       PeriodicTask::GetProjectStatus},
+    {"statistics",     PeriodicTask::GetStatistics},
+    {"tasks",          PeriodicTask::GetTasks}
+};
+
+struct Options {
+    std::size_t hosts = 10;
+    std::uint16_t port = 31416;
+    bool addresses = false;
+    std::string password;
+
+    // the polling profile
+    std::set<PeriodicTask> tasks;
+    std::map<PeriodicTask, std::chrono::milliseconds> intervals;
+    double scale = 1;
+    bool coalesced = false;
+    bool bulk_connection = false;
+    std::size_t connect_concurrency = 8;
+
+    std::chrono::seconds warmup{5};
+    std::chrono::seconds duration{30};
+
+    // spawns the mock clients with the hosts, port and password of the benchmark and the given arguments
+    std::string mock;
+    std::vector<std::string> mock_arguments;
+
+    // records the rpcs to or replays them from the capture file
+    std::string record;
+    std::string replay;
+    double replay_speed = 1;
+};
+
+[[ noreturn ]] void usage(std::ostream &out, int exit_code) {
+    out << "Usage: fleet_benchmark [options] [-- mock_clients options]\n"
+        << "\n"
+        << "Hosts:\n"
+        << "  --hosts N                hosts to poll (default 10)\n"
+        << "  --port PORT              port of the first host, the others use the following ports (default 31416)\n"
+        << "  --addresses              the hosts are 127.0.0.1, 127.0.0.2, .. with the same port instead\n"
+        << "  --passwd PASSWORD        authorize the hosts with the password\n"
+        << "  --mock PATH              run the mock_clients at PATH for the hosts during the benchmark,\n"
+        << "                           the arguments after -- are passed to it\n"
+        << "  --record PATH            record the rpcs to the capture file\n"
+        << "  --replay PATH            serve the hosts from the capture file instead of connecting to them\n"
+        << "  --replay-speed F         replay the recorded round trips F times faster, 0 without delays (default 1)\n"
+        << "\n"
+        << "Polling profile:\n"
+        << "  --tasks TASK,..          the periodic tasks to poll (default all)\n"
+        << "  --interval TASK=MS       interval of the task\n"
+        << "  --scale F                divides the intervals not set explicitly (default 1)\n"
+        << "  --coalesced              use DispatchMode::Coalesced\n"
+        << "  --bulk                   use a second connection for the commands with large replies\n"
+        << "  --connect-concurrency N  concurrent connects (default 8)\n"
+        << "\n"
+        << "Run:\n"
+        << "  --warmup SEC             seconds to run before measuring (default 5)\n"
+        << "  --duration SEC           seconds to measure (default 30)\n"
+        << "\n"
+        << "Tasks: ";
+    for (const auto &task : TASKS__)
+        out << task.first << (&task == &*TASKS__.rbegin() ? "\n" : ", ");
+    std::exit(exit_code);
+}
+
+[[ noreturn ]] void die(const std::string &msg) {
+    std::cerr << "fleet_benchmark: " << msg << "\n";
+    std::exit(EXIT_FAILURE);
+}
+
+template<typename T>
+T parse_number__(const std::string &option, const std::string &value) {
+    try {
+        std::size_t end;
+        T result;
+        if (std::is_floating_point<T>::value) {
+            result = static_cast<T>(std::stod(value, &end));
+        } else {
+            // e.g. a port of 70000 must not wrap around
+            auto number = std::stoull(value, &end);
+            if (static_cast<long double>(number) > static_cast<long double>(std::numeric_limits<T>::max()))
+                end = 0;
+            result = static_cast<T>(number);
+        }
+        if (end == value.size() && value.front() != '-')
+            return result;
+    } catch (...) {}
+    die("Invalid value \"" + value + "\" of " + option);
+}
+
+PeriodicTask parse_task__(const std::string &name) {
+    auto task = TASKS__.find(name);
+    if (task == TASKS__.end())
+        die("Unknown task \"" + name + "\"");
+    return task->second;
+}
+
+Options parse_options(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string option(argv[i]);
+
+        auto value = [&]() -> std::string {
+            if (i + 1 == argc)
+                die("Missing value after " + option);
+            return argv[++i];
+        };
+
+        if (option == "-h" || option == "--help") {
+            usage(std::cout, EXIT_SUCCESS);
+        } else if (option == "--") {
+            options.mock_arguments.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (option == "--hosts") {
+            options.hosts = parse_number__<std::size_t>(option, value());
+        } else if (option == "--port") {
+            options.port = parse_number__<std::uint16_t>(option, value());
+        } else if (option == "--addresses") {
+            options.addresses = true;
+        } else if (option == "--passwd") {
+            options.password = value();
+        } else if (option == "--mock") {
+            options.mock = value();
+        } else if (option == "--tasks") {
+            std::istringstream names(value());
+            std::string name;
+            while (std::getline(names, name, ','))
+                options.tasks.insert(parse_task__(name));
+        } else if (option == "--interval") {
+            const auto interval = value();
+            const auto separator = interval.find('=');
+            if (separator == std::string::npos)
+                die("Expected TASK=MS after --interval");
+            options.intervals[parse_task__(interval.substr(0, separator))] =
+                std::chrono::milliseconds(parse_number__<std::uint32_t>(option, interval.substr(separator + 1)));
+        } else if (option == "--record") {
+            options.record = value();
+        } else if (option == "--replay") {
+            options.replay = value();
+        } else if (option == "--replay-speed") {
+            options.replay_speed = parse_number__<double>(option, value());
+        } else if (option == "--scale") {
+            options.scale = parse_number__<double>(option, value());
+        } else if (option == "--coalesced") {
+            options.coalesced = true;
+        } else if (option == "--bulk") {
+            options.bulk_connection = true;
+        } else if (option == "--connect-concurrency") {
+            options.connect_concurrency = parse_number__<std::size_t>(option, value());
+        } else if (option == "--warmup") {
+            options.warmup = std::chrono::seconds(parse_number__<std::uint32_t>(option, value()));
+        } else if (option == "--duration") {
+            options.duration = std::chrono::seconds(parse_number__<std::uint32_t>(option, value()));
+        } else {
+            usage(std::cerr, EXIT_FAILURE);
+        }
+    }
+
+    if (options.hosts == 0)
+        die("At least one host is needed");
+    if (!options.addresses && options.port + options.hosts - 1 > 65535)
+        die("Not enough ports for the hosts");
+    if (options.scale <= 0)
+        die("The scale has to be positive");
+    if (options.duration.count() == 0)
+        die("The duration has to be positive");
+    if (options.connect_concurrency == 0)
+        die("The connect concurrency has to be positive");
+    if (!options.record.empty() && !options.replay.empty())
+        die("Either record or replay the rpcs");
+    if (!options.replay.empty() && !options.mock.empty())
+        die("The replayed hosts don't need the mock clients");
+    if (options.replay_speed < 0)
+        die("The replay speed must not be negative");
+
+    if (options.tasks.empty())
+        for (const auto &task : TASKS__)
+            options.tasks.insert(task.second);
+
+    return options;
+}
+
+std::string address__(const Options &options, std::size_t host) {
+    in_addr address;
+    address.s_addr = htonl(INADDR_LOOPBACK + static_cast<std::uint32_t>(options.addresses ? host : 0));
+    char buffer[INET_ADDRSTRLEN];
+    return inet_ntop(AF_INET, &address, buffer, sizeof(buffer));
+}
+
+std::uint16_t port__(const Options &options, std::size_t host) {
+    return static_cast<std::uint16_t>(options.port + (options.addresses ? 0 : host));
+}
+
+// ---- the mock clients ----
+
+bool is_listening__(const std::string &address, std::uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, address.c_str(), &addr.sin_addr);
+
+    bool connected = connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    close(fd);
+    return connected;
+}
+
+pid_t spawn_mock(const Options &options) {
+    std::vector<std::string> arguments = {
+        options.mock,
+        "--clients", std::to_string(options.hosts),
+        "--port", std::to_string(options.port)
+    };
+    if (options.addresses)
+        arguments.push_back("--addresses");
+    if (!options.password.empty()) {
+        arguments.push_back("--passwd");
+        arguments.push_back(options.password);
+    }
+    arguments.insert(arguments.end(), options.mock_arguments.begin(), options.mock_arguments.end());
+
+    std::vector<char *> argv;
+    for (auto &argument : arguments)
+        argv.push_back(&argument[0]);
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0)
+        die(std::string("Error forking the mock clients: ") + std::strerror(errno));
+
+    if (pid == 0) {
+        // keep the report of the mock out of ours
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0)
+            dup2(null, STDOUT_FILENO);
+        execv(argv[0], argv.data());
+        std::fprintf(stderr, "fleet_benchmark: Error executing %s: %s\n", argv[0], std::strerror(errno));
+        _exit(EXIT_FAILURE);
+    }
+
+    // the last host listens once all do
+    const auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (!is_listening__(address__(options, options.hosts - 1), port__(options, options.hosts - 1))) {
+        if (Clock::now() > deadline || waitpid(pid, nullptr, WNOHANG) == pid)
+            die("The mock clients didn't start");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return pid;
+}
+
+void stop_mock(pid_t pid) {
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+}
+
+// ---- the handlers ----
+
+class HostStarter : public HostHandler {
+    public:
+        HostStarter(Controller &controller, const std::string &password)
+            : controller_(controller), password_(password) {}
+
+        void on_host_connected(const std::string &host) final {
+            if (password_.empty())
+                start_(host);
+            else
+                controller_.authorize_host(host, password_);
+        }
+
+        void on_host_authorized(const std::string &host) final {
+            start_(host);
+        }
+
+        void on_host_authorization_failed(const std::string &) final {
+            ++errors;
+        }
+
+        void on_host_error(const std::string &, Error) final {
+            ++errors;
+        }
+
+        std::atomic<std::size_t> started{0};
+        std::atomic<std::size_t> errors{0};
+
+    private:
+        void start_(const std::string &host) {
+            controller_.schedule_periodic_tasks(host, true);
+            ++started;
+        }
+
+    private:
+        Controller &controller_;
+        const std::string password_;
+};
+
+// just counts the updates, the handlers of a real gui would copy the entities at least
+class UpdateCounter : public PeriodicTaskHandler {
+    public:
+        using PeriodicTaskHandler::on_update;
+
+        void on_update(const std::string &, const woinc::CCStatus &) final { ++updates; }
+        void on_update(const std::string &, const woinc::ClientState &) final { ++updates; }
+        void on_update(const std::string &, const woinc::DiskUsage &) final { ++updates; }
+        void on_update(const std::string &, const woinc::FileTransfers &) final { ++updates; }
+        void on_update(const std::string &, const woinc::Messages &) final { ++updates; }
+        void on_update(const std::string &, const woinc::Notices &, bool) final { ++updates; }
+        void on_update(const std::string &, const woinc::Projects &) final { ++updates; }
+        void on_update(const std::string &, const woinc::Statistics &) final { ++updates; }
+        void on_update(const std::string &, const woinc::Tasks &) final { ++updates; }
+
+        std::atomic<std::uint64_t> updates{0};
+};
+
+// ---- the report ----
+
+// the value of the field in /proc/self/status, e.g. the threads or the resident memory in kB
+std::uint64_t process_status__(const std::string &field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+            return std::strtoull(line.c_str() + field.size() + 1, nullptr, 10);
+    return 0;
+}
+
+struct Usage {
+    double cpu_seconds = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t threads = 0;
+    std::uint64_t rss_kib = 0;
+    std::uint64_t peak_rss_kib = 0;
+
+    static Usage now() {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        Usage result;
+        result.cpu_seconds = static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+            + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+        result.allocations = allocations__.load(std::memory_order_relaxed);
+        result.threads = process_status__("Threads");
+        result.rss_kib = process_status__("VmRSS");
+        result.peak_rss_kib = process_status__("VmHWM");
+        return result;
+    }
+};
+
+double milliseconds__(std::uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e6;
+}
+
+void print_latency(std::ostream &out, const std::string &name, std::uint64_t polls, const Histogram &histogram) {
+    out << "  " << std::left << std::setw(16) << name << std::right
+        << std::setw(10) << polls
+        << std::setw(10) << histogram.count()
+        << std::setw(10) << milliseconds__(histogram.percentile(50))
+        << std::setw(10) << milliseconds__(histogram.percentile(99))
+        << std::setw(10) << milliseconds__(histogram.max()) << "\n";
+}
+
+void report(std::ostream &out, const Options &options, const std::vector<HostMetrics> &metrics,
+            const Usage &begin, const Usage &end, double seconds, std::uint64_t updates, std::size_t errors) {
+    HostMetrics fleet;
+    for (const auto &host : metrics)
+        fleet.merge(host);
+
+    std::uint64_t periodic_rpcs = 0;
+    Histogram latency, round_trip;
+    for (auto task : options.tasks) {
+        periodic_rpcs += fleet.periodic(MetricSeries::RpcRoundTrip, task).count();
+        latency.merge(fleet.periodic(MetricSeries::UpdateLatency, task));
+        round_trip.merge(fleet.periodic(MetricSeries::RpcRoundTrip, task));
+    }
+    const auto rpcs = periodic_rpcs + fleet.commands(MetricSeries::RpcRoundTrip).count();
+
+    const auto cpu = end.cpu_seconds - begin.cpu_seconds;
+    const auto allocations = end.allocations - begin.allocations;
+    auto per = [](double value, std::uint64_t count) { return count == 0 ? 0.0 : value / static_cast<double>(count); };
+
+    out << std::fixed << std::setprecision(1)
+        << "hosts: " << options.hosts << ", measured: " << seconds << " s"
+        << ", dispatch mode: " << (options.coalesced ? "coalesced" : "direct")
+        << (options.bulk_connection ? ", bulk connection" : "") << "\n"
+        << "rpcs: " << rpcs << " (" << per(static_cast<double>(rpcs), 1) / seconds << "/s), periodic: " << periodic_rpcs
+        << ", updates: " << updates << ", host errors: " << errors << "\n"
+        << "cpu: " << std::setprecision(2) << cpu << " s, " << std::setprecision(1) << per(cpu * 1e6, rpcs) << " us per rpc\n"
+        << "allocations: " << allocations << ", " << per(static_cast<double>(allocations), periodic_rpcs) << " per poll\n"
+        << "threads: " << end.threads
+        << ", rss: " << static_cast<double>(end.rss_kib) / 1024 << " MiB"
+        << " (peak " << static_cast<double>(end.peak_rss_kib) / 1024 << " MiB)\n"
+        << "\n"
+        << std::setprecision(2)
+        << "latency from due to handlers [ms], unchanged replies aren't passed to the handlers\n"
+        << "  " << std::left << std::setw(16) << "task" << std::right << std::setw(10) << "polls"
+        << std::setw(10) << "updates" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+
+    for (const auto &task : TASKS__)
+        if (options.tasks.count(task.second))
+            print_latency(out, task.first, fleet.periodic(MetricSeries::RpcRoundTrip, task.second).count(),
+                          fleet.periodic(MetricSeries::UpdateLatency, task.second));
+    print_latency(out, "all", periodic_rpcs, latency);
+
+    out << "\nround trip [ms]\n";
+    print_latency(out, "all", periodic_rpcs, round_trip);
+}
+
+}
+
+int main(int argc, char **argv) {
+    const auto options = parse_options(argc, argv);
+
+    const pid_t mock = options.mock.empty() ? 0 : spawn_mock(options);
+
+    std::vector<std::string> hosts;
+    for (std::size_t i = 0; i < options.hosts; ++i)
+        hosts.push_back("host" + std::to_string(i));
+
+    std::vector<HostMetrics> metrics;
+    Usage begin, end;
+    std::uint64_t updates;
+    std::size_t errors;
+    double seconds;
+
+    {
+        Controller controller;
+        HostStarter starter(controller, options.password);
+        UpdateCounter counter;
+
+        for (const auto &task : TASKS__) {
+            auto interval = options.intervals.find(task.second);
+            controller.periodic_task_interval(task.second, interval != options.intervals.end()
+                ? interval->second
+                : std::chrono::duration_cast<std::chrono::milliseconds>(
+                    controller.periodic_task_interval(task.second) / options.scale));
+        }
+
+        controller.dispatch_mode(options.coalesced ? DispatchMode::Coalesced : DispatchMode::Direct);
+        controller.bulk_connection(options.bulk_connection);
+        controller.connect_concurrency(options.connect_concurrency);
+
+        try {
+            if (!options.record.empty())
+                controller.record_rpcs(options.record);
+            if (!options.replay.empty())
+                controller.replay_rpcs(options.replay, options.replay_speed);
+        } catch (const std::exception &err) {
+            die(err.what());
+        }
+
+        controller.register_handler(&starter);
+        // only the subscribed tasks are polled
+        controller.register_handler(&counter, PeriodicTaskSubscription{{}, options.tasks});
+
+        for (std::size_t i = 0; i < options.hosts; ++i)
+            controller.add_host(hosts[i], address__(options, i), port__(options, i));
+
+        // the warmup includes connecting the hosts
+        const auto started = Clock::now();
+        std::this_thread::sleep_for(options.warmup);
+        while (starter.started < options.hosts && starter.errors == 0 && Clock::now() - started < options.warmup * 10)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (starter.started < options.hosts)
+            std::cerr << "fleet_benchmark: Only " << starter.started << " of " << options.hosts << " hosts started\n";
+
+        for (const auto &host : hosts)
+            controller.reset_metrics(host);
+        const auto updates_begin = counter.updates.load();
+        const auto errors_begin = starter.errors.load();
+        const auto measure_begin = Clock::now();
+        begin = Usage::now();
+
+        std::this_thread::sleep_for(options.duration);
+
+        end = Usage::now();
+        seconds = std::chrono::duration<double>(Clock::now() - measure_begin).count();
+        updates = counter.updates - updates_begin;
+        errors = starter.errors - errors_begin;
+        for (const auto &host : hosts)
+            metrics.push_back(controller.metrics(host));
+
+        controller.deregister_handler(&counter);
+        controller.deregister_handler(&starter);
+        controller.shutdown();
+    }
+
+    if (mock != 0)
+        stop_mock(mock);
+
+    report(std::cout, options, metrics, begin, end, seconds, updates, errors);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,980 @@
+/* libui/profiling/mock_clients.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+// Simulates BOINC clients speaking the GUI-RPC protocol to load test libwoincui on a single (Linux) machine.
+// Each client listens on its own port or loopback address, see usage() for the options.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <woinc/rpc_command.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+constexpr char EOM__ = 0x03;
+constexpr std::size_t MAX_MESSAGES__ = 2000;
+
+struct Options {
+    std::size_t clients = 1;
+    std::uint16_t port = 31416;
+    // listen on 127.0.0.1, 127.0.0.2, .. with the same port instead of on consecutive ports
+    bool addresses = false;
+    std::string password;
+
+    std::size_t projects = 5;
+    std::size_t tasks = 50;
+    std::size_t running = 8;
+    std::size_t days = 30;
+    std::size_t messages = 100;
+    std::size_t notices = 10;
+    // additional bytes per task in the replies with tasks
+    std::size_t padding = 0;
+
+    // the fraction of the tasks replaced per minute besides the finished ones
+    double churn = 0.05;
+    // new messages per minute
+    double message_rate = 2;
+    // the running tasks take that many seconds
+    double task_duration = 3600;
+
+    std::chrono::milliseconds latency{0};
+    std::chrono::milliseconds jitter{0};
+    // the fractions of the requests answered by closing the connection or an error
+    double disconnect_rate = 0;
+    double error_rate = 0;
+
+    std::chrono::seconds report{0};
+    std::uint64_t seed = 1;
+};
+
+volatile std::sig_atomic_t stop__ = 0;
+
+extern "C" void on_signal__(int) {
+    stop__ = 1;
+}
+
+[[ noreturn ]] void usage(std::ostream &out, int exit_code) {
+    out << "Usage: mock_clients [options]\n"
+        << "\n"
+        << "Clients:\n"
+        << "  --clients N          simulated clients (default 1)\n"
+        << "  --port PORT          port of the first client, the others use the following ports (default 31416)\n"
+        << "  --addresses          listen on 127.0.0.1, 127.0.0.2, .. with the same port instead\n"
+        << "  --passwd PASSWORD    require the authorization with the password\n"
+        << "\n"
+        << "Replies:\n"
+        << "  --projects N         attached projects per client (default 5)\n"
+        << "  --tasks N            tasks per client (default 50)\n"
+        << "  --running N          running tasks per client (default 8)\n"
+        << "  --days N             days of the statistics per project (default 30)\n"
+        << "  --messages N         initial messages per client (default 100)\n"
+        << "  --notices N          notices per client (default 10)\n"
+        << "  --padding BYTES      additional bytes per task (default 0)\n"
+        << "\n"
+        << "Churn:\n"
+        << "  --churn FRACTION     tasks replaced per minute besides the finished ones (default 0.05)\n"
+        << "  --message-rate N     new messages per minute (default 2)\n"
+        << "  --task-duration SEC  seconds a running task takes (default 3600)\n"
+        << "\n"
+        << "Faults:\n"
+        << "  --latency MS         delay of each reply (default 0)\n"
+        << "  --jitter MS          additional random delay of up to MS (default 0)\n"
+        << "  --disconnect-rate F  fraction of the requests answered by closing the connection (default 0)\n"
+        << "  --error-rate F       fraction of the requests answered with an error (default 0)\n"
+        << "\n"
+        << "Misc:\n"
+        << "  --report SEC         print the counters every SEC seconds (default only at exit)\n"
+        << "  --seed N             seed of the random numbers (default 1)\n";
+    std::exit(exit_code);
+}
+
+[[ noreturn ]] void die(const std::string &msg) {
+    std::cerr << "mock_clients: " << msg << "\n";
+    std::exit(EXIT_FAILURE);
+}
+
+template<typename T>
+T parse_number__(const std::string &option, const std::string &value) {
+    try {
+        std::size_t end;
+        T result;
+        if (std::is_floating_point<T>::value) {
+            result = static_cast<T>(std::stod(value, &end));
+        } else {
+            // e.g. a port of 70000 must not wrap around
+            auto number = std::stoull(value, &end);
+            if (static_cast<long double>(number) > static_cast<long double>(std::numeric_limits<T>::max()))
+                end = 0;
+            result = static_cast<T>(number);
+        }
+        if (end == value.size() && value.front() != '-')
+            return result;
+    } catch (...) {}
+    die("Invalid value \"" + value + "\" of " + option);
+}
+
+Options parse_options(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string option(argv[i]);
+
+        if (option == "-h" || option == "--help")
+            usage(std::cout, EXIT_SUCCESS);
+        if (option == "--addresses") {
+            options.addresses = true;
+            continue;
+        }
+
+        auto value = [&]() -> std::string {
+            if (i + 1 == argc)
+                die("Missing value after " + option);
+            return argv[++i];
+        };
+
+        if (option == "--clients")              options.clients = parse_number__<std::size_t>(option, value());
+        else if (option == "--port")            options.port = parse_number__<std::uint16_t>(option, value());
+        else if (option == "--passwd")          options.password = value();
+        else if (option == "--projects")        options.projects = parse_number__<std::size_t>(option, value());
+        else if (option == "--tasks")           options.tasks = parse_number__<std::size_t>(option, value());
+        else if (option == "--running")         options.running = parse_number__<std::size_t>(option, value());
+        else if (option == "--days")            options.days = parse_number__<std::size_t>(option, value());
+        else if (option == "--messages")        options.messages = parse_number__<std::size_t>(option, value());
+        else if (option == "--notices")         options.notices = parse_number__<std::size_t>(option, value());
+        else if (option == "--padding")         options.padding = parse_number__<std::size_t>(option, value());
+        else if (option == "--churn")           options.churn = parse_number__<double>(option, value());
+        else if (option == "--message-rate")    options.message_rate = parse_number__<double>(option, value());
+        else if (option == "--task-duration")   options.task_duration = parse_number__<double>(option, value());
+        else if (option == "--latency")         options.latency = std::chrono::milliseconds(parse_number__<std::uint32_t>(option, value()));
+        else if (option == "--jitter")          options.jitter = std::chrono::milliseconds(parse_number__<std::uint32_t>(option, value()));
+        else if (option == "--disconnect-rate") options.disconnect_rate = parse_number__<double>(option, value());
+        else if (option == "--error-rate")      options.error_rate = parse_number__<double>(option, value());
+        else if (option == "--report")          options.report = std::chrono::seconds(parse_number__<std::uint32_t>(option, value()));
+        else if (option == "--seed")            options.seed = parse_number__<std::uint64_t>(option, value());
+        else usage(std::cerr, EXIT_FAILURE);
+    }
+
+    if (options.clients == 0)
+        die("At least one client is needed");
+    if (!options.addresses && options.port + options.clients - 1 > 65535)
+        die("Not enough ports for the clients");
+    if (options.projects == 0 && options.tasks > 0)
+        die("The tasks need a project");
+    if (options.task_duration <= 0)
+        die("The task duration has to be positive");
+
+    return options;
+}
+
+// ---- xml ----
+
+void tag__(std::string &out, const char *tag, const std::string &value) {
+    out += '<';
+    out += tag;
+    out += '>';
+    out += value;
+    out += "</";
+    out += tag;
+    out += ">\n";
+}
+
+void tag__(std::string &out, const char *tag, const char *value) {
+    tag__(out, tag, std::string(value));
+}
+
+void tag__(std::string &out, const char *tag, double value) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%f", value);
+    tag__(out, tag, std::string(buffer));
+}
+
+template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+void tag__(std::string &out, const char *tag, T value) {
+    tag__(out, tag, std::to_string(value));
+}
+
+// the content of the first child of the request, e.g. the seqno of get_messages
+std::string content__(const std::string &request, const std::string &tag) {
+    const auto open = "<" + tag + ">";
+    auto begin = request.find(open);
+    if (begin == std::string::npos)
+        return "";
+    begin += open.size();
+    auto end = request.find("</" + tag + ">", begin);
+    return end == std::string::npos ? "" : request.substr(begin, end - begin);
+}
+
+// the tag of the command within <boinc_gui_rpc_request>
+std::string command__(const std::string &request) {
+    auto begin = request.find("<boinc_gui_rpc_request>");
+    if (begin == std::string::npos)
+        return "";
+    begin = request.find('<', begin + 1);
+    if (begin == std::string::npos)
+        return "";
+    auto end = request.find_first_of("/> \n", ++begin);
+    return end == std::string::npos ? "" : request.substr(begin, end - begin);
+}
+
+// ---- MockClient ----
+
+struct MockTask {
+    std::string name;
+    std::size_t project = 0;
+    double fraction_done = 0;
+    std::time_t received = 0;
+    std::time_t deadline = 0;
+};
+
+struct MockMessage {
+    std::uint64_t seqno;
+    std::size_t project;
+    std::time_t time;
+};
+
+// The state of a simulated client, advanced by the wall clock whenever it's asked for its tasks, messages or statistics
+class MockClient {
+    public:
+        MockClient(std::size_t index, const Options &options, std::uint64_t seed);
+
+        void advance(Clock::time_point now);
+
+        std::string cc_status() const;
+        std::string client_state() const;
+        std::string disk_usage() const;
+        std::string file_transfers() const;
+        std::string messages(std::uint64_t seqno) const;
+        std::string notices(std::uint64_t seqno) const;
+        std::string projects() const;
+        std::string statistics() const;
+        std::string tasks() const;
+
+    private:
+        std::string url_(std::size_t project) const;
+        MockTask new_task_(std::time_t now);
+        void add_message_(std::time_t now);
+        // the credits of the project at the time, growing linearly since the start
+        double total_credit_(std::size_t project, std::time_t time) const;
+
+        void write_project_(std::string &out, std::size_t project, std::time_t now) const;
+        void write_task_(std::string &out, const MockTask &task, bool running) const;
+
+    private:
+        const std::size_t index_;
+        const Options &options_;
+        std::mt19937_64 random_;
+
+        const std::time_t start_time_;
+        Clock::time_point last_advance_;
+
+        std::vector<MockTask> tasks_;
+        std::uint64_t task_counter_ = 0;
+        double pending_churn_ = 0;
+
+        std::deque<MockMessage> messages_;
+        std::uint64_t message_seqno_ = 0;
+        double pending_messages_ = 0;
+};
+
+MockClient::MockClient(std::size_t index, const Options &options, std::uint64_t seed)
+    : index_(index), options_(options), random_(seed), start_time_(std::time(nullptr)), last_advance_(Clock::now())
+{
+    tasks_.reserve(options_.tasks);
+    for (std::size_t i = 0; i < options_.tasks; ++i) {
+        tasks_.push_back(new_task_(start_time_));
+        // spread the progress, so the tasks don't finish all at once
+        if (i < options_.running)
+            tasks_.back().fraction_done = std::uniform_real_distribution<double>(0, 1)(random_);
+    }
+
+    for (std::size_t i = 0; i < options_.messages; ++i)
+        add_message_(start_time_);
+}
+
+void MockClient::advance(Clock::time_point now) {
+    const auto elapsed = std::chrono::duration<double>(now - last_advance_).count();
+    last_advance_ = now;
+
+    const auto wall_time = std::time(nullptr);
+
+    // finished running tasks are replaced by new ones at the end of the queue, i.e. the next waiting one starts
+    const auto running = std::min(options_.running, tasks_.size());
+    for (std::size_t i = 0; i < running; ++i) {
+        tasks_[i].fraction_done += elapsed / options_.task_duration;
+        if (tasks_[i].fraction_done >= 1) {
+            tasks_.erase(tasks_.begin() + static_cast<std::ptrdiff_t>(i));
+            tasks_.push_back(new_task_(wall_time));
+        }
+    }
+
+    pending_churn_ += options_.churn * static_cast<double>(tasks_.size()) * elapsed / 60;
+    for (; pending_churn_ >= 1 && !tasks_.empty(); pending_churn_ -= 1) {
+        auto i = std::uniform_int_distribution<std::size_t>(0, tasks_.size() - 1)(random_);
+        tasks_[i] = new_task_(wall_time);
+    }
+
+    pending_messages_ += options_.message_rate * elapsed / 60;
+    for (; pending_messages_ >= 1; pending_messages_ -= 1)
+        add_message_(wall_time);
+}
+
+std::string MockClient::url_(std::size_t project) const {
+    return "https://project" + std::to_string(project) + ".mock/";
+}
+
+MockTask MockClient::new_task_(std::time_t now) {
+    MockTask task;
+    task.project = options_.projects == 0 ? 0 : task_counter_ % options_.projects;
+    task.name = "wu_" + std::to_string(index_) + "_" + std::to_string(task_counter_) + "_0";
+    task.received = now;
+    // a few tasks are near their deadline
+    task.deadline = now + std::uniform_int_distribution<std::time_t>(3600, 14 * 86400)(random_);
+    ++task_counter_;
+    return task;
+}
+
+void MockClient::add_message_(std::time_t now) {
+    messages_.push_back(MockMessage{++message_seqno_, options_.projects == 0 ? 0 : message_seqno_ % options_.projects, now});
+    if (messages_.size() > MAX_MESSAGES__)
+        messages_.pop_front();
+}
+
+double MockClient::total_credit_(std::size_t project, std::time_t time) const {
+    const auto rate = 10.0 * static_cast<double>(project + 1); // per hour
+    return 100000.0 * static_cast<double>(index_ + 1) + rate * static_cast<double>(time - start_time_ + 30 * 86400) / 3600;
+}
+
+std::string MockClient::cc_status() const {
+    std::string out("<cc_status>\n");
+    tag__(out, "network_status", 0);
+    tag__(out, "ams_password_error", 0);
+    tag__(out, "task_suspend_reason", 0);
+    tag__(out, "task_mode", 2);
+    tag__(out, "task_mode_perm", 2);
+    tag__(out, "task_mode_delay", 0.0);
+    tag__(out, "gpu_suspend_reason", 0);
+    tag__(out, "gpu_mode", 2);
+    tag__(out, "gpu_mode_perm", 2);
+    tag__(out, "gpu_mode_delay", 0.0);
+    tag__(out, "network_suspend_reason", 0);
+    tag__(out, "network_mode", 2);
+    tag__(out, "network_mode_perm", 2);
+    tag__(out, "network_mode_delay", 0.0);
+    tag__(out, "disallow_attach", 0);
+    tag__(out, "simple_gui_only", 0);
+    tag__(out, "max_event_log_lines", 2000);
+    out += "</cc_status>\n";
+    return out;
+}
+
+std::string MockClient::client_state() const {
+    const auto now = std::time(nullptr);
+    std::string out("<client_state>\n");
+
+    for (std::size_t project = 0; project < options_.projects; ++project) {
+        write_project_(out, project, now);
+
+        out += "<app>\n";
+        tag__(out, "name", "mock");
+        tag__(out, "user_friendly_name", "Mock application");
+        tag__(out, "non_cpu_intensive", 0);
+        out += "</app>\n";
+
+        out += "<app_version>\n";
+        tag__(out, "app_name", "mock");
+        tag__(out, "version_num", 100);
+        tag__(out, "platform", "x86_64-pc-linux-gnu");
+        tag__(out, "avg_ncpus", 1.0);
+        out += "</app_version>\n";
+
+        for (const auto &task : tasks_) {
+            if (task.project != project)
+                continue;
+            out += "<workunit>\n";
+            tag__(out, "name", task.name.substr(0, task.name.size() - 2));
+            tag__(out, "app_name", "mock");
+            tag__(out, "version_num", 100);
+            tag__(out, "rsc_fpops_est", 1e13);
+            tag__(out, "rsc_fpops_bound", 1e15);
+            tag__(out, "rsc_memory_bound", 5e8);
+            tag__(out, "rsc_disk_bound", 1e9);
+            out += "</workunit>\n";
+        }
+    }
+
+    const auto running = std::min(options_.running, tasks_.size());
+    for (std::size_t i = 0; i < tasks_.size(); ++i)
+        write_task_(out, tasks_[i], i < running);
+
+    out += "<time_stats>\n";
+    tag__(out, "on_frac", 0.99);
+    tag__(out, "connected_frac", 0.99);
+    tag__(out, "cpu_and_network_available_frac", 0.99);
+    tag__(out, "active_frac", 0.99);
+    tag__(out, "gpu_active_frac", 0.99);
+    tag__(out, "client_start_time", static_cast<double>(start_time_));
+    tag__(out, "total_start_time", static_cast<double>(start_time_ - 365 * 86400));
+    tag__(out, "total_duration", 365.0 * 86400);
+    tag__(out, "total_active_duration", 360.0 * 86400);
+    tag__(out, "total_gpu_active_duration", 360.0 * 86400);
+    tag__(out, "now", static_cast<double>(now));
+    tag__(out, "previous_uptime", static_cast<double>(now - start_time_));
+    tag__(out, "session_active_duration", static_cast<double>(now - start_time_));
+    tag__(out, "session_gpu_active_duration", static_cast<double>(now - start_time_));
+    out += "</time_stats>\n";
+
+    out += "</client_state>\n";
+    return out;
+}
+
+std::string MockClient::disk_usage() const {
+    std::string out("<disk_usage_summary>\n");
+    for (std::size_t project = 0; project < options_.projects; ++project) {
+        out += "<project>\n";
+        tag__(out, "master_url", url_(project));
+        tag__(out, "disk_usage", 1e8 * static_cast<double>(project + 1));
+        out += "</project>\n";
+    }
+    tag__(out, "d_total", 1e12);
+    tag__(out, "d_free", 5e11);
+    tag__(out, "d_boinc", 1e9);
+    tag__(out, "d_allowed", 1e11);
+    out += "</disk_usage_summary>\n";
+    return out;
+}
+
+std::string MockClient::file_transfers() const {
+    return "<file_transfers>\n</file_transfers>\n";
+}
+
+std::string MockClient::messages(std::uint64_t seqno) const {
+    std::string out("<msgs>\n");
+
+    auto first = std::lower_bound(messages_.begin(), messages_.end(), seqno + 1, [](const MockMessage &m, std::uint64_t s) {
+        return m.seqno < s;
+    });
+
+    for (; first != messages_.end(); ++first) {
+        out += "<msg>\n";
+        tag__(out, "project", options_.projects == 0 ? std::string() : "Project " + std::to_string(first->project));
+        tag__(out, "pri", 1);
+        tag__(out, "seqno", first->seqno);
+        tag__(out, "body", "Simulated message " + std::to_string(first->seqno));
+        tag__(out, "time", first->time);
+        out += "</msg>\n";
+    }
+
+    out += "</msgs>\n";
+    return out;
+}
+
+std::string MockClient::notices(std::uint64_t seqno) const {
+    std::string out("<notices>\n");
+
+    for (std::uint64_t i = seqno + 1; i <= options_.notices; ++i) {
+        out += "<notice>\n";
+        tag__(out, "title", "Notice " + std::to_string(i));
+        tag__(out, "description", "Simulated notice " + std::to_string(i));
+        tag__(out, "create_time", static_cast<double>(start_time_));
+        tag__(out, "arrival_time", static_cast<double>(start_time_));
+        tag__(out, "is_private", 0);
+        tag__(out, "project_name", "Project 0");
+        tag__(out, "category", "client");
+        tag__(out, "link", "https://project0.mock/");
+        tag__(out, "seqno", i);
+        out += "</notice>\n";
+    }
+
+    out += "</notices>\n";
+    return out;
+}
+
+std::string MockClient::projects() const {
+    const auto now = std::time(nullptr);
+    std::string out("<projects>\n");
+    for (std::size_t project = 0; project < options_.projects; ++project)
+        write_project_(out, project, now);
+    out += "</projects>\n";
+    return out;
+}
+
+std::string MockClient::statistics() const {
+    const auto now = std::time(nullptr);
+    const auto today = now - now % 86400;
+
+    std::string out("<statistics>\n");
+
+    for (std::size_t project = 0; project < options_.projects; ++project) {
+        out += "<project_statistics>\n";
+        tag__(out, "master_url", url_(project));
+
+        for (std::size_t i = options_.days; i > 0; --i) {
+            const auto day = today - static_cast<std::time_t>(i - 1) * 86400;
+            // the days are over except today
+            const auto time = i == 1 ? now : day + 86399;
+            const auto total = total_credit_(project, time);
+
+            out += "<daily_statistics>\n";
+            tag__(out, "day", static_cast<double>(day));
+            tag__(out, "user_total_credit", 10 * total);
+            tag__(out, "user_expavg_credit", 2400.0 * static_cast<double>(project + 1));
+            tag__(out, "host_total_credit", total);
+            tag__(out, "host_expavg_credit", 240.0 * static_cast<double>(project + 1));
+            out += "</daily_statistics>\n";
+        }
+
+        out += "</project_statistics>\n";
+    }
+
+    out += "</statistics>\n";
+    return out;
+}
+
+std::string MockClient::tasks() const {
+    std::string out("<results>\n");
+    const auto running = std::min(options_.running, tasks_.size());
+    for (std::size_t i = 0; i < tasks_.size(); ++i)
+        write_task_(out, tasks_[i], i < running);
+    out += "</results>\n";
+    return out;
+}
+
+void MockClient::write_project_(std::string &out, std::size_t project, std::time_t now) const {
+    out += "<project>\n";
+    tag__(out, "master_url", url_(project));
+    tag__(out, "project_name", "Project " + std::to_string(project));
+    tag__(out, "user_name", "mock");
+    tag__(out, "team_name", "mocks");
+    tag__(out, "host_venue", "");
+    tag__(out, "hostid", 1000 + index_);
+    tag__(out, "user_total_credit", 10 * total_credit_(project, now));
+    tag__(out, "user_expavg_credit", 2400.0 * static_cast<double>(project + 1));
+    tag__(out, "host_total_credit", total_credit_(project, now));
+    tag__(out, "host_expavg_credit", 240.0 * static_cast<double>(project + 1));
+    tag__(out, "resource_share", 100.0);
+    tag__(out, "disk_usage", 1e8 * static_cast<double>(project + 1));
+    tag__(out, "njobs_success", 1000);
+    tag__(out, "njobs_error", 1);
+    tag__(out, "elapsed_time", 3.6e6);
+    tag__(out, "last_rpc_time", static_cast<double>(now - 600));
+    tag__(out, "sched_priority", -0.1 * static_cast<double>(project));
+    tag__(out, "duration_correction_factor", 1.0);
+    tag__(out, "project_dir", "/var/lib/boinc/projects/project" + std::to_string(project) + ".mock");
+    out += "</project>\n";
+}
+
+void MockClient::write_task_(std::string &out, const MockTask &task, bool running) const {
+    out += "<result>\n";
+    tag__(out, "name", task.name);
+    tag__(out, "wu_name", task.name.substr(0, task.name.size() - 2));
+    tag__(out, "platform", "x86_64-pc-linux-gnu");
+    tag__(out, "version_num", 100);
+    tag__(out, "project_url", url_(task.project));
+    tag__(out, "final_cpu_time", 0.0);
+    tag__(out, "final_elapsed_time", 0.0);
+    tag__(out, "exit_status", 0);
+    tag__(out, "state", 2);
+    tag__(out, "report_deadline", static_cast<double>(task.deadline));
+    tag__(out, "received_time", static_cast<double>(task.received));
+    tag__(out, "estimated_cpu_time_remaining", options_.task_duration * (1 - task.fraction_done));
+    tag__(out, "resources", "1 CPU");
+
+    if (running) {
+        const auto elapsed = options_.task_duration * task.fraction_done;
+        out += "<active_task>\n";
+        tag__(out, "active_task_state", 1);
+        tag__(out, "app_version_num", 100);
+        tag__(out, "slot", 0);
+        tag__(out, "pid", 10000 + static_cast<int>(task.received % 10000));
+        tag__(out, "scheduler_state", 2);
+        tag__(out, "checkpoint_cpu_time", elapsed);
+        tag__(out, "fraction_done", task.fraction_done);
+        tag__(out, "current_cpu_time", elapsed);
+        tag__(out, "elapsed_time", elapsed);
+        tag__(out, "swap_size", 1e8);
+        tag__(out, "working_set_size_smoothed", 1e8);
+        tag__(out, "progress_rate", 1 / options_.task_duration);
+        out += "</active_task>\n";
+    }
+
+    if (options_.padding > 0)
+        tag__(out, "padding", std::string(options_.padding, 'x'));
+
+    out += "</result>\n";
+}
+
+// ---- Server ----
+
+struct Counters {
+    std::uint64_t connections = 0;
+    std::uint64_t requests = 0;
+    std::uint64_t bytes_in = 0;
+    std::uint64_t bytes_out = 0;
+    std::uint64_t disconnects = 0;
+    std::uint64_t errors = 0;
+    std::map<std::string, std::uint64_t> commands;
+};
+
+struct Connection {
+    std::size_t client = 0;
+    std::string in;
+    std::string out;
+    std::size_t written = 0;
+    // the replies waiting for their injected latency, in order
+    std::deque<std::pair<Clock::time_point, std::string>> delayed;
+    bool authorized = false;
+    std::string nonce;
+    bool closing = false;
+};
+
+class Server {
+    public:
+        explicit Server(const Options &options);
+        ~Server();
+
+        Server(const Server &) = delete;
+        Server &operator=(const Server &) = delete;
+
+        void run();
+        void report(std::ostream &out) const;
+
+    private:
+        void listen_();
+        void accept_(int listener, std::size_t client);
+        // returns false if the connection has to be closed
+        bool read_(int fd, Connection &connection);
+        bool write_(int fd, Connection &connection);
+        void handle_(Connection &connection, const std::string &request);
+        std::string reply_(Connection &connection, const std::string &command, const std::string &request);
+
+    private:
+        const Options &options_;
+        std::mt19937_64 random_;
+        std::vector<MockClient> clients_;
+        std::vector<int> listeners_;
+        std::map<int, Connection> connections_;
+        Counters counters_;
+};
+
+Server::Server(const Options &options)
+    : options_(options), random_(options.seed)
+{
+    clients_.reserve(options_.clients);
+    for (std::size_t i = 0; i < options_.clients; ++i)
+        clients_.emplace_back(i, options_, options_.seed + i + 1);
+    listen_();
+}
+
+Server::~Server() {
+    for (auto &connection : connections_)
+        close(connection.first);
+    for (auto listener : listeners_)
+        close(listener);
+}
+
+void Server::listen_() {
+    for (std::size_t i = 0; i < options_.clients; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            die(std::string("Error creating the socket: ") + std::strerror(errno));
+
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK + static_cast<std::uint32_t>(options_.addresses ? i : 0));
+        address.sin_port = htons(static_cast<std::uint16_t>(options_.port + (options_.addresses ? 0 : i)));
+
+        if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(fd, 128) != 0)
+            die("Error listening for client " + std::to_string(i) + ": " + std::strerror(errno));
+
+        listeners_.push_back(fd);
+    }
+}
+
+void Server::run() {
+    std::vector<pollfd> fds;
+    auto next_report = Clock::now() + options_.report;
+
+    while (!stop__) {
+        auto now = Clock::now();
+        auto next_due = Clock::time_point::max();
+
+        if (options_.report.count() > 0) {
+            if (now >= next_report) {
+                report(std::cerr);
+                next_report = now + options_.report;
+            }
+            next_due = next_report;
+        }
+
+        fds.clear();
+        for (auto listener : listeners_)
+            fds.push_back(pollfd{listener, POLLIN, 0});
+
+        for (auto &entry : connections_) {
+            auto &connection = entry.second;
+            while (!connection.delayed.empty() && connection.delayed.front().first <= now) {
+                connection.out += connection.delayed.front().second;
+                connection.delayed.pop_front();
+            }
+            if (!connection.delayed.empty())
+                next_due = std::min(next_due, connection.delayed.front().first);
+
+            short events = POLLIN;
+            if (connection.written < connection.out.size())
+                events = static_cast<short>(events | POLLOUT);
+            fds.push_back(pollfd{entry.first, events, 0});
+        }
+
+        int timeout = -1;
+        if (next_due != Clock::time_point::max())
+            timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    next_due - now + std::chrono::milliseconds(1)).count());
+
+        if (poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout) < 0) {
+            if (errno == EINTR)
+                continue;
+            die(std::string("Error polling: ") + std::strerror(errno));
+        }
+
+        for (std::size_t i = 0; i < listeners_.size(); ++i)
+            if (fds[i].revents & POLLIN)
+                accept_(listeners_[i], i);
+
+        for (std::size_t i = listeners_.size(); i < fds.size(); ++i) {
+            if (fds[i].revents == 0)
+                continue;
+
+            auto connection = connections_.find(fds[i].fd);
+            bool open = !(fds[i].revents & (POLLERR | POLLNVAL));
+            if (open && (fds[i].revents & (POLLIN | POLLHUP)))
+                open = read_(fds[i].fd, connection->second);
+            if (open)
+                open = write_(fds[i].fd, connection->second);
+
+            if (!open) {
+                close(fds[i].fd);
+                connections_.erase(connection);
+            }
+        }
+    }
+}
+
+void Server::accept_(int listener, std::size_t client) {
+    while (true) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EINTR)
+                std::cerr << "mock_clients: Error accepting a connection: " << std::strerror(errno) << "\n";
+            return;
+        }
+
+        ++counters_.connections;
+        connections_[fd].client = client;
+    }
+}
+
+bool Server::read_(int fd, Connection &connection) {
+    char buffer[64 * 1024];
+
+    while (true) {
+        auto count = recv(fd, buffer, sizeof(buffer), 0);
+        if (count == 0)
+            return false;
+        if (count < 0)
+            return errno == EAGAIN || errno == EINTR;
+
+        counters_.bytes_in += static_cast<std::uint64_t>(count);
+        connection.in.append(buffer, static_cast<std::size_t>(count));
+
+        std::size_t eom;
+        while (!connection.closing && (eom = connection.in.find(EOM__)) != std::string::npos) {
+            auto request = connection.in.substr(0, eom);
+            connection.in.erase(0, eom + 1);
+            handle_(connection, request);
+        }
+
+        if (connection.closing)
+            return false;
+    }
+}
+
+bool Server::write_(int fd, Connection &connection) {
+    while (connection.written < connection.out.size()) {
+        auto count = send(fd, connection.out.data() + connection.written, connection.out.size() - connection.written, MSG_NOSIGNAL);
+        if (count < 0)
+            return errno == EAGAIN || errno == EINTR;
+
+        counters_.bytes_out += static_cast<std::uint64_t>(count);
+        connection.written += static_cast<std::size_t>(count);
+    }
+
+    connection.out.clear();
+    connection.written = 0;
+    return true;
+}
+
+void Server::handle_(Connection &connection, const std::string &request) {
+    ++counters_.requests;
+
+    std::uniform_real_distribution<double> fraction(0, 1);
+
+    if (options_.disconnect_rate > 0 && fraction(random_) < options_.disconnect_rate) {
+        ++counters_.disconnects;
+        connection.closing = true;
+        return;
+    }
+
+    const auto command = command__(request);
+    ++counters_.commands[command];
+
+    std::string reply("<boinc_gui_rpc_reply>\n");
+    if (options_.error_rate > 0 && fraction(random_) < options_.error_rate) {
+        ++counters_.errors;
+        reply += "<error>Simulated failure</error>\n";
+    } else {
+        reply += reply_(connection, command, request);
+    }
+    reply += "</boinc_gui_rpc_reply>\n";
+    reply += EOM__;
+
+    auto delay = options_.latency;
+    if (options_.jitter.count() > 0)
+        delay += std::chrono::milliseconds(
+            std::uniform_int_distribution<std::chrono::milliseconds::rep>(0, options_.jitter.count())(random_));
+
+    if (delay.count() > 0 || !connection.delayed.empty())
+        connection.delayed.emplace_back(Clock::now() + delay, std::move(reply));
+    else
+        connection.out += reply;
+}
+
+std::string Server::reply_(Connection &connection, const std::string &command, const std::string &request) {
+    auto &client = clients_[connection.client];
+
+    if (command == "auth1") {
+        connection.nonce = std::to_string(std::chrono::system_clock::now().time_since_epoch().count())
+            + "." + std::to_string(random_() % 1000000);
+        return "<nonce>" + connection.nonce + "</nonce>\n";
+    }
+
+    if (command == "auth2") {
+        connection.authorized = !connection.nonce.empty()
+            && content__(request, "nonce_hash") == woinc::rpc::authorization_hash(connection.nonce, options_.password);
+        return connection.authorized ? "<authorized/>\n" : "<unauthorized/>\n";
+    }
+
+    if (command == "exchange_versions")
+        return "<server_version>\n<major>8</major>\n<minor>0</minor>\n<release>2</release>\n</server_version>\n";
+
+    if (!options_.password.empty() && !connection.authorized)
+        return "<unauthorized/>\n";
+
+    auto seqno = [&]() -> std::uint64_t {
+        try {
+            return std::stoull(content__(request, "seqno"));
+        } catch (...) {
+            return 0;
+        }
+    };
+
+    if (command == "get_cc_status")
+        return client.cc_status();
+    if (command == "get_disk_usage")
+        return client.disk_usage();
+    if (command == "get_file_transfers")
+        return client.file_transfers();
+    if (command == "get_notices" || command == "get_notices_public")
+        return client.notices(seqno());
+    if (command == "get_project_status")
+        return client.projects();
+
+    client.advance(Clock::now());
+
+    if (command == "get_state")
+        return client.client_state();
+    if (command == "get_messages")
+        return client.messages(seqno());
+    if (command == "get_results")
+        return client.tasks();
+    if (command == "get_statistics")
+        return client.statistics();
+
+    // all other commands just succeed
+    return "<success/>\n";
+}
+
+void Server::report(std::ostream &out) const {
+    out << "connections: " << counters_.connections << " (open " << connections_.size() << ")"
+        << ", requests: " << counters_.requests
+        << ", bytes in: " << counters_.bytes_in
+        << ", bytes out: " << counters_.bytes_out
+        << ", injected disconnects: " << counters_.disconnects
+        << ", injected errors: " << counters_.errors << "\n";
+    for (const auto &command : counters_.commands)
+        out << "  " << (command.first.empty() ? "(invalid)" : command.first) << ": " << command.second << "\n";
+}
+
+}
+
+int main(int argc, char **argv) {
+    const auto options = parse_options(argc, argv);
+
+    std::signal(SIGINT, on_signal__);
+    std::signal(SIGTERM, on_signal__);
+
+    Server server(options);
+
+    std::cerr << "Simulating " << options.clients << " clients on "
+        << (options.addresses ? "127.0.0.1 and the following addresses, port " : "127.0.0.1, ports starting at ")
+        << options.port << "\n";
+
+    server.run();
+    server.report(std::cout);
+
+    return EXIT_SUCCESS;
+}
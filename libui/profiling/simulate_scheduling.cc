@@ -0,0 +1,648 @@
+/* libui/profiling/simulate_scheduling.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+// Runs the PeriodicTasksScheduler for many virtual hosts in virtual time and reports the cost of the scheduling,
+// the job counts, the lateness of the jobs and the fairness between the hosts for each connection policy.
+// The rpcs aren't executed, each job takes its modelled round trip and parsing time instead,
+// the parsing optionally contends for a limited number of cores. See usage() for the options.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <woinc/ui/handler.h>
+#include <woinc/ui/metrics.h>
+
+#include "clock.h"
+#include "configuration.h"
+#include "handler_registry.h"
+#include "job_queue.h"
+#include "jobs.h"
+#include "periodic_tasks_scheduler.h"
+#include "tracer.h"
+
+namespace {
+
+using namespace woinc::ui;
+
+typedef Clock::TimePoint TimePoint;
+typedef std::chrono::nanoseconds Nanoseconds;
+
+const std::map<std::string, PeriodicTask> TASKS__ = {
+    {"cc_status",      PeriodicTask::GetCCStatus},
+    {"client_state",   PeriodicTask::GetClientState},
+    {"disk_usage",     PeriodicTask::GetDiskUsage},
+    {"file_transfers", PeriodicTask::GetFileTransfers},
+    {"messages",       PeriodicTask::GetMessages},
+    {"notices",        PeriodicTask::GetNotices},
+    {"projects",       PeriodicTask::GetProjectStatus},
+    {"statistics",     PeriodicTask::GetStatistics},
+    {"tasks",          PeriodicTask::GetTasks}
+};
+
+constexpr std::size_t TASK_COUNT__ = PERIODIC_TASK_COUNT;
+
+// the connections of a host, see Controller::bulk_connection
+enum class Policy {
+    Single, // one connection, the bulk lane is served after the periodic one
+    Bulk    // a second connection for the bulk lane
+};
+
+const std::map<std::string, Policy> POLICIES__ = {
+    {"single", Policy::Single},
+    {"bulk",   Policy::Bulk}
+};
+
+struct Options {
+    std::size_t hosts = 10000;
+    std::chrono::seconds duration = std::chrono::hours(1);
+
+    std::set<PeriodicTask> tasks;
+    std::map<PeriodicTask, std::chrono::milliseconds> intervals;
+    double scale = 1;
+
+    // per task in milliseconds, roughly a client in the local network
+    std::array<double, TASK_COUNT__> round_trip = {{2, 40, 5, 2, 3, 5, 3, 15, 4}};
+    std::array<double, TASK_COUNT__> parsing = {{0.05, 20, 0.2, 0.05, 0.2, 0.5, 0.3, 5, 1}};
+    // the times vary uniformly by this fraction
+    double jitter = 0.5;
+    // the parsing of all hosts shares the cores, zero for unlimited
+    std::size_t cores = 0;
+
+    std::vector<Policy> policies = {Policy::Single, Policy::Bulk};
+    unsigned int seed = 1;
+};
+
+[[ noreturn ]] void usage(std::ostream &out, int exit_code) {
+    out << "Usage: simulate_scheduling [options]\n"
+        << "\n"
+        << "  --hosts N              virtual hosts (default 10000)\n"
+        << "  --duration SEC         virtual seconds to simulate (default 3600)\n"
+        << "  --tasks TASK,..        the periodic tasks to schedule (default all)\n"
+        << "  --interval TASK=MS     interval of the task\n"
+        << "  --scale F              divides the intervals not set explicitly (default 1)\n"
+        << "  --round-trip TASK=MS   mean round trip of the task's rpc\n"
+        << "  --parsing TASK=MS      mean time to parse the task's reply\n"
+        << "  --jitter F             the times vary uniformly by +-F of their mean (default 0.5)\n"
+        << "  --cores N              the parsing of all hosts shares N cores (default 0, unlimited)\n"
+        << "  --policies P,..        the connection policies to compare: single, bulk (default both)\n"
+        << "  --seed N               seed of the jitter (default 1)\n"
+        << "\n"
+        << "Tasks: ";
+    for (const auto &task : TASKS__)
+        out << task.first << (&task == &*TASKS__.rbegin() ? "\n" : ", ");
+    std::exit(exit_code);
+}
+
+[[ noreturn ]] void die(const std::string &msg) {
+    std::cerr << "simulate_scheduling: " << msg << "\n";
+    std::exit(EXIT_FAILURE);
+}
+
+template<typename T>
+T parse_number__(const std::string &option, const std::string &value) {
+    try {
+        std::size_t end;
+        T result;
+        if (std::is_floating_point<T>::value)
+            result = static_cast<T>(std::stod(value, &end));
+        else
+            result = static_cast<T>(std::stoull(value, &end));
+        if (end == value.size() && value.front() != '-')
+            return result;
+    } catch (...) {}
+    die("Invalid value \"" + value + "\" of " + option);
+}
+
+template<typename T>
+T parse_name__(const std::map<std::string, T> &names, const std::string &name) {
+    auto found = names.find(name);
+    if (found == names.end())
+        die("Unknown name \"" + name + "\"");
+    return found->second;
+}
+
+// splits TASK=VALUE
+std::pair<PeriodicTask, std::string> parse_task_value__(const std::string &option, const std::string &value) {
+    const auto separator = value.find('=');
+    if (separator == std::string::npos)
+        die("Expected TASK=VALUE after " + option);
+    return std::make_pair(parse_name__(TASKS__, value.substr(0, separator)), value.substr(separator + 1));
+}
+
+template<typename T>
+std::vector<T> parse_list__(const std::map<std::string, T> &names, const std::string &list) {
+    std::vector<T> result;
+    std::string::size_type begin = 0;
+    while (begin <= list.size()) {
+        auto end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        result.push_back(parse_name__(names, list.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+    return result;
+}
+
+Options parse_options(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string option(argv[i]);
+
+        auto value = [&]() -> std::string {
+            if (i + 1 == argc)
+                die("Missing value after " + option);
+            return argv[++i];
+        };
+
+        if (option == "-h" || option == "--help") {
+            usage(std::cout, EXIT_SUCCESS);
+        } else if (option == "--hosts") {
+            options.hosts = parse_number__<std::size_t>(option, value());
+        } else if (option == "--duration") {
+            options.duration = std::chrono::seconds(parse_number__<std::uint32_t>(option, value()));
+        } else if (option == "--tasks") {
+            for (auto task : parse_list__(TASKS__, value()))
+                options.tasks.insert(task);
+        } else if (option == "--interval") {
+            auto interval = parse_task_value__(option, value());
+            options.intervals[interval.first] =
+                std::chrono::milliseconds(parse_number__<std::uint32_t>(option, interval.second));
+        } else if (option == "--scale") {
+            options.scale = parse_number__<double>(option, value());
+        } else if (option == "--round-trip") {
+            auto round_trip = parse_task_value__(option, value());
+            options.round_trip[static_cast<std::size_t>(round_trip.first)] = parse_number__<double>(option, round_trip.second);
+        } else if (option == "--parsing") {
+            auto parsing = parse_task_value__(option, value());
+            options.parsing[static_cast<std::size_t>(parsing.first)] = parse_number__<double>(option, parsing.second);
+        } else if (option == "--jitter") {
+            options.jitter = parse_number__<double>(option, value());
+        } else if (option == "--cores") {
+            options.cores = parse_number__<std::size_t>(option, value());
+        } else if (option == "--policies") {
+            options.policies = parse_list__(POLICIES__, value());
+        } else if (option == "--seed") {
+            options.seed = parse_number__<unsigned int>(option, value());
+        } else {
+            usage(std::cerr, EXIT_FAILURE);
+        }
+    }
+
+    if (options.hosts == 0)
+        die("At least one host is needed");
+    if (options.duration.count() == 0)
+        die("The duration has to be positive");
+    if (options.scale <= 0)
+        die("The scale has to be positive");
+    if (options.jitter >= 1)
+        die("The jitter has to be below 1");
+
+    if (options.tasks.empty())
+        for (const auto &task : TASKS__)
+            options.tasks.insert(task.second);
+
+    return options;
+}
+
+// ---- the simulation ----
+
+class VirtualClock : public Clock {
+    public:
+        // far enough from the epoch for the scheduler to subtract its intervals
+        VirtualClock() : now_(std::chrono::hours(24)) {}
+
+        TimePoint now() const override { return now_; }
+        void advance(TimePoint time) { now_ = time; }
+
+    private:
+        TimePoint now_;
+};
+
+// the pooled job of a task of a virtual host, never executed by a client
+struct SimulatedJob : public Job {
+    SimulatedJob(std::size_t host_index, PeriodicTask periodic_task)
+        : Job(periodic_job_lane(periodic_task), true, static_cast<std::size_t>(periodic_task))
+        , host(host_index), task(periodic_task), payload() {}
+
+    void execute(Client &) override {}
+
+    const std::size_t host;
+    const PeriodicTask task;
+    PeriodicJob::Payload payload;
+    TimePoint due;
+    Nanoseconds parsing{0};
+};
+
+// subscribes the simulated tasks, so the scheduler schedules them
+struct Subscriber : public PeriodicTaskHandler {};
+
+struct TaskResult {
+    std::uint64_t jobs = 0;
+    // from getting due until a connection started the job and until it completed
+    Histogram start_lateness;
+    Histogram completion_lateness;
+};
+
+struct Result {
+    double virtual_seconds = 0;
+    double wall_seconds = 0;
+
+    std::uint64_t ticks = 0;
+    // the wall time of the scheduler ticks, i.e. the cost of scanning the hosts
+    Histogram tick_duration;
+    double tick_seconds = 0;
+
+    std::array<TaskResult, TASK_COUNT__> tasks;
+
+    // per host, for the fairness
+    std::vector<std::uint64_t> host_jobs;
+    std::vector<double> host_mean_lateness;
+};
+
+class Simulation {
+    public:
+        Simulation(const Options &options, Policy policy);
+
+        Result run();
+
+    private:
+        enum class EventKind : std::uint8_t { Tick, RoundTripDone, ParsingDone };
+
+        struct Event {
+            TimePoint time;
+            std::uint64_t sequence;
+            EventKind kind;
+            std::uint32_t host;
+            std::uint8_t connection;
+
+            // for the min heap, in order of their time and creation
+            bool operator<(const Event &other) const {
+                return time != other.time ? time > other.time : sequence > other.sequence;
+            }
+        };
+
+        struct Connection {
+            std::unique_ptr<JobQueue> queue;
+            SimulatedJob *running = nullptr;
+        };
+
+        struct Host {
+            std::string name;
+            std::array<Connection, 2> connections;
+            std::array<std::unique_ptr<SimulatedJob>, TASK_COUNT__> jobs;
+            std::uint64_t jobs_done = 0;
+            std::uint64_t lateness_sum = 0;
+        };
+
+    private:
+        void schedule_(const std::string &host, PeriodicTask task, const PeriodicJob::Payload &payload, TimePoint due);
+        void start_(std::uint32_t host, std::uint8_t connection);
+        void parse_(std::uint32_t host, std::uint8_t connection);
+        void complete_(std::uint32_t host, std::uint8_t connection);
+
+        void push_(TimePoint time, EventKind kind, std::uint32_t host = 0, std::uint8_t connection = 0);
+        Nanoseconds vary_(double milliseconds);
+
+    private:
+        const Options &options_;
+        const Policy policy_;
+
+        VirtualClock clock_;
+        Configuration configuration_;
+        HandlerRegistry handler_registry_;
+        Tracer tracer_;
+        Subscriber subscriber_;
+        PeriodicTasksSchedulerContext context_;
+        PeriodicTasksScheduler scheduler_;
+
+        std::vector<Host> hosts_;
+        std::unordered_map<std::string, std::uint32_t> host_indices_;
+
+        std::priority_queue<Event> events_;
+        std::uint64_t sequence_ = 0;
+
+        // the jobs waiting for a core to parse their reply
+        std::deque<std::pair<std::uint32_t, std::uint8_t>> parsing_queue_;
+        std::size_t busy_cores_ = 0;
+
+        std::mt19937_64 random_;
+        std::uniform_real_distribution<double> jitter_;
+
+        Result result_;
+};
+
+Simulation::Simulation(const Options &options, Policy policy)
+    : options_(options)
+    , policy_(policy)
+    , context_(configuration_, handler_registry_, tracer_,
+               [this](const std::string &host, PeriodicTask task, const PeriodicJob::Payload &payload, TimePoint due) {
+                   schedule_(host, task, payload, due);
+               },
+               clock_)
+    , scheduler_(context_)
+    , random_(options.seed)
+    , jitter_(1 - options.jitter, 1 + options.jitter)
+{
+    for (const auto &task : TASKS__) {
+        auto interval = options_.intervals.find(task.second);
+        configuration_.interval(task.second, interval != options_.intervals.end()
+            ? interval->second
+            : std::chrono::duration_cast<std::chrono::milliseconds>(configuration_.interval(task.second) / options_.scale));
+    }
+
+    handler_registry_.register_handler(&subscriber_, PeriodicTaskSubscription{{}, options_.tasks});
+
+    hosts_.resize(options_.hosts);
+    for (std::uint32_t i = 0; i < hosts_.size(); ++i) {
+        auto &host = hosts_[i];
+        char name[32];
+        std::snprintf(name, sizeof(name), "host%06u", i);
+        host.name = name;
+
+        for (auto &connection : host.connections)
+            connection.queue = std::make_unique<JobQueue>(clock_);
+        for (std::size_t task = 0; task < TASK_COUNT__; ++task)
+            host.jobs[task] = std::make_unique<SimulatedJob>(i, static_cast<PeriodicTask>(task));
+
+        host_indices_.emplace(host.name, i);
+        ConfigurationTestHook::add_host(configuration_, host.name);
+        configuration_.schedule_periodic_tasks(host.name, true);
+        context_.add_host(host.name);
+    }
+
+    result_.host_jobs.resize(hosts_.size());
+    result_.host_mean_lateness.resize(hosts_.size());
+}
+
+Result Simulation::run() {
+    const auto begin = clock_.now();
+    const auto end = begin + options_.duration;
+    const auto wall_begin = std::chrono::steady_clock::now();
+
+    push_(begin, EventKind::Tick);
+
+    while (!events_.empty() && events_.top().time <= end) {
+        const auto event = events_.top();
+        events_.pop();
+
+        clock_.advance(event.time);
+
+        switch (event.kind) {
+            case EventKind::Tick:
+                {
+                    const auto tick_begin = std::chrono::steady_clock::now();
+                    const auto next = scheduler_.tick();
+                    const auto duration = std::chrono::steady_clock::now() - tick_begin;
+
+                    result_.ticks++;
+                    result_.tick_duration.record(static_cast<std::uint64_t>(Nanoseconds(duration).count()));
+                    result_.tick_seconds += std::chrono::duration<double>(duration).count();
+
+                    push_(event.time + next, EventKind::Tick);
+                }
+                break;
+            case EventKind::RoundTripDone:
+                parse_(event.host, event.connection);
+                break;
+            case EventKind::ParsingDone:
+                complete_(event.host, event.connection);
+                break;
+        }
+    }
+
+    result_.virtual_seconds = std::chrono::duration<double>(options_.duration).count();
+    result_.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_begin).count();
+
+    for (std::size_t i = 0; i < hosts_.size(); ++i) {
+        const auto &host = hosts_[i];
+        result_.host_jobs[i] = host.jobs_done;
+        result_.host_mean_lateness[i] = host.jobs_done == 0
+            ? 0 : static_cast<double>(host.lateness_sum) / static_cast<double>(host.jobs_done) / 1e6;
+    }
+
+    context_.trigger_shutdown();
+
+    // the queued jobs are owned by the hosts
+    for (auto &host : hosts_)
+        for (auto &connection : host.connections)
+            while (connection.queue->try_pop()) {}
+
+    return std::move(result_);
+}
+
+// called by the scheduler after it unlocked its context
+void Simulation::schedule_(const std::string &name, PeriodicTask task, const PeriodicJob::Payload &payload, TimePoint due) {
+    const auto index = host_indices_.at(name);
+    auto &job = *hosts_[index].jobs[static_cast<std::size_t>(task)];
+
+    job.payload = payload;
+    job.due = due;
+
+    const std::uint8_t connection = policy_ == Policy::Bulk && job.lane() == JobLane::Bulk ? 1 : 0;
+    hosts_[index].connections[connection].queue->push(JobPtr(&job));
+
+    start_(index, connection);
+}
+
+void Simulation::start_(std::uint32_t index, std::uint8_t connection_index) {
+    auto &connection = hosts_[index].connections[connection_index];
+    if (connection.running != nullptr)
+        return;
+
+    auto job = connection.queue->try_pop();
+    if (!job)
+        return;
+
+    auto *simulated = static_cast<SimulatedJob *>(job.release());
+    connection.running = simulated;
+
+    const auto now = clock_.now();
+    const auto task = static_cast<std::size_t>(simulated->task);
+
+    const auto lateness = static_cast<std::uint64_t>(Nanoseconds(now - simulated->due).count());
+    result_.tasks[task].start_lateness.record(lateness);
+    hosts_[index].lateness_sum += lateness;
+
+    simulated->parsing = vary_(options_.parsing[task]);
+    const auto round_trip_done = now + vary_(options_.round_trip[task]);
+
+    // without contending for the cores the job completes right after its parsing, which saves an event
+    if (options_.cores == 0)
+        push_(round_trip_done + simulated->parsing, EventKind::ParsingDone, index, connection_index);
+    else
+        push_(round_trip_done, EventKind::RoundTripDone, index, connection_index);
+}
+
+void Simulation::parse_(std::uint32_t index, std::uint8_t connection) {
+    if (busy_cores_ == options_.cores) {
+        parsing_queue_.emplace_back(index, connection);
+        return;
+    }
+    ++busy_cores_;
+
+    const auto *job = hosts_[index].connections[connection].running;
+    push_(clock_.now() + job->parsing, EventKind::ParsingDone, index, connection);
+}
+
+void Simulation::complete_(std::uint32_t index, std::uint8_t connection_index) {
+    const auto now = clock_.now();
+
+    // the core continues with the next waiting job
+    if (options_.cores != 0) {
+        if (parsing_queue_.empty()) {
+            --busy_cores_;
+        } else {
+            const auto next = parsing_queue_.front();
+            parsing_queue_.pop_front();
+            const auto *job = hosts_[next.first].connections[next.second].running;
+            push_(now + job->parsing, EventKind::ParsingDone, next.first, next.second);
+        }
+    }
+
+    auto &host = hosts_[index];
+    auto &connection = host.connections[connection_index];
+    auto *job = connection.running;
+    connection.running = nullptr;
+
+    auto &task = result_.tasks[static_cast<std::size_t>(job->task)];
+    task.jobs++;
+    task.completion_lateness.record(static_cast<std::uint64_t>(Nanoseconds(now - job->due).count()));
+    host.jobs_done++;
+
+    context_.executed(host.name, job->task, job->payload);
+
+    start_(index, connection_index);
+}
+
+void Simulation::push_(TimePoint time, EventKind kind, std::uint32_t host, std::uint8_t connection) {
+    events_.push(Event{time, sequence_++, kind, host, connection});
+}
+
+Nanoseconds Simulation::vary_(double milliseconds) {
+    return Nanoseconds(static_cast<std::int64_t>(milliseconds * 1e6 * jitter_(random_)));
+}
+
+// ---- the report ----
+
+// 1 if all values are equal, down to 1/n if a single one gets everything
+double jain_index__(const std::vector<double> &values) {
+    double sum = 0, sum_of_squares = 0;
+    for (auto value : values) {
+        sum += value;
+        sum_of_squares += value * value;
+    }
+    return sum_of_squares == 0 ? 1 : sum * sum / (static_cast<double>(values.size()) * sum_of_squares);
+}
+
+double milliseconds__(std::uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e6;
+}
+
+void report(std::ostream &out, const Options &options, const std::string &policy, const Result &result) {
+    out << std::fixed << std::setprecision(2)
+        << "policy: " << policy << ", hosts: " << options.hosts
+        << ", simulated " << result.virtual_seconds << " s in " << result.wall_seconds << " s ("
+        << result.virtual_seconds / result.wall_seconds << "x)\n"
+        << "scheduler ticks: " << result.ticks << ", " << result.tick_seconds << " s in total, per tick p50 "
+        << milliseconds__(result.tick_duration.percentile(50)) << " ms, p99 "
+        << milliseconds__(result.tick_duration.percentile(99)) << " ms, max "
+        << milliseconds__(result.tick_duration.max()) << " ms, "
+        << 1e3 * result.tick_seconds / static_cast<double>(std::max<std::uint64_t>(result.ticks, 1))
+            / static_cast<double>(options.hosts) * 1e3 << " us per host and tick\n";
+
+    std::vector<double> jobs(result.host_jobs.begin(), result.host_jobs.end());
+    const auto minmax = std::minmax_element(result.host_jobs.begin(), result.host_jobs.end());
+    const auto lateness = std::max_element(result.host_mean_lateness.begin(), result.host_mean_lateness.end());
+
+    out << "fairness: jobs per host " << *minmax.first << " to " << *minmax.second
+        << " (Jain index " << std::setprecision(4) << jain_index__(jobs) << std::setprecision(2)
+        << "), mean lateness per host up to " << *lateness << " ms (Jain index " << std::setprecision(4)
+        << jain_index__(result.host_mean_lateness) << std::setprecision(2) << ")\n"
+        << "\n"
+        << "  " << std::left << std::setw(16) << "task" << std::right
+        << std::setw(12) << "jobs" << std::setw(8) << "rate"
+        << std::setw(10) << "start p50" << std::setw(10) << "p99" << std::setw(10) << "max"
+        << std::setw(10) << "done p50" << std::setw(10) << "p99" << "   [ms]\n";
+
+    Configuration defaults;
+    for (const auto &name : TASKS__) {
+        if (options.tasks.find(name.second) == options.tasks.end())
+            continue;
+
+        const auto &task = result.tasks[static_cast<std::size_t>(name.second)];
+
+        // the jobs relative to polling exactly at the interval
+        auto interval = options.intervals.find(name.second);
+        const double interval_seconds = interval != options.intervals.end()
+            ? std::chrono::duration<double>(interval->second).count()
+            : std::chrono::duration<double>(defaults.interval(name.second)).count() / options.scale;
+        const double ideal = static_cast<double>(options.hosts) * (result.virtual_seconds / interval_seconds + 1);
+
+        out << "  " << std::left << std::setw(16) << name.first << std::right
+            << std::setw(12) << task.jobs << std::setw(8) << static_cast<double>(task.jobs) / ideal
+            << std::setw(10) << milliseconds__(task.start_lateness.percentile(50))
+            << std::setw(10) << milliseconds__(task.start_lateness.percentile(99))
+            << std::setw(10) << milliseconds__(task.start_lateness.max())
+            << std::setw(10) << milliseconds__(task.completion_lateness.percentile(50))
+            << std::setw(10) << milliseconds__(task.completion_lateness.percentile(99)) << "\n";
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    const auto options = parse_options(argc, argv);
+
+    bool first = true;
+    for (auto policy : options.policies) {
+        Result result;
+        {
+            Simulation simulation(options, policy);
+            result = simulation.run();
+        }
+
+        if (!first)
+            std::cout << "\n";
+        first = false;
+
+        for (const auto &name : POLICIES__)
+            if (name.second == policy)
+                report(std::cout, options, name.first, result);
+    }
+
+    return EXIT_SUCCESS;
+}
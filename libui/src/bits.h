@@ -0,0 +1,53 @@
+/* libui/src/bits.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_BITS_H_
+#define WOINC_UI_BITS_H_
+
+#include <cstdint>
+
+namespace woinc { namespace ui {
+
+// the number of leading and trailing zero bits of a value other than 0,
+// using the builtins where available
+
+inline unsigned int leading_zeros(std::uint64_t value) {
+#ifdef __GNUC__
+    return static_cast<unsigned int>(__builtin_clzll(value));
+#else
+    unsigned int count = 0;
+    for (std::uint64_t mask = std::uint64_t(1) << 63; (value & mask) == 0; mask >>= 1)
+        ++count;
+    return count;
+#endif
+}
+
+inline unsigned int trailing_zeros(std::uint64_t value) {
+#ifdef __GNUC__
+    return static_cast<unsigned int>(__builtin_ctzll(value));
+#else
+    unsigned int count = 0;
+    for (; (value & 1) == 0; value >>= 1)
+        ++count;
+    return count;
+#endif
+}
+
+}}
+
+#endif
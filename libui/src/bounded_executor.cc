@@ -0,0 +1,126 @@
+/* libui/src/bounded_executor.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "bounded_executor.h"
+
+#include <cassert>
+#include <utility>
+
+#define WOINC_LOCK_GUARD std::lock_guard<decltype(mutex_)> guard(mutex_)
+
+namespace woinc { namespace ui {
+
+BoundedExecutor::BoundedExecutor(std::size_t max_threads) : max_threads_(max_threads) {
+    assert(max_threads_ > 0);
+}
+
+BoundedExecutor::~BoundedExecutor() {
+    shutdown();
+}
+
+bool BoundedExecutor::post(std::function<void()> task, int priority) {
+    {
+        WOINC_LOCK_GUARD;
+
+        if (shutdown_)
+            return false;
+
+        // inserted behind the tasks with the same priority
+        tasks_.emplace(priority, std::move(task));
+        spawn_threads_();
+    }
+
+    condition_.notify_one();
+    return true;
+}
+
+void BoundedExecutor::max_threads(std::size_t value) {
+    assert(value > 0);
+
+    {
+        WOINC_LOCK_GUARD;
+        max_threads_ = value;
+        if (!shutdown_)
+            spawn_threads_();
+    }
+
+    condition_.notify_all();
+}
+
+std::size_t BoundedExecutor::max_threads() const {
+    WOINC_LOCK_GUARD;
+    return max_threads_;
+}
+
+void BoundedExecutor::shutdown() {
+    std::vector<std::thread> threads;
+
+    {
+        WOINC_LOCK_GUARD;
+        shutdown_ = true;
+        tasks_.clear();
+        threads.swap(threads_);
+    }
+
+    condition_.notify_all();
+
+    for (auto &thread : threads) {
+        // a task may shut us down, its thread finishes on its own, so the executor has to outlive the task
+        if (thread.get_id() == std::this_thread::get_id())
+            thread.detach();
+        else
+            thread.join();
+    }
+}
+
+void BoundedExecutor::spawn_threads_() {
+    while (idle_threads_ < tasks_.size() && threads_.size() < max_threads_) {
+        threads_.emplace_back([this]() { run_(); });
+        // counted as idle until it waits the first time, so a burst of posts doesn't start too many
+        ++idle_threads_;
+    }
+}
+
+void BoundedExecutor::run_() {
+    std::unique_lock<decltype(mutex_)> lock(mutex_);
+
+    while (true) {
+        condition_.wait(lock, [this]() { return shutdown_ || (!tasks_.empty() && running_tasks_ < max_threads_); });
+
+        if (shutdown_)
+            break;
+
+        auto task = std::move(tasks_.begin()->second);
+        tasks_.erase(tasks_.begin());
+        --idle_threads_;
+        ++running_tasks_;
+
+        lock.unlock();
+        try {
+            task();
+        } catch (...) {}
+        lock.lock();
+
+        --running_tasks_;
+        ++idle_threads_;
+        // a lowered limit may have kept other threads waiting
+        condition_.notify_one();
+    }
+}
+
+}}
@@ -0,0 +1,76 @@
+/* libui/src/bounded_executor.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_BOUNDED_EXECUTOR_H_
+#define WOINC_UI_BOUNDED_EXECUTOR_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+// Runs the posted tasks on at most max_threads threads, which are started on demand.
+// Tasks with a higher priority run first, those with the same priority in the order they were posted.
+// Exceptions thrown by the tasks are dropped.
+class WOINCUI_LOCAL BoundedExecutor {
+    public:
+        explicit BoundedExecutor(std::size_t max_threads);
+        ~BoundedExecutor();
+
+        BoundedExecutor(const BoundedExecutor &) = delete;
+        BoundedExecutor(BoundedExecutor &&) = delete;
+        BoundedExecutor &operator=(const BoundedExecutor &) = delete;
+        BoundedExecutor &operator=(BoundedExecutor &&) = delete;
+
+        // returns false if the executor is already shut down
+        bool post(std::function<void()> task, int priority = 0);
+
+        // a lowered limit lets the surplus threads idle once their tasks are done
+        void max_threads(std::size_t value);
+        std::size_t max_threads() const;
+
+        // drops the pending tasks and waits for the running ones
+        void shutdown();
+
+    private:
+        // starts the threads needed for the pending tasks, assumes the executor is locked
+        void spawn_threads_();
+        void run_();
+
+    private:
+        mutable std::mutex mutex_;
+        std::condition_variable condition_;
+
+        std::size_t max_threads_;
+        bool shutdown_ = false;
+        std::size_t idle_threads_ = 0;
+        std::size_t running_tasks_ = 0;
+        std::multimap<int, std::function<void()>, std::greater<int>> tasks_;
+        std::vector<std::thread> threads_;
+};
+
+}}
+
+#endif
@@ -18,17 +18,193 @@
 
 #include "client.h"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// the delay before reconnecting to a host doubles with each failed reconnect up to the maximum
+constexpr std::chrono::milliseconds MIN_RECONNECT_BACKOFF__(1000);
+constexpr std::chrono::milliseconds MAX_RECONNECT_BACKOFF__(64000);
+
+// a simple multiply-xorshift hash over 8 byte words, it only has to detect changed replies
+constexpr std::uint64_t HASH_PRIME__ = 0x9E3779B97F4A7C15ULL;
+
+std::uint64_t hash_word__(std::uint64_t hash, std::uint64_t word) {
+    hash = (hash ^ word) * HASH_PRIME__;
+    return hash ^ (hash >> 29);
+}
+
+}
+
 namespace woinc { namespace ui {
 
+// ---- FingerprintingConnection ----
+
+void FingerprintingConnection::Sink::reset(std::ostream &response) {
+    response_ = &response;
+    hash_value_ = HASH_PRIME__;
+    size_ = 0;
+    partial_size_ = 0;
+}
+
+std::uint64_t FingerprintingConnection::Sink::hash() const {
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, partial_, partial_size_);
+    auto hash = (hash_word__(hash_value_, tail) ^ size_) * HASH_PRIME__;
+    return hash ^ (hash >> 32);
+}
+
+FingerprintingConnection::Sink::int_type FingerprintingConnection::Sink::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+    const char ch = traits_type::to_char_type(c);
+    return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+}
+
+std::streamsize FingerprintingConnection::Sink::xsputn(const char *s, std::streamsize n) {
+    hash_(s, static_cast<std::size_t>(n));
+    return response_->write(s, n) ? n : 0;
+}
+
+void FingerprintingConnection::Sink::hash_(const char *s, std::size_t n) {
+    size_ += n;
+
+    // complete the word left over by the last write first
+    if (partial_size_ > 0) {
+        const auto count = std::min(n, sizeof(partial_) - partial_size_);
+        std::memcpy(partial_ + partial_size_, s, count);
+        partial_size_ += count;
+        s += count;
+        n -= count;
+
+        if (partial_size_ < sizeof(partial_))
+            return;
+
+        std::uint64_t word;
+        std::memcpy(&word, partial_, sizeof(word));
+        hash_value_ = hash_word__(hash_value_, word);
+        partial_size_ = 0;
+    }
+
+    for (; n >= sizeof(std::uint64_t); s += sizeof(std::uint64_t), n -= sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, s, sizeof(word));
+        hash_value_ = hash_word__(hash_value_, word);
+    }
+
+    std::memcpy(partial_, s, n);
+    partial_size_ = n;
+}
+
+FingerprintingConnection::FingerprintingConnection(std::unique_ptr<woinc::rpc::Connection> transport)
+    : transport_(std::move(transport)), sink_stream_(&sink_) {}
+
+FingerprintingConnection::Result FingerprintingConnection::open(const std::string &hostname, std::uint16_t port) {
+    return transport_ ? transport_->open(hostname, port) : Connection::open(hostname, port);
+}
+
+void FingerprintingConnection::close() {
+    if (transport_)
+        transport_->close();
+    else
+        Connection::close();
+}
+
+void FingerprintingConnection::deadline(std::chrono::steady_clock::time_point deadline) {
+    if (transport_)
+        transport_->deadline(deadline);
+    else
+        Connection::deadline(deadline);
+}
+
+void FingerprintingConnection::interrupt() {
+    if (transport_)
+        transport_->interrupt();
+    else
+        Connection::interrupt();
+}
+
+bool FingerprintingConnection::is_connected() const {
+    return transport_ ? transport_->is_connected() : Connection::is_connected();
+}
+
+bool FingerprintingConnection::is_localhost() const {
+    return transport_ ? transport_->is_localhost() : Connection::is_localhost();
+}
+
+const FingerprintingConnection::Timeline &FingerprintingConnection::timeline() const {
+    return transport_ ? transport_->timeline() : Connection::timeline();
+}
+
+FingerprintingConnection::Result FingerprintingConnection::transport_rpc_(const std::string &request,
+                                                                          std::ostream &response) {
+    return transport_ ? transport_->do_rpc(request, response) : Connection::do_rpc(request, response);
+}
+
+void FingerprintingConnection::expect(ReplyFingerprint *fingerprint) {
+    fingerprint_ = fingerprint;
+    unchanged_ = false;
+}
+
+FingerprintingConnection::Result FingerprintingConnection::do_rpc(const std::string &request, std::ostream &response) {
+    if (fingerprint_ == nullptr)
+        return transport_rpc_(request, response);
+
+    auto *fingerprint = fingerprint_;
+    fingerprint_ = nullptr;
+
+    sink_.reset(response);
+    sink_stream_.clear();
+    auto result = transport_rpc_(request, sink_stream_);
+
+    if (!result) {
+        fingerprint->valid = false;
+        return result;
+    }
+
+    const auto hash = sink_.hash();
+
+    if (fingerprint->valid && fingerprint->hash == hash && fingerprint->size == sink_.size()) {
+        // the command discards the reply without parsing it and the job skips the delivery
+        unchanged_ = true;
+        result.consumed = true;
+        return result;
+    }
+
+    fingerprint->hash = hash;
+    fingerprint->size = sink_.size();
+    fingerprint->valid = true;
+
+    return result;
+}
+
+// ---- Client ----
+
+Client::Client(std::string host, HostMetricsRecorderPtr metrics, Tracer *tracer,
+               const ConnectionFactory &connection_factory)
+    : host_(std::move(host))
+    , rpc_connection_(connection_factory ? connection_factory(host_) : nullptr)
+    , metrics_(std::move(metrics))
+    , tracer_(tracer)
+{
+    if (tracer_ != nullptr)
+        trace_host_ = tracer_->host_id(host_);
+}
+
 Client::~Client() {
     disconnect();
 }
 
-bool Client::connect(std::string host, std::uint16_t port) {
+bool Client::connect(const std::string &url, std::uint16_t port) {
     disconnect();
 
-    host_ = std::move(host);
-    connected_ = rpc_connection_.open(host_, port);
+    url_ = url;
+    port_ = port;
+    connected_ = rpc_connection_.open(url, port);
+    reconnect_backoff_ = std::chrono::milliseconds::zero();
+    next_reconnect_ = std::chrono::steady_clock::time_point();
 
     return connected_;
 }
@@ -40,11 +216,131 @@ void Client::disconnect() {
     }
 }
 
+void Client::authorized(std::string password) {
+    password_ = std::move(password);
+}
+
+void Client::deadline(std::chrono::steady_clock::time_point deadline) {
+    rpc_connection_.deadline(deadline);
+}
+
+void Client::interrupt() {
+    rpc_connection_.interrupt();
+}
+
+void Client::job(std::size_t metrics_slot, const char *name) {
+    metrics_slot_ = metrics_slot;
+    job_name_ = name;
+}
+
 woinc::rpc::CommandStatus Client::execute(woinc::rpc::Command &cmd) {
-    if (connected_)
-        return cmd.execute(rpc_connection_);
-    else
+    if (!ensure_connection_())
         return woinc::rpc::CommandStatus::Disconnected;
+
+    const auto before = cmd.metrics();
+    auto status = cmd.execute(rpc_connection_);
+
+    record_(cmd, before, false);
+
+    return status;
+}
+
+woinc::rpc::CommandStatus Client::execute(woinc::rpc::Command &cmd, ReplyFingerprint &fingerprint, bool &unchanged) {
+    unchanged = false;
+
+    if (!ensure_connection_())
+        return woinc::rpc::CommandStatus::Disconnected;
+
+    const auto before = cmd.metrics();
+
+    rpc_connection_.expect(&fingerprint);
+    auto status = cmd.execute(rpc_connection_);
+
+    record_(cmd, before, rpc_connection_.unchanged());
+
+    unchanged = rpc_connection_.unchanged();
+
+    if (status != woinc::rpc::CommandStatus::Ok) {
+        // e.g. an error reply or a parsing error, don't skip the next reply
+        fingerprint.valid = false;
+    }
+
+    rpc_connection_.expect(nullptr);
+
+    return status;
+}
+
+bool Client::ensure_connection_() {
+    if (!connected_)
+        return false;
+
+    if (rpc_connection_.is_connected())
+        return true;
+
+    // the commands queued meanwhile fail right away instead of each trying to reconnect
+    const auto now = std::chrono::steady_clock::now();
+    if (now < next_reconnect_)
+        return false;
+
+    if (reconnect_()) {
+        reconnect_backoff_ = std::chrono::milliseconds::zero();
+        return true;
+    }
+
+    reconnect_backoff_ = std::min(std::max(reconnect_backoff_ * 2, MIN_RECONNECT_BACKOFF__), MAX_RECONNECT_BACKOFF__);
+    next_reconnect_ = now + reconnect_backoff_;
+
+    return false;
+}
+
+bool Client::reconnect_() {
+    if (!rpc_connection_.open(url_, port_))
+        return false;
+
+    if (password_.empty())
+        return true;
+
+    woinc::rpc::AuthorizeCommand cmd;
+    cmd.request().password = password_;
+    if (cmd.execute(rpc_connection_) == woinc::rpc::CommandStatus::Ok && cmd.response().authorized)
+        return true;
+
+    // otherwise the next command would use the unauthorized connection
+    rpc_connection_.close();
+    return false;
+}
+
+void Client::record_(const woinc::rpc::Command &cmd, const woinc::rpc::RpcMetrics &before, bool unchanged) {
+    auto after = cmd.metrics();
+
+    if (metrics_)
+        metrics_->record(metrics_slot_, before, after, !unchanged);
+
+    if (tracer_ == nullptr || !tracer_->enabled())
+        return;
+
+    // only the last rpc of commands with more than one is traced
+    const auto &timeline = rpc_connection_.timeline();
+    const auto none = woinc::rpc::Connection::Timeline::TimePoint::min();
+
+    if (timeline.sent == none)
+        return;
+    tracer_->complete("send", trace_host_, job_name_, timeline.started, timeline.sent,
+                      "bytes", after.bytes_out - before.bytes_out);
+
+    if (timeline.first_byte == none)
+        return;
+    tracer_->complete("await reply", trace_host_, job_name_, timeline.sent, timeline.first_byte);
+
+    if (timeline.completed == none)
+        return;
+    tracer_->complete("receive", trace_host_, job_name_, timeline.first_byte, timeline.completed,
+                      "bytes", after.bytes_in - before.bytes_in);
+
+    if (unchanged)
+        tracer_->instant("unchanged", trace_host_, job_name_, timeline.completed);
+    else
+        tracer_->complete("parse", trace_host_, job_name_, timeline.completed, std::chrono::steady_clock::now());
 }
 
 const std::string &Client::host() const {
@@ -19,34 +19,152 @@
 #ifndef WOINC_UI_CLIENT_H_
 #define WOINC_UI_CLIENT_H_
 
-#include <string>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
 
 #include <woinc/rpc_command.h>
 #include <woinc/rpc_connection.h>
+#include <woinc/ui/controller.h>
+#include <woinc/ui/metrics.h>
 
+#include "metrics_registry.h"
+#include "tracer.h"
 #include "visibility.h"
 
 namespace woinc { namespace ui {
 
-// The client is not threadsafe! Should only be called by the worker thread for this host.
+// Identifies the last reply to a command to detect unchanged replies
+struct WOINCUI_LOCAL ReplyFingerprint {
+    std::uint64_t hash = 0;
+    std::size_t size = 0;
+    bool valid = false;
+};
+
+// Hashes the replies while passing them through to the command, so a reply matching the fingerprint
+// of the last one is marked as consumed and the command skips parsing it.
+// Uses the transport if there is one, otherwise it connects itself.
+class WOINCUI_LOCAL FingerprintingConnection : public woinc::rpc::Connection {
+    public:
+        explicit FingerprintingConnection(std::unique_ptr<woinc::rpc::Connection> transport = nullptr);
+
+        // the next rpc compares its reply with the fingerprint and updates it,
+        // an unchanged reply isn't parsed by the command
+        void expect(ReplyFingerprint *fingerprint);
+        bool unchanged() const { return unchanged_; }
+
+        Result open(const std::string &hostname, std::uint16_t port = DefaultBOINCPort) override;
+        void close() override;
+
+        Result do_rpc(const std::string &request, std::ostream &response) override;
+
+        void deadline(std::chrono::steady_clock::time_point deadline) override;
+        void interrupt() override;
+
+        bool is_connected() const override;
+        bool is_localhost() const override;
+
+        const Timeline &timeline() const override;
+
+    private:
+        Result transport_rpc_(const std::string &request, std::ostream &response);
+
+    private:
+        // hashes the written reply in words of 8 bytes and passes it on to the response
+        struct Sink : public std::streambuf {
+            void reset(std::ostream &response);
+            // includes the bytes of an incomplete last word
+            std::uint64_t hash() const;
+            std::size_t size() const { return size_; }
+
+            protected:
+                int_type overflow(int_type c) override;
+                std::streamsize xsputn(const char *s, std::streamsize n) override;
+
+            private:
+                void hash_(const char *s, std::size_t n);
+
+            private:
+                std::ostream *response_ = nullptr;
+                std::uint64_t hash_value_ = 0;
+                std::size_t size_ = 0;
+                // the bytes of the word not completed by the writes so far
+                char partial_[sizeof(std::uint64_t)];
+                std::size_t partial_size_ = 0;
+        };
+
+        std::unique_ptr<woinc::rpc::Connection> transport_;
+
+        ReplyFingerprint *fingerprint_ = nullptr;
+        bool unchanged_ = false;
+
+        Sink sink_;
+        std::ostream sink_stream_;
+};
+
+// The client is not threadsafe! Should only be called by the worker thread for this host, except for interrupt().
 class WOINCUI_LOCAL Client {
     public:
+        // the metrics of the executed commands are recorded to the recorder and their rpcs are traced
+        // by the tracer if there is one; the connection is created by the factory if there is one
+        explicit Client(std::string host, HostMetricsRecorderPtr metrics = nullptr, Tracer *tracer = nullptr,
+                        const ConnectionFactory &connection_factory = nullptr);
         ~Client();
 
     public:
-        bool connect(std::string host, std::uint16_t port);
-        bool authorize(const std::string &password);
+        bool connect(const std::string &url, std::uint16_t port);
         void disconnect();
 
+        // remembers the password to authorize again after reconnecting
+        void authorized(std::string password);
+
+        // see woinc::rpc::Connection::deadline
+        void deadline(std::chrono::steady_clock::time_point deadline);
+
+        // aborts the running connect or command and fails the following ones, callable by any thread
+        void interrupt();
+
+        // the following commands are executed for the job with the metrics slot and name, see Job
+        void job(std::size_t metrics_slot, const char *name);
+
         woinc::rpc::CommandStatus execute(woinc::rpc::Command &cmd);
+        // like execute(cmd), but if the reply is byte-identical to the one of the fingerprint,
+        // the parsing is skipped and unchanged is set; the command keeps the response of its last execution then
+        woinc::rpc::CommandStatus execute(woinc::rpc::Command &cmd, ReplyFingerprint &fingerprint, bool &unchanged);
 
+        // the name of the host as known by the controller, not the url
         const std::string &host() const;
 
+    private:
+        // an aborted rpc closes the connection, so reconnect on the next command,
+        // after a failed reconnect not before the backoff has passed
+        bool ensure_connection_();
+        // reconnects and authorizes again if the client was authorized before
+        bool reconnect_();
+
+        // records the metrics and traces the phases of the last rpc of the command
+        void record_(const woinc::rpc::Command &cmd, const woinc::rpc::RpcMetrics &before, bool unchanged);
+
     private:
         bool connected_ = false;
         std::string host_;
-        woinc::rpc::Connection rpc_connection_;
+        std::string url_;
+        std::uint16_t port_ = 0;
+        std::string password_;
+        std::chrono::milliseconds reconnect_backoff_ = std::chrono::milliseconds::zero();
+        std::chrono::steady_clock::time_point next_reconnect_;
+        FingerprintingConnection rpc_connection_;
+        HostMetricsRecorderPtr metrics_;
+        Tracer *tracer_;
+        Tracer::HostId trace_host_ = Tracer::NoHost;
+
+        std::size_t metrics_slot_ = HostMetrics::COMMANDS;
+        const char *job_name_ = "command";
 };
 
 }}
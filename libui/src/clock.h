@@ -0,0 +1,54 @@
+/* libui/src/clock.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_CLOCK_H_
+#define WOINC_UI_CLOCK_H_
+
+#include <chrono>
+
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+// The time source of the scheduling, the steady clock unless a simulation runs the scheduling in virtual time
+class WOINCUI_LOCAL Clock {
+    public:
+        typedef std::chrono::steady_clock::time_point TimePoint;
+
+        virtual ~Clock() = default;
+
+        virtual TimePoint now() const = 0;
+
+        static const Clock &steady();
+};
+
+class WOINCUI_LOCAL SteadyClock : public Clock {
+    public:
+        TimePoint now() const override {
+            return std::chrono::steady_clock::now();
+        }
+};
+
+inline const Clock &Clock::steady() {
+    static const SteadyClock clock;
+    return clock;
+}
+
+}}
+
+#endif
@@ -40,6 +40,16 @@ Configuration::Intervals Configuration::intervals() const {
     return intervals_;
 }
 
+void Configuration::bulk_connection(bool value) {
+    WOINC_CONFIGURATION_LOCK_GUARD;
+    bulk_connection_ = value;
+}
+
+bool Configuration::bulk_connection() const {
+    WOINC_CONFIGURATION_LOCK_GUARD;
+    return bulk_connection_;
+}
+
 void Configuration::active_only_tasks(const std::string &host, bool value) {
     WOINC_CONFIGURATION_LOCK_GUARD;
     assert(host_configurations_.find(host) != host_configurations_.end());
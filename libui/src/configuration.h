@@ -21,9 +21,10 @@
 
 #include <array>
 #include <chrono>
-#include <map>
 #include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 #include <woinc/ui/defs.h>
 
@@ -34,7 +35,7 @@ namespace woinc { namespace ui {
 class WOINCUI_LOCAL Configuration {
     public:
         typedef std::chrono::milliseconds Interval;
-        typedef std::array<Interval, 9> Intervals;
+        typedef std::array<Interval, PERIODIC_TASK_COUNT> Intervals;
 
     public:
         void interval(PeriodicTask task, Interval duration);
@@ -42,6 +43,10 @@ class WOINCUI_LOCAL Configuration {
 
         Intervals intervals() const;
 
+        // applies to the hosts added afterwards
+        void bulk_connection(bool value);
+        bool bulk_connection() const;
+
         void active_only_tasks(const std::string &host, bool value);
         bool active_only_tasks(const std::string &host) const;
 
@@ -50,6 +55,7 @@ class WOINCUI_LOCAL Configuration {
 
     private:
         friend class Controller;
+        friend struct ConfigurationTestHook;
         void add_host(std::string host);
         void remove_host(const std::string &host);
 
@@ -68,12 +74,26 @@ class WOINCUI_LOCAL Configuration {
             std::chrono::seconds(1)     // GetTasks
         };
 
+        bool bulk_connection_ = false;
+
         struct HostConfiguration {
             bool schedule_periodic_tasks = false;
             bool active_only_tasks_ = false;
         };
 
-        std::map<std::string, HostConfiguration> host_configurations_;
+        // hashed, the scheduler looks each host up on every scan
+        std::unordered_map<std::string, HostConfiguration> host_configurations_;
+};
+
+// registers the hosts without a controller, for the tests and the simulation of the scheduling only
+struct WOINCUI_LOCAL ConfigurationTestHook {
+    static void add_host(Configuration &configuration, std::string host) {
+        configuration.add_host(std::move(host));
+    }
+
+    static void remove_host(Configuration &configuration, const std::string &host) {
+        configuration.remove_host(host);
+    }
 };
 
 }}
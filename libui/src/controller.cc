@@ -18,23 +18,40 @@
 
 #include <woinc/ui/controller.h>
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <exception>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <stdexcept>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #ifndef NDEBUG
 #include <iostream>
 #endif
 
+#include <woinc/rpc_capture.h>
+
+#include "bounded_executor.h"
 #include "configuration.h"
+#include "fleet_aggregator.h"
 #include "handler_registry.h"
 #include "host_controller.h"
+#include "metrics_registry.h"
 #include "periodic_tasks_scheduler.h"
+#include "snapshot_store.h"
+#include "state_file.h"
+#include "statistics_history.h"
+#include "tracer.h"
+#include "update_dispatcher.h"
 
 #define WOINC_LOCK_GUARD std::lock_guard<decltype(mutex_)> guard(mutex_)
 
@@ -51,6 +68,20 @@ void check_not_empty_host_name__(const std::string &host) {
     check_not_empty__(host, "Missing host name");
 }
 
+template<typename T>
+bool is_fresh__(const woinc::ui::SnapshotPtr<T> &snapshot, std::chrono::milliseconds max_age) {
+    return snapshot && std::chrono::steady_clock::now() - snapshot->time.load() <= max_age;
+}
+
+// the futures of the commands are fulfilled by the receiver passed to the call
+template<typename Result, typename Call>
+std::future<Result> with_future__(Call call) {
+    std::promise<Result> promise;
+    auto future = promise.get_future();
+    call(woinc::ui::ResultReceiver<Result>(std::move(promise)));
+    return future;
+}
+
 }
 
 namespace woinc { namespace ui {
@@ -74,17 +105,32 @@ class WOINCUI_LOCAL Controller::Impl {
         void deregister_handler(HostHandler *handler);
 
         void register_handler(PeriodicTaskHandler *handler);
+        void register_handler(PeriodicTaskHandler *handler, PeriodicTaskSubscription subscription);
         void deregister_handler(PeriodicTaskHandler *handler);
 
+        void register_handler(FleetHandler *handler);
+        void deregister_handler(FleetHandler *handler);
+
+        void dispatch_mode(DispatchMode mode);
+        DispatchMode dispatch_mode() const;
+
         void add_host(std::string host,
                       std::string url,
-                      std::uint16_t port);
+                      std::uint16_t port,
+                      int connect_priority);
         void authorize_host(std::string host,
                             std::string password);
 
         void remove_host(const std::string &host);
         void async_remove_host(std::string host);
 
+        void state_file(const std::string &path, std::chrono::seconds save_interval);
+        void save_state();
+
+        void record_rpcs(const std::string &path);
+        void replay_rpcs(const std::string &path, double speed);
+        void connection_factory(ConnectionFactory factory);
+
         void periodic_task_interval(const PeriodicTask task, std::chrono::milliseconds interval);
         std::chrono::milliseconds periodic_task_interval(const PeriodicTask task) const;
         void schedule_periodic_tasks(const std::string &host, bool value);
@@ -92,48 +138,81 @@ class WOINCUI_LOCAL Controller::Impl {
 
         void active_only_tasks(const std::string &host, bool value);
 
-        std::future<bool> file_transfer_op(const std::string &host, FileTransferOp op,
-                                           const std::string &master_url, const std::string &filename);
-        std::future<bool> project_op(const std::string &host, ProjectOp op, const std::string &master_url);
-        std::future<bool> task_op(const std::string &host, TaskOp op, const std::string &master_url, const std::string &task_name);
+        void snapshot_tasks(const std::set<PeriodicTask> &tasks);
+        std::set<PeriodicTask> snapshot_tasks() const;
+
+        void bulk_connection(bool value);
+        bool bulk_connection() const;
+        void connect_concurrency(std::size_t value);
+        std::size_t connect_concurrency() const;
+        std::uint64_t unchanged_replies(const std::string &host, PeriodicTask task);
+        HostMetrics metrics(const std::string &host) const;
+        void reset_metrics(const std::string &host);
+
+        Tracer &tracer() { return tracer_; }
+        const Tracer &tracer() const { return tracer_; }
 
-        std::future<GlobalPreferences> load_global_preferences(const std::string &host, GetGlobalPrefsMode mode);
-        std::future<bool> save_global_preferences(const std::string &host, const GlobalPreferences &prefs, const GlobalPreferencesMask &mask);
-        std::future<bool> read_global_prefs_override(const std::string &host);
+        void aggregate_fleet(bool value);
+        bool aggregate_fleet() const;
+        void fleet_deadline_horizon(std::chrono::seconds horizon);
+        const FleetAggregator &fleet_aggregator() const { return fleet_aggregator_; }
 
-        std::future<CCConfig> cc_config(const std::string &host);
-        std::future<bool> cc_config(const std::string &host, const CCConfig &cc_config);
+        void record_statistics_history(bool value);
+        bool record_statistics_history() const;
+        StatisticsHistory &statistics_history() { return statistics_history_; }
+        const StatisticsHistory &statistics_history() const { return statistics_history_; }
 
-        std::future<bool> read_config_files(const std::string &host);
+        void file_transfer_op(const std::string &host, FileTransferOp op,
+                              const std::string &master_url, const std::string &filename, ResultReceiver<bool> receiver, const CallOptions &options);
+        void project_op(const std::string &host, ProjectOp op, const std::string &master_url, ResultReceiver<bool> receiver, const CallOptions &options);
+        void task_op(const std::string &host, TaskOp op, const std::string &master_url, const std::string &task_name, ResultReceiver<bool> receiver, const CallOptions &options);
 
-        std::future<bool> run_mode(const std::string &host, RunMode mode);
-        std::future<bool> gpu_mode(const std::string &host, RunMode mode);
-        std::future<bool> network_mode(const std::string &host, RunMode mode);
+        const SnapshotStore &snapshot_store() const { return snapshot_store_; }
 
-        std::future<AllProjectsList> all_projects_list(const std::string &host);
+        void cc_status(const std::string &host, std::chrono::milliseconds max_age, ResultReceiver<CCStatus> receiver, const CallOptions &options);
+        void tasks(const std::string &host, std::chrono::milliseconds max_age, ResultReceiver<Tasks> receiver, const CallOptions &options);
 
-        std::future<bool> start_loading_project_config(const std::string &host, std::string master_url);
-        std::future<ProjectConfig> poll_project_config(const std::string &host);
+        void load_global_preferences(const std::string &host, GetGlobalPrefsMode mode, ResultReceiver<GlobalPreferences> receiver, const CallOptions &options);
+        void save_global_preferences(const std::string &host, const GlobalPreferences &prefs, const GlobalPreferencesMask &mask, ResultReceiver<bool> receiver, const CallOptions &options);
+        void read_global_prefs_override(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options);
 
-        std::future<bool> start_account_lookup(const std::string &host, std::string master_url,
-                                               std::string email, std::string password);
-        std::future<AccountOut> poll_account_lookup(const std::string &host);
+        void cc_config(const std::string &host, ResultReceiver<CCConfig> receiver, const CallOptions &options);
+        void cc_config(const std::string &host, const CCConfig &cc_config, ResultReceiver<bool> receiver, const CallOptions &options);
 
-        std::future<bool> attach_project(const std::string &host, std::string master_url, std::string authenticator);
+        void read_config_files(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options);
 
-        std::future<bool> network_available(const std::string &host);
-        std::future<bool> run_benchmarks(const std::string &host);
-        std::future<bool> quit(const std::string &host);
+        void run_mode(const std::string &host, RunMode mode, ResultReceiver<bool> receiver, const CallOptions &options);
+        void gpu_mode(const std::string &host, RunMode mode, ResultReceiver<bool> receiver, const CallOptions &options);
+        void network_mode(const std::string &host, RunMode mode, ResultReceiver<bool> receiver, const CallOptions &options);
+
+        void all_projects_list(const std::string &host, ResultReceiver<AllProjectsList> receiver, const CallOptions &options);
+
+        void start_loading_project_config(const std::string &host, std::string master_url, ResultReceiver<bool> receiver, const CallOptions &options);
+        void poll_project_config(const std::string &host, ResultReceiver<ProjectConfig> receiver, const CallOptions &options);
+
+        void start_account_lookup(const std::string &host, std::string master_url,
+                                  std::string email, std::string password, ResultReceiver<bool> receiver, const CallOptions &options);
+        void poll_account_lookup(const std::string &host, ResultReceiver<AccountOut> receiver, const CallOptions &options);
+
+        void attach_project(const std::string &host, std::string master_url, std::string authenticator, ResultReceiver<bool> receiver, const CallOptions &options);
+
+        void network_available(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options);
+        void run_benchmarks(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options);
+        void quit(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options);
 
     private: // helper methods which assume the controller is already locked
         // use a copy of the host string as it may be the key of the host controller map
-        // which will be deleted in the erase call leading to a use after free access later on
-        void remove_host_(std::string host);
-        void async_remove_host_(std::string host);
+        // which will be deleted in the erase call leading to a use after free access later on;
+        // returns the shut down host controller, which has to be released after unlocking the controller
+        // because its discarded jobs fail their receivers and may call the completions of the user
+        std::shared_ptr<HostController> remove_host_(std::string host);
 
         bool has_host_(const std::string &name) const;
 
-        void schedule_now_(const std::string &host, std::unique_ptr<Job> job, const char *func);
+        // called by the saver thread
+        void save_state_periodically_(std::chrono::seconds interval);
+
+        void schedule_now_(const std::string &host, JobPtr job, const char *func);
 
         void verify_not_shutdown_() const;
         void verify_known_host_(const std::string &host, const char *func) const;
@@ -142,50 +221,110 @@ class WOINCUI_LOCAL Controller::Impl {
                  typename Result,
                  typename Getter = Result (*)(decltype(std::declval<Command>().response()) &),
                  typename Request = decltype(std::declval<Command>().request())>
-        std::future<Result> create_and_schedule_async_job_(const char *func,
-                                                           const std::string &host,
-                                                           Getter getter,
-                                                           std::string error_msg,
-                                                           std::remove_reference_t<Request> request = {}) {
-            typedef std::promise<Result> Promise;
-            Promise promise;
-            auto future = promise.get_future();
+        void create_and_schedule_async_job_(const char *func,
+                                            const std::string &host,
+                                            const CallOptions &options,
+                                            ResultReceiver<Result> receiver,
+                                            Getter getter,
+                                            std::string error_msg,
+                                            std::remove_reference_t<Request> request = {},
+                                            CoalescingKey coalescing_key = {}) {
+            // verify before creating the job, a discarded job would fail its receiver
+            verify_not_shutdown_();
+            verify_known_host_(host, func);
+
+            // calls with own deadlines or cancellation tokens can't be shared
+            if (options.restricted())
+                coalescing_key = {};
+
+            // share the rpc of an identical request which is still queued or running
+            if (coalescing_key && in_flight_jobs_.join(host, coalescing_key, receiver))
+                return;
 
             auto job = std::make_unique<woinc::ui::AsyncJob<Result>>(
                 std::make_unique<Command>(std::move(request)),
-                std::move(promise),
-                [error_msg, getter](woinc::rpc::Command *cmd, Promise &p, woinc::rpc::CommandStatus status) {
+                std::move(receiver),
+                [error_msg, getter](woinc::rpc::Command *cmd, ResultReceiver<Result> &r, woinc::rpc::CommandStatus status) {
                     if (status == woinc::rpc::CommandStatus::Ok)
-                        p.set_value(getter(static_cast<Command *>(cmd)->response()));
+                        r.set_value(getter(static_cast<Command *>(cmd)->response()));
                     else
-                        p.set_exception(std::make_exception_ptr(std::runtime_error{error_msg}));
+                        r.set_exception(std::make_exception_ptr(std::runtime_error{error_msg}));
                 });
+            job->options(options);
+            job->name(func);
+
+            if (coalescing_key) {
+                job->coalescing_key(coalescing_key);
+                job->track(in_flight_jobs_, host);
+            } else {
+                // the command may modify the state of the client
+                in_flight_jobs_.detach(host);
+            }
 
             schedule_now_(host, std::move(job), func);
-            return future;
         }
 
 
+    private: // helper methods which lock the controller themselves
+        // the final save at shutdown is the only one allowed after the shutdown was triggered
+        void save_state_(bool at_shutdown);
+        void restore_host_(const std::string &host, const StateFile &state_file);
+
     private:
         std::mutex mutex_;
 
         bool shutdown_ = false;
 
         HandlerRegistry handler_registry_;
+        SnapshotStore snapshot_store_;
+        MetricsRegistry metrics_registry_;
+        Tracer tracer_;
+        UpdateDispatcher update_dispatcher_;
+
+        FleetAggregator fleet_aggregator_;
+        // only written while holding the lock
+        std::atomic<bool> aggregate_fleet_{false};
+
+        StatisticsHistory statistics_history_;
+        // only written while holding the lock
+        std::atomic<bool> record_statistics_history_{false};
 
         Configuration configuration_;
 
         PeriodicTasksSchedulerContext periodic_tasks_scheduler_context_;
         std::thread periodic_tasks_scheduler_thread_;
 
-        typedef std::map<std::string, std::unique_ptr<HostController>> HostControllers;
+        // declared before the host controllers, their queued jobs unregister themselves on destruction
+        InFlightJobs in_flight_jobs_;
+
+        // shared with the connect pool, which connects a host without holding the lock
+        typedef std::map<std::string, std::shared_ptr<HostController>> HostControllers;
         HostControllers host_controllers_;
+
+        // the removals lock the controller anyway, so a single thread is enough
+        BoundedExecutor removals_{1};
+        // limits the concurrent name resolutions and connects when adding many hosts
+        BoundedExecutor connects_{8};
+
+        // the warm start, see Controller::state_file
+        std::unique_ptr<const StateFile> state_file_;
+        std::thread state_saver_thread_;
+        std::condition_variable state_saver_condition_;
+
+        // creates the connections of the hosts, e.g. to record or replay their rpcs, see Controller::record_rpcs
+        ConnectionFactory connection_factory_;
+        std::shared_ptr<wrpc::CaptureWriter> capture_writer_;
 };
 
 Controller::Impl::Impl() :
+    update_dispatcher_(handler_registry_, snapshot_store_, tracer_),
     periodic_tasks_scheduler_context_(configuration_,
                                       handler_registry_,
-                                      [this](const std::string &host, std::unique_ptr<Job> job) { host_controllers_.at(host)->schedule(std::move(job)); }),
+                                      tracer_,
+                                      [this](const std::string &host, PeriodicTask task, const PeriodicJob::Payload &payload,
+                                             std::chrono::steady_clock::time_point due) {
+                                          host_controllers_.at(host)->schedule(task, payload, due);
+                                      }),
     periodic_tasks_scheduler_thread_(PeriodicTasksScheduler(periodic_tasks_scheduler_context_))
 {}
 
@@ -194,20 +333,57 @@ Controller::Impl::~Impl() {
 }
 
 void Controller::Impl::shutdown() {
-    WOINC_LOCK_GUARD;
+    {
+        WOINC_LOCK_GUARD;
 
-    // shutdown the controller, i.e. don't accept requests anymore
-    shutdown_ = true;
+        // shutdown the controller, i.e. don't accept requests anymore
+        shutdown_ = true;
 
+        // abort the running connects and rpcs of all hosts at once instead of waiting for each host one after another
+        for (auto &host_controller : host_controllers_)
+            host_controller.second->interrupt();
+    }
+
+    state_saver_condition_.notify_all();
+    // the final save needs the hosts, so it's done before removing them
+    if (state_saver_thread_.joinable()) {
+        state_saver_thread_.join();
+        try {
+            save_state_(true);
+        } catch (const std::exception &err) {
+#ifndef NDEBUG
+            std::cerr << "Saving the state at shutdown failed: " << err.what() << "\n";
+#endif
+        }
+    }
 
-    // shutdown the periodic tasks scheduler
-    periodic_tasks_scheduler_context_.trigger_shutdown();
-    if (periodic_tasks_scheduler_thread_.joinable())
-        periodic_tasks_scheduler_thread_.join();
+    // outside of the lock, a running removal needs it; the pending ones are done below anyway
+    removals_.shutdown();
+    // the pending connects are dropped, the running ones are interrupted
+    connects_.shutdown();
 
-    // shutdown the host controllers
-    while (!host_controllers_.empty())
-        remove_host_(host_controllers_.cbegin()->first);
+    std::vector<std::shared_ptr<HostController>> removed;
+
+    {
+        WOINC_LOCK_GUARD;
+
+        // shutdown the periodic tasks scheduler
+        periodic_tasks_scheduler_context_.trigger_shutdown();
+        if (periodic_tasks_scheduler_thread_.joinable())
+            periodic_tasks_scheduler_thread_.join();
+
+        // shutdown the host controllers
+        while (!host_controllers_.empty())
+            removed.push_back(remove_host_(host_controllers_.cbegin()->first));
+
+        update_dispatcher_.shutdown();
+
+        if (capture_writer_)
+            capture_writer_->flush();
+    }
+
+    // outside of the lock, see remove_host_
+    removed.clear();
 }
 
 void Controller::Impl::register_handler(HostHandler *handler) {
@@ -222,18 +398,40 @@ void Controller::Impl::register_handler(PeriodicTaskHandler *handler) {
     handler_registry_.register_handler(handler);
 }
 
+void Controller::Impl::register_handler(PeriodicTaskHandler *handler, PeriodicTaskSubscription subscription) {
+    handler_registry_.register_handler(handler, std::move(subscription));
+}
+
 void Controller::Impl::deregister_handler(PeriodicTaskHandler *handler) {
     handler_registry_.deregister_handler(handler);
 }
 
+void Controller::Impl::register_handler(FleetHandler *handler) {
+    fleet_aggregator_.register_handler(handler);
+}
+
+void Controller::Impl::deregister_handler(FleetHandler *handler) {
+    fleet_aggregator_.deregister_handler(handler);
+}
+
+void Controller::Impl::dispatch_mode(DispatchMode mode) {
+    update_dispatcher_.mode(mode);
+}
+
+DispatchMode Controller::Impl::dispatch_mode() const {
+    return update_dispatcher_.mode();
+}
+
 void Controller::Impl::add_host(std::string host,
                                 std::string url,
-                                std::uint16_t port) {
+                                std::uint16_t port,
+                                int connect_priority) {
     check_not_empty_host_name__(host);
     check_not_empty__(url, "Missing url to host");
 
-    // to be able to use it by copy in the connect-thread
-    HostController *host_controller_ptr;
+    // shared with the connect task, which doesn't hold the lock
+    std::shared_ptr<HostController> host_controller;
+    const StateFile *state_file;
 
     {
         WOINC_LOCK_GUARD;
@@ -243,35 +441,56 @@ void Controller::Impl::add_host(std::string host,
         if (has_host_(host))
             throw std::invalid_argument("Host \"" + host + "\" already registered.");
 
-        auto host_controller = std::make_unique<HostController>(host);
-        host_controller_ptr = host_controller.get();
+        auto metrics = metrics_registry_.add_host(host);
+
+        host_controller = std::make_shared<HostController>(host,
+                                                           handler_registry_,
+                                                           update_dispatcher_,
+                                                           periodic_tasks_scheduler_context_,
+                                                           metrics,
+                                                           tracer_,
+                                                           configuration_.bulk_connection(),
+                                                           connection_factory_);
 
         configuration_.add_host(host);
-        host_controllers_.emplace(host, std::move(host_controller));
+        snapshot_store_.add_host(host);
+        update_dispatcher_.add_host(host, std::move(metrics));
+        fleet_aggregator_.add_host(host);
+        host_controllers_.emplace(host, host_controller);
         // periodic tasks are not scheduled yet
         periodic_tasks_scheduler_context_.add_host(host);
 
-        handler_registry_.for_host_handler([&](auto &handler) {
-            handler.on_host_added(host);
-        });
+        state_file = state_file_.get();
     }
 
-    // connect asynchronously because the connect may block for a long time (see man 2 connect)
-    std::thread([this, host, host_controller_ptr, port, url]() {
-        bool connected = host_controller_ptr->connect(url, port);
+    // outside of the lock: a connect of another host may call the handlers, which in turn call the controller
+    handler_registry_.for_host_handler([&](auto &handler) {
+        handler.on_host_added(host);
+    });
+
+    // the snapshots of the host are only written by its worker, which isn't started before the connect
+    if (state_file != nullptr)
+        restore_host_(host, *state_file);
+
+    // connect asynchronously because the name resolution and connect may block for a long time;
+    // a host removed before or while connecting is shut down and doesn't report anything
+    connects_.post([this, host, host_controller, port, url]() {
+        bool connected = host_controller->connect(url, port);
+        if (host_controller->is_shut_down())
+            return;
         handler_registry_.for_host_handler([&](HostHandler &handler) {
             if (connected)
                 handler.on_host_connected(host);
             else
                 handler.on_host_error(host, Error::ConnectionError);
         });
-    }).detach();
+    }, connect_priority);
 }
 
 void Controller::Impl::authorize_host(std::string host,
                                       std::string password) {
+    // an empty password marks a host without one, e.g. to use its bulk connection
     check_not_empty_host_name__(host);
-    check_not_empty__(password, "Missing password");
 
     WOINC_LOCK_GUARD;
 
@@ -280,22 +499,116 @@ void Controller::Impl::authorize_host(std::string host,
 
     auto hc = host_controllers_.find(host);
     assert(hc != host_controllers_.end());
-    hc->second->authorize(password, handler_registry_);
+    hc->second->authorize(password);
 }
 
 void Controller::Impl::remove_host(const std::string &host) {
     check_not_empty_host_name__(host);
 
-    WOINC_LOCK_GUARD;
-    verify_not_shutdown_();
-    verify_known_host_(host, __func__);
-    remove_host_(host);
+    std::shared_ptr<HostController> removed;
+
+    {
+        WOINC_LOCK_GUARD;
+        verify_not_shutdown_();
+        verify_known_host_(host, __func__);
+        removed = remove_host_(host);
+    }
+
+    // outside of the lock, see remove_host_
+    removed.reset();
 }
 
 void Controller::Impl::async_remove_host(std::string host) {
     check_not_empty_host_name__(host);
 
-    std::thread([this, host]() { async_remove_host_(host); }).detach();
+    removals_.post([this, host]() {
+        std::shared_ptr<HostController> removed;
+
+        {
+            WOINC_LOCK_GUARD;
+            // the host may have been removed in the meantime
+            if (!shutdown_ && has_host_(host))
+                removed = remove_host_(host);
+        }
+
+        // outside of the lock, see remove_host_
+        removed.reset();
+    });
+}
+
+void Controller::Impl::state_file(const std::string &path, std::chrono::seconds save_interval) {
+    check_not_empty__(path, "Missing path of the state file");
+    if (save_interval.count() <= 0)
+        throw std::invalid_argument("The save interval must be positive");
+
+    // only maps the file and reads its index
+    auto state_file = std::make_unique<const StateFile>(path);
+
+    WOINC_LOCK_GUARD;
+
+    verify_not_shutdown_();
+    if (state_file_)
+        throw std::logic_error("The state file is already set");
+
+    state_file_ = std::move(state_file);
+    state_saver_thread_ = std::thread([this, save_interval]() { save_state_periodically_(save_interval); });
+}
+
+void Controller::Impl::save_state() {
+    save_state_(false);
+}
+
+void Controller::Impl::record_rpcs(const std::string &path) {
+    check_not_empty__(path, "Missing path of the capture file");
+
+    auto writer = std::make_shared<wrpc::CaptureWriter>(path);
+    if (!writer->good())
+        throw std::runtime_error("Could not create the capture file \"" + path + "\"");
+
+    WOINC_LOCK_GUARD;
+
+    verify_not_shutdown_();
+    if (connection_factory_)
+        throw std::logic_error("The connections are already recorded, replayed or created by a factory");
+
+    capture_writer_ = writer;
+    connection_factory_ = [writer](const std::string &) {
+        return std::make_unique<wrpc::RecordingConnection>(writer);
+    };
+}
+
+void Controller::Impl::replay_rpcs(const std::string &path, double speed) {
+    check_not_empty__(path, "Missing path of the capture file");
+    if (!(speed >= 0))
+        throw std::invalid_argument("The speed must not be negative");
+
+    auto capture = std::make_shared<wrpc::Capture>();
+    if (!capture->read(path))
+        throw std::runtime_error("Could not read the capture file \"" + path + "\"");
+
+    WOINC_LOCK_GUARD;
+
+    verify_not_shutdown_();
+    if (connection_factory_)
+        throw std::logic_error("The connections are already recorded, replayed or created by a factory");
+
+    std::shared_ptr<const wrpc::Capture> replayed = std::move(capture);
+    connection_factory_ = [replayed, speed](const std::string &) {
+        return std::make_unique<wrpc::ReplayConnection>(replayed, speed);
+    };
+}
+
+void Controller::Impl::connection_factory(ConnectionFactory factory) {
+    if (!factory)
+        throw std::invalid_argument("Missing connection factory");
+
+    WOINC_LOCK_GUARD;
+
+    verify_not_shutdown_();
+    if (connection_factory_)
+        throw std::logic_error("The connections are already recorded, replayed or created by a factory");
+
+    connection_factory_ = std::move(factory);
 }
 
 void Controller::Impl::periodic_task_interval(const PeriodicTask task, std::chrono::milliseconds interval) {
@@ -340,218 +653,458 @@ void Controller::Impl::active_only_tasks(const std::string &host, bool value) {
     periodic_tasks_scheduler_context_.reschedule_now(host, PeriodicTask::GetTasks);
 }
 
-std::future<bool> Controller::Impl::file_transfer_op(const std::string &host, FileTransferOp op,
-                                                     const std::string &master_url, const std::string &filename) {
+void Controller::Impl::snapshot_tasks(const std::set<PeriodicTask> &tasks) {
+    PeriodicTaskSet set;
+    for (auto task : tasks)
+        set.set(static_cast<size_t>(task));
+    handler_registry_.snapshot_tasks(set);
+}
+
+std::set<PeriodicTask> Controller::Impl::snapshot_tasks() const {
+    const auto set = handler_registry_.snapshot_tasks();
+    std::set<PeriodicTask> tasks;
+    for (size_t i = 0; i < set.size(); ++i)
+        if (set.test(i))
+            tasks.insert(static_cast<PeriodicTask>(i));
+    return tasks;
+}
+
+void Controller::Impl::bulk_connection(bool value) {
+    configuration_.bulk_connection(value);
+}
+
+bool Controller::Impl::bulk_connection() const {
+    return configuration_.bulk_connection();
+}
+
+void Controller::Impl::connect_concurrency(std::size_t value) {
+    if (value == 0)
+        throw std::invalid_argument("The connect concurrency must be at least 1");
+    connects_.max_threads(value);
+}
+
+std::size_t Controller::Impl::connect_concurrency() const {
+    return connects_.max_threads();
+}
+
+std::uint64_t Controller::Impl::unchanged_replies(const std::string &host, PeriodicTask task) {
+    check_not_empty_host_name__(host);
+
+    WOINC_LOCK_GUARD;
+
+    verify_known_host_(host, __func__);
+
+    return host_controllers_.at(host)->unchanged_replies(task);
+}
+
+HostMetrics Controller::Impl::metrics(const std::string &host) const {
+    check_not_empty_host_name__(host);
+
+    auto recorder = metrics_registry_.host(host);
+    return recorder ? recorder->snapshot() : HostMetrics();
+}
+
+void Controller::Impl::reset_metrics(const std::string &host) {
+    check_not_empty_host_name__(host);
+
+    if (auto recorder = metrics_registry_.host(host))
+        recorder->clear();
+}
+
+void Controller::Impl::aggregate_fleet(bool value) {
+    struct HostSnapshots {
+        std::string host;
+        SnapshotPtr<CCStatus> cc_status;
+        SnapshotPtr<Projects> projects;
+        SnapshotPtr<Statistics> statistics;
+        SnapshotPtr<Tasks> tasks;
+    };
+    std::vector<HostSnapshots> snapshots;
+
+    {
+        WOINC_LOCK_GUARD;
+
+        if (value == aggregate_fleet_)
+            return;
+        aggregate_fleet_ = value;
+
+        if (!value) {
+            // no handler call is running once deregistered
+            handler_registry_.deregister_handler(&fleet_aggregator_);
+            fleet_aggregator_.clear();
+            return;
+        }
+
+        // drops the contributions of a replay racing with the last disabling
+        fleet_aggregator_.clear();
+
+        handler_registry_.register_handler(&fleet_aggregator_, PeriodicTaskSubscription{{}, {
+            PeriodicTask::GetCCStatus, PeriodicTask::GetProjectStatus, PeriodicTask::GetStatistics, PeriodicTask::GetTasks
+        }});
+
+        snapshots.reserve(host_controllers_.size());
+        for (const auto &host_controller : host_controllers_) {
+            const auto &host = host_controller.first;
+            snapshots.push_back({host, snapshot_store_.cc_status(host), snapshot_store_.projects(host),
+                                 snapshot_store_.statistics(host), snapshot_store_.tasks(host)});
+        }
+    }
+
+    // start from the latest state instead of waiting for the next polls, outside of the lock
+    // because the aggregator calls the fleet handlers; an update racing with this is corrected
+    // by the following one of the host, one of a meanwhile removed host is ignored by the aggregator
+    for (const auto &host : snapshots) {
+        if (host.cc_status)
+            fleet_aggregator_.on_update(host.host, host.cc_status->value);
+        if (host.projects)
+            fleet_aggregator_.on_update(host.host, host.projects->value);
+        if (host.statistics)
+            fleet_aggregator_.on_update(host.host, host.statistics->value);
+        if (host.tasks)
+            fleet_aggregator_.on_update(host.host, host.tasks->value);
+    }
+}
+
+bool Controller::Impl::aggregate_fleet() const {
+    return aggregate_fleet_;
+}
+
+void Controller::Impl::record_statistics_history(bool value) {
+    WOINC_LOCK_GUARD;
+
+    if (value == record_statistics_history_)
+        return;
+    record_statistics_history_ = value;
+
+    if (!value) {
+        handler_registry_.deregister_handler(&statistics_history_);
+        return;
+    }
+
+    handler_registry_.register_handler(&statistics_history_, PeriodicTaskSubscription{{}, {PeriodicTask::GetStatistics}});
+
+    for (const auto &host_controller : host_controllers_)
+        if (auto snapshot = snapshot_store_.statistics(host_controller.first))
+            statistics_history_.on_update(host_controller.first, snapshot->value, true);
+}
+
+bool Controller::Impl::record_statistics_history() const {
+    return record_statistics_history_;
+}
+
+void Controller::Impl::fleet_deadline_horizon(std::chrono::seconds horizon) {
+    std::vector<std::pair<std::string, SnapshotPtr<Tasks>>> snapshots;
+
+    {
+        WOINC_LOCK_GUARD;
+
+        fleet_aggregator_.deadline_horizon(horizon);
+
+        if (aggregate_fleet_)
+            for (const auto &host_controller : host_controllers_)
+                if (auto snapshot = snapshot_store_.tasks(host_controller.first))
+                    snapshots.emplace_back(host_controller.first, std::move(snapshot));
+    }
+
+    // unchanged replies aren't delivered, so recount the tasks near their deadline now,
+    // outside of the lock like in aggregate_fleet
+    for (const auto &snapshot : snapshots)
+        fleet_aggregator_.on_update(snapshot.first, snapshot.second->value);
+}
+
+void Controller::Impl::file_transfer_op(const std::string &host, FileTransferOp op,
+                                        const std::string &master_url, const std::string &filename, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
     check_not_empty__(master_url, "Missing master url");
     check_not_empty__(filename, "Missing filename");
 
     WOINC_LOCK_GUARD;
 
-    auto future = create_and_schedule_async_job_<wrpc::FileTransferOpCommand, bool>(
+    create_and_schedule_async_job_<wrpc::FileTransferOpCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error while executing file transfer operation",
         {op, master_url, filename});
 
     periodic_tasks_scheduler_context_.reschedule_now(host, PeriodicTask::GetFileTransfers);
-
-    return future;
 }
 
-std::future<bool> Controller::Impl::project_op(const std::string &host, ProjectOp op, const std::string &master_url) {
+void Controller::Impl::project_op(const std::string &host, ProjectOp op, const std::string &master_url, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
     check_not_empty__(master_url, "Missing master url");
 
     WOINC_LOCK_GUARD;
 
-    auto future = create_and_schedule_async_job_<wrpc::ProjectOpCommand, bool>(
+    create_and_schedule_async_job_<wrpc::ProjectOpCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error while executing project operation",
         {op, master_url});
 
     periodic_tasks_scheduler_context_.reschedule_now(host, PeriodicTask::GetProjectStatus);
-
-    return future;
 }
 
-std::future<bool> Controller::Impl::task_op(const std::string &host, TaskOp op,
-                                            const std::string &master_url, const std::string &task_name) {
+void Controller::Impl::task_op(const std::string &host, TaskOp op,
+                               const std::string &master_url, const std::string &task_name, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
     check_not_empty__(master_url, "Missing master url");
     check_not_empty__(task_name, "Missing task name");
 
     WOINC_LOCK_GUARD;
 
-    auto future = create_and_schedule_async_job_<rpc::TaskOpCommand, bool>(
+    create_and_schedule_async_job_<rpc::TaskOpCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error while executing task operation",
         {op, master_url, task_name});
 
     periodic_tasks_scheduler_context_.reschedule_now(host, PeriodicTask::GetTasks);
+}
 
-    return future;
+void Controller::Impl::cc_status(const std::string &host, std::chrono::milliseconds max_age, ResultReceiver<CCStatus> receiver, const CallOptions &options) {
+    check_not_empty_host_name__(host);
+
+    auto snapshot = snapshot_store_.cc_status(host);
+    if (is_fresh__(snapshot, max_age)) {
+        receiver.set_value(snapshot->value);
+        return;
+    }
+
+    WOINC_LOCK_GUARD;
+
+    create_and_schedule_async_job_<wrpc::GetCCStatusCommand, CCStatus, std::function<CCStatus(wrpc::GetCCStatusResponse &)>>(
+        __func__,
+        host,
+        options,
+        std::move(receiver),
+        [this, host](const auto &r) { snapshot_store_.publish(host, r.cc_status); return r.cc_status; },
+        "Error getting the cc status",
+        {},
+        make_coalescing_key<wrpc::GetCCStatusCommand, CCStatus>());
+}
+
+void Controller::Impl::tasks(const std::string &host, std::chrono::milliseconds max_age, ResultReceiver<Tasks> receiver, const CallOptions &options) {
+    check_not_empty_host_name__(host);
+
+    auto snapshot = snapshot_store_.tasks(host);
+    if (is_fresh__(snapshot, max_age)) {
+        receiver.set_value(snapshot->value);
+        return;
+    }
+
+    WOINC_LOCK_GUARD;
+
+    verify_not_shutdown_();
+    verify_known_host_(host, __func__);
+
+    // request the same tasks as the periodic task to keep the snapshot consistent
+    bool active_only = configuration_.active_only_tasks(host);
+
+    create_and_schedule_async_job_<wrpc::GetResultsCommand, Tasks, std::function<Tasks(wrpc::GetResultsResponse &)>>(
+        __func__,
+        host,
+        options,
+        std::move(receiver),
+        [this, host](const auto &r) { snapshot_store_.publish(host, r.tasks); return r.tasks; },
+        "Error getting the tasks",
+        {active_only},
+        make_coalescing_key<wrpc::GetResultsCommand, Tasks>(active_only ? 1 : 0));
 }
 
-std::future<GlobalPreferences> Controller::Impl::load_global_preferences(const std::string &host, GetGlobalPrefsMode mode) {
+void Controller::Impl::load_global_preferences(const std::string &host, GetGlobalPrefsMode mode, ResultReceiver<GlobalPreferences> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::GetGlobalPreferencesCommand, GlobalPreferences>(
+    create_and_schedule_async_job_<wrpc::GetGlobalPreferencesCommand, GlobalPreferences>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.preferences; },
         "Error while loading the preferences",
-        {mode});
+        {mode},
+        make_coalescing_key<wrpc::GetGlobalPreferencesCommand, GlobalPreferences>(static_cast<std::uint64_t>(mode)));
 }
 
-std::future<bool> Controller::Impl::save_global_preferences(const std::string &host, const GlobalPreferences &prefs, const GlobalPreferencesMask &mask) {
+void Controller::Impl::save_global_preferences(const std::string &host, const GlobalPreferences &prefs, const GlobalPreferencesMask &mask, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::SetGlobalPreferencesCommand, bool>(
+    create_and_schedule_async_job_<wrpc::SetGlobalPreferencesCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error while setting the preferences",
         {prefs, mask});
 }
 
-std::future<bool> Controller::Impl::read_global_prefs_override(const std::string &host) {
+void Controller::Impl::read_global_prefs_override(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::ReadGlobalPreferencesOverrideCommand, bool>(
+    create_and_schedule_async_job_<wrpc::ReadGlobalPreferencesOverrideCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error reading the preferences");
 }
 
-std::future<CCConfig> Controller::Impl::cc_config(const std::string &host) {
+void Controller::Impl::cc_config(const std::string &host, ResultReceiver<CCConfig> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::GetCCConfigCommand, CCConfig>(
+    create_and_schedule_async_job_<wrpc::GetCCConfigCommand, CCConfig>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.cc_config; },
-        "Error reading the cc_config");
+        "Error reading the cc_config",
+        {},
+        make_coalescing_key<wrpc::GetCCConfigCommand, CCConfig>());
 }
 
-std::future<bool> Controller::Impl::cc_config(const std::string &host, const CCConfig &cc_config) {
+void Controller::Impl::cc_config(const std::string &host, const CCConfig &cc_config, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::SetCCConfigCommand, bool>(
+    create_and_schedule_async_job_<wrpc::SetCCConfigCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error writing the cc_config",
         {cc_config});
 }
 
-std::future<bool> Controller::Impl::read_config_files(const std::string &host) {
+void Controller::Impl::read_config_files(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::ReadCCConfigCommand, bool>(
+    create_and_schedule_async_job_<wrpc::ReadCCConfigCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error reading the config files");
 }
 
-std::future<bool> Controller::Impl::run_mode(const std::string &host, RunMode mode) {
+void Controller::Impl::run_mode(const std::string &host, RunMode mode, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::SetRunModeCommand, bool>(
+    create_and_schedule_async_job_<wrpc::SetRunModeCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error setting the run mode",
         mode);
 }
 
-std::future<bool> Controller::Impl::gpu_mode(const std::string &host, RunMode mode) {
+void Controller::Impl::gpu_mode(const std::string &host, RunMode mode, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::SetGpuModeCommand, bool>(
+    create_and_schedule_async_job_<wrpc::SetGpuModeCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error setting the gpu run mode",
         mode);
 }
 
-std::future<bool> Controller::Impl::network_mode(const std::string &host, RunMode mode) {
+void Controller::Impl::network_mode(const std::string &host, RunMode mode, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::SetNetworkModeCommand, bool>(
+    create_and_schedule_async_job_<wrpc::SetNetworkModeCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error setting the network mode",
         mode);
 }
 
-std::future<AllProjectsList> Controller::Impl::all_projects_list(const std::string &host) {
+void Controller::Impl::all_projects_list(const std::string &host, ResultReceiver<AllProjectsList> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::GetAllProjectsListCommand, AllProjectsList>(
+    create_and_schedule_async_job_<wrpc::GetAllProjectsListCommand, AllProjectsList>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.projects; },
-        "Error getting the projects list");
+        "Error getting the projects list",
+        {},
+        make_coalescing_key<wrpc::GetAllProjectsListCommand, AllProjectsList>());
 }
 
-std::future<bool> Controller::Impl::start_loading_project_config(const std::string &host, std::string master_url) {
+void Controller::Impl::start_loading_project_config(const std::string &host, std::string master_url, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
     check_not_empty__(master_url, "Missing master url");
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::GetProjectConfigCommand, bool>(
+    create_and_schedule_async_job_<wrpc::GetProjectConfigCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error loading the project config",
         {master_url});
 }
 
-std::future<ProjectConfig> Controller::Impl::poll_project_config(const std::string &host) {
+void Controller::Impl::poll_project_config(const std::string &host, ResultReceiver<ProjectConfig> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::GetProjectConfigPollCommand, ProjectConfig>(
+    create_and_schedule_async_job_<wrpc::GetProjectConfigPollCommand, ProjectConfig>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.project_config; },
-        "Error polling the project config");
+        "Error polling the project config",
+        {},
+        make_coalescing_key<wrpc::GetProjectConfigPollCommand, ProjectConfig>());
 }
 
-std::future<bool> Controller::Impl::start_account_lookup(const std::string &host, std::string master_url,
-                                                         std::string email, std::string password) {
+void Controller::Impl::start_account_lookup(const std::string &host, std::string master_url,
+                                            std::string email, std::string password, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
     check_not_empty__(master_url, "Missing master url");
     check_not_empty__(email, "Missing email");
@@ -559,101 +1112,192 @@ std::future<bool> Controller::Impl::start_account_lookup(const std::string &host
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::LookupAccountCommand, bool>(
+    create_and_schedule_async_job_<wrpc::LookupAccountCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error looking up the account info",
         {master_url, email, password});
 }
 
-std::future<AccountOut> Controller::Impl::poll_account_lookup(const std::string &host) {
+void Controller::Impl::poll_account_lookup(const std::string &host, ResultReceiver<AccountOut> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::LookupAccountPollCommand, AccountOut>(
+    create_and_schedule_async_job_<wrpc::LookupAccountPollCommand, AccountOut>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.account_out; },
-        "Error polling the account info");
+        "Error polling the account info",
+        {},
+        make_coalescing_key<wrpc::LookupAccountPollCommand, AccountOut>());
 }
 
-std::future<bool> Controller::Impl::attach_project(const std::string &host,
-                                                   std::string master_url,
-                                                   std::string authenticator) {
+void Controller::Impl::attach_project(const std::string &host,
+                                      std::string master_url,
+                                      std::string authenticator, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
     check_not_empty__(master_url, "Missing master url");
     check_not_empty__(authenticator, "Missing authenticator");
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::ProjectAttachCommand, bool>(
+    create_and_schedule_async_job_<wrpc::ProjectAttachCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error attaching the project",
         {std::move(master_url), std::move(authenticator)});
 }
 
-std::future<bool> Controller::Impl::network_available(const std::string &host) {
+void Controller::Impl::network_available(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::NetworkAvailableCommand, bool>(
+    create_and_schedule_async_job_<wrpc::NetworkAvailableCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error retrying deferred network communication");
 }
 
-std::future<bool> Controller::Impl::run_benchmarks(const std::string &host) {
+void Controller::Impl::run_benchmarks(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::RunBenchmarksCommand, bool>(
+    create_and_schedule_async_job_<wrpc::RunBenchmarksCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error triggering the benchmarks run");
 }
 
-std::future<bool> Controller::Impl::quit(const std::string &host) {
+void Controller::Impl::quit(const std::string &host, ResultReceiver<bool> receiver, const CallOptions &options) {
     check_not_empty_host_name__(host);
 
     WOINC_LOCK_GUARD;
 
-    return create_and_schedule_async_job_<wrpc::QuitCommand, bool>(
+    create_and_schedule_async_job_<wrpc::QuitCommand, bool>(
         __func__,
         host,
+        options,
+        std::move(receiver),
         [](const auto &r) { return r.success; },
         "Error quitting the client");
 }
 
-void Controller::Impl::remove_host_(std::string host) {
+std::shared_ptr<HostController> Controller::Impl::remove_host_(std::string host) {
+    auto host_controller = host_controllers_.at(host);
+
     periodic_tasks_scheduler_context_.remove_host(host);
-    host_controllers_.at(host)->shutdown();
+    host_controller->shutdown();
     host_controllers_.erase(host);
+    update_dispatcher_.remove_host(host);
+    snapshot_store_.remove_host(host);
+    metrics_registry_.remove_host(host);
+    fleet_aggregator_.remove_host(host);
+    statistics_history_.remove_host(host);
     handler_registry_.for_host_handler([&](HostHandler &handler) { handler.on_host_removed(host); });
     configuration_.remove_host(host);
-}
 
-void Controller::Impl::async_remove_host_(std::string host) {
-    WOINC_LOCK_GUARD;
-    verify_not_shutdown_();
-    remove_host_(host);
+    return host_controller;
 }
 
 bool Controller::Impl::has_host_(const std::string &name) const {
     return host_controllers_.find(name) != host_controllers_.end();
 }
 
+void Controller::Impl::save_state_periodically_(std::chrono::seconds interval) {
+    Tracer::thread_name("state saver");
+
+    std::unique_lock<decltype(mutex_)> lock(mutex_);
+
+    while (!state_saver_condition_.wait_for(lock, interval, [this]() { return shutdown_; })) {
+        lock.unlock();
+        try {
+            save_state_(false);
+        } catch (const std::exception &err) {
+#ifndef NDEBUG
+            std::cerr << "Saving the state failed: " << err.what() << "\n";
+#endif
+        }
+        lock.lock();
+    }
+}
+
+void Controller::Impl::save_state_(bool at_shutdown) {
+    StateFile::Hosts hosts;
+    const StateFile *state_file;
+
+    {
+        WOINC_LOCK_GUARD;
+
+        if (!at_shutdown)
+            verify_not_shutdown_();
+        if (!state_file_)
+            throw std::logic_error("No state file set");
+
+        state_file = state_file_.get();
+
+        for (const auto &host_controller : host_controllers_) {
+            const auto &host = host_controller.first;
+            const auto seqnos = periodic_tasks_scheduler_context_.state(host);
+
+            auto &state = hosts[host];
+            state.messages_seqno = seqnos.messages_seqno;
+            state.notices_seqno = seqnos.notices_seqno;
+            state.client_state = snapshot_store_.client_state(host);
+            state.projects = snapshot_store_.projects(host);
+            state.statistics = snapshot_store_.statistics(host);
+            state.tasks = snapshot_store_.tasks(host);
+        }
+    }
+
+    // the state file is only destroyed with the controller, so it outlives the save
+    state_file->save(hosts);
+}
+
+void Controller::Impl::restore_host_(const std::string &host, const StateFile &state_file) {
+    StateFile::HostState state;
+    if (!state_file.restore(host, state))
+        return;
+
+    // the seqnos can only be validated against the start time of the client
+    if (state.client_state) {
+        PeriodicTasksSchedulerContext::State seqnos;
+        seqnos.messages_seqno = state.messages_seqno;
+        seqnos.notices_seqno = state.notices_seqno;
+        seqnos.client_start_time = state.client_state->value.time_stats.client_start_time;
+        periodic_tasks_scheduler_context_.restore(host, seqnos);
+
+        update_dispatcher_.restore(host, state.client_state);
+    }
+
+    if (state.projects)
+        update_dispatcher_.restore(host, state.projects);
+    if (state.statistics)
+        update_dispatcher_.restore(host, state.statistics);
+    if (state.tasks)
+        update_dispatcher_.restore(host, state.tasks);
+}
+
 #ifndef NDEBUG
-void Controller::Impl::schedule_now_(const std::string &host, std::unique_ptr<Job> job, const char *func) {
+void Controller::Impl::schedule_now_(const std::string &host, JobPtr job, const char *func) {
 #else
-void Controller::Impl::schedule_now_(const std::string &host, std::unique_ptr<Job> job, const char *) {
+void Controller::Impl::schedule_now_(const std::string &host, JobPtr job, const char *) {
 #endif
     assert(job != nullptr);
     assert(func != nullptr);
@@ -668,7 +1312,7 @@ void Controller::Impl::schedule_now_(const std::string &host, std::unique_ptr<Jo
         throw UnknownHostException{host};
     }
 
-    hc->second->schedule_now(std::move(job));
+    hc->second->schedule(std::move(job));
 }
 
 void Controller::Impl::verify_not_shutdown_() const {
@@ -716,14 +1360,51 @@ void Controller::register_handler(PeriodicTaskHandler *handler) {
     impl_->register_handler(handler);
 }
 
+void Controller::register_handler(PeriodicTaskHandler *handler, PeriodicTaskSubscription subscription) {
+    impl_->register_handler(handler, std::move(subscription));
+}
+
 void Controller::deregister_handler(PeriodicTaskHandler *handler) {
     impl_->deregister_handler(handler);
 }
 
+void Controller::register_handler(FleetHandler *handler) {
+    impl_->register_handler(handler);
+}
+
+void Controller::deregister_handler(FleetHandler *handler) {
+    impl_->deregister_handler(handler);
+}
+
+void Controller::dispatch_mode(DispatchMode mode) {
+    impl_->dispatch_mode(mode);
+}
+
+DispatchMode Controller::dispatch_mode() const {
+    return impl_->dispatch_mode();
+}
+
+void Controller::bulk_connection(bool value) {
+    impl_->bulk_connection(value);
+}
+
+bool Controller::bulk_connection() const {
+    return impl_->bulk_connection();
+}
+
+void Controller::connect_concurrency(std::size_t value) {
+    impl_->connect_concurrency(value);
+}
+
+std::size_t Controller::connect_concurrency() const {
+    return impl_->connect_concurrency();
+}
+
 void Controller::add_host(const std::string &host,
                           const std::string &url,
-                          std::uint16_t port) {
-    impl_->add_host(host, url, port);
+                          std::uint16_t port,
+                          int connect_priority) {
+    impl_->add_host(host, url, port, connect_priority);
 }
 
 void Controller::authorize_host(const std::string &host,
@@ -739,6 +1420,26 @@ void Controller::async_remove_host(std::string host) {
     impl_->async_remove_host(host);
 }
 
+void Controller::state_file(const std::string &path, std::chrono::seconds save_interval) {
+    impl_->state_file(path, save_interval);
+}
+
+void Controller::save_state() {
+    impl_->save_state();
+}
+
+void Controller::record_rpcs(const std::string &path) {
+    impl_->record_rpcs(path);
+}
+
+void Controller::replay_rpcs(const std::string &path, double speed) {
+    impl_->replay_rpcs(path, speed);
+}
+
+void Controller::connection_factory(ConnectionFactory factory) {
+    impl_->connection_factory(std::move(factory));
+}
+
 void Controller::periodic_task_interval(const PeriodicTask task, std::chrono::milliseconds interval) {
     impl_->periodic_task_interval(task, interval);
 }
@@ -759,96 +1460,337 @@ void Controller::active_only_tasks(const std::string &host, bool value) {
     impl_->active_only_tasks(host, value);
 }
 
+void Controller::snapshot_tasks(std::set<PeriodicTask> tasks) {
+    impl_->snapshot_tasks(tasks);
+}
+
+std::set<PeriodicTask> Controller::snapshot_tasks() const {
+    return impl_->snapshot_tasks();
+}
+
+std::uint64_t Controller::unchanged_replies(const std::string &host, PeriodicTask task) const {
+    return impl_->unchanged_replies(host, task);
+}
+
+HostMetrics Controller::metrics(const std::string &host) const {
+    return impl_->metrics(host);
+}
+
+void Controller::reset_metrics(const std::string &host) {
+    impl_->reset_metrics(host);
+}
+
+void Controller::tracing(bool value) {
+    impl_->tracer().enabled(value);
+}
+
+bool Controller::tracing() const {
+    return impl_->tracer().enabled();
+}
+
+void Controller::trace_buffer_size(std::size_t events) {
+    if (events == 0)
+        throw std::invalid_argument("The trace buffer size must be at least 1");
+    impl_->tracer().capacity(events);
+}
+
+std::size_t Controller::trace_buffer_size() const {
+    return impl_->tracer().capacity();
+}
+
+void Controller::write_trace(std::ostream &out) const {
+    impl_->tracer().write(out);
+}
+
+void Controller::clear_trace() {
+    impl_->tracer().clear();
+}
+
 std::future<bool> Controller::file_transfer_op(const std::string &host, FileTransferOp op,
-                                               const std::string &master_url, const std::string &filename) {
-    return impl_->file_transfer_op(host, op, master_url, filename);
+                                               const std::string &master_url, const std::string &filename, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->file_transfer_op(host, op, master_url, filename, std::move(receiver), options); });
 }
 
-std::future<bool> Controller::project_op(const std::string &host, ProjectOp op, const std::string &master_url) {
-    return impl_->project_op(host, op, master_url);
+void Controller::file_transfer_op(const std::string &host, FileTransferOp op,
+                                  const std::string &master_url, const std::string &filename, Completion<bool> completion, const CallOptions &options) {
+    impl_->file_transfer_op(host, op, master_url, filename, ResultReceiver<bool>(std::move(completion)), options);
+}
+
+std::future<bool> Controller::project_op(const std::string &host, ProjectOp op, const std::string &master_url, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->project_op(host, op, master_url, std::move(receiver), options); });
+}
+
+void Controller::project_op(const std::string &host, ProjectOp op, const std::string &master_url, Completion<bool> completion, const CallOptions &options) {
+    impl_->project_op(host, op, master_url, ResultReceiver<bool>(std::move(completion)), options);
 }
 
 std::future<bool> Controller::task_op(const std::string &host, TaskOp op,
-                         const std::string &master_url, const std::string &task_name) {
-    return impl_->task_op(host, op, master_url, task_name);
+                         const std::string &master_url, const std::string &task_name, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->task_op(host, op, master_url, task_name, std::move(receiver), options); });
+}
+
+void Controller::task_op(const std::string &host, TaskOp op,
+                         const std::string &master_url, const std::string &task_name, Completion<bool> completion, const CallOptions &options) {
+    impl_->task_op(host, op, master_url, task_name, ResultReceiver<bool>(std::move(completion)), options);
+}
+
+SnapshotPtr<CCStatus> Controller::cc_status_snapshot(const std::string &host) const {
+    return impl_->snapshot_store().cc_status(host);
+}
+
+SnapshotPtr<ClientState> Controller::client_state_snapshot(const std::string &host) const {
+    return impl_->snapshot_store().client_state(host);
+}
+
+SnapshotPtr<DiskUsage> Controller::disk_usage_snapshot(const std::string &host) const {
+    return impl_->snapshot_store().disk_usage(host);
+}
+
+SnapshotPtr<FileTransfers> Controller::file_transfers_snapshot(const std::string &host) const {
+    return impl_->snapshot_store().file_transfers(host);
+}
+
+SnapshotPtr<Projects> Controller::projects_snapshot(const std::string &host) const {
+    return impl_->snapshot_store().projects(host);
+}
+
+SnapshotPtr<Statistics> Controller::statistics_snapshot(const std::string &host) const {
+    return impl_->snapshot_store().statistics(host);
+}
+
+SnapshotPtr<Tasks> Controller::tasks_snapshot(const std::string &host) const {
+    return impl_->snapshot_store().tasks(host);
+}
+
+void Controller::aggregate_fleet(bool value) {
+    impl_->aggregate_fleet(value);
+}
+
+bool Controller::aggregate_fleet() const {
+    return impl_->aggregate_fleet();
+}
+
+void Controller::fleet_deadline_horizon(std::chrono::seconds horizon) {
+    impl_->fleet_deadline_horizon(horizon);
+}
+
+std::chrono::seconds Controller::fleet_deadline_horizon() const {
+    return impl_->fleet_aggregator().deadline_horizon();
+}
+
+SnapshotPtr<FleetAggregates> Controller::fleet_aggregates() const {
+    return impl_->fleet_aggregator().aggregates();
+}
+
+void Controller::record_statistics_history(bool value) {
+    impl_->record_statistics_history(value);
+}
+
+bool Controller::record_statistics_history() const {
+    return impl_->record_statistics_history();
+}
+
+void Controller::statistics_history_retention(std::chrono::hours retention) {
+    if (retention.count() <= 0)
+        throw std::invalid_argument("Invalid retention");
+    impl_->statistics_history().retention(retention);
+}
+
+std::chrono::hours Controller::statistics_history_retention() const {
+    return impl_->statistics_history().retention();
+}
+
+DailyStatistics Controller::statistics_history(const std::string &host, const std::string &master_url,
+                                               std::time_t from, std::time_t to, std::size_t max_points) const {
+    return impl_->statistics_history().query(host, master_url, from, to, max_points);
+}
+
+std::vector<std::string> Controller::statistics_history_projects(const std::string &host) const {
+    return impl_->statistics_history().projects(host);
+}
+
+std::size_t Controller::statistics_history_memory() const {
+    return impl_->statistics_history().memory();
+}
+
+void Controller::write_statistics_history(std::ostream &out) const {
+    impl_->statistics_history().write(out);
+}
+
+void Controller::read_statistics_history(std::istream &in) {
+    impl_->statistics_history().read(in);
+}
+
+std::future<CCStatus> Controller::cc_status(const std::string &host, std::chrono::milliseconds max_age, const CallOptions &options) {
+    return with_future__<CCStatus>([&](auto receiver) { impl_->cc_status(host, max_age, std::move(receiver), options); });
+}
+
+void Controller::cc_status(const std::string &host, std::chrono::milliseconds max_age, Completion<CCStatus> completion, const CallOptions &options) {
+    impl_->cc_status(host, max_age, ResultReceiver<CCStatus>(std::move(completion)), options);
+}
+
+std::future<Tasks> Controller::tasks(const std::string &host, std::chrono::milliseconds max_age, const CallOptions &options) {
+    return with_future__<Tasks>([&](auto receiver) { impl_->tasks(host, max_age, std::move(receiver), options); });
+}
+
+void Controller::tasks(const std::string &host, std::chrono::milliseconds max_age, Completion<Tasks> completion, const CallOptions &options) {
+    impl_->tasks(host, max_age, ResultReceiver<Tasks>(std::move(completion)), options);
 }
 
 std::future<GlobalPreferences> Controller::load_global_preferences(const std::string &host,
-                                                                   GetGlobalPrefsMode mode) {
-    return impl_->load_global_preferences(host, mode);
+                                                                   GetGlobalPrefsMode mode, const CallOptions &options) {
+    return with_future__<GlobalPreferences>([&](auto receiver) { impl_->load_global_preferences(host, mode, std::move(receiver), options); });
+}
+
+void Controller::load_global_preferences(const std::string &host,
+                                         GetGlobalPrefsMode mode, Completion<GlobalPreferences> completion, const CallOptions &options) {
+    impl_->load_global_preferences(host, mode, ResultReceiver<GlobalPreferences>(std::move(completion)), options);
 }
 
 std::future<bool> Controller::save_global_preferences(const std::string &host,
                                                       const GlobalPreferences &prefs,
-                                                      const GlobalPreferencesMask &mask) {
-    return impl_->save_global_preferences(host, prefs, mask);
+                                                      const GlobalPreferencesMask &mask, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->save_global_preferences(host, prefs, mask, std::move(receiver), options); });
+}
+
+void Controller::save_global_preferences(const std::string &host,
+                                         const GlobalPreferences &prefs,
+                                         const GlobalPreferencesMask &mask, Completion<bool> completion, const CallOptions &options) {
+    impl_->save_global_preferences(host, prefs, mask, ResultReceiver<bool>(std::move(completion)), options);
+}
+
+std::future<bool> Controller::read_global_prefs_override(const std::string &host, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->read_global_prefs_override(host, std::move(receiver), options); });
+}
+
+void Controller::read_global_prefs_override(const std::string &host, Completion<bool> completion, const CallOptions &options) {
+    impl_->read_global_prefs_override(host, ResultReceiver<bool>(std::move(completion)), options);
+}
+
+std::future<CCConfig> Controller::cc_config(const std::string &host, const CallOptions &options) {
+    return with_future__<CCConfig>([&](auto receiver) { impl_->cc_config(host, std::move(receiver), options); });
+}
+
+void Controller::cc_config(const std::string &host, Completion<CCConfig> completion, const CallOptions &options) {
+    impl_->cc_config(host, ResultReceiver<CCConfig>(std::move(completion)), options);
+}
+
+std::future<bool> Controller::cc_config(const std::string &host, const CCConfig &cc_config, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->cc_config(host, cc_config, std::move(receiver), options); });
+}
+
+void Controller::cc_config(const std::string &host, const CCConfig &cc_config, Completion<bool> completion, const CallOptions &options) {
+    impl_->cc_config(host, cc_config, ResultReceiver<bool>(std::move(completion)), options);
+}
+
+std::future<bool> Controller::read_config_files(const std::string &host, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->read_config_files(host, std::move(receiver), options); });
+}
+
+void Controller::read_config_files(const std::string &host, Completion<bool> completion, const CallOptions &options) {
+    impl_->read_config_files(host, ResultReceiver<bool>(std::move(completion)), options);
+}
+
+std::future<bool> Controller::gpu_mode(const std::string &host, RunMode mode, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->gpu_mode(host, mode, std::move(receiver), options); });
 }
 
-std::future<bool> Controller::read_global_prefs_override(const std::string &host) {
-    return impl_->read_global_prefs_override(host);
+void Controller::gpu_mode(const std::string &host, RunMode mode, Completion<bool> completion, const CallOptions &options) {
+    impl_->gpu_mode(host, mode, ResultReceiver<bool>(std::move(completion)), options);
 }
 
-std::future<CCConfig> Controller::cc_config(const std::string &host) {
-    return impl_->cc_config(host);
+std::future<bool> Controller::network_mode(const std::string &host, RunMode mode, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->network_mode(host, mode, std::move(receiver), options); });
 }
 
-std::future<bool> Controller::cc_config(const std::string &host, const CCConfig &cc_config) {
-    return impl_->cc_config(host, cc_config);
+void Controller::network_mode(const std::string &host, RunMode mode, Completion<bool> completion, const CallOptions &options) {
+    impl_->network_mode(host, mode, ResultReceiver<bool>(std::move(completion)), options);
 }
 
-std::future<bool> Controller::read_config_files(const std::string &host) {
-    return impl_->read_config_files(host);
+std::future<bool> Controller::run_mode(const std::string &host, RunMode mode, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->run_mode(host, mode, std::move(receiver), options); });
 }
 
-std::future<bool> Controller::gpu_mode(const std::string &host, RunMode mode) {
-    return impl_->gpu_mode(host, mode);
+void Controller::run_mode(const std::string &host, RunMode mode, Completion<bool> completion, const CallOptions &options) {
+    impl_->run_mode(host, mode, ResultReceiver<bool>(std::move(completion)), options);
 }
 
-std::future<bool> Controller::network_mode(const std::string &host, RunMode mode) {
-    return impl_->network_mode(host, mode);
+std::future<AllProjectsList> Controller::all_projects_list(const std::string &host, const CallOptions &options) {
+    return with_future__<AllProjectsList>([&](auto receiver) { impl_->all_projects_list(host, std::move(receiver), options); });
 }
 
-std::future<bool> Controller::run_mode(const std::string &host, RunMode mode) {
-    return impl_->run_mode(host, mode);
+void Controller::all_projects_list(const std::string &host, Completion<AllProjectsList> completion, const CallOptions &options) {
+    impl_->all_projects_list(host, ResultReceiver<AllProjectsList>(std::move(completion)), options);
 }
 
-std::future<AllProjectsList> Controller::all_projects_list(const std::string &host) {
-    return impl_->all_projects_list(host);
+std::future<bool> Controller::start_loading_project_config(const std::string &host, std::string master_url, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->start_loading_project_config(host, std::move(master_url), std::move(receiver), options); });
 }
 
-std::future<bool> Controller::start_loading_project_config(const std::string &host, std::string master_url) {
-    return impl_->start_loading_project_config(host, std::move(master_url));
+void Controller::start_loading_project_config(const std::string &host, std::string master_url, Completion<bool> completion, const CallOptions &options) {
+    impl_->start_loading_project_config(host, std::move(master_url), ResultReceiver<bool>(std::move(completion)), options);
 }
 
-std::future<ProjectConfig> Controller::poll_project_config(const std::string &host) {
-    return impl_->poll_project_config(host);
+std::future<ProjectConfig> Controller::poll_project_config(const std::string &host, const CallOptions &options) {
+    return with_future__<ProjectConfig>([&](auto receiver) { impl_->poll_project_config(host, std::move(receiver), options); });
+}
+
+void Controller::poll_project_config(const std::string &host, Completion<ProjectConfig> completion, const CallOptions &options) {
+    impl_->poll_project_config(host, ResultReceiver<ProjectConfig>(std::move(completion)), options);
 }
 
 std::future<bool> Controller::start_account_lookup(const std::string &host, std::string master_url,
-                                                   std::string email, std::string password) {
-    return impl_->start_account_lookup(host, std::move(master_url), std::move(email), std::move(password));
+                                                   std::string email, std::string password, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->start_account_lookup(host, std::move(master_url), std::move(email), std::move(password), std::move(receiver), options); });
 }
 
-std::future<AccountOut> Controller::poll_account_lookup(const std::string &host) {
-    return impl_->poll_account_lookup(host);
+void Controller::start_account_lookup(const std::string &host, std::string master_url,
+                                      std::string email, std::string password, Completion<bool> completion, const CallOptions &options) {
+    impl_->start_account_lookup(host, std::move(master_url), std::move(email), std::move(password), ResultReceiver<bool>(std::move(completion)), options);
+}
+
+std::future<AccountOut> Controller::poll_account_lookup(const std::string &host, const CallOptions &options) {
+    return with_future__<AccountOut>([&](auto receiver) { impl_->poll_account_lookup(host, std::move(receiver), options); });
+}
+
+void Controller::poll_account_lookup(const std::string &host, Completion<AccountOut> completion, const CallOptions &options) {
+    impl_->poll_account_lookup(host, ResultReceiver<AccountOut>(std::move(completion)), options);
 }
 
 std::future<bool> Controller::attach_project(const std::string &host,
                                              std::string master_url,
-                                             std::string authenticator) {
-    return impl_->attach_project(host, std::move(master_url), std::move(authenticator));
+                                             std::string authenticator, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->attach_project(host, std::move(master_url), std::move(authenticator), std::move(receiver), options); });
+}
+
+void Controller::attach_project(const std::string &host,
+                                std::string master_url,
+                                std::string authenticator, Completion<bool> completion, const CallOptions &options) {
+    impl_->attach_project(host, std::move(master_url), std::move(authenticator), ResultReceiver<bool>(std::move(completion)), options);
+}
+
+std::future<bool> Controller::network_available(const std::string &host, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->network_available(host, std::move(receiver), options); });
+}
+
+void Controller::network_available(const std::string &host, Completion<bool> completion, const CallOptions &options) {
+    impl_->network_available(host, ResultReceiver<bool>(std::move(completion)), options);
+}
+
+std::future<bool> Controller::run_benchmarks(const std::string &host, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->run_benchmarks(host, std::move(receiver), options); });
 }
 
-std::future<bool> Controller::network_available(const std::string &host) {
-    return impl_->network_available(host);
+void Controller::run_benchmarks(const std::string &host, Completion<bool> completion, const CallOptions &options) {
+    impl_->run_benchmarks(host, ResultReceiver<bool>(std::move(completion)), options);
 }
 
-std::future<bool> Controller::run_benchmarks(const std::string &host) {
-    return impl_->run_benchmarks(host);
+std::future<bool> Controller::quit(const std::string &host, const CallOptions &options) {
+    return with_future__<bool>([&](auto receiver) { impl_->quit(host, std::move(receiver), options); });
 }
 
-std::future<bool> Controller::quit(const std::string &host) {
-    return impl_->quit(host);
+void Controller::quit(const std::string &host, Completion<bool> completion, const CallOptions &options) {
+    impl_->quit(host, ResultReceiver<bool>(std::move(completion)), options);
 }
 
 }}
@@ -0,0 +1,310 @@
+/* libui/src/fleet_aggregator.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "fleet_aggregator.h"
+
+#include <algorithm>
+#include <ctime>
+#include <memory>
+#include <utility>
+
+#define WOINC_LOCK_GUARD std::lock_guard<decltype(mutex_)> guard(mutex_)
+
+namespace {
+
+template<typename T>
+void add__(T &total, T value, int sign) {
+    if (sign > 0)
+        total += value;
+    else
+        total -= value;
+}
+
+bool is_running__(const woinc::Task &task) {
+    return task.active_task && task.active_task->scheduler_state == woinc::SchedulerState::Scheduled;
+}
+
+}
+
+namespace woinc { namespace ui {
+
+FleetAggregator::FleetAggregator()
+    : deadline_horizon_(std::chrono::seconds(std::chrono::hours(24)).count())
+    , changed_at_(std::chrono::steady_clock::now())
+{}
+
+void FleetAggregator::deadline_horizon(std::chrono::seconds horizon) {
+    deadline_horizon_.store(horizon.count());
+}
+
+std::chrono::seconds FleetAggregator::deadline_horizon() const {
+    return std::chrono::seconds(deadline_horizon_.load());
+}
+
+void FleetAggregator::add_host(const std::string &host) {
+    WOINC_LOCK_GUARD;
+    hosts_.emplace(host, Host());
+}
+
+void FleetAggregator::remove_host(const std::string &host) {
+    {
+        WOINC_LOCK_GUARD;
+
+        auto iter = hosts_.find(host);
+        if (iter == hosts_.end())
+            return;
+
+        apply_(host, iter->second.tasks, -1);
+        apply_(host, iter->second.projects, -1);
+        apply_(host, iter->second.credit_last_day, -1);
+        apply_(host, iter->second.suspend_reason, -1);
+        hosts_.erase(iter);
+
+        changed_();
+    }
+
+    notify_(host);
+}
+
+void FleetAggregator::clear() {
+    WOINC_LOCK_GUARD;
+
+    for (auto &host : hosts_)
+        host.second = Host();
+    project_references_.clear();
+    aggregates_ = FleetAggregates();
+
+    ++version_;
+    changed_at_ = std::chrono::steady_clock::now();
+}
+
+SnapshotPtr<FleetAggregates> FleetAggregator::aggregates() const {
+    WOINC_LOCK_GUARD;
+    return latest_snapshot_();
+}
+
+SnapshotPtr<FleetAggregates> FleetAggregator::latest_snapshot_() const {
+    if (!snapshot_ || snapshot_version_ != version_) {
+        auto snapshot = std::make_shared<Snapshot<FleetAggregates>>();
+        snapshot->value = aggregates_;
+        snapshot->time = changed_at_;
+        snapshot_ = std::move(snapshot);
+        snapshot_version_ = version_;
+    }
+
+    return snapshot_;
+}
+
+void FleetAggregator::register_handler(FleetHandler *handler) {
+    std::lock_guard<decltype(handlers_mutex_)> guard(handlers_mutex_);
+    handlers_.push_back(handler);
+}
+
+void FleetAggregator::deregister_handler(FleetHandler *handler) {
+    std::lock_guard<decltype(handlers_mutex_)> guard(handlers_mutex_);
+    handlers_.erase(std::remove(handlers_.begin(), handlers_.end(), handler), handlers_.end());
+}
+
+void FleetAggregator::on_update(const std::string &host, const woinc::CCStatus &cc_status) {
+    replace_(host, &Host::suspend_reason, cc_status.cpu.suspend_reason);
+}
+
+void FleetAggregator::on_update(const std::string &host, const woinc::Projects &projects) {
+    std::map<std::string, ProjectStatus> contribution;
+
+    for (const auto &project : projects) {
+        auto &status = contribution[project.master_url];
+        status.name = project.project_name;
+        status.credit_per_day = project.host_expavg_credit;
+    }
+
+    replace_(host, &Host::projects, std::move(contribution));
+}
+
+void FleetAggregator::on_update(const std::string &host, const woinc::Statistics &statistics) {
+    std::map<std::string, double> contribution;
+
+    for (const auto &project : statistics) {
+        // the statistics are ordered by day, but don't rely on it
+        const DailyStatistic *latest = nullptr;
+        const DailyStatistic *previous = nullptr;
+
+        for (const auto &day : project.daily_statistics) {
+            if (latest == nullptr || day.day > latest->day) {
+                previous = latest;
+                latest = &day;
+            } else if (previous == nullptr || day.day > previous->day) {
+                previous = &day;
+            }
+        }
+
+        double credit = 0;
+        if (previous != nullptr)
+            credit = std::max(0., latest->host_total_credit - previous->host_total_credit);
+
+        contribution[project.master_url] += credit;
+    }
+
+    replace_(host, &Host::credit_last_day, std::move(contribution));
+}
+
+void FleetAggregator::on_update(const std::string &host, const woinc::Tasks &tasks) {
+    std::map<std::string, TaskCounts> contribution;
+
+    const auto deadline = std::time(nullptr) + static_cast<std::time_t>(deadline_horizon_.load());
+
+    for (const auto &task : tasks) {
+        auto &counts = contribution[task.project_url];
+        ++counts.tasks;
+        if (is_running__(task))
+            ++counts.running;
+        if (!task.ready_to_report && task.report_deadline > 0 && task.report_deadline <= deadline)
+            ++counts.near_deadline;
+    }
+
+    replace_(host, &Host::tasks, std::move(contribution));
+}
+
+template<typename Contribution>
+void FleetAggregator::replace_(const std::string &host, Contribution Host::*slot, Contribution contribution) {
+    {
+        WOINC_LOCK_GUARD;
+
+        // the host may have been removed meanwhile
+        auto known = hosts_.find(host);
+        if (known == hosts_.end())
+            return;
+
+        auto &current = known->second.*slot;
+
+        if (current == contribution)
+            return;
+
+        apply_(host, current, -1);
+        apply_(host, contribution, 1);
+        current = std::move(contribution);
+
+        changed_();
+    }
+
+    notify_(host);
+}
+
+void FleetAggregator::apply_(const std::string &, const std::map<std::string, TaskCounts> &tasks, int sign) {
+    for (const auto &entry : tasks) {
+        auto &project = sign > 0 ? acquire_(entry.first) : aggregates_.projects.at(entry.first);
+
+        add__(project.tasks, entry.second.tasks, sign);
+        add__(project.running_tasks, entry.second.running, sign);
+        add__(project.tasks_near_deadline, entry.second.near_deadline, sign);
+
+        add__(aggregates_.tasks, entry.second.tasks, sign);
+        add__(aggregates_.running_tasks, entry.second.running, sign);
+        add__(aggregates_.tasks_near_deadline, entry.second.near_deadline, sign);
+
+        if (sign < 0)
+            release_(entry.first);
+    }
+}
+
+void FleetAggregator::apply_(const std::string &, const std::map<std::string, ProjectStatus> &projects, int sign) {
+    for (const auto &entry : projects) {
+        auto &project = sign > 0 ? acquire_(entry.first) : aggregates_.projects.at(entry.first);
+
+        if (sign > 0 && !entry.second.name.empty())
+            project.name = entry.second.name;
+
+        add__(project.hosts, std::size_t(1), sign);
+        add__(project.credit_per_day, entry.second.credit_per_day, sign);
+        add__(aggregates_.credit_per_day, entry.second.credit_per_day, sign);
+
+        if (sign < 0)
+            release_(entry.first);
+    }
+}
+
+void FleetAggregator::apply_(const std::string &, const std::map<std::string, double> &credit_last_day, int sign) {
+    for (const auto &entry : credit_last_day) {
+        auto &project = sign > 0 ? acquire_(entry.first) : aggregates_.projects.at(entry.first);
+
+        add__(project.credit_last_day, entry.second, sign);
+        add__(aggregates_.credit_last_day, entry.second, sign);
+
+        if (sign < 0)
+            release_(entry.first);
+    }
+}
+
+void FleetAggregator::apply_(const std::string &host, SuspendReason reason, int sign) {
+    if (reason == SuspendReason::NotSuspended)
+        return;
+
+    if (sign > 0) {
+        aggregates_.suspended_hosts[host] = reason;
+        ++aggregates_.suspend_reasons[reason];
+    } else {
+        aggregates_.suspended_hosts.erase(host);
+        if (--aggregates_.suspend_reasons.at(reason) == 0)
+            aggregates_.suspend_reasons.erase(reason);
+    }
+}
+
+FleetProjectTotals &FleetAggregator::acquire_(const std::string &url) {
+    ++project_references_[url];
+    return aggregates_.projects[url];
+}
+
+void FleetAggregator::release_(const std::string &url) {
+    auto references = project_references_.find(url);
+
+    if (--references->second > 0)
+        return;
+
+    project_references_.erase(references);
+    aggregates_.projects.erase(url);
+
+    // don't keep the rounding errors of the subtracted credits
+    if (aggregates_.projects.empty()) {
+        aggregates_.credit_per_day = 0;
+        aggregates_.credit_last_day = 0;
+    }
+}
+
+void FleetAggregator::changed_() {
+    ++version_;
+    changed_at_ = std::chrono::steady_clock::now();
+}
+
+void FleetAggregator::notify_(const std::string &host) {
+    std::lock_guard<decltype(handlers_mutex_)> handlers_guard(handlers_mutex_);
+
+    if (handlers_.empty())
+        return;
+
+    // the latest aggregates, so the handlers never go back to older ones if another host changed them meanwhile
+    SnapshotPtr<FleetAggregates> snapshot;
+    {
+        WOINC_LOCK_GUARD;
+        snapshot = latest_snapshot_();
+    }
+
+    for (auto handler : handlers_)
+        handler->on_update(host, snapshot->value);
+}
+
+}}
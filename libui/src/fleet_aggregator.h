@@ -0,0 +1,147 @@
+/* libui/src/fleet_aggregator.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_FLEET_AGGREGATOR_H_
+#define WOINC_UI_FLEET_AGGREGATOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <woinc/types.h>
+#include <woinc/ui/fleet.h>
+#include <woinc/ui/handler.h>
+#include <woinc/ui/snapshot.h>
+
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+// Maintains the fleet aggregates as the sum of the contributions of the hosts.
+//
+// Registered as periodic task handler while enabled, an update of a host only replaces the contribution of this host,
+// so it costs the size of the update and not the size of the fleet. Unchanged contributions don't notify the handlers.
+// The snapshot for the queries is only copied from the aggregates if they changed since the last query.
+//
+// The handlers are called after releasing the lock of the aggregates with their latest snapshot,
+// so they may query the aggregator but not (de)register handlers.
+// Updates of unknown hosts are ignored, e.g. a late one of a removed host.
+class WOINCUI_LOCAL FleetAggregator : public PeriodicTaskHandler {
+    public:
+        FleetAggregator();
+
+        // tasks with a report deadline closer than the horizon count as near their deadline
+        void deadline_horizon(std::chrono::seconds horizon);
+        std::chrono::seconds deadline_horizon() const;
+
+        void add_host(const std::string &host);
+        // drops the contributions of the host
+        void remove_host(const std::string &host);
+        // drops all contributions, e.g. when being disabled, but keeps the hosts
+        void clear();
+
+        SnapshotPtr<FleetAggregates> aggregates() const;
+
+        void register_handler(FleetHandler *handler);
+        void deregister_handler(FleetHandler *handler);
+
+    public:
+        using PeriodicTaskHandler::on_update;
+
+        void on_update(const std::string &host, const woinc::CCStatus &cc_status) final;
+        void on_update(const std::string &host, const woinc::Projects &projects) final;
+        void on_update(const std::string &host, const woinc::Statistics &statistics) final;
+        void on_update(const std::string &host, const woinc::Tasks &tasks) final;
+
+    private:
+        struct TaskCounts {
+            std::size_t tasks = 0;
+            std::size_t running = 0;
+            std::size_t near_deadline = 0;
+
+            bool operator==(const TaskCounts &o) const {
+                return tasks == o.tasks && running == o.running && near_deadline == o.near_deadline;
+            }
+        };
+
+        struct ProjectStatus {
+            std::string name;
+            double credit_per_day = 0;
+
+            bool operator==(const ProjectStatus &o) const {
+                return name == o.name && credit_per_day == o.credit_per_day;
+            }
+        };
+
+        // the contribution of a host, each project entry holds a reference to the project totals
+        struct Host {
+            std::map<std::string, TaskCounts> tasks;
+            std::map<std::string, ProjectStatus> projects;
+            std::map<std::string, double> credit_last_day;
+            SuspendReason suspend_reason = SuspendReason::NotSuspended;
+        };
+
+        // replaces the contribution of the host in the slot with the new one and notifies the handlers if it changed
+        template<typename Contribution>
+        void replace_(const std::string &host, Contribution Host::*slot, Contribution contribution);
+
+        // assumes the aggregates are locked
+        SnapshotPtr<FleetAggregates> latest_snapshot_() const;
+
+        // adds (sign 1) or subtracts (sign -1) the contribution to the aggregates
+        void apply_(const std::string &host, const std::map<std::string, TaskCounts> &tasks, int sign);
+        void apply_(const std::string &host, const std::map<std::string, ProjectStatus> &projects, int sign);
+        void apply_(const std::string &host, const std::map<std::string, double> &credit_last_day, int sign);
+        void apply_(const std::string &host, SuspendReason reason, int sign);
+
+        // adding a contribution to a project acquires its totals, subtracting it releases them
+        FleetProjectTotals &acquire_(const std::string &url);
+        void release_(const std::string &url);
+
+        // assumes the aggregates are locked
+        void changed_();
+        // must not be called while the aggregates are locked
+        void notify_(const std::string &host);
+
+    private:
+        std::atomic<std::chrono::seconds::rep> deadline_horizon_;
+
+        // held while calling the handlers, acquired before mutex_ if both are needed
+        std::mutex handlers_mutex_;
+        std::vector<FleetHandler *> handlers_;
+
+        mutable std::mutex mutex_;
+        std::map<std::string, Host> hosts_;
+        FleetAggregates aggregates_;
+        // the number of host contributions referencing the project totals
+        std::map<std::string, std::size_t> project_references_;
+
+        std::uint64_t version_ = 0;
+        std::chrono::steady_clock::time_point changed_at_;
+        mutable std::uint64_t snapshot_version_ = 0;
+        mutable SnapshotPtr<FleetAggregates> snapshot_;
+};
+
+}}
+
+#endif
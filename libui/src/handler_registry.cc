@@ -37,17 +37,21 @@ void HandlerRegistry::deregister_handler(HostHandler *handler) {
                         host_handler_.end());
 }
 
-void HandlerRegistry::register_handler(PeriodicTaskHandler *handler) {
+void HandlerRegistry::register_handler(PeriodicTaskHandler *handler, PeriodicTaskSubscription subscription) {
     WOINC_LOCK_GUARD;
-    periodic_task_handler_.push_back(handler);
+    std::lock_guard<decltype(subscriptions_mutex_)> subscriptions_guard(subscriptions_mutex_);
+    periodic_task_handler_.push_back(PeriodicTaskSubscriber{handler, std::move(subscription)});
+    ++subscriptions_version_;
 }
 
 void HandlerRegistry::deregister_handler(PeriodicTaskHandler *handler) {
     WOINC_LOCK_GUARD;
-    periodic_task_handler_.erase(std::remove(periodic_task_handler_.begin(),
-                                             periodic_task_handler_.end(),
-                                             handler),
+    std::lock_guard<decltype(subscriptions_mutex_)> subscriptions_guard(subscriptions_mutex_);
+    periodic_task_handler_.erase(std::remove_if(periodic_task_handler_.begin(),
+                                                periodic_task_handler_.end(),
+                                                [&](const auto &subscriber) { return subscriber.handler == handler; }),
                                  periodic_task_handler_.end());
+    ++subscriptions_version_;
 }
 
 void HandlerRegistry::for_host_handler(std::function<void(HostHandler &handler)> f) const {
@@ -58,8 +62,49 @@ void HandlerRegistry::for_host_handler(std::function<void(HostHandler &handler)>
 
 void HandlerRegistry::for_periodic_task_handler(std::function<void(PeriodicTaskHandler &handler)> f) const {
     WOINC_LOCK_GUARD;
-    for (auto &&handler : periodic_task_handler_)
-        f(*handler);
+    for (auto &&subscriber : periodic_task_handler_)
+        f(*subscriber.handler);
+}
+
+void HandlerRegistry::for_periodic_task_handler(const std::string &host, PeriodicTask task,
+                                                std::function<void(PeriodicTaskHandler &handler)> f) const {
+    WOINC_LOCK_GUARD;
+    for (auto &&subscriber : periodic_task_handler_)
+        if (subscriber.subscription.matches(host, task))
+            f(*subscriber.handler);
+}
+
+void HandlerRegistry::snapshot_tasks(PeriodicTaskSet tasks) {
+    std::lock_guard<decltype(subscriptions_mutex_)> guard(subscriptions_mutex_);
+    snapshot_tasks_ = tasks;
+    ++subscriptions_version_;
+}
+
+PeriodicTaskSet HandlerRegistry::snapshot_tasks() const {
+    std::lock_guard<decltype(subscriptions_mutex_)> guard(subscriptions_mutex_);
+    return snapshot_tasks_;
+}
+
+std::uint64_t HandlerRegistry::subscriptions_version() const {
+    return subscriptions_version_;
+}
+
+PeriodicTaskSet HandlerRegistry::subscribed_periodic_tasks(const std::string &host) const {
+    std::lock_guard<decltype(subscriptions_mutex_)> guard(subscriptions_mutex_);
+
+    PeriodicTaskSet tasks = snapshot_tasks_;
+
+    for (auto &&subscriber : periodic_task_handler_) {
+        const auto &subscription = subscriber.subscription;
+        if (!subscription.hosts.empty() && subscription.hosts.find(host) == subscription.hosts.end())
+            continue;
+        if (subscription.tasks.empty())
+            return tasks.set();
+        for (auto task : subscription.tasks)
+            tasks.set(static_cast<size_t>(task));
+    }
+
+    return tasks;
 }
 
 }}
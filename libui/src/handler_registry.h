@@ -19,8 +19,12 @@
 #ifndef WOINC_UI_HANDLER_REGISTRY_H_
 #define WOINC_UI_HANDLER_REGISTRY_H_
 
+#include <atomic>
+#include <bitset>
+#include <cstdint>
 #include <functional>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include <woinc/ui/handler.h>
@@ -29,23 +33,51 @@
 
 namespace woinc { namespace ui {
 
+// one bit per PeriodicTask
+typedef std::bitset<PERIODIC_TASK_COUNT> PeriodicTaskSet;
+
 class WOINCUI_LOCAL HandlerRegistry {
     public:
         void register_handler(HostHandler *handler);
         void deregister_handler(HostHandler *handler);
 
-        void register_handler(PeriodicTaskHandler *handler);
+        void register_handler(PeriodicTaskHandler *handler, PeriodicTaskSubscription subscription = {});
         void deregister_handler(PeriodicTaskHandler *handler);
 
+        // the tasks scheduled for all hosts even if no handler is subscribed to them, see Controller::snapshot_tasks
+        void snapshot_tasks(PeriodicTaskSet tasks);
+        PeriodicTaskSet snapshot_tasks() const;
+
     public:
         void for_host_handler(std::function<void(HostHandler &handler)> f) const;
         void for_periodic_task_handler(std::function<void(PeriodicTaskHandler &handler)> f) const;
+        // only calls the handlers subscribed to the host and task
+        void for_periodic_task_handler(const std::string &host, PeriodicTask task,
+                                       std::function<void(PeriodicTaskHandler &handler)> f) const;
+
+        // the periodic tasks at least one handler is subscribed to for the given host and the snapshot tasks,
+        // may be called while holding locks the handlers may need as well
+        PeriodicTaskSet subscribed_periodic_tasks(const std::string &host) const;
+
+        // changes whenever a periodic task handler is (de)registered or the snapshot tasks change,
+        // i.e. whenever an unchanged reply may not be skipped because someone didn't receive it yet
+        std::uint64_t subscriptions_version() const;
 
     private:
+        struct PeriodicTaskSubscriber {
+            PeriodicTaskHandler *handler;
+            PeriodicTaskSubscription subscription;
+        };
+
+        // mutex_ is held while calling the handlers, subscriptions_mutex_ only while reading the subscriptions;
+        // the periodic task subscribers are modified while holding both
         mutable std::mutex mutex_;
+        mutable std::mutex subscriptions_mutex_;
 
         std::vector<HostHandler *> host_handler_;
-        std::vector<PeriodicTaskHandler *> periodic_task_handler_;
+        std::vector<PeriodicTaskSubscriber> periodic_task_handler_;
+        PeriodicTaskSet snapshot_tasks_;
+        std::atomic<std::uint64_t> subscriptions_version_{0};
 };
 
 }}
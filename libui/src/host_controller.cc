@@ -20,45 +20,189 @@
 
 namespace woinc { namespace ui {
 
-HostController::HostController(std::string name) : host_name_(std::move(name)) {}
+HostController::HostController(std::string name,
+                               const HandlerRegistry &handler_registry,
+                               UpdateDispatcher &dispatcher,
+                               PostExecutionHandler &periodic_job_handler,
+                               HostMetricsRecorderPtr metrics,
+                               Tracer &tracer,
+                               bool bulk_connection,
+                               const ConnectionFactory &connection_factory)
+    : host_name_(std::move(name))
+    , handler_registry_(handler_registry)
+    , dispatcher_(dispatcher)
+    , periodic_job_handler_(periodic_job_handler)
+    , metrics_(std::move(metrics))
+    , tracer_(tracer)
+    , trace_host_(tracer_.host_id(host_name_))
+    , client_(host_name_, metrics_, &tracer_, connection_factory)
+    , use_bulk_connection_(bulk_connection)
+    , bulk_authorized_(false)
+    , bulk_client_(host_name_, metrics_, &tracer_, bulk_connection ? connection_factory : nullptr)
+{
+    for (size_t i = 0; i < periodic_jobs_.size(); ++i) {
+        periodic_jobs_[i] = PeriodicJob::create(static_cast<PeriodicTask>(i), handler_registry_, dispatcher_);
+        periodic_jobs_[i]->register_post_execution_handler(&periodic_job_handler_);
+    }
+}
 
 HostController::~HostController() {
     shutdown();
 }
 
 bool HostController::connect(const std::string &url, std::uint16_t port) {
+    {
+        std::lock_guard<decltype(state_mutex_)> guard(state_mutex_);
+        if (shut_down_)
+            return false;
+        connecting_ = true;
+    }
+
+    // workers started after an interrupt find their queues shut down and return immediately
+    connect_(url, port);
+
+    bool connected;
+    {
+        std::lock_guard<decltype(state_mutex_)> guard(state_mutex_);
+        connecting_ = false;
+        connected = worker_thread_.joinable() && !shut_down_;
+    }
+    connected_condition_.notify_all();
+
+    return connected;
+}
+
+bool HostController::is_shut_down() const {
+    std::lock_guard<decltype(state_mutex_)> guard(state_mutex_);
+    return shut_down_;
+}
+
+void HostController::connect_(const std::string &url, std::uint16_t port) {
     if (!client_.connect(url, port))
-        return false;
+        return;
+
+    worker_thread_ = std::thread([&]() { work_(job_queue_, client_, "worker"); });
+
+    // the host is usable without the bulk connection, so a failure isn't reported
+    // and the bulk jobs stay on the first connection
+    if (!use_bulk_connection_ || !bulk_client_.connect(url, port))
+        return;
+
+    bulk_worker_thread_ = std::thread([&]() { work_(bulk_job_queue_, bulk_client_, "bulk worker"); });
 
-    worker_thread_ = std::thread([&]() {
-        while (auto job = job_queue_.pop())
-            (*job)(client_);
-    });
+    // the host may have been authorized while connecting
+    std::lock_guard<decltype(state_mutex_)> guard(state_mutex_);
+    bulk_connected_ = true;
+    authorize_bulk_client_();
+}
+
+void HostController::authorize(const std::string &password) {
+    // an empty password only tells the host doesn't have one, there is nothing to authorize
+    if (!password.empty())
+        schedule(std::make_unique<AuthorizationJob>(password, handler_registry_));
 
-    return true;
+    std::lock_guard<decltype(state_mutex_)> guard(state_mutex_);
+    password_ = password;
+    password_known_ = true;
+    if (bulk_connected_)
+        authorize_bulk_client_();
 }
 
-void HostController::authorize(const std::string &password, const HandlerRegistry &handler_registry) {
-    schedule(std::make_unique<AuthorizationJob>(password, handler_registry));
+void HostController::authorize_bulk_client_() {
+    // until authorize was called it's unknown whether the host needs a password
+    if (!password_known_)
+        return;
+
+    if (password_.empty()) {
+        bulk_authorized_ = true;
+        return;
+    }
+
+    // until then the bulk jobs use the first connection, which gets authorized as well
+    bulk_authorized_ = false;
+    push_(bulk_job_queue_, std::make_unique<AuthorizationJob>(password_, handler_registry_, [this](bool authorized) {
+        bulk_authorized_ = authorized;
+    }));
 }
 
 void HostController::disconnect() {
     client_.disconnect();
+    bulk_client_.disconnect();
 }
 
-void HostController::shutdown() {
+void HostController::interrupt() {
+    {
+        std::lock_guard<decltype(state_mutex_)> guard(state_mutex_);
+        shut_down_ = true;
+    }
+
     job_queue_.shutdown();
+    bulk_job_queue_.shutdown();
+    client_.interrupt();
+    bulk_client_.interrupt();
+}
+
+void HostController::shutdown() {
+    interrupt();
+
+    {
+        std::unique_lock<decltype(state_mutex_)> lock(state_mutex_);
+        connected_condition_.wait(lock, [this]() { return !connecting_; });
+    }
+
     if (worker_thread_.joinable())
         worker_thread_.join();
+    if (bulk_worker_thread_.joinable())
+        bulk_worker_thread_.join();
     disconnect();
 }
 
-void HostController::schedule_now(std::unique_ptr<Job> job) {
-    job_queue_.push_front(std::move(job));
+void HostController::schedule(JobPtr job) {
+    auto &queue = queue_for_(*job);
+    push_(queue, std::move(job));
+}
+
+void HostController::schedule(PeriodicTask task, const PeriodicJob::Payload &payload,
+                              std::chrono::steady_clock::time_point due) {
+    auto &job = periodic_jobs_.at(static_cast<size_t>(task));
+    job->payload = payload;
+    job->due = due;
+    push_(queue_for_(*job), JobPtr(job.get()));
+}
+
+JobQueue &HostController::queue_for_(const Job &job) {
+    return job.lane() == JobLane::Bulk && bulk_authorized_.load() ? bulk_job_queue_ : job_queue_;
+}
+
+void HostController::push_(JobQueue &queue, JobPtr job) {
+    const auto depth = queue.size();
+    const auto now = std::chrono::steady_clock::now();
+
+    metrics_->record(MetricSeries::QueueDepth, job->metrics_slot(), depth);
+    tracer_.instant("enqueue", trace_host_, job->name(), now, "queue_depth", depth);
+
+    job->queued_at(now);
+    queue.push(std::move(job));
+}
+
+void HostController::work_(JobQueue &queue, Client &client, const char *thread_name) {
+    Tracer::thread_name(std::string(thread_name) + " " + host_name_);
+
+    while (auto job = queue.pop()) {
+        const auto dequeued = std::chrono::steady_clock::now();
+
+        metrics_->record(MetricSeries::QueueWait, job->metrics_slot(), nanoseconds_since(job->queued_at()));
+        tracer_.complete("queued", trace_host_, job->name(), job->queued_at(), dequeued);
+
+        client.job(job->metrics_slot(), job->name());
+        (*job)(client);
+
+        tracer_.complete("job", trace_host_, job->name(), dequeued, std::chrono::steady_clock::now());
+    }
 }
 
-void HostController::schedule(std::unique_ptr<Job> job) {
-    job_queue_.push_back(std::move(job));
+std::uint64_t HostController::unchanged_replies(PeriodicTask task) const {
+    return periodic_jobs_.at(static_cast<size_t>(task))->unchanged_replies.load();
 }
 
 }}
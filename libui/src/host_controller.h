@@ -19,13 +19,23 @@
 #ifndef WOINC_UI_HOST_H_
 #define WOINC_UI_HOST_H_
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 
 #include "client.h"
 #include "handler_registry.h"
 #include "job_queue.h"
+#include "jobs.h"
+#include "metrics_registry.h"
+#include "tracer.h"
+#include "update_dispatcher.h"
 #include "visibility.h"
 
 namespace woinc { namespace ui {
@@ -34,7 +44,14 @@ namespace woinc { namespace ui {
 // and the only user is the controller, we ensure thread safety there.
 class WOINCUI_LOCAL HostController {
     public:
-        explicit HostController(std::string name);
+        HostController(std::string name,
+                       const HandlerRegistry &handler_registry,
+                       UpdateDispatcher &dispatcher,
+                       PostExecutionHandler &periodic_job_handler,
+                       HostMetricsRecorderPtr metrics,
+                       Tracer &tracer,
+                       bool bulk_connection = false,
+                       const ConnectionFactory &connection_factory = nullptr);
         virtual ~HostController();
 
         HostController(HostController &) = delete;
@@ -44,22 +61,70 @@ class WOINCUI_LOCAL HostController {
         HostController &operator=(HostController &&) = default;
 
     public: // called by the controller, error checking and thread safety are done there
+        // The connect is run by the connect pool of the controller without holding its lock,
+        // so it's synchronized with interrupt and shutdown: an interrupt aborts the connect
+        // and shutdown waits for it. Returns false if it failed or the host got shut down.
         bool connect(const std::string &url, std::uint16_t port);
-        void authorize(const std::string &password, const HandlerRegistry &handler_registry);
+        bool is_shut_down() const;
+
+        void authorize(const std::string &password);
         void disconnect();
 
+        // stops the workers and aborts their running jobs without waiting for them,
+        // used to shut down many hosts at once
+        void interrupt();
         void shutdown();
 
     public:
-        void schedule_now(std::unique_ptr<Job> job);
-        void schedule(std::unique_ptr<Job> job);
+        // the lane of the job determines its priority
+        void schedule(JobPtr job);
+        // reuses the pooled job of the task, so it must not be scheduled again until it has been executed
+        void schedule(PeriodicTask task, const PeriodicJob::Payload &payload, std::chrono::steady_clock::time_point due);
+
+        std::uint64_t unchanged_replies(PeriodicTask task) const;
+
+    private:
+        void connect_(const std::string &url, std::uint16_t port);
+        // expects the state mutex to be held
+        void authorize_bulk_client_();
+        JobQueue &queue_for_(const Job &job);
+
+        void push_(JobQueue &queue, JobPtr job);
+        void work_(JobQueue &queue, Client &client, const char *thread_name);
 
     private:
         const std::string host_name_;
+        const HandlerRegistry &handler_registry_;
+        UpdateDispatcher &dispatcher_;
+        PostExecutionHandler &periodic_job_handler_;
+        const HostMetricsRecorderPtr metrics_;
+        Tracer &tracer_;
+        const Tracer::HostId trace_host_;
+
+        mutable std::mutex state_mutex_;
+        std::condition_variable connected_condition_;
+        bool connecting_ = false;
+        bool shut_down_ = false;
+
+        // declared before the queue and worker, so they are destroyed after the worker has been joined
+        std::array<std::unique_ptr<PeriodicJob>, PERIODIC_TASK_COUNT> periodic_jobs_;
 
         Client client_;
         JobQueue job_queue_;
         std::thread worker_thread_;
+
+        // The optional second connection, reserved for the jobs of the bulk lane so large replies
+        // don't block the interactive and periodic jobs. Until it's authorized the bulk jobs use the first one.
+        // It's authorized with the last password passed to authorize once both happened, an empty password
+        // marks a host without one. A host which is never authorized keeps the bulk jobs on the first connection.
+        const bool use_bulk_connection_;
+        bool bulk_connected_ = false;       // guarded by the state mutex
+        bool password_known_ = false;       // guarded by the state mutex, authorize was called
+        std::string password_;              // guarded by the state mutex
+        std::atomic<bool> bulk_authorized_;
+        Client bulk_client_;
+        JobQueue bulk_job_queue_;
+        std::thread bulk_worker_thread_;
 };
 
 }}
@@ -18,77 +18,215 @@
 
 #include "job_queue.h"
 
+#include <atomic>
 #include <cassert>
 #include <memory>
-#include <stdexcept>
-
-#ifndef NDEBUG
-#include <iostream>
-#endif
+#include <thread>
 
 namespace woinc { namespace ui {
 
+// ---- JobQueue::Lane ----
+
+JobQueue::Lane::Lane() : head(&stub), tail(&stub) {}
+
+void JobQueue::Lane::push(Node *node) {
+    node->queue_next.store(nullptr, std::memory_order_relaxed);
+    Node *prev = head.exchange(node, std::memory_order_acq_rel);
+    // between the exchange and this store the lane is inconsistent for the consumer
+    prev->queue_next.store(node, std::memory_order_release);
+}
+
+bool JobQueue::Lane::pop(Node *&node) {
+    node = nullptr;
+
+    Node *t = tail;
+    Node *next = t->queue_next.load(std::memory_order_acquire);
+
+    if (t == &stub) {
+        if (next == nullptr)
+            return head.load(std::memory_order_acquire) == &stub;
+        tail = next;
+        t = next;
+        next = next->queue_next.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+        tail = next;
+        node = t;
+        return true;
+    }
+
+    if (t != head.load(std::memory_order_acquire))
+        return false;
+
+    // t is the last node, put the stub behind it to be able to take it out
+    push(&stub);
+
+    next = t->queue_next.load(std::memory_order_acquire);
+    if (next == nullptr)
+        return false;
+
+    tail = next;
+    node = t;
+    return true;
+}
+
+// ---- JobQueue ----
+
+JobQueue::JobQueue(const Clock &clock) : clock_(clock), shutdown_(false), sleeping_(false), size_(0) {}
+
 JobQueue::~JobQueue() {
     shutdown();
     // ensure no one is in a critical section
     std::unique_lock<std::mutex> lock(mutex_);
+    dispose_pending_();
 }
 
-void JobQueue::push_front(std::unique_ptr<Job> job) {
-    push_(std::move(job), true);
+void JobQueue::push(JobPtr job) {
+    assert(job && "Can't insert empty job");
+
+    if (shutdown_.load())
+        return;
+
+    auto &lane = lanes_.at(static_cast<size_t>(job->lane()));
+    size_.fetch_add(1, std::memory_order_relaxed);
+    lane.push(job.release());
+
+    // pairs with the fence of the consumer setting sleeping_ before checking the lanes a last time:
+    // without both fences the push and the store of sleeping_ may be missed by each other (store buffering),
+    // so the consumer would wait for a notification which never comes
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load()) {
+        std::lock_guard<decltype(mutex_)> guard(mutex_);
+        condition_.notify_one();
+    }
 }
 
-void JobQueue::push_back(std::unique_ptr<Job> job) {
-    push_(std::move(job), false);
+JobPtr JobQueue::pop() {
+    while (!shutdown_.load()) {
+        if (auto job = try_pop())
+            return job;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        sleeping_.store(true);
+        // see push
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!collect_() && !shutdown_.load())
+            condition_.wait(lock);
+        sleeping_.store(false);
+    }
+
+    return nullptr;
 }
 
-std::unique_ptr<Job> JobQueue::pop() {
-    std::unique_ptr<Job> job;
-    std::unique_lock<std::mutex> lock(mutex_);
+JobPtr JobQueue::try_pop() {
+    if (!collect_())
+        return nullptr;
 
-    condition_.wait(lock, [this]() { return !jobs_.empty() || shutdown_; });
+    const auto now = clock_.now();
 
-    if (!shutdown_) {
-        assert(!jobs_.empty() && "Found empty job queue");
+    for (auto &pending : pending_) {
+        while (pending.first != nullptr) {
+            JobPtr job(pop_(pending));
+            assert(job && "Received empty job from the queue");
 
-        job = std::move(jobs_.front());
-        jobs_.pop_front();
+            if (!job->stale(now))
+                return job;
 
-        assert(job && "Received empty job from the queue");
+            job->drop();
+        }
     }
 
-    return job;
+    return nullptr;
 }
 
 void JobQueue::shutdown() {
-    {
-        std::lock_guard<decltype(mutex_)> guard(mutex_);
-        shutdown_ = true;
-    }
+    shutdown_.store(true);
 
+    std::lock_guard<decltype(mutex_)> guard(mutex_);
     condition_.notify_all();
 }
 
-void JobQueue::push_(std::unique_ptr<Job> job, bool front) {
-    assert(job && "Can't insert empty job");
+bool JobQueue::collect_() {
+    bool found = false;
+
+    for (size_t i = 0; i < lane_count_; ++i) {
+        auto &lane = lanes_[i];
+        auto &pending = pending_[i];
+
+        Node *node;
+        while (true) {
+            if (!lane.pop(node)) {
+                // a producer got preempted in the middle of a push, it will finish soon
+                std::this_thread::yield();
+                continue;
+            }
+            if (node == nullptr)
+                break;
+            append_(pending, static_cast<Job *>(node));
+        }
 
-    bool pushed = true;
+        found = found || pending.first != nullptr;
+    }
 
-    {
-        std::lock_guard<decltype(mutex_)> guard(mutex_);
+    return found;
+}
 
-        if (!shutdown_) {
-            if (front)
-                jobs_.push_front(std::move(job));
-            else
-                jobs_.push_back(std::move(job));
-        } else {
-            pushed = false;
+void JobQueue::append_(Pending &pending, Job *job) {
+    job->queue_next.store(nullptr, std::memory_order_relaxed);
+
+    if (job->coalescing_key()) {
+        Node *prev = nullptr;
+        for (Job *older = pending.first; older != nullptr; ) {
+            Node *next = older->queue_next.load(std::memory_order_relaxed);
+
+            if (older->coalescing_key() == job->coalescing_key()) {
+                // the older job is dropped and the newer one queued at the end as usual,
+                // so it doesn't overtake the jobs pushed in between, e.g. a modifying command
+                job->supersede(*older);
+                if (prev == nullptr)
+                    pending.first = static_cast<Job *>(next);
+                else
+                    prev->queue_next.store(next, std::memory_order_relaxed);
+                if (pending.last == older)
+                    pending.last = static_cast<Job *>(prev);
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                JobPtr disposed(older);
+                // there is at most one pending job per key
+                break;
+            }
+
+            prev = older;
+            older = static_cast<Job *>(next);
         }
     }
 
-    if (pushed)
-        condition_.notify_one();
+    if (pending.last == nullptr)
+        pending.first = job;
+    else
+        pending.last->queue_next.store(job, std::memory_order_relaxed);
+    pending.last = job;
+}
+
+Job *JobQueue::pop_(Pending &pending) {
+    Job *job = pending.first;
+
+    if (job != nullptr) {
+        pending.first = static_cast<Job *>(job->queue_next.load(std::memory_order_relaxed));
+        if (pending.first == nullptr)
+            pending.last = nullptr;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+void JobQueue::dispose_pending_() {
+    collect_();
+    for (auto &pending : pending_)
+        while (Job *job = pop_(pending))
+            JobPtr disposed(job);
 }
 
 }}
@@ -19,19 +19,28 @@
 #ifndef WOINC_UI_JOB_QUEUE_H_
 #define WOINC_UI_JOB_QUEUE_H_
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
-#include <deque>
-#include <memory>
 #include <mutex>
 
+#include "clock.h"
 #include "jobs.h"
 #include "visibility.h"
 
 namespace woinc { namespace ui {
 
+// Multi-producer single-consumer queue with one lane per JobLane.
+//
+// Pushing is lock-free (an intrusive linked list per lane, linked by the hook of the jobs),
+// only the consumer parks on a condition variable if all lanes are empty.
+// The consumer moves the pushed jobs into its own pending lists before popping,
+// a job with a coalescing key supersedes a pending job with the same key there, which is dropped.
+// The lanes are served in strict priority order, within a lane the jobs are FIFO.
+// Stale jobs, i.e. cancelled ones or those past their deadline by the clock, are dropped instead of being returned.
 class WOINCUI_LOCAL JobQueue {
     public:
-        JobQueue() = default;
+        explicit JobQueue(const Clock &clock = Clock::steady());
         ~JobQueue();
 
         JobQueue(const JobQueue &) = delete;
@@ -39,28 +48,65 @@ class WOINCUI_LOCAL JobQueue {
         JobQueue &operator=(const JobQueue &) = delete;
         JobQueue &operator=(JobQueue &&) = delete;
 
-        // The job queue takes ownership of the job
-        void push_front(std::unique_ptr<Job> job);
-        void push_back(std::unique_ptr<Job> job);
+        // The job queue takes ownership of the job, may be called by any thread
+        void push(JobPtr job);
 
         // Returns the next job to run while blocking if there isn't any job in the queue.
         // If shutdown is triggered, an empty pointer will be returned.
         // The caller takes ownership of the job.
-        std::unique_ptr<Job> pop();
+        // Must only be called by one thread.
+        JobPtr pop();
+        // like pop, but returns an empty pointer instead of blocking if there is no job
+        JobPtr try_pop();
 
         void shutdown();
 
+        // the jobs pushed but not yet popped, including the stale ones which will be dropped
+        size_t size() const { return size_.load(std::memory_order_relaxed); }
+
     private:
-        void push_(std::unique_ptr<Job> job, bool front);
+        typedef JobQueueNode Node;
+
+        // the lock-free part, see http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+        struct Lane {
+            Lane();
+
+            void push(Node *node);
+            // returns false if a producer is in the middle of a push, the caller has to try again
+            bool pop(Node *&node);
+
+            std::atomic<Node *> head;
+            Node *tail;
+            Node stub;
+        };
+
+        // only accessed by the consumer
+        struct Pending {
+            Job *first = nullptr;
+            Job *last = nullptr;
+        };
+
+        // moves the pushed jobs into the pending lists, returns true if there is any pending job
+        bool collect_();
+        void append_(Pending &pending, Job *job);
+        Job *pop_(Pending &pending);
+
+        void dispose_pending_();
 
     private:
-        bool shutdown_ = false;
+        const Clock &clock_;
+
+        std::atomic<bool> shutdown_;
+        std::atomic<bool> sleeping_;
+        std::atomic<size_t> size_;
 
         std::mutex mutex_;
         std::condition_variable condition_;
 
-        typedef std::deque<std::unique_ptr<Job>> Queue;
-        Queue jobs_;
+        static constexpr size_t lane_count_ = 3;
+
+        std::array<Lane, lane_count_> lanes_;
+        std::array<Pending, lane_count_> pending_;
 };
 
 }}
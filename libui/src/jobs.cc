@@ -18,8 +18,9 @@
 
 #include "jobs.h"
 
+#include <algorithm>
 #include <cassert>
-#include <functional>
+#include <cstdint>
 
 namespace wrpc = woinc::rpc;
 
@@ -42,20 +43,174 @@ Error as_error__(wrpc::CommandStatus status) {
 }
 
 
-template<typename Command, typename Getter>
-void execute__(Client &client, const HandlerRegistry &handler_registry, Command &&cmd, Getter getter) {
-    auto status = client.execute(cmd);
-    if (status == wrpc::CommandStatus::Ok) {
-        handler_registry.for_periodic_task_handler([&](auto &handler) {
-            handler.on_update(client.host(), getter(cmd.response()));
-        });
-    } else {
-        handler_registry.for_host_handler([&](auto &handler) {
-            handler.on_host_error(client.host(), as_error__(status));
-        });
+void report_error__(Client &client, const HandlerRegistry &handler_registry, wrpc::CommandStatus status) {
+    handler_registry.for_host_handler([&](auto &handler) {
+        handler.on_host_error(client.host(), as_error__(status));
+    });
+}
+
+// the commands are reused, so the responses are reset before the next poll;
+// only the top-level vectors keep their capacity, the structures and the elements are rebuilt by the parsing
+
+void reset__(wrpc::GetCCStatusResponse &response)      { response.cc_status = woinc::CCStatus(); }
+void reset__(wrpc::GetClientStateResponse &response)   { response.client_state = woinc::ClientState(); }
+void reset__(wrpc::GetDiskUsageResponse &response)     { response.disk_usage = woinc::DiskUsage(); }
+void reset__(wrpc::GetFileTransfersResponse &response) { response.file_transfers.clear(); }
+void reset__(wrpc::GetMessagesResponse &response)      { response.messages.clear(); }
+void reset__(wrpc::GetProjectStatusResponse &response) { response.projects.clear(); }
+void reset__(wrpc::GetResultsResponse &response)       { response.tasks.clear(); }
+
+void reset__(wrpc::GetStatisticsResponse &response) {
+    response.statistics.clear();
+    response.first_days.clear();
+}
+
+void reset__(wrpc::GetNoticesResponse &response) {
+    response.refreshed = false;
+    response.notices.clear();
+}
+
+template<typename Command>
+void prepare__(Command &, const PeriodicJob::Payload &) {}
+
+void prepare__(wrpc::GetClientStateCommand &, PeriodicJob::Payload &payload) {
+    payload.client_start_time = 0;
+}
+
+void prepare__(wrpc::GetMessagesCommand &cmd, const PeriodicJob::Payload &payload) {
+    cmd.request().seqno = payload.seqno;
+}
+
+void prepare__(wrpc::GetNoticesCommand &cmd, const PeriodicJob::Payload &payload) {
+    cmd.request().seqno = payload.seqno;
+}
+
+void prepare__(wrpc::GetResultsCommand &cmd, const PeriodicJob::Payload &payload) {
+    cmd.request().active_only = payload.active_only;
+}
+
+template<typename Response>
+void deliver__(PeriodicJob &job, const std::string &host, Response &response);
+
+template<>
+void deliver__(PeriodicJob &job, const std::string &host, wrpc::GetCCStatusResponse &response) {
+    job.dispatcher.dispatch(host, job.due, response.cc_status);
+}
+
+template<>
+void deliver__(PeriodicJob &job, const std::string &host, wrpc::GetClientStateResponse &response) {
+    job.payload.client_start_time = response.client_state.time_stats.client_start_time;
+    job.dispatcher.dispatch(host, job.due, response.client_state);
+}
+
+template<>
+void deliver__(PeriodicJob &job, const std::string &host, wrpc::GetDiskUsageResponse &response) {
+    job.dispatcher.dispatch(host, job.due, response.disk_usage);
+}
+
+template<>
+void deliver__(PeriodicJob &job, const std::string &host, wrpc::GetFileTransfersResponse &response) {
+    job.dispatcher.dispatch(host, job.due, response.file_transfers);
+}
+
+template<>
+void deliver__(PeriodicJob &job, const std::string &host, wrpc::GetMessagesResponse &response) {
+    if (!response.messages.empty()) {
+        job.payload.seqno = response.messages.back().seqno;
+        job.dispatcher.dispatch(host, job.due, response.messages);
     }
 }
 
+template<>
+void deliver__(PeriodicJob &job, const std::string &host, wrpc::GetNoticesResponse &response) {
+    if (!response.notices.empty())
+        job.payload.seqno = response.notices.back().seqno;
+    job.dispatcher.dispatch(host, job.due, response.notices, response.refreshed);
+}
+
+template<>
+void deliver__(PeriodicJob &job, const std::string &host, wrpc::GetProjectStatusResponse &response) {
+    job.dispatcher.dispatch(host, job.due, response.projects);
+}
+
+template<>
+void deliver__(PeriodicJob &job, const std::string &host, wrpc::GetResultsResponse &response) {
+    job.dispatcher.dispatch(host, job.due, response.tasks);
+}
+
+template<typename Request, typename Response>
+void deliver__(PeriodicJob &job, const std::string &host, Request &, Response &response) {
+    deliver__(job, host, response);
+}
+
+// only the days since the latest known one of each project are parsed, see GetStatisticsRequest::since
+void deliver__(PeriodicJob &job, const std::string &host,
+               wrpc::GetStatisticsRequest &request, wrpc::GetStatisticsResponse &response) {
+    const bool refreshed = request.since.empty();
+
+    request.since.clear();
+    for (const auto &project : response.statistics) {
+        auto latest = std::max_element(project.daily_statistics.begin(), project.daily_statistics.end(),
+                                       [](const auto &a, const auto &b) { return a.day < b.day; });
+        if (latest != project.daily_statistics.end())
+            request.since.emplace(project.master_url, latest->day);
+    }
+
+    job.dispatcher.dispatch(host, job.due, response.statistics, response.first_days, refreshed);
+}
+
+template<typename Request>
+void forget__(Request &) {}
+
+// the client may have been restarted meanwhile, so parse all days of the next reply
+void forget__(wrpc::GetStatisticsRequest &request) {
+    request.since.clear();
+}
+
+// the replies to messages and notices are incremental, an unchanged reply doesn't mean an unchanged state
+template<typename Command>
+bool fingerprinted__(const Command &) { return true; }
+bool fingerprinted__(const wrpc::GetMessagesCommand &) { return false; }
+bool fingerprinted__(const wrpc::GetNoticesCommand &) { return false; }
+
+template<typename Command>
+struct PeriodicCommandJob : public PeriodicJob {
+    PeriodicCommandJob(PeriodicTask t, const HandlerRegistry &hr, UpdateDispatcher &d)
+        : PeriodicJob(t, hr, d) {}
+
+    void execute(Client &client) final {
+        reset__(cmd_.response());
+        prepare__(cmd_, payload);
+
+        // someone subscribed meanwhile may not have received the last reply yet
+        const auto subscriptions_version = handler_registry.subscriptions_version();
+        if (subscriptions_version != subscriptions_version_) {
+            fingerprint_.valid = false;
+            subscriptions_version_ = subscriptions_version;
+        }
+
+        bool unchanged = false;
+        auto status = fingerprinted__(cmd_)
+            ? client.execute(cmd_, fingerprint_, unchanged)
+            : client.execute(cmd_);
+
+        if (status != wrpc::CommandStatus::Ok) {
+            forget__(cmd_.request());
+            report_error__(client, handler_registry, status);
+        } else if (unchanged) {
+            ++unchanged_replies;
+            dispatcher.unchanged(client.host(), task);
+        } else {
+            deliver__(*this, client.host(), cmd_.request(), cmd_.response());
+        }
+    }
+
+    private:
+        Command cmd_;
+        ReplyFingerprint fingerprint_;
+        std::uint64_t subscriptions_version_ = 0;
+};
+
 }
 
 namespace woinc { namespace ui {
@@ -75,110 +230,90 @@ void Job::register_post_execution_handler(PostExecutionHandler *handler) {
 
 // ---- PeriodicJob ----
 
-PeriodicJob::PeriodicJob(PeriodicTask t, const HandlerRegistry &hr, const Payload &p)
-    : task(t), handler_registry(hr), payload(p)
-{}
+PeriodicJob::PeriodicJob(PeriodicTask t, const HandlerRegistry &hr, UpdateDispatcher &d)
+    : Job(periodic_job_lane(t), true, static_cast<std::size_t>(t)), task(t), handler_registry(hr), dispatcher(d), payload(), unchanged_replies(0)
+{
+    name(trace_name(t));
+}
 
-void PeriodicJob::execute(Client &client) {
+std::unique_ptr<PeriodicJob> PeriodicJob::create(PeriodicTask task,
+                                                 const HandlerRegistry &handler_registry,
+                                                 UpdateDispatcher &dispatcher) {
     switch (task) {
         case PeriodicTask::GetCCStatus:
-            execute__(client, handler_registry,
-                      wrpc::GetCCStatusCommand(),
-                      std::mem_fn(&wrpc::GetCCStatusResponse::cc_status));
-            break;
+            return std::make_unique<PeriodicCommandJob<wrpc::GetCCStatusCommand>>(task, handler_registry, dispatcher);
         case PeriodicTask::GetClientState:
-            execute__(client, handler_registry,
-                      wrpc::GetClientStateCommand(),
-                      std::mem_fn(&wrpc::GetClientStateResponse::client_state));
-            break;
+            return std::make_unique<PeriodicCommandJob<wrpc::GetClientStateCommand>>(task, handler_registry, dispatcher);
         case PeriodicTask::GetDiskUsage:
-            execute__(client, handler_registry,
-                      wrpc::GetDiskUsageCommand(),
-                      std::mem_fn(&wrpc::GetDiskUsageResponse::disk_usage));
-            break;
+            return std::make_unique<PeriodicCommandJob<wrpc::GetDiskUsageCommand>>(task, handler_registry, dispatcher);
         case PeriodicTask::GetFileTransfers:
-            execute__(client, handler_registry,
-                      wrpc::GetFileTransfersCommand(),
-                      std::mem_fn(&wrpc::GetFileTransfersResponse::file_transfers));
-            break;
+            return std::make_unique<PeriodicCommandJob<wrpc::GetFileTransfersCommand>>(task, handler_registry, dispatcher);
         case PeriodicTask::GetMessages:
-            {
-                wrpc::GetMessagesCommand cmd;
-                cmd.request().seqno = payload.seqno;
-                auto status = client.execute(cmd);
-                if (status == wrpc::CommandStatus::Ok) {
-                    if (!cmd.response().messages.empty()) {
-                        payload.seqno = cmd.response().messages.back().seqno;
-                        handler_registry.for_periodic_task_handler([&](auto &handler) {
-                            handler.on_update(client.host(), cmd.response().messages);
-                        });
-                    }
-                } else {
-                    handler_registry.for_host_handler([&](auto &handler) {
-                        handler.on_host_error(client.host(), as_error__(status));
-                    });
-                }
-            }
-            break;
+            return std::make_unique<PeriodicCommandJob<wrpc::GetMessagesCommand>>(task, handler_registry, dispatcher);
         case PeriodicTask::GetNotices:
-            {
-                wrpc::GetNoticesCommand cmd;
-                cmd.request().seqno = payload.seqno;
-                auto status = client.execute(cmd);
-                if (status == wrpc::CommandStatus::Ok) {
-                    if (!cmd.response().notices.empty())
-                        payload.seqno = cmd.response().notices.back().seqno;
-                    handler_registry.for_periodic_task_handler([&](auto &handler) {
-                        handler.on_update(client.host(), cmd.response().notices, cmd.response().refreshed);
-                    });
-                } else {
-                    handler_registry.for_host_handler([&](auto &handler) {
-                        handler.on_host_error(client.host(), as_error__(status));
-                    });
-                }
-            }
-            break;
+            return std::make_unique<PeriodicCommandJob<wrpc::GetNoticesCommand>>(task, handler_registry, dispatcher);
         case PeriodicTask::GetProjectStatus:
-            execute__(client, handler_registry,
-                      wrpc::GetProjectStatusCommand(),
-                      std::mem_fn(&wrpc::GetProjectStatusResponse::projects));
-            break;
+            return std::make_unique<PeriodicCommandJob<wrpc::GetProjectStatusCommand>>(task, handler_registry, dispatcher);
         case PeriodicTask::GetStatistics:
-            execute__(client, handler_registry,
-                      wrpc::GetStatisticsCommand(),
-                      std::mem_fn(&wrpc::GetStatisticsResponse::statistics));
-            break;
+            return std::make_unique<PeriodicCommandJob<wrpc::GetStatisticsCommand>>(task, handler_registry, dispatcher);
         case PeriodicTask::GetTasks:
-            {
-#if 0
-                static int foo = 0;
-                if (++foo == 5) {
-                    handler_registry.for_periodic_task_handler([&](auto &handler) {
-                        handler.on_host_error(client.host(), Error::CLIENT_ERROR);
-                    });
-                    break;
-                }
-#endif
-                wrpc::GetResultsCommand cmd;
-                cmd.request().active_only = payload.active_only;
-                execute__(client, handler_registry,
-                          std::move(cmd), std::mem_fn(&wrpc::GetResultsResponse::tasks));
-            }
-            break;
+            return std::make_unique<PeriodicCommandJob<wrpc::GetResultsCommand>>(task, handler_registry, dispatcher);
     }
+    assert(false);
+    return nullptr;
+}
+
+// ---- InFlightJobs ----
+
+void InFlightJobs::add(const std::string &host, Job *job) {
+    assert(job->coalescing_key());
+    std::lock_guard<decltype(mutex_)> guard(mutex_);
+    jobs_[std::make_pair(host, job->coalescing_key())] = job;
+}
+
+void InFlightJobs::remove(const std::string &host, const Job *job) {
+    std::lock_guard<decltype(mutex_)> guard(mutex_);
+    auto iter = jobs_.find(std::make_pair(host, job->coalescing_key()));
+    // the entry may have been replaced by a newer job already
+    if (iter != jobs_.end() && iter->second == job)
+        jobs_.erase(iter);
+}
+
+void InFlightJobs::detach(const std::string &host) {
+    std::lock_guard<decltype(mutex_)> guard(mutex_);
+    auto iter = jobs_.lower_bound(std::make_pair(host, CoalescingKey()));
+    while (iter != jobs_.end() && iter->first.first == host)
+        iter = jobs_.erase(iter);
 }
 
 // ---- AuthorizationJob ----
 
 AuthorizationJob::AuthorizationJob(const std::string &password, const HandlerRegistry &handler_registry)
     : password_(password), handler_registry_(handler_registry)
-{}
+{
+    name("authorize");
+}
+
+AuthorizationJob::AuthorizationJob(const std::string &password, const HandlerRegistry &handler_registry, Callback callback)
+    : password_(password), handler_registry_(handler_registry), callback_(std::move(callback))
+{
+    name("authorize");
+}
 
 void AuthorizationJob::execute(Client &client) {
     woinc::rpc::AuthorizeCommand cmd;
     cmd.request().password = password_;
 
     auto status = client.execute(cmd);
+
+    if (status == wrpc::CommandStatus::Ok)
+        client.authorized(password_);
+
+    if (callback_) {
+        callback_(status == wrpc::CommandStatus::Ok);
+        return;
+    }
+
     handler_registry_.for_host_handler([&](auto &handler) {
         if (status == wrpc::CommandStatus::Ok)
             handler.on_host_authorized(client.host());
@@ -19,27 +19,102 @@
 #ifndef WOINC_UI_JOBS_H_
 #define WOINC_UI_JOBS_H_
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <exception>
+#include <functional>
 #include <future>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <woinc/rpc_command.h>
+#include <woinc/ui/call_options.h>
+#include <woinc/ui/completion.h>
 #include <woinc/ui/defs.h>
+#include <woinc/ui/error.h>
+#include <woinc/ui/metrics.h>
 
 #include "client.h"
 #include "handler_registry.h"
+#include "tracer.h"
+#include "update_dispatcher.h"
 #include "visibility.h"
 
 namespace woinc { namespace ui {
 
 struct WOINCUI_LOCAL Job;
+class WOINCUI_LOCAL JobQueue;
+
+// the lanes of the job queue in order of their priority
+enum class JobLane {
+    Interactive,
+    Periodic,
+    Bulk
+};
+
+// the replies of these commands may be large and are not urgent, so they shouldn't delay the other periodic tasks
+inline JobLane periodic_job_lane(PeriodicTask task) {
+    return task == PeriodicTask::GetClientState
+            || task == PeriodicTask::GetMessages
+            || task == PeriodicTask::GetStatistics
+        ? JobLane::Bulk
+        : JobLane::Periodic;
+}
+
+// Jobs with the same key are interchangeable, so a pending job may be superseded by a newer one with the same key.
+// The kind identifies the job type and the value its request, see make_coalescing_key.
+struct WOINCUI_LOCAL CoalescingKey {
+    const void *kind = nullptr;
+    std::uint64_t value = 0;
+
+    explicit operator bool() const { return kind != nullptr; }
+
+    bool operator==(const CoalescingKey &other) const {
+        return kind == other.kind && value == other.value;
+    }
+
+    bool operator<(const CoalescingKey &other) const {
+        if (kind != other.kind)
+            return std::less<const void *>()(kind, other.kind);
+        return value < other.value;
+    }
+};
+
+template<typename... Kind>
+struct WOINCUI_LOCAL CoalescingKind {
+    static const char tag;
+};
+
+template<typename... Kind>
+const char CoalescingKind<Kind...>::tag = 0;
+
+template<typename... Kind>
+CoalescingKey make_coalescing_key(std::uint64_t value = 0) {
+    CoalescingKey key;
+    key.kind = &CoalescingKind<Kind...>::tag;
+    key.value = value;
+    return key;
+}
+
+// the hook of the intrusive job queue
+struct WOINCUI_LOCAL JobQueueNode {
+    std::atomic<JobQueueNode *> queue_next{nullptr};
+};
 
 struct WOINCUI_LOCAL PostExecutionHandler {
     virtual ~PostExecutionHandler() = default;
     virtual void handle_post_execution(const std::string &host, Job *) = 0;
 };
 
-struct WOINCUI_LOCAL Job {
+struct WOINCUI_LOCAL Job : private JobQueueNode {
     virtual ~Job() = default;
 
     virtual void execute(Client &client) = 0;
@@ -48,29 +123,108 @@ struct WOINCUI_LOCAL Job {
 
     void register_post_execution_handler(PostExecutionHandler *handler);
 
+    // pooled jobs are owned by their host controller and only lent to the job queue
+    bool pooled() const { return pooled_; }
+
+    JobLane lane() const { return lane_; }
+
+    const CoalescingKey &coalescing_key() const { return coalescing_key_; }
+    void coalescing_key(CoalescingKey key) { coalescing_key_ = key; }
+
+    // called by the job queue if this job supersedes the pending job with the same coalescing key,
+    // the older job will be destroyed afterwards without being executed
+    virtual void supersede(Job &) {}
+
+    const CallOptions &options() const { return options_; }
+    void options(CallOptions options) { options_ = std::move(options); }
+
+    // cancelled or past its deadline, so the job queue drops it instead of executing it
+    bool stale(std::chrono::steady_clock::time_point now) const {
+        return options_.cancellation.cancelled() || now >= options_.deadline;
+    }
+
+    // called by the job queue instead of execute() if the job is stale
+    virtual void drop() {}
+
+    // the metrics of the job are recorded to the slot of its periodic task or to HostMetrics::COMMANDS
+    std::size_t metrics_slot() const { return metrics_slot_; }
+
+    // the subject of its trace events, a string literal
+    const char *name() const { return name_; }
+    void name(const char *name) { name_ = name; }
+
+    // set by the host controller when scheduling the job
+    std::chrono::steady_clock::time_point queued_at() const { return queued_at_; }
+    void queued_at(std::chrono::steady_clock::time_point time) { queued_at_ = time; }
+
+    protected:
+        explicit Job(JobLane lane = JobLane::Interactive, bool pooled = false,
+                     std::size_t metrics_slot = HostMetrics::COMMANDS)
+            : pooled_(pooled), lane_(lane), metrics_slot_(metrics_slot) {}
+
     private:
+        friend class JobQueue;
+
+        const bool pooled_;
+        const JobLane lane_;
+        const std::size_t metrics_slot_;
+        const char *name_ = "command";
+        std::chrono::steady_clock::time_point queued_at_;
+        CoalescingKey coalescing_key_;
+        CallOptions options_;
         PostExecutionHandler *post_handler_ = nullptr;
 };
 
+struct WOINCUI_LOCAL JobDeleter {
+    JobDeleter() = default;
+    template<typename J>
+    JobDeleter(const std::default_delete<J> &) {}
+
+    void operator()(Job *job) const {
+        if (!job->pooled())
+            delete job;
+    }
+};
+
+typedef std::unique_ptr<Job, JobDeleter> JobPtr;
+
+// The periodic jobs are created once per host and task and reused for each execution,
+// keeping the command and the capacity of its response containers in between.
 struct WOINCUI_LOCAL PeriodicJob : public Job {
     union Payload {
         bool active_only;
         int seqno;
+        // set by the job from the received client state, 0 if it failed
+        std::time_t client_start_time;
     };
 
-    PeriodicJob(PeriodicTask t, const HandlerRegistry &handler_registry, const Payload &payload = Payload());
-    virtual ~PeriodicJob() = default;
+    static std::unique_ptr<PeriodicJob> create(PeriodicTask task,
+                                               const HandlerRegistry &handler_registry,
+                                               UpdateDispatcher &dispatcher);
 
-    void execute(Client &client) final;
+    virtual ~PeriodicJob() = default;
 
     const PeriodicTask task;
     const HandlerRegistry &handler_registry;
+    UpdateDispatcher &dispatcher;
 
     Payload payload;
+    // when the task got due, the update latency is measured from here
+    std::chrono::steady_clock::time_point due;
+
+    // replies which were byte-identical to the previous one, so parsing and dispatching were skipped
+    std::atomic<std::uint64_t> unchanged_replies;
+
+    protected:
+        PeriodicJob(PeriodicTask t, const HandlerRegistry &handler_registry, UpdateDispatcher &dispatcher);
 };
 
 struct WOINCUI_LOCAL AuthorizationJob : public Job {
+    typedef std::function<void(bool authorized)> Callback;
+
     AuthorizationJob(const std::string &password, const HandlerRegistry &handler_registry);
+    // reports the result to the callback instead of the host handlers
+    AuthorizationJob(const std::string &password, const HandlerRegistry &handler_registry, Callback callback);
     virtual ~AuthorizationJob() = default;
 
     void execute(Client &client) final;
@@ -78,29 +232,207 @@ struct WOINCUI_LOCAL AuthorizationJob : public Job {
     private:
         const std::string password_;
         const HandlerRegistry &handler_registry_;
+        const Callback callback_;
+};
+
+template<typename Result>
+struct WOINCUI_LOCAL AsyncJob;
+
+// Receives the result of an async job, either by the promise of a future or by the completion of a callback.
+// Only the chosen one is constructed, so the callbacks don't need the shared state of a promise.
+template<typename Result>
+class WOINCUI_LOCAL ResultReceiver {
+    public:
+        explicit ResultReceiver(std::promise<Result> promise) : callback_(false) {
+            new (&promise_) std::promise<Result>(std::move(promise));
+        }
+
+        explicit ResultReceiver(Completion<Result> completion) : callback_(true) {
+            new (&completion_) Completion<Result>(std::move(completion));
+        }
+
+        ResultReceiver(ResultReceiver &&other) : callback_(other.callback_) {
+            if (callback_)
+                new (&completion_) Completion<Result>(std::move(other.completion_));
+            else
+                new (&promise_) std::promise<Result>(std::move(other.promise_));
+        }
+
+        ResultReceiver(const ResultReceiver &) = delete;
+        ResultReceiver &operator=(const ResultReceiver &) = delete;
+        ResultReceiver &operator=(ResultReceiver &&) = delete;
+
+        ~ResultReceiver() {
+            if (callback_)
+                completion_.~Completion<Result>();
+            else
+                promise_.~promise();
+        }
+
+        void set_value(Result value) {
+            if (callback_)
+                completion_(Outcome<Result>(std::move(value)));
+            else
+                promise_.set_value(std::move(value));
+        }
+
+        void set_exception(std::exception_ptr error) {
+            if (callback_)
+                completion_(Outcome<Result>(std::move(error)));
+            else
+                promise_.set_exception(std::move(error));
+        }
+
+    private:
+        const bool callback_;
+        union {
+            std::promise<Result> promise_;
+            Completion<Result> completion_;
+        };
+};
+
+// Tracks the async jobs with a coalescing key from their scheduling until their completion,
+// so identical requests to a host can join a queued or running job instead of sending their own rpc.
+class WOINCUI_LOCAL InFlightJobs {
+    public:
+        // returns false if there is no job for the request which still accepts receivers
+        template<typename Result>
+        bool join(const std::string &host, const CoalescingKey &key, ResultReceiver<Result> &receiver) {
+            std::lock_guard<decltype(mutex_)> guard(mutex_);
+            auto job = jobs_.find(std::make_pair(host, key));
+            // the coalescing key includes the command and result type, so it's an AsyncJob<Result>
+            return job != jobs_.end() && static_cast<AsyncJob<Result> *>(job->second)->join(receiver);
+        }
+
+        void add(const std::string &host, Job *job);
+        void remove(const std::string &host, const Job *job);
+
+        // later requests won't join the current jobs of the host anymore,
+        // used to not answer requests with replies sent before a modifying command
+        void detach(const std::string &host);
+
+    private:
+        std::mutex mutex_;
+        std::map<std::pair<std::string, CoalescingKey>, Job *> jobs_;
 };
 
-// wrap async commands that request data from the client; errors should be propagated through the future by the handler
+// wrap async commands that request data from the client; errors should be propagated through the receiver by the handler
 template<typename Result>
 struct WOINCUI_LOCAL AsyncJob : public Job {
-    typedef std::promise<Result> Promise;
+    typedef ResultReceiver<Result> Receiver;
     typedef std::function<void(woinc::rpc::Command *cmd,
-                               Promise &promise,
+                               Receiver &receiver,
                                woinc::rpc::CommandStatus status)> ResultHandler;
 
     // the job takes the ownership of the command
-    AsyncJob(std::unique_ptr<woinc::rpc::Command> cmd, Promise promise, ResultHandler handler)
-        : cmd_(std::move(cmd)), promise_(std::move(promise)), handler_(std::move(handler)) {}
-    virtual ~AsyncJob() = default;
+    AsyncJob(std::unique_ptr<woinc::rpc::Command> cmd, Receiver receiver, ResultHandler handler)
+        : cmd_(std::move(cmd)), receiver_(std::move(receiver)), handler_(std::move(handler)) {}
+
+    // a job discarded without being executed, i.e. on shutting down the host, fails its receivers;
+    // the controller releases the host controllers and therefore their pending jobs outside of its lock
+    virtual ~AsyncJob() {
+        if (!completed_)
+            fail_(std::make_exception_ptr(ShutdownException()));
+        else if (in_flight_ != nullptr)
+            in_flight_->remove(host_, this);
+    }
+
+    // register the job to let identical requests join it until it's completed, requires a coalescing key
+    void track(InFlightJobs &in_flight, std::string host) {
+        host_ = std::move(host);
+        in_flight_ = &in_flight;
+        in_flight_->add(host_, this);
+    }
+
+    // returns false if the job is already completed
+    bool join(Receiver &receiver) {
+        std::lock_guard<decltype(mutex_)> guard(mutex_);
+        if (completed_)
+            return false;
+        joined_receivers_.push_back(std::move(receiver));
+        return true;
+    }
 
     void execute(Client &client) final {
-        handler_(cmd_.get(), promise_, client.execute(*cmd_));
+        client.deadline(options().deadline);
+        auto status = client.execute(*cmd_);
+        client.deadline(std::chrono::steady_clock::time_point::max());
+
+        if (status != woinc::rpc::CommandStatus::Ok && std::chrono::steady_clock::now() >= options().deadline) {
+            fail_(std::make_exception_ptr(DeadlineExceededException()));
+            return;
+        }
+
+        auto joined = complete_();
+
+        handler_(cmd_.get(), receiver_, status);
+        for (auto &receiver : joined)
+            handler_(cmd_.get(), receiver, status);
+    }
+
+    void drop() final {
+        if (options().cancellation.cancelled())
+            fail_(std::make_exception_ptr(CancelledException()));
+        else
+            fail_(std::make_exception_ptr(DeadlineExceededException()));
+    }
+
+    // the coalescing key includes the command and result type, so the older job is an AsyncJob<Result> as well
+    void supersede(Job &older) final {
+        auto &job = static_cast<AsyncJob &>(older);
+
+        std::vector<Receiver> taken;
+        {
+            std::lock_guard<decltype(job.mutex_)> guard(job.mutex_);
+            job.completed_ = true;
+            taken.push_back(std::move(job.receiver_));
+            for (auto &receiver : job.joined_receivers_)
+                taken.push_back(std::move(receiver));
+            job.joined_receivers_.clear();
+        }
+
+        std::lock_guard<decltype(mutex_)> guard(mutex_);
+        for (auto &receiver : taken)
+            joined_receivers_.push_back(std::move(receiver));
     }
 
+    private:
+        // stops accepting receivers and returns the joined ones
+        std::vector<Receiver> complete_() {
+            std::vector<Receiver> joined;
+            {
+                std::lock_guard<decltype(mutex_)> guard(mutex_);
+                completed_ = true;
+                joined.swap(joined_receivers_);
+            }
+
+            if (in_flight_ != nullptr) {
+                in_flight_->remove(host_, this);
+                in_flight_ = nullptr;
+            }
+
+            return joined;
+        }
+
+        void fail_(std::exception_ptr error) {
+            auto joined = complete_();
+
+            receiver_.set_exception(error);
+            for (auto &receiver : joined)
+                receiver.set_exception(error);
+        }
+
     private:
         std::unique_ptr<woinc::rpc::Command> cmd_;
-        Promise promise_;
+        Receiver receiver_;
         ResultHandler handler_;
+
+        std::mutex mutex_;
+        bool completed_ = false;
+        std::vector<Receiver> joined_receivers_;
+
+        InFlightJobs *in_flight_ = nullptr;
+        std::string host_;
 };
 
 }}
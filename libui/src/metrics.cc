@@ -0,0 +1,112 @@
+/* libui/src/metrics.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include <woinc/ui/metrics.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "bits.h"
+
+namespace woinc { namespace ui {
+
+// ---- Histogram ----
+
+void Histogram::record(std::uint64_t value) {
+    auto index = index_(value);
+
+    if (index >= counts_.size())
+        counts_.resize(index + 1, 0);
+
+    ++counts_[index];
+
+    min_ = count_ == 0 ? value : std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += value;
+    ++count_;
+}
+
+void Histogram::merge(const Histogram &other) {
+    if (other.count_ == 0)
+        return;
+
+    if (other.counts_.size() > counts_.size())
+        counts_.resize(other.counts_.size(), 0);
+
+    for (std::size_t i = 0; i < other.counts_.size(); ++i)
+        counts_[i] += other.counts_[i];
+
+    min_ = count_ == 0 ? other.min_ : std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+    count_ += other.count_;
+}
+
+void Histogram::clear() {
+    counts_.clear();
+    count_ = sum_ = min_ = max_ = 0;
+}
+
+double Histogram::mean() const {
+    return count_ == 0 ? 0. : static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+std::uint64_t Histogram::percentile(double percentage) const {
+    if (count_ == 0)
+        return 0;
+
+    percentage = std::min(std::max(percentage, 0.), 100.);
+
+    auto rank = static_cast<std::uint64_t>(std::ceil(percentage / 100. * static_cast<double>(count_)));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank)
+            return std::max(std::min(upper_bound_(i), max_), min_);
+    }
+
+    return max_;
+}
+
+// the values below SubBuckets have a bucket on their own,
+// all others are bucketed by their highest bit and the following four bits
+std::size_t Histogram::index_(std::uint64_t value) {
+    if (value < SubBuckets)
+        return static_cast<std::size_t>(value);
+
+    // the position of the highest bit, at least 4 as the value isn't below SubBuckets
+    auto exponent = static_cast<std::size_t>(63 - leading_zeros(value));
+
+    auto sub_bucket = static_cast<std::size_t>(value >> (exponent - 4)) - SubBuckets;
+    return SubBuckets + (exponent - 4) * SubBuckets + sub_bucket;
+}
+
+std::uint64_t Histogram::upper_bound_(std::size_t index) {
+    if (index < SubBuckets)
+        return index;
+
+    auto shift = (index - SubBuckets) / SubBuckets;
+    auto sub_bucket = (index - SubBuckets) % SubBuckets;
+
+    auto lower = static_cast<std::uint64_t>(SubBuckets + sub_bucket) << shift;
+    return lower + ((std::uint64_t(1) << shift) - 1);
+}
+
+}}
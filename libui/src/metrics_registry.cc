@@ -0,0 +1,78 @@
+/* libui/src/metrics_registry.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "metrics_registry.h"
+
+#define WOINC_LOCK_GUARD std::lock_guard<decltype(mutex_)> guard(mutex_)
+
+namespace woinc { namespace ui {
+
+// ---- HostMetricsRecorder ----
+
+void HostMetricsRecorder::record(MetricSeries series, std::size_t slot, std::uint64_t value) {
+    WOINC_LOCK_GUARD;
+    metrics_.at(series, slot).record(value);
+}
+
+void HostMetricsRecorder::record(std::size_t slot,
+                                 const woinc::rpc::RpcMetrics &before,
+                                 const woinc::rpc::RpcMetrics &after,
+                                 bool parsed) {
+    // e.g. the connection was already lost
+    if (after.rpcs == before.rpcs)
+        return;
+
+    WOINC_LOCK_GUARD;
+    metrics_.at(MetricSeries::RpcRoundTrip, slot).record(after.round_trip_ns - before.round_trip_ns);
+    metrics_.at(MetricSeries::BytesOut, slot).record(after.bytes_out - before.bytes_out);
+    metrics_.at(MetricSeries::BytesIn, slot).record(after.bytes_in - before.bytes_in);
+    if (parsed)
+        metrics_.at(MetricSeries::ParseDuration, slot).record(after.parse_ns - before.parse_ns);
+}
+
+HostMetrics HostMetricsRecorder::snapshot() const {
+    WOINC_LOCK_GUARD;
+    return metrics_;
+}
+
+void HostMetricsRecorder::clear() {
+    WOINC_LOCK_GUARD;
+    metrics_ = HostMetrics();
+}
+
+// ---- MetricsRegistry ----
+
+HostMetricsRecorderPtr MetricsRegistry::add_host(const std::string &host) {
+    auto recorder = std::make_shared<HostMetricsRecorder>();
+    WOINC_LOCK_GUARD;
+    hosts_[host] = recorder;
+    return recorder;
+}
+
+void MetricsRegistry::remove_host(const std::string &host) {
+    WOINC_LOCK_GUARD;
+    hosts_.erase(host);
+}
+
+HostMetricsRecorderPtr MetricsRegistry::host(const std::string &host) const {
+    WOINC_LOCK_GUARD;
+    auto iter = hosts_.find(host);
+    return iter == hosts_.end() ? nullptr : iter->second;
+}
+
+}}
@@ -0,0 +1,79 @@
+/* libui/src/metrics_registry.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_METRICS_REGISTRY_H_
+#define WOINC_UI_METRICS_REGISTRY_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <woinc/rpc_command.h>
+#include <woinc/ui/metrics.h>
+
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+inline std::uint64_t nanoseconds_since(std::chrono::steady_clock::time_point start) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+// The metrics of one host, written by its worker threads and the update dispatcher
+class WOINCUI_LOCAL HostMetricsRecorder {
+    public:
+        // slot is the index of the periodic task or HostMetrics::COMMANDS
+        void record(MetricSeries series, std::size_t slot, std::uint64_t value);
+        // records the difference of the metrics of a command before and after an execution;
+        // the parse duration is skipped for replies which weren't parsed
+        void record(std::size_t slot, const woinc::rpc::RpcMetrics &before, const woinc::rpc::RpcMetrics &after,
+                    bool parsed = true);
+
+        HostMetrics snapshot() const;
+        void clear();
+
+    private:
+        mutable std::mutex mutex_;
+        HostMetrics metrics_;
+};
+
+typedef std::shared_ptr<HostMetricsRecorder> HostMetricsRecorderPtr;
+
+// The recorders of all hosts. The host controllers keep their recorder,
+// the lookup by name is only needed by those without access to them, e.g. the update dispatcher.
+class WOINCUI_LOCAL MetricsRegistry {
+    public:
+        HostMetricsRecorderPtr add_host(const std::string &host);
+        void remove_host(const std::string &host);
+
+        // returns an empty pointer if the host is unknown
+        HostMetricsRecorderPtr host(const std::string &host) const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::map<std::string, HostMetricsRecorderPtr> hosts_;
+};
+
+}}
+
+#endif
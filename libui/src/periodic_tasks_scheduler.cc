@@ -35,11 +35,18 @@ namespace woinc { namespace ui {
 
 PeriodicTasksSchedulerContext::PeriodicTasksSchedulerContext(const Configuration &config,
                                                              const HandlerRegistry &handler_registry,
-                                                             Scheduler scheduler)
-    : configuration_(config), handler_registry_(handler_registry), scheduler_(std::move(scheduler)) {}
+                                                             Tracer &tracer,
+                                                             Scheduler scheduler,
+                                                             const Clock &clock)
+    : configuration_(config)
+    , handler_registry_(handler_registry)
+    , tracer_(tracer)
+    , scheduler_(std::move(scheduler))
+    , clock_(clock)
+{}
 
 void PeriodicTasksSchedulerContext::add_host(std::string host) {
-    auto tasks = std::array<Task, 9> {
+    auto tasks = HostTasks { tracer_.host_id(host), State(), {
         Task(PeriodicTask::GetCCStatus),
         Task(PeriodicTask::GetClientState),
         Task(PeriodicTask::GetDiskUsage),
@@ -49,23 +56,42 @@ void PeriodicTasksSchedulerContext::add_host(std::string host) {
         Task(PeriodicTask::GetProjectStatus),
         Task(PeriodicTask::GetStatistics),
         Task(PeriodicTask::GetTasks)
-    };
+    }};
 
     std::lock_guard<decltype(mutex_)> guard(mutex_);
-    tasks_.emplace(host, std::move(tasks));
-    states_.emplace(std::move(host), State());
+    tasks_.emplace(std::move(host), std::move(tasks));
+    ++hosts_version_;
 }
 
 void PeriodicTasksSchedulerContext::remove_host(const std::string &host) {
-    std::lock_guard<decltype(mutex_)> guard(mutex_);
+    std::unique_lock<decltype(mutex_)> guard(mutex_);
+    // the scheduler refers to the hosts while scheduling them without the lock
+    scheduled_condition_.wait(guard, [this]() { return !scheduling_; });
     tasks_.erase(host);
-    states_.erase(host);
+    ++hosts_version_;
+}
+
+PeriodicTasksSchedulerContext::State PeriodicTasksSchedulerContext::state(const std::string &host) {
+    std::lock_guard<decltype(mutex_)> guard(mutex_);
+    return tasks_.at(host).state;
+}
+
+void PeriodicTasksSchedulerContext::restore(const std::string &host, const State &state) {
+    std::lock_guard<decltype(mutex_)> guard(mutex_);
+
+    // the host may have been removed meanwhile
+    auto current = tasks_.find(host);
+    if (current != tasks_.end() && current->second.state.messages_seqno == 0 && current->second.state.notices_seqno == 0
+            && (state.messages_seqno != 0 || state.notices_seqno != 0)) {
+        current->second.state = state;
+        current->second.state.restored = true;
+    }
 }
 
 void PeriodicTasksSchedulerContext::reschedule_now(const std::string &host, PeriodicTask to_reschedule) {
     {
         std::lock_guard<decltype(mutex_)> guard(mutex_);
-        tasks_.at(host).at(static_cast<size_t>(to_reschedule)).last_execution = std::chrono::steady_clock::time_point::min();
+        tasks_.at(host).tasks.at(static_cast<size_t>(to_reschedule)).last_execution = std::chrono::steady_clock::time_point::min();
     }
     condition_.notify_one();
 }
@@ -79,89 +105,190 @@ void PeriodicTasksSchedulerContext::trigger_shutdown() {
 }
 
 void PeriodicTasksSchedulerContext::handle_post_execution(const std::string &host, Job *j) {
+    // we schedule and therefore register to periodic tasks only
+    assert(dynamic_cast<PeriodicJob *>(j) != nullptr);
+
+    PeriodicJob *job = static_cast<PeriodicJob *>(j);
+
+    executed(host, job->task, job->payload);
+}
+
+void PeriodicTasksSchedulerContext::executed(const std::string &host, PeriodicTask type,
+                                             const PeriodicJob::Payload &payload) {
     std::lock_guard<decltype(mutex_)> guard(mutex_);
 
     if (shutdown_triggered_)
         return;
 
-    // we schedule and therefore register to periodic tasks only
-    assert(dynamic_cast<PeriodicJob *>(j) != nullptr);
+    // the host may have been removed while the job was running
+    auto found = tasks_.find(host);
+    if (found == tasks_.end())
+        return;
 
-    PeriodicJob *job = static_cast<PeriodicJob *>(j);
+    auto &host_tasks = found->second;
+    auto &task = host_tasks.tasks.at(static_cast<size_t>(type));
+    assert(task.type == type);
 
-    auto &tasks = tasks_.at(host);
-    auto task = std::find_if(tasks.begin(), tasks.end(), [&](const auto &t) {
-        return t.type == job->task;
-    });
+    task.last_execution = clock_.now();
+    task.pending = false;
 
-    if (task != tasks.end()) {
-        task->last_execution = std::chrono::steady_clock::now();
-        task->pending = false;
+    auto &state = host_tasks.state;
 
-        if (job->task == PeriodicTask::GetMessages)
-            states_.at(host).messages_seqno = job->payload.seqno;
-        else if (job->task == PeriodicTask::GetNotices)
-            states_.at(host).notices_seqno = job->payload.seqno;
+    if (type == PeriodicTask::GetMessages) {
+        state.messages_seqno = payload.seqno;
+    } else if (type == PeriodicTask::GetNotices) {
+        state.notices_seqno = payload.seqno;
+    } else if (type == PeriodicTask::GetClientState && state.restored && payload.client_start_time != 0) {
+        // the client was restarted since the state was saved, so its seqnos started over
+        if (payload.client_start_time != state.client_start_time) {
+            state.messages_seqno = 0;
+            state.notices_seqno = 0;
+        }
+        state.restored = false;
     }
 }
 
 
 // --- PeriodicTasksScheduler ---
 
+namespace {
+    const auto MAX_WAKE_UP_INTERVAL__ = 200ms;
+}
+
 PeriodicTasksScheduler::PeriodicTasksScheduler(PeriodicTasksSchedulerContext &context)
     : context_(context)
-{}
+    , intervals_(context_.configuration_.intervals())
+    , wake_up_interval_(std::min(*std::min_element(intervals_.begin(), intervals_.end()), MAX_WAKE_UP_INTERVAL__))
+    , last_cache_update_(context_.clock_.now())
+{
+    std::lock_guard<decltype(context_.mutex_)> guard(context_.mutex_);
+    take_hosts_();
+}
 
 void PeriodicTasksScheduler::operator()() {
-    const auto max_wake_up_time = 200ms;
+    Tracer::thread_name("periodic tasks scheduler");
 
-    auto intervals{context_.configuration_.intervals()};
-    auto wake_up_interval = std::min(*std::min_element(intervals.begin(), intervals.end()), max_wake_up_time);
-    auto last_cache_update = std::chrono::steady_clock::now();
+    std::unique_lock<decltype(context_.mutex_)> guard(context_.mutex_);
 
     while (true) {
-        const auto now = std::chrono::steady_clock::now();
+        const auto wake_up_interval = tick_(guard);
 
-        // update interval cache once a second
-        if (now - last_cache_update > 1s) {
-            intervals = std::move(context_.configuration_.intervals());
-            wake_up_interval = std::min(*std::min_element(intervals.begin(), intervals.end()), max_wake_up_time);
-            last_cache_update = now;
-        }
+        if (context_.condition_.wait_for(guard, wake_up_interval, [this]() { return context_.shutdown_triggered_; }))
+            break;
+    }
+}
+
+std::chrono::milliseconds PeriodicTasksScheduler::tick() {
+    std::unique_lock<decltype(context_.mutex_)> guard(context_.mutex_);
+    return tick_(guard);
+}
+
+std::chrono::milliseconds PeriodicTasksScheduler::tick_(std::unique_lock<std::mutex> &guard) {
+    const auto now = context_.clock_.now();
+
+    if (context_.shutdown_triggered_)
+        return wake_up_interval_;
+
+    if (hosts_version_ != context_.hosts_version_)
+        take_hosts_();
+
+    // the hosts can't be removed until the scheduling finished, see PeriodicTasksSchedulerContext::remove_host
+    context_.scheduling_ = true;
+    guard.unlock();
+
+    // update interval cache once a second
+    if (now - last_cache_update_ > 1s) {
+        intervals_ = context_.configuration_.intervals();
+        wake_up_interval_ = std::min(*std::min_element(intervals_.begin(), intervals_.end()), MAX_WAKE_UP_INTERVAL__);
+        last_cache_update_ = now;
+    }
+
+    for (auto &host : hosts_) {
+        host.scheduled = context_.configuration_.schedule_periodic_tasks(host.name);
+        if (!host.scheduled)
+            continue;
+        // skip the rpcs for entities no handler is interested in
+        host.subscribed = context_.handler_registry_.subscribed_periodic_tasks(host.name);
+        host.active_only = host.subscribed.test(static_cast<size_t>(PeriodicTask::GetTasks))
+            && context_.configuration_.active_only_tasks(host.name);
+    }
+
+    guard.lock();
 
-        std::unique_lock<decltype(context_.mutex_)> guard(context_.mutex_);
+    for (auto &host : hosts_) {
+        if (!host.scheduled)
+            continue;
 
-        if (!context_.shutdown_triggered_) {
-            for (auto &host_tasks : context_.tasks_) {
-                if (!context_.configuration_.schedule_periodic_tasks(host_tasks.first))
-                    continue;
-                for (auto &task : host_tasks.second)
-                    if (!task.pending && now >= task.last_execution + intervals.at(static_cast<size_t>(task.type)))
-                        schedule_(host_tasks.first, task);
-            }
+        auto &host_tasks = *host.tasks;
+        auto subscribed = host.subscribed;
+
+        // the restored seqnos have to be validated by the client state first, see State::restored;
+        // a failed fetch of it is retried as often as the messages would be fetched
+        const bool validating = host_tasks.state.restored
+            && (subscribed.test(static_cast<size_t>(PeriodicTask::GetMessages))
+                || subscribed.test(static_cast<size_t>(PeriodicTask::GetNotices)));
+        if (validating) {
+            subscribed.reset(static_cast<size_t>(PeriodicTask::GetMessages));
+            subscribed.reset(static_cast<size_t>(PeriodicTask::GetNotices));
+            subscribed.set(static_cast<size_t>(PeriodicTask::GetClientState));
         }
 
-        if (context_.condition_.wait_for(guard, wake_up_interval, [this]() { return context_.shutdown_triggered_; }))
-            break;
+        for (auto &task : host_tasks.tasks) {
+            auto interval = intervals_.at(static_cast<size_t>(task.type));
+            if (validating && task.type == PeriodicTask::GetClientState)
+                interval = std::min(interval, intervals_.at(static_cast<size_t>(PeriodicTask::GetMessages)));
+
+            // never executed tasks are due immediately
+            const auto due = task.last_execution == std::chrono::steady_clock::time_point::min()
+                ? now
+                : task.last_execution + interval;
+            if (!task.pending
+                    && subscribed.test(static_cast<size_t>(task.type))
+                    && now >= due)
+                schedule_(host.name, host_tasks, task, host.active_only, due);
+        }
     }
+
+    guard.unlock();
+
+    for (const auto &scheduled : scheduled_) {
+        // from the time the task was due until the scheduler woke up to schedule it
+        if (context_.tracer_.enabled())
+            context_.tracer_.complete("due", scheduled.trace_host, trace_name(scheduled.task), scheduled.due, context_.clock_.now());
+
+        context_.scheduler_(*scheduled.host, scheduled.task, scheduled.payload, scheduled.due);
+    }
+    scheduled_.clear();
+
+    guard.lock();
+    context_.scheduling_ = false;
+    context_.scheduled_condition_.notify_all();
+
+    return wake_up_interval_;
 }
 
-void PeriodicTasksScheduler::schedule_(const std::string &host, PeriodicTasksSchedulerContext::Task &task) {
+void PeriodicTasksScheduler::take_hosts_() {
+    hosts_.clear();
+    for (auto &host_tasks : context_.tasks_)
+        hosts_.push_back(Host { host_tasks.first, &host_tasks.second, false, PeriodicTaskSet(), false });
+    hosts_version_ = context_.hosts_version_;
+}
+
+void PeriodicTasksScheduler::schedule_(const std::string &host, PeriodicTasksSchedulerContext::HostTasks &host_tasks,
+                                       PeriodicTasksSchedulerContext::Task &task, bool active_only,
+                                       std::chrono::steady_clock::time_point due) {
     task.pending = true;
 
     PeriodicJob::Payload payload;
 
     if (task.type == PeriodicTask::GetMessages)
-        payload.seqno = context_.states_.at(host).messages_seqno;
+        payload.seqno = host_tasks.state.messages_seqno;
     else if (task.type == PeriodicTask::GetNotices)
-        payload.seqno = context_.states_.at(host).notices_seqno;
+        payload.seqno = host_tasks.state.notices_seqno;
     else if (task.type == PeriodicTask::GetTasks)
-        payload.active_only = context_.configuration_.active_only_tasks(host);
-
-    auto job = std::make_unique<PeriodicJob>(task.type, context_.handler_registry_, payload);
-    job->register_post_execution_handler(&context_);
+        payload.active_only = active_only;
 
-    context_.scheduler_(host, std::move(job));
+    scheduled_.push_back(Scheduled { &host, host_tasks.trace_host, task.type, payload, due });
 }
 
 }}
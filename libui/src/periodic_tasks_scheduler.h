@@ -22,28 +22,54 @@
 #include <array>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <ctime>
 #include <functional>
-#include <map>
 #include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "clock.h"
 #include "configuration.h"
 #include "handler_registry.h"
 #include "jobs.h"
+#include "tracer.h"
 #include "visibility.h"
 
 namespace woinc { namespace ui {
 
 class WOINCUI_LOCAL PeriodicTasksSchedulerContext : public PostExecutionHandler {
     public:
-        typedef std::function<void(std::string, std::unique_ptr<Job>)> Scheduler;
+        typedef std::function<void(const std::string &, PeriodicTask, const PeriodicJob::Payload &,
+                                   std::chrono::steady_clock::time_point due)> Scheduler;
+
+        // the incremental fetches of the messages and notices continue after these seqnos
+        struct State {
+            int messages_seqno = 0;
+            int notices_seqno  = 0;
+
+            // restored seqnos are only valid as long as the client wasn't restarted,
+            // so they are reset if the first client state of the host reports another start time;
+            // until it's received the messages and notices are held back and the client state is fetched
+            // even if no handler subscribed to it
+            bool restored = false;
+            std::time_t client_start_time = 0;
+        };
 
     public:
-        PeriodicTasksSchedulerContext(const Configuration &config, const HandlerRegistry &hander_registry, Scheduler scheduler);
+        // the scheduling runs by the clock, e.g. a virtual one to simulate it
+        PeriodicTasksSchedulerContext(const Configuration &config, const HandlerRegistry &hander_registry,
+                                      Tracer &tracer, Scheduler scheduler, const Clock &clock = Clock::steady());
 
         void add_host(std::string host);
+        // waits for a running scheduling of the host to finish, so it's not scheduled afterwards
         void remove_host(const std::string &host);
 
+        State state(const std::string &host);
+        // ignored if the host already fetched messages or notices or there are no seqnos to restore
+        void restore(const std::string &host, const State &state);
+
         void reschedule_now(const std::string &host, PeriodicTask task);
 
         void trigger_shutdown();
@@ -54,15 +80,23 @@ class WOINCUI_LOCAL PeriodicTasksSchedulerContext : public PostExecutionHandler
         // that the thread deletes the scheduler object once the thread finishes
         void handle_post_execution(const std::string &host, Job *job) final;
 
+        // the task of the host was executed, its next execution is due an interval from now
+        void executed(const std::string &host, PeriodicTask task, const PeriodicJob::Payload &payload);
+
     private:
         friend class PeriodicTasksScheduler;
 
         const Configuration &configuration_;
         const HandlerRegistry &handler_registry_;
+        Tracer &tracer_;
         const Scheduler scheduler_;
+        const Clock &clock_;
 
         std::mutex mutex_;
         std::condition_variable condition_;
+        // signaled when the scheduler finished calling the scheduler without the lock
+        std::condition_variable scheduled_condition_;
+        bool scheduling_ = false;
 
         volatile bool shutdown_triggered_ = false;
 
@@ -73,25 +107,71 @@ class WOINCUI_LOCAL PeriodicTasksSchedulerContext : public PostExecutionHandler
             std::chrono::steady_clock::time_point last_execution = std::chrono::steady_clock::time_point::min();
         };
 
-        struct State {
-            int messages_seqno = 0;
-            int notices_seqno  = 0;
+        struct HostTasks {
+            // looked up once, the tracer's lookup by name takes its lock
+            Tracer::HostId trace_host;
+            State state;
+            // indexed by the task
+            std::array<Task, PERIODIC_TASK_COUNT> tasks;
         };
 
-        std::map<std::string, std::array<Task, 9>> tasks_;
-        std::map<std::string, State> states_;
+        // hashed, the completion of every job looks its host up; the elements stay in place when it grows
+        std::unordered_map<std::string, HostTasks> tasks_;
+        // changed by adding or removing a host
+        std::uint64_t hosts_version_ = 0;
 };
 
 class WOINCUI_LOCAL PeriodicTasksScheduler {
     public:
         explicit PeriodicTasksScheduler(PeriodicTasksSchedulerContext &context);
 
+        // schedules the due tasks until the shutdown is triggered
         void operator()();
 
+        // schedules the due tasks once and returns when to do it again,
+        // to run the scheduling without the thread, e.g. in virtual time
+        std::chrono::milliseconds tick();
+
     private:
-        void schedule_(const std::string &host, PeriodicTasksSchedulerContext::Task &task);
+        // expects the context to be locked by the guard, which it unlocks while the configuration,
+        // the handler registry and the scheduler are called
+        std::chrono::milliseconds tick_(std::unique_lock<std::mutex> &guard);
+
+        // expects the context to be locked
+        void take_hosts_();
+        void schedule_(const std::string &host, PeriodicTasksSchedulerContext::HostTasks &host_tasks,
+                       PeriodicTasksSchedulerContext::Task &task, bool active_only,
+                       std::chrono::steady_clock::time_point due);
 
+    private:
         PeriodicTasksSchedulerContext &context_;
+
+        Configuration::Intervals intervals_;
+        std::chrono::milliseconds wake_up_interval_;
+        Clock::TimePoint last_cache_update_;
+
+        // the hosts of the context as of hosts_version_ with their configuration as of the last tick
+        struct Host {
+            std::string name;
+            PeriodicTasksSchedulerContext::HostTasks *tasks;
+            bool scheduled;
+            PeriodicTaskSet subscribed;
+            bool active_only;
+        };
+
+        std::vector<Host> hosts_;
+        std::uint64_t hosts_version_ = 0;
+
+        // the tasks scheduled by a tick, passed to the scheduler after unlocking the context
+        struct Scheduled {
+            const std::string *host;
+            Tracer::HostId trace_host;
+            PeriodicTask task;
+            PeriodicJob::Payload payload;
+            std::chrono::steady_clock::time_point due;
+        };
+
+        std::vector<Scheduled> scheduled_;
 };
 
 }}
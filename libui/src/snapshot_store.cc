@@ -0,0 +1,198 @@
+/* libui/src/snapshot_store.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "snapshot_store.h"
+
+#include <atomic>
+#include <chrono>
+#include <utility>
+
+namespace woinc { namespace ui {
+
+SnapshotStore::SnapshotStore() : hosts_(std::make_shared<Hosts>()) {}
+
+void SnapshotStore::add_host(const std::string &host) {
+    std::lock_guard<decltype(hosts_mutex_)> guard(hosts_mutex_);
+
+    auto hosts = std::make_shared<Hosts>(*std::atomic_load(&hosts_));
+    hosts->emplace(host, std::make_shared<HostSnapshots>());
+
+    std::atomic_store(&hosts_, std::shared_ptr<const Hosts>(std::move(hosts)));
+}
+
+void SnapshotStore::remove_host(const std::string &host) {
+    std::lock_guard<decltype(hosts_mutex_)> guard(hosts_mutex_);
+
+    auto hosts = std::make_shared<Hosts>(*std::atomic_load(&hosts_));
+    hosts->erase(host);
+
+    std::atomic_store(&hosts_, std::shared_ptr<const Hosts>(std::move(hosts)));
+}
+
+SnapshotPtr<CCStatus> SnapshotStore::cc_status(const std::string &host) const {
+    return read_(host, &HostSnapshots::cc_status);
+}
+
+SnapshotPtr<ClientState> SnapshotStore::client_state(const std::string &host) const {
+    return read_(host, &HostSnapshots::client_state);
+}
+
+SnapshotPtr<DiskUsage> SnapshotStore::disk_usage(const std::string &host) const {
+    return read_(host, &HostSnapshots::disk_usage);
+}
+
+SnapshotPtr<FileTransfers> SnapshotStore::file_transfers(const std::string &host) const {
+    return read_(host, &HostSnapshots::file_transfers);
+}
+
+SnapshotPtr<Projects> SnapshotStore::projects(const std::string &host) const {
+    return read_(host, &HostSnapshots::projects);
+}
+
+SnapshotPtr<Statistics> SnapshotStore::statistics(const std::string &host) const {
+    return read_(host, &HostSnapshots::statistics);
+}
+
+SnapshotPtr<Tasks> SnapshotStore::tasks(const std::string &host) const {
+    return read_(host, &HostSnapshots::tasks);
+}
+
+void SnapshotStore::publish(const std::string &host, const CCStatus &cc_status) {
+    publish_(host, cc_status, &HostSnapshots::cc_status);
+}
+
+void SnapshotStore::publish(const std::string &host, const ClientState &client_state) {
+    publish_(host, client_state, &HostSnapshots::client_state);
+}
+
+void SnapshotStore::publish(const std::string &host, const DiskUsage &disk_usage) {
+    publish_(host, disk_usage, &HostSnapshots::disk_usage);
+}
+
+void SnapshotStore::publish(const std::string &host, const FileTransfers &file_transfers) {
+    publish_(host, file_transfers, &HostSnapshots::file_transfers);
+}
+
+void SnapshotStore::publish(const std::string &host, const Projects &projects) {
+    publish_(host, projects, &HostSnapshots::projects);
+}
+
+void SnapshotStore::publish(const std::string &host, const Statistics &statistics) {
+    publish_(host, statistics, &HostSnapshots::statistics);
+}
+
+void SnapshotStore::publish(const std::string &host, const Tasks &tasks) {
+    publish_(host, tasks, &HostSnapshots::tasks);
+}
+
+void SnapshotStore::refresh(const std::string &host, PeriodicTask task) {
+    switch (task) {
+        case PeriodicTask::GetCCStatus:      refresh_(host, &HostSnapshots::cc_status); break;
+        case PeriodicTask::GetClientState:   refresh_(host, &HostSnapshots::client_state); break;
+        case PeriodicTask::GetDiskUsage:     refresh_(host, &HostSnapshots::disk_usage); break;
+        case PeriodicTask::GetFileTransfers: refresh_(host, &HostSnapshots::file_transfers); break;
+        case PeriodicTask::GetProjectStatus: refresh_(host, &HostSnapshots::projects); break;
+        case PeriodicTask::GetStatistics:    refresh_(host, &HostSnapshots::statistics); break;
+        case PeriodicTask::GetTasks:         refresh_(host, &HostSnapshots::tasks); break;
+        case PeriodicTask::GetMessages:
+        case PeriodicTask::GetNotices:
+            break;
+    }
+}
+
+bool SnapshotStore::restore(const std::string &host, SnapshotPtr<ClientState> client_state) {
+    return restore_(host, std::move(client_state), &HostSnapshots::client_state);
+}
+
+bool SnapshotStore::restore(const std::string &host, SnapshotPtr<Projects> projects) {
+    return restore_(host, std::move(projects), &HostSnapshots::projects);
+}
+
+bool SnapshotStore::restore(const std::string &host, SnapshotPtr<Statistics> statistics) {
+    return restore_(host, std::move(statistics), &HostSnapshots::statistics);
+}
+
+bool SnapshotStore::restore(const std::string &host, SnapshotPtr<Tasks> tasks) {
+    return restore_(host, std::move(tasks), &HostSnapshots::tasks);
+}
+
+std::shared_ptr<SnapshotStore::HostSnapshots> SnapshotStore::host_(const std::string &host) const {
+    auto hosts = std::atomic_load(&hosts_);
+    auto iter = hosts->find(host);
+    return iter == hosts->end() ? nullptr : iter->second;
+}
+
+template<typename T>
+SnapshotPtr<T> SnapshotStore::read_(const std::string &host, SnapshotPtr<T> HostSnapshots::*slot) const {
+    auto snapshots = host_(host);
+    return snapshots ? std::atomic_load(&((*snapshots).*slot)) : nullptr;
+}
+
+template<typename T>
+void SnapshotStore::publish_(const std::string &host, const T &value, SnapshotPtr<T> HostSnapshots::*slot) {
+    auto snapshots = host_(host);
+    if (snapshots)
+        publish_((*snapshots).*slot, value);
+}
+
+template<typename T>
+void SnapshotStore::publish_(SnapshotPtr<T> &slot, const T &value) {
+    auto next = std::make_shared<Snapshot<T>>();
+    next->value = value;
+    next->time = std::chrono::steady_clock::now();
+
+    std::atomic_store(&slot, SnapshotPtr<T>(std::move(next)));
+}
+
+template<typename T>
+void SnapshotStore::refresh_(const std::string &host, SnapshotPtr<T> HostSnapshots::*slot) {
+    auto snapshots = host_(host);
+    if (!snapshots)
+        return;
+
+    auto &s = (*snapshots).*slot;
+
+    // only the writer publishes, so the current snapshot can't change in between
+    auto current = std::atomic_load(&s);
+    if (!current)
+        return;
+
+    // a restored snapshot has to be replaced to drop its stale flag, which readers don't expect to change
+    if (current->stale)
+        publish_(s, current->value);
+    else
+        std::const_pointer_cast<Snapshot<T>>(current)->time = std::chrono::steady_clock::now();
+}
+
+template<typename T>
+bool SnapshotStore::restore_(const std::string &host, SnapshotPtr<T> snapshot, SnapshotPtr<T> HostSnapshots::*slot) {
+    auto snapshots = host_(host);
+    if (!snapshots)
+        return false;
+
+    auto &s = (*snapshots).*slot;
+
+    // only the writer publishes, so a received snapshot can't be published in between
+    if (std::atomic_load(&s))
+        return false;
+
+    std::atomic_store(&s, std::move(snapshot));
+    return true;
+}
+
+}}
@@ -0,0 +1,118 @@
+/* libui/src/snapshot_store.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_SNAPSHOT_STORE_H_
+#define WOINC_UI_SNAPSHOT_STORE_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <woinc/types.h>
+#include <woinc/ui/defs.h>
+#include <woinc/ui/snapshot.h>
+
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+// The latest state of the periodically polled entities per host.
+//
+// Readers don't wait for a writer: the hosts and each entity are published through shared pointers
+// which are swapped atomically, so a reader gets either the previous or the new snapshot.
+// Depending on the standard library the atomic operations on the shared pointers may use a short internal lock.
+// Each host must only be written by one thread at a time, i.e. its worker thread.
+class WOINCUI_LOCAL SnapshotStore {
+    public:
+        SnapshotStore();
+
+        SnapshotStore(const SnapshotStore &) = delete;
+        SnapshotStore(SnapshotStore &&) = delete;
+        SnapshotStore &operator=(const SnapshotStore &) = delete;
+        SnapshotStore &operator=(SnapshotStore &&) = delete;
+
+        void add_host(const std::string &host);
+        void remove_host(const std::string &host);
+
+    public: // the readers; return an empty pointer if the host is unknown or nothing was received yet
+        SnapshotPtr<CCStatus> cc_status(const std::string &host) const;
+        SnapshotPtr<ClientState> client_state(const std::string &host) const;
+        SnapshotPtr<DiskUsage> disk_usage(const std::string &host) const;
+        SnapshotPtr<FileTransfers> file_transfers(const std::string &host) const;
+        SnapshotPtr<Projects> projects(const std::string &host) const;
+        SnapshotPtr<Statistics> statistics(const std::string &host) const;
+        SnapshotPtr<Tasks> tasks(const std::string &host) const;
+
+    public: // the writers; the value is copied into the new snapshot
+        void publish(const std::string &host, const CCStatus &cc_status);
+        void publish(const std::string &host, const ClientState &client_state);
+        void publish(const std::string &host, const DiskUsage &disk_usage);
+        void publish(const std::string &host, const FileTransfers &file_transfers);
+        void publish(const std::string &host, const Projects &projects);
+        void publish(const std::string &host, const Statistics &statistics);
+        void publish(const std::string &host, const Tasks &tasks);
+
+        // moves the time of the current snapshot of the task on to now, i.e. it's confirmed to be up to date
+        void refresh(const std::string &host, PeriodicTask task);
+
+        // publishes the restored snapshot as is unless the host already published its own, returns if it did
+        bool restore(const std::string &host, SnapshotPtr<ClientState> client_state);
+        bool restore(const std::string &host, SnapshotPtr<Projects> projects);
+        bool restore(const std::string &host, SnapshotPtr<Statistics> statistics);
+        bool restore(const std::string &host, SnapshotPtr<Tasks> tasks);
+
+    private:
+        struct HostSnapshots {
+            SnapshotPtr<CCStatus> cc_status;
+            SnapshotPtr<ClientState> client_state;
+            SnapshotPtr<DiskUsage> disk_usage;
+            SnapshotPtr<FileTransfers> file_transfers;
+            SnapshotPtr<Projects> projects;
+            SnapshotPtr<Statistics> statistics;
+            SnapshotPtr<Tasks> tasks;
+        };
+
+        typedef std::map<std::string, std::shared_ptr<HostSnapshots>> Hosts;
+
+        std::shared_ptr<HostSnapshots> host_(const std::string &host) const;
+
+        template<typename T>
+        SnapshotPtr<T> read_(const std::string &host, SnapshotPtr<T> HostSnapshots::*slot) const;
+
+        template<typename T>
+        void publish_(const std::string &host, const T &value, SnapshotPtr<T> HostSnapshots::*slot);
+
+        template<typename T>
+        void publish_(SnapshotPtr<T> &slot, const T &value);
+
+        template<typename T>
+        void refresh_(const std::string &host, SnapshotPtr<T> HostSnapshots::*slot);
+
+        template<typename T>
+        bool restore_(const std::string &host, SnapshotPtr<T> snapshot, SnapshotPtr<T> HostSnapshots::*slot);
+
+    private:
+        // serializes adding and removing hosts, which copy the map
+        std::mutex hosts_mutex_;
+        std::shared_ptr<const Hosts> hosts_;
+};
+
+}}
+
+#endif
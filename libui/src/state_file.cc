@@ -0,0 +1,602 @@
+/* libui/src/state_file.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "state_file.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace woinc;
+
+const char MAGIC__[8] = {'W', 'O', 'I', 'N', 'C', 'S', 'T', 'F'};
+const std::uint32_t VERSION__ = 1;
+const std::uint32_t BYTE_ORDER__ = 0x01020304;
+
+#ifdef WOINC_EXPOSE_FULL_STRUCTURES
+const std::uint32_t FULL_STRUCTURES__ = 1;
+#else
+const std::uint32_t FULL_STRUCTURES__ = 0;
+#endif
+
+const std::uint32_t LAYOUT__ = static_cast<std::uint32_t>(
+    sizeof(int) | sizeof(long) << 8 | sizeof(std::time_t) << 16 | FULL_STRUCTURES__ << 24);
+
+// the magic, version, byte order, layout and the offset and size of the index
+const std::size_t HEADER_SIZE__ = sizeof(MAGIC__) + 3 * sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t);
+
+struct DecodeError : public std::runtime_error {
+    DecodeError() : std::runtime_error("Corrupt state file") {}
+};
+
+// The structures are described once by their transfer__ functions and written and read by these archives.
+// Numbers are stored as in memory, strings and containers with their size in front.
+
+class Writer {
+    public:
+        explicit Writer(std::string &out) : out_(out) {}
+
+        template<typename T>
+        std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value> operator()(const T &value) {
+            out_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        template<typename T>
+        std::enable_if_t<std::is_class<T>::value> operator()(const T &value) {
+            // the transfer functions are shared with the reader but don't modify the value
+            transfer__(*this, const_cast<T &>(value));
+        }
+
+        void operator()(const std::string &value) {
+            size_(value.size());
+            out_.append(value);
+        }
+
+        template<typename T>
+        void operator()(const std::vector<T> &values) {
+            size_(values.size());
+            for (const auto &value : values)
+                (*this)(value);
+        }
+
+        template<typename K, typename V>
+        void operator()(const std::map<K, V> &values) {
+            size_(values.size());
+            for (const auto &value : values) {
+                (*this)(value.first);
+                (*this)(value.second);
+            }
+        }
+
+        template<typename T>
+        void operator()(const std::unique_ptr<T> &value) {
+            (*this)(static_cast<bool>(value));
+            if (value)
+                (*this)(*value);
+        }
+
+    private:
+        void size_(std::size_t size) {
+            (*this)(static_cast<std::uint32_t>(size));
+        }
+
+        std::string &out_;
+};
+
+class Reader {
+    public:
+        Reader(const char *data, std::size_t size) : pos_(data), end_(data + size) {}
+
+        bool at_end() const { return pos_ == end_; }
+
+        template<typename T>
+        std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value> operator()(T &value) {
+            std::memcpy(&value, take_(sizeof(value)), sizeof(value));
+        }
+
+        // not every byte is a valid bool
+        void operator()(bool &value) {
+            value = *take_(1) != 0;
+        }
+
+        template<typename T>
+        std::enable_if_t<std::is_class<T>::value> operator()(T &value) {
+            transfer__(*this, value);
+        }
+
+        void operator()(std::string &value) {
+            auto size = size_(1);
+            value.assign(take_(size), size);
+        }
+
+        template<typename T>
+        void operator()(std::vector<T> &values) {
+            values.clear();
+            values.resize(size_(1));
+            for (auto &value : values)
+                (*this)(value);
+        }
+
+        template<typename K, typename V>
+        void operator()(std::map<K, V> &values) {
+            values.clear();
+            for (auto size = size_(2); size > 0; --size) {
+                K key;
+                V value;
+                (*this)(key);
+                (*this)(value);
+                values.emplace(std::move(key), std::move(value));
+            }
+        }
+
+        template<typename T>
+        void operator()(std::unique_ptr<T> &value) {
+            bool present;
+            (*this)(present);
+            if (present) {
+                value = std::make_unique<T>();
+                (*this)(*value);
+            } else {
+                value.reset();
+            }
+        }
+
+    private:
+        const char *take_(std::size_t size) {
+            if (static_cast<std::size_t>(end_ - pos_) < size)
+                throw DecodeError();
+            auto data = pos_;
+            pos_ += size;
+            return data;
+        }
+
+        // rejects sizes the remaining data can't hold, so corrupt sizes don't lead to huge allocations
+        std::size_t size_(std::size_t min_element_size) {
+            std::uint32_t size;
+            (*this)(size);
+            if (size > static_cast<std::size_t>(end_ - pos_) / min_element_size)
+                throw DecodeError();
+            return size;
+        }
+
+        const char *pos_;
+        const char *end_;
+};
+
+template<typename Archive, typename... Fields>
+void fields__(Archive &archive, Fields &... fields) {
+    using expand = int[];
+    static_cast<void>(expand{0, (archive(fields), 0)...});
+}
+
+template<typename Archive>
+void transfer__(Archive &a, FileRef &v) {
+    fields__(a, v.main_program, v.file_name);
+#ifdef WOINC_EXPOSE_FULL_STRUCTURES
+    fields__(a, v.copy_file, v.optional, v.open_name);
+#endif
+}
+
+template<typename Archive>
+void transfer__(Archive &a, ActiveTask &v) {
+    fields__(a, v.active_task_state, v.scheduler_state, v.needs_shmem, v.too_large, v.pid, v.slot,
+             v.bytes_received, v.bytes_sent, v.checkpoint_cpu_time, v.current_cpu_time, v.elapsed_time,
+             v.fraction_done, v.progress_rate, v.swap_size, v.working_set_size_smoothed);
+#ifdef WOINC_EXPOSE_FULL_STRUCTURES
+    fields__(a, v.page_fault_rate, v.working_set_size, v.app_version_num,
+             v.graphics_exec_path, v.remote_desktop_addr, v.slot_path, v.web_graphics_url);
+#endif
+}
+
+template<typename Archive>
+void transfer__(Archive &a, App &v) {
+    fields__(a, v.non_cpu_intensive, v.name, v.user_friendly_name, v.project_url);
+}
+
+#ifdef WOINC_EXPOSE_FULL_STRUCTURES
+template<typename Archive>
+void transfer__(Archive &a, AppVersion::Coproc &v) {
+    fields__(a, v.type, v.count);
+}
+#endif
+
+template<typename Archive>
+void transfer__(Archive &a, AppVersion &v) {
+    fields__(a, v.avg_ncpus, v.flops, v.version_num, v.app_name, v.plan_class, v.platform, v.app_files, v.project_url);
+#ifdef WOINC_EXPOSE_FULL_STRUCTURES
+    fields__(a, v.dont_throttle, v.is_vm_app, v.is_wrapper, v.needs_network, v.gpu_ram,
+             v.api_version, v.cmdline, v.file_prefix, v.coproc);
+#endif
+}
+
+template<typename Archive>
+void transfer__(Archive &a, DailyStatistic &v) {
+    fields__(a, v.host_expavg_credit, v.host_total_credit, v.user_expavg_credit, v.user_total_credit, v.day);
+}
+
+template<typename Archive>
+void transfer__(Archive &a, GuiUrl &v) {
+    fields__(a, v.name, v.description, v.url);
+}
+
+template<typename Archive>
+void transfer__(Archive &a, Project &v) {
+    fields__(a, v.anonymous_platform, v.attached_via_acct_mgr, v.detach_when_done, v.dont_request_more_work,
+             v.ended, v.master_url_fetch_pending, v.non_cpu_intensive, v.scheduler_rpc_in_progress,
+             v.suspended_via_gui, v.trickle_up_pending);
+    fields__(a, v.disk_usage, v.duration_correction_factor, v.elapsed_time, v.host_expavg_credit,
+             v.host_total_credit, v.resource_share, v.sched_priority, v.user_expavg_credit, v.user_total_credit);
+    fields__(a, v.hostid, v.master_fetch_failures, v.njobs_error, v.njobs_success, v.nrpc_failures,
+             v.sched_rpc_pending);
+    fields__(a, v.external_cpid, v.master_url, v.project_dir, v.project_name, v.team_name, v.user_name, v.venue);
+    fields__(a, v.download_backoff, v.last_rpc_time, v.min_rpc_time, v.project_files_downloaded_time,
+             v.upload_backoff, v.gui_urls);
+}
+
+template<typename Archive>
+void transfer__(Archive &a, ProjectStatistics &v) {
+    fields__(a, v.master_url, v.daily_statistics);
+}
+
+template<typename Archive>
+void transfer__(Archive &a, Task &v) {
+    fields__(a, v.state, v.coproc_missing, v.got_server_ack, v.network_wait, v.project_suspended_via_gui,
+             v.ready_to_report, v.scheduler_wait, v.suspended_via_gui);
+    fields__(a, v.estimated_cpu_time_remaining, v.final_cpu_time, v.final_elapsed_time,
+             v.exit_status, v.signal, v.version_num);
+    fields__(a, v.name, v.project_url, v.resources, v.scheduler_wait_reason, v.wu_name,
+             v.active_task, v.received_time, v.report_deadline);
+#ifdef WOINC_EXPOSE_FULL_STRUCTURES
+    fields__(a, v.edf_scheduled, v.report_immediately, v.completed_time, v.plan_class, v.platform);
+#endif
+}
+
+template<typename Archive>
+void transfer__(Archive &a, TimeStats &v) {
+    fields__(a, v.active_frac, v.connected_frac, v.cpu_and_network_available_frac, v.gpu_active_frac, v.now,
+             v.on_frac, v.previous_uptime, v.session_active_duration, v.session_gpu_active_duration,
+             v.total_active_duration, v.total_duration, v.total_gpu_active_duration,
+             v.client_start_time, v.total_start_time);
+}
+
+template<typename Archive>
+void transfer__(Archive &a, Workunit &v) {
+    fields__(a, v.rsc_disk_bound, v.rsc_fpops_bound, v.rsc_fpops_est, v.rsc_memory_bound, v.version_num,
+             v.app_name, v.name, v.project_url);
+#ifdef WOINC_EXPOSE_FULL_STRUCTURES
+    fields__(a, v.command_line, v.job_keyword_ids, v.input_files);
+#endif
+}
+
+#ifdef WOINC_EXPOSE_FULL_STRUCTURES
+template<typename Archive>
+void transfer__(Archive &a, GlobalPreferences::TimeSpan &v) {
+    fields__(a, v.start, v.end);
+}
+
+template<typename Archive>
+void transfer__(Archive &a, GlobalPreferences &v) {
+    fields__(a, v.confirm_before_connecting, v.dont_verify_images, v.hangup_if_dialed, v.leave_apps_in_memory,
+             v.run_gpu_if_user_active, v.run_if_user_active, v.run_on_batteries);
+    fields__(a, v.cpu_scheduling_period_minutes, v.cpu_usage_limit, v.daily_xfer_limit_mb, v.disk_interval,
+             v.disk_max_used_gb, v.disk_max_used_pct, v.disk_min_free_gb, v.idle_time_to_run,
+             v.max_bytes_sec_down, v.max_bytes_sec_up, v.max_ncpus_pct, v.ram_max_used_busy_pct,
+             v.ram_max_used_idle_pct, v.suspend_cpu_usage, v.vm_max_used_pct, v.work_buf_additional_days,
+             v.work_buf_min_days, v.daily_xfer_period_days);
+    fields__(a, v.daily_cpu_times, v.daily_net_times, v.general_cpu_times, v.general_net_times);
+    fields__(a, v.network_wifi_only, v.override_file_present, v.battery_charge_min_pct,
+             v.battery_max_temperature, v.niu_cpu_usage_limit, v.niu_max_ncpus_pct, v.niu_suspend_cpu_usage,
+             v.suspend_if_no_recent_input, v.max_cpus, v.source_project);
+}
+
+template<typename Archive>
+void transfer__(Archive &a, HostInfo &v) {
+    fields__(a, v.d_free, v.d_total, v.m_cache, v.m_nbytes, v.m_swap, v.p_fpops, v.p_iops, v.p_membw,
+             v.p_ncpus, v.timezone, v.domain_name, v.ip_addr, v.os_name, v.os_version, v.p_model, v.p_vendor);
+    fields__(a, v.p_vm_extensions_disabled, v.wsl_available, v.p_calculated, v.n_usable_coprocs,
+             v.host_cpid, v.mac_address, v.p_features, v.product_name, v.virtualbox_version);
+}
+
+template<typename Archive>
+void transfer__(Archive &a, Version &v) {
+    fields__(a, v.major, v.minor, v.release);
+}
+#endif
+
+template<typename Archive>
+void transfer__(Archive &a, ClientState &v) {
+    fields__(a, v.app_versions, v.apps, v.projects, v.tasks, v.time_stats, v.workunits);
+#ifdef WOINC_EXPOSE_FULL_STRUCTURES
+    fields__(a, v.global_prefs, v.host_info, v.platforms, v.core_client_version,
+             v.executing_as_daemon, v.platform_name);
+#endif
+}
+
+// the snapshots know when they were received by the monotonic clock, which doesn't survive a restart
+
+std::int64_t to_wall_clock__(std::chrono::steady_clock::time_point time) {
+    const auto age = std::chrono::steady_clock::now() - time;
+    const auto received = std::chrono::system_clock::now() - std::chrono::duration_cast<std::chrono::system_clock::duration>(age);
+    return std::chrono::duration_cast<std::chrono::seconds>(received.time_since_epoch()).count();
+}
+
+std::chrono::steady_clock::time_point from_wall_clock__(std::int64_t received) {
+    auto age = std::chrono::system_clock::now().time_since_epoch() - std::chrono::seconds(received);
+    if (age.count() < 0)
+        age = decltype(age)::zero();
+    return std::chrono::steady_clock::now() - std::chrono::duration_cast<std::chrono::steady_clock::duration>(age);
+}
+
+std::runtime_error write_error__(const std::string &path) {
+    return std::runtime_error("Could not write the state file \"" + path + "\": " + std::strerror(errno));
+}
+
+}
+
+namespace woinc { namespace ui {
+
+StateFile::StateFile(std::string path) : path_(std::move(path)) {
+    map_();
+
+    if (data_ != nullptr && !read_index_()) {
+        index_.clear();
+        ::munmap(const_cast<char *>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+StateFile::~StateFile() {
+    if (data_ != nullptr)
+        ::munmap(const_cast<char *>(data_), size_);
+}
+
+bool StateFile::restore(const std::string &host, HostState &state) const {
+    auto entry = index_.find(host);
+    if (entry == index_.end())
+        return false;
+
+    try {
+        state.messages_seqno = entry->second.messages_seqno;
+        state.notices_seqno = entry->second.notices_seqno;
+        state.client_state = decode_<ClientState>(entry->second.client_state);
+        state.projects = decode_<Projects>(entry->second.projects);
+        state.statistics = decode_<Statistics>(entry->second.statistics);
+        state.tasks = decode_<Tasks>(entry->second.tasks);
+    } catch (const DecodeError &) {
+        state = HostState();
+        return false;
+    }
+
+    return true;
+}
+
+void StateFile::save(const Hosts &hosts) const {
+    std::string out(HEADER_SIZE__, '\0');
+
+    std::vector<std::pair<const std::string *, Entry>> entries;
+    entries.reserve(hosts.size());
+
+    for (const auto &host : hosts) {
+        Entry entry;
+        entry.messages_seqno = host.second.messages_seqno;
+        entry.notices_seqno = host.second.notices_seqno;
+        entry.client_state = encode_(out, host.second.client_state);
+        entry.projects = encode_(out, host.second.projects);
+        entry.statistics = encode_(out, host.second.statistics);
+        entry.tasks = encode_(out, host.second.tasks);
+        entries.emplace_back(&host.first, entry);
+    }
+
+    const auto index_offset = out.size();
+    {
+        Writer writer(out);
+        writer(static_cast<std::uint32_t>(entries.size()));
+        for (const auto &entry : entries) {
+            writer(*entry.first);
+            writer(entry.second.messages_seqno);
+            writer(entry.second.notices_seqno);
+            for (const auto *range : {&entry.second.client_state, &entry.second.projects,
+                                      &entry.second.statistics, &entry.second.tasks}) {
+                writer(static_cast<std::uint64_t>(range->offset));
+                writer(static_cast<std::uint64_t>(range->size));
+                writer(range->received);
+            }
+        }
+    }
+
+    std::string header;
+    {
+        Writer writer(header);
+        for (auto c : MAGIC__)
+            writer(c);
+        writer(VERSION__);
+        writer(BYTE_ORDER__);
+        writer(LAYOUT__);
+        writer(static_cast<std::uint64_t>(index_offset));
+        writer(static_cast<std::uint64_t>(out.size() - index_offset));
+    }
+    out.replace(0, HEADER_SIZE__, header);
+
+    std::lock_guard<decltype(save_mutex_)> guard(save_mutex_);
+
+    const auto tmp_path = path_ + ".tmp";
+
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+        throw write_error__(tmp_path);
+
+    for (std::size_t written = 0; written < out.size();) {
+        auto n = ::write(fd, out.data() + written, out.size() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            auto error = write_error__(tmp_path);
+            ::close(fd);
+            ::unlink(tmp_path.c_str());
+            throw error;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+
+    // the replacing file must be complete before the rename is persisted,
+    // the descriptor is closed in any case and the first error is reported
+    int sync_error = ::fsync(fd) != 0 ? errno : 0;
+    if (::close(fd) != 0 && sync_error == 0)
+        sync_error = errno;
+    if (sync_error != 0) {
+        errno = sync_error;
+        auto error = write_error__(tmp_path);
+        ::unlink(tmp_path.c_str());
+        throw error;
+    }
+
+    if (::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        auto error = write_error__(path_);
+        ::unlink(tmp_path.c_str());
+        throw error;
+    }
+}
+
+void StateFile::map_() {
+    int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) == 0 && static_cast<std::size_t>(file_stat.st_size) >= HEADER_SIZE__) {
+        auto size = static_cast<std::size_t>(file_stat.st_size);
+        auto data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            data_ = static_cast<const char *>(data);
+            size_ = size;
+        }
+    }
+
+    // the mapping stays valid without the descriptor
+    ::close(fd);
+}
+
+bool StateFile::read_index_() {
+    try {
+        Reader header(data_, HEADER_SIZE__);
+
+        char magic[sizeof(MAGIC__)];
+        for (auto &c : magic)
+            header(c);
+
+        std::uint32_t version, byte_order, layout;
+        std::uint64_t index_offset, index_size;
+        header(version);
+        header(byte_order);
+        header(layout);
+        header(index_offset);
+        header(index_size);
+
+        if (std::memcmp(magic, MAGIC__, sizeof(MAGIC__)) != 0
+                || version != VERSION__
+                || byte_order != BYTE_ORDER__
+                || layout != LAYOUT__
+                || index_offset < HEADER_SIZE__
+                || index_offset > size_
+                || index_size != size_ - index_offset)
+            return false;
+
+        Reader index(data_ + index_offset, static_cast<std::size_t>(index_size));
+
+        std::uint32_t hosts;
+        index(hosts);
+
+        for (; hosts > 0; --hosts) {
+            std::string host;
+            Entry entry;
+
+            index(host);
+            index(entry.messages_seqno);
+            index(entry.notices_seqno);
+
+            for (auto *range : {&entry.client_state, &entry.projects, &entry.statistics, &entry.tasks}) {
+                std::uint64_t offset, size;
+                index(offset);
+                index(size);
+                index(range->received);
+
+                // the entities lie between the header and the index
+                if (size > 0 && (offset < HEADER_SIZE__ || offset > index_offset || size > index_offset - offset))
+                    return false;
+
+                range->offset = static_cast<std::size_t>(offset);
+                range->size = static_cast<std::size_t>(size);
+            }
+
+            index_[std::move(host)] = entry;
+        }
+
+        return index.at_end();
+    } catch (const DecodeError &) {
+        return false;
+    }
+}
+
+template<typename T>
+StateFile::Range StateFile::encode_(std::string &out, const SnapshotPtr<T> &snapshot) {
+    Range range;
+
+    if (snapshot) {
+        range.offset = out.size();
+        Writer writer(out);
+        writer(snapshot->value);
+        range.size = out.size() - range.offset;
+        range.received = to_wall_clock__(snapshot->time.load());
+    }
+
+    return range;
+}
+
+template<typename T>
+SnapshotPtr<T> StateFile::decode_(const Range &range) const {
+    if (range.size == 0)
+        return nullptr;
+
+    auto snapshot = std::make_shared<Snapshot<T>>();
+
+    Reader reader(data_ + range.offset, range.size);
+    reader(snapshot->value);
+    if (!reader.at_end())
+        throw DecodeError();
+
+    snapshot->time = from_wall_clock__(range.received);
+    snapshot->stale = true;
+
+    return snapshot;
+}
+
+}}
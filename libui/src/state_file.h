@@ -0,0 +1,119 @@
+/* libui/src/state_file.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_STATE_FILE_H_
+#define WOINC_UI_STATE_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <woinc/types.h>
+#include <woinc/ui/snapshot.h>
+
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+// The last known state of the hosts, saved to allow showing it immediately on the next start.
+//
+// The file consists of a header, the binary encoded entities of the hosts and an index of the hosts at its end.
+// It's mapped into memory when opened but only the index is read, the entities of a host are decoded
+// when it's restored. The encoding is the in-memory representation of the numbers, so a file is only read
+// on the platform and with the structures (see WOINC_EXPOSE_FULL_STRUCTURES) it was written with,
+// otherwise it's ignored like a missing or corrupt one.
+class WOINCUI_LOCAL StateFile {
+    public:
+        struct HostState {
+            int messages_seqno = 0;
+            int notices_seqno = 0;
+
+            // empty if not saved; restored snapshots are stale and keep the time they were received
+            SnapshotPtr<ClientState> client_state;
+            SnapshotPtr<Projects> projects;
+            SnapshotPtr<Statistics> statistics;
+            SnapshotPtr<Tasks> tasks;
+        };
+
+        typedef std::map<std::string, HostState> Hosts;
+
+    public:
+        // maps the file if it exists and is valid
+        explicit StateFile(std::string path);
+        ~StateFile();
+
+        StateFile(const StateFile &) = delete;
+        StateFile(StateFile &&) = delete;
+        StateFile &operator=(const StateFile &) = delete;
+        StateFile &operator=(StateFile &&) = delete;
+
+        const std::string &path() const { return path_; }
+
+        // the number of hosts in the mapped file
+        std::size_t size() const { return index_.size(); }
+
+        // decodes the saved state of the host, returns false if there is none or it's corrupt
+        bool restore(const std::string &host, HostState &state) const;
+
+        // writes the hosts to a temporary file which then replaces the file, so the mapped file stays valid;
+        // throws a std::runtime_error if writing fails
+        void save(const Hosts &hosts) const;
+
+    private:
+        struct Range {
+            std::size_t offset = 0;
+            std::size_t size = 0;
+            // the wall clock time the entity was received, in seconds since the epoch
+            std::int64_t received = 0;
+        };
+
+        struct Entry {
+            int messages_seqno = 0;
+            int notices_seqno = 0;
+            Range client_state;
+            Range projects;
+            Range statistics;
+            Range tasks;
+        };
+
+        void map_();
+        bool read_index_();
+
+        template<typename T>
+        static Range encode_(std::string &out, const SnapshotPtr<T> &snapshot);
+
+        template<typename T>
+        SnapshotPtr<T> decode_(const Range &range) const;
+
+    private:
+        const std::string path_;
+
+        const char *data_ = nullptr;
+        std::size_t size_ = 0;
+
+        std::map<std::string, Entry> index_;
+
+        // serializes the saves, which use the same temporary file
+        mutable std::mutex save_mutex_;
+};
+
+}}
+
+#endif
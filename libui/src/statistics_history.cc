@@ -0,0 +1,247 @@
+/* libui/src/statistics_history.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "statistics_history.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+#define WOINC_LOCK_GUARD std::lock_guard<decltype(mutex_)> guard(mutex_)
+
+namespace {
+
+constexpr char MAGIC__[8] = {'W', 'O', 'I', 'N', 'C', 'S', 'T', 'H'};
+constexpr std::uint32_t VERSION__ = 1;
+// host names and master urls are way shorter, it just prevents huge allocations when reading garbage
+constexpr std::uint32_t MAX_STRING_LENGTH__ = 1 << 16;
+
+template<typename T>
+void write__(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+void read__(std::istream &in, T &value) {
+    if (!in.read(reinterpret_cast<char *>(&value), sizeof(value)))
+        throw std::runtime_error("Truncated statistics history");
+}
+
+void write__(std::ostream &out, const std::string &value) {
+    write__(out, static_cast<std::uint32_t>(value.size()));
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+void read__(std::istream &in, std::string &value) {
+    std::uint32_t size;
+    read__(in, size);
+    if (size > MAX_STRING_LENGTH__)
+        throw std::runtime_error("Invalid statistics history");
+
+    value.resize(size);
+    if (!in.read(&value[0], static_cast<std::streamsize>(size)))
+        throw std::runtime_error("Truncated statistics history");
+}
+
+}
+
+namespace woinc { namespace ui {
+
+void StatisticsHistory::retention(std::chrono::hours retention) {
+    WOINC_LOCK_GUARD;
+
+    retention_ = retention;
+
+    for (auto &host : hosts_)
+        for (auto &project : host.second)
+            drop_expired_(project.second);
+}
+
+std::chrono::hours StatisticsHistory::retention() const {
+    WOINC_LOCK_GUARD;
+    return retention_;
+}
+
+DailyStatistics StatisticsHistory::query(const std::string &host, const std::string &master_url,
+                                         std::time_t from, std::time_t to, std::size_t max_points) const {
+    WOINC_LOCK_GUARD;
+
+    DailyStatistics result;
+
+    auto projects = hosts_.find(host);
+    if (projects == hosts_.end())
+        return result;
+    auto series = projects->second.find(master_url);
+    if (series == projects->second.end() || series->second.empty())
+        return result;
+
+    // the buckets only have to span the recorded days, not an open range like [0, max]
+    from = std::max(from, series->second.first_day());
+    to = std::min(to, series->second.last_day());
+    if (to < from)
+        return result;
+
+    if (max_points == 0) {
+        series->second.visit(from, to, [&](const DailyStatistic &statistic) { result.push_back(statistic); });
+        return result;
+    }
+
+    const auto range = static_cast<std::uint64_t>(to - from) + 1;
+    const auto width = (range + max_points - 1) / max_points;
+    std::uint64_t bucket = 0;
+
+    result.reserve(std::min<std::uint64_t>(max_points, series->second.size()));
+    series->second.visit(from, to, [&](const DailyStatistic &statistic) {
+        const auto current = static_cast<std::uint64_t>(statistic.day - from) / width;
+        if (!result.empty() && current == bucket)
+            result.back() = statistic;
+        else
+            result.push_back(statistic);
+        bucket = current;
+    });
+
+    return result;
+}
+
+std::vector<std::string> StatisticsHistory::projects(const std::string &host) const {
+    WOINC_LOCK_GUARD;
+
+    std::vector<std::string> result;
+
+    auto projects = hosts_.find(host);
+    if (projects != hosts_.end())
+        for (const auto &project : projects->second)
+            result.push_back(project.first);
+
+    return result;
+}
+
+std::size_t StatisticsHistory::memory() const {
+    WOINC_LOCK_GUARD;
+
+    std::size_t memory = 0;
+    for (const auto &host : hosts_)
+        for (const auto &project : host.second)
+            memory += project.first.capacity() + project.second.memory();
+    return memory;
+}
+
+void StatisticsHistory::remove_host(const std::string &host) {
+    WOINC_LOCK_GUARD;
+    hosts_.erase(host);
+}
+
+void StatisticsHistory::clear() {
+    WOINC_LOCK_GUARD;
+    hosts_.clear();
+}
+
+void StatisticsHistory::write(std::ostream &out) const {
+    WOINC_LOCK_GUARD;
+
+    out.write(MAGIC__, sizeof(MAGIC__));
+    write__(out, VERSION__);
+
+    write__(out, static_cast<std::uint64_t>(hosts_.size()));
+    for (const auto &host : hosts_) {
+        write__(out, host.first);
+        write__(out, static_cast<std::uint64_t>(host.second.size()));
+        for (const auto &project : host.second) {
+            write__(out, project.first);
+            project.second.serialize(out);
+        }
+    }
+
+    if (!out)
+        throw std::runtime_error("Error writing the statistics history");
+}
+
+void StatisticsHistory::read(std::istream &in) {
+    char magic[sizeof(MAGIC__)];
+    std::uint32_t version;
+
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), MAGIC__))
+        throw std::runtime_error("Invalid statistics history");
+    read__(in, version);
+    if (version != VERSION__)
+        throw std::runtime_error("Unsupported version of the statistics history");
+
+    // decode everything before replacing anything
+    Hosts hosts;
+
+    std::uint64_t host_count;
+    read__(in, host_count);
+    for (; host_count > 0; --host_count) {
+        std::string host;
+        read__(in, host);
+        auto &projects = hosts[host];
+
+        std::uint64_t project_count;
+        read__(in, project_count);
+        for (; project_count > 0; --project_count) {
+            std::string master_url;
+            read__(in, master_url);
+            projects[master_url].deserialize(in);
+        }
+    }
+
+    WOINC_LOCK_GUARD;
+
+    for (auto &host : hosts) {
+        for (auto &project : host.second)
+            drop_expired_(project.second);
+        hosts_[host.first] = std::move(host.second);
+    }
+}
+
+void StatisticsHistory::on_update(const std::string &host, const woinc::Statistics &days, bool) {
+    WOINC_LOCK_GUARD;
+
+    auto &projects = hosts_[host];
+
+    for (const auto &project : days) {
+        auto &series = projects[project.master_url];
+
+        auto append = [&](const DailyStatistics &project_days) {
+            for (const auto &day : project_days)
+                if (series.empty() || day.day >= series.last_day())
+                    series.append(day);
+        };
+
+        // the clients report the days in order, but don't rely on it
+        auto by_day = [](const DailyStatistic &a, const DailyStatistic &b) { return a.day < b.day; };
+        if (std::is_sorted(project.daily_statistics.begin(), project.daily_statistics.end(), by_day)) {
+            append(project.daily_statistics);
+        } else {
+            auto sorted = project.daily_statistics;
+            std::sort(sorted.begin(), sorted.end(), by_day);
+            append(sorted);
+        }
+
+        drop_expired_(series);
+    }
+}
+
+void StatisticsHistory::drop_expired_(StatisticsSeries &series) const {
+    if (!series.empty())
+        series.drop_before(series.last_day() - std::chrono::duration_cast<std::chrono::seconds>(retention_).count());
+}
+
+}}
@@ -0,0 +1,84 @@
+/* libui/src/statistics_history.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_STATISTICS_HISTORY_H_
+#define WOINC_UI_STATISTICS_HISTORY_H_
+
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <woinc/types.h>
+#include <woinc/ui/handler.h>
+
+#include "time_series.h"
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+// Records the daily statistics of the projects of the hosts beyond the few days the clients report.
+//
+// Registered as periodic task handler while recording, each update only appends the days
+// not older than the latest recorded one of the project, the days dropped by the clients are kept.
+// Days older than the retention, relative to the latest day of a project, are dropped block-wise.
+class WOINCUI_LOCAL StatisticsHistory : public PeriodicTaskHandler {
+    public:
+        void retention(std::chrono::hours retention);
+        std::chrono::hours retention() const;
+
+        // the days of the project within [from, to]; if there are more than max_points (and max_points isn't zero)
+        // the range is split into max_points buckets of equal length and only the last day of each bucket is returned
+        DailyStatistics query(const std::string &host, const std::string &master_url,
+                              std::time_t from, std::time_t to, std::size_t max_points) const;
+        std::vector<std::string> projects(const std::string &host) const;
+
+        std::size_t memory() const;
+
+        void remove_host(const std::string &host);
+        void clear();
+
+        // the history is written in the byte order of the host;
+        // reading replaces the history of the hosts in the stream and throws a std::runtime_error if it's invalid
+        void write(std::ostream &out) const;
+        void read(std::istream &in);
+
+    public:
+        using PeriodicTaskHandler::on_update;
+
+        // only the new days are delivered, so this costs the new days and not the length of the history
+        void on_update(const std::string &host, const woinc::Statistics &days, bool refreshed) final;
+
+    private:
+        typedef std::map<std::string, std::map<std::string, StatisticsSeries>> Hosts;
+
+        void drop_expired_(StatisticsSeries &series) const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::chrono::hours retention_{24 * 365};
+        Hosts hosts_;
+};
+
+}}
+
+#endif
@@ -0,0 +1,431 @@
+/* libui/src/time_series.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "time_series.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+#include "bits.h"
+
+namespace {
+
+// the bits of a column for a day at most, i.e. a new window of an XORed value
+constexpr std::size_t MAX_BITS_PER_DAY__ = 2 + 5 + 6 + 64;
+
+template<typename T>
+void write__(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+void read__(std::istream &in, T &value) {
+    if (!in.read(reinterpret_cast<char *>(&value), sizeof(value)))
+        throw std::runtime_error("Truncated statistics history");
+}
+
+void write__(std::ostream &out, const woinc::DailyStatistic &statistic) {
+    write__(out, statistic.day);
+    write__(out, statistic.host_expavg_credit);
+    write__(out, statistic.host_total_credit);
+    write__(out, statistic.user_expavg_credit);
+    write__(out, statistic.user_total_credit);
+}
+
+void read__(std::istream &in, woinc::DailyStatistic &statistic) {
+    read__(in, statistic.day);
+    read__(in, statistic.host_expavg_credit);
+    read__(in, statistic.host_total_credit);
+    read__(in, statistic.user_expavg_credit);
+    read__(in, statistic.user_total_credit);
+}
+
+std::uint64_t bits_of__(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double value_of__(std::uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// maps small negative and positive numbers to small unsigned ones
+std::uint64_t zigzag__(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag__(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+}
+
+namespace woinc { namespace ui {
+
+// ---- BitStream ----
+
+void BitStream::write(std::uint64_t value, unsigned int count) {
+    if (count == 0)
+        return;
+    if (count < 64)
+        value &= (std::uint64_t(1) << count) - 1;
+
+    const auto offset = bits_ % 64;
+    if (offset == 0)
+        words_.push_back(0);
+
+    const auto free = 64 - offset;
+    if (count <= free) {
+        words_.back() |= value << (free - count);
+    } else {
+        const auto rest = count - free;
+        words_.back() |= value >> rest;
+        words_.push_back(value << (64 - rest));
+    }
+
+    bits_ += count;
+}
+
+void BitStream::serialize(std::ostream &out) const {
+    write__(out, static_cast<std::uint64_t>(bits_));
+    out.write(reinterpret_cast<const char *>(words_.data()),
+              static_cast<std::streamsize>(words_.size() * sizeof(std::uint64_t)));
+}
+
+void BitStream::deserialize(std::istream &in, std::size_t max_bits) {
+    std::uint64_t bits;
+    read__(in, bits);
+    if (bits > max_bits)
+        throw std::runtime_error("Invalid statistics history");
+
+    bits_ = static_cast<std::size_t>(bits);
+    words_.resize((bits_ + 63) / 64);
+    if (!in.read(reinterpret_cast<char *>(words_.data()), static_cast<std::streamsize>(words_.size() * sizeof(std::uint64_t))))
+        throw std::runtime_error("Truncated statistics history");
+}
+
+std::uint64_t BitStream::Reader::read(unsigned int count) {
+    if (count == 0)
+        return 0;
+    if (position_ + count > stream_.bits_)
+        throw std::runtime_error("Corrupt statistics history");
+
+    const auto word = position_ / 64;
+    const auto offset = position_ % 64;
+    const auto available = 64 - offset;
+
+    std::uint64_t value;
+    if (count <= available) {
+        value = stream_.words_[word] << offset >> (64 - count);
+    } else {
+        const auto rest = count - available;
+        value = (stream_.words_[word] << offset >> offset) << rest | stream_.words_[word + 1] >> (64 - rest);
+    }
+
+    position_ += count;
+    return value;
+}
+
+// ---- StatisticsSeries ----
+
+void StatisticsSeries::append(const DailyStatistic &statistic) {
+    if (has_latest_) {
+        if (statistic.day < latest_.day)
+            return;
+        if (statistic.day > latest_.day)
+            encode_(latest_);
+    }
+
+    latest_ = statistic;
+    has_latest_ = true;
+}
+
+void StatisticsSeries::drop_before(std::time_t day) {
+    while (!blocks_.empty() && blocks_.front().last_day < day) {
+        if (blocks_.size() == 1)
+            open_block_ = false;
+        blocks_.pop_front();
+    }
+}
+
+std::time_t StatisticsSeries::first_day() const {
+    return blocks_.empty() ? latest_.day : blocks_.front().first_day;
+}
+
+std::size_t StatisticsSeries::size() const {
+    std::size_t size = has_latest_ ? 1 : 0;
+    for (const auto &block : blocks_)
+        size += block.size;
+    return size;
+}
+
+std::size_t StatisticsSeries::memory() const {
+    std::size_t memory = sizeof(*this) + blocks_.size() * sizeof(Block);
+    for (const auto &block : blocks_)
+        for (const auto &column : block.columns)
+            memory += column.memory();
+    return memory;
+}
+
+template<typename Visitor>
+void StatisticsSeries::decode_(const Block &block, Visitor visitor) {
+    std::array<BitStream::Reader, 5> columns{{
+        BitStream::Reader(block.columns[0]), BitStream::Reader(block.columns[1]), BitStream::Reader(block.columns[2]),
+        BitStream::Reader(block.columns[3]), BitStream::Reader(block.columns[4])
+    }};
+    std::array<ColumnEncoder, 5> decoders;
+
+    DailyStatistic statistic;
+    for (std::uint32_t i = 0; i < block.size; ++i) {
+        const bool first = i == 0;
+        statistic.day = decode_day_(columns[0], decoders[0], first);
+        statistic.host_expavg_credit = decode_value_(columns[1], decoders[1], first);
+        statistic.host_total_credit = decode_value_(columns[2], decoders[2], first);
+        statistic.user_expavg_credit = decode_value_(columns[3], decoders[3], first);
+        statistic.user_total_credit = decode_value_(columns[4], decoders[4], first);
+        visitor(statistic);
+    }
+}
+
+void StatisticsSeries::visit(std::time_t from, std::time_t to,
+                             const std::function<void(const DailyStatistic &)> &visitor) const {
+    if (!has_latest_ || to < from)
+        return;
+
+    // the blocks are ordered by their days, so skip the ones entirely before the range without decoding them
+    auto block = std::partition_point(blocks_.begin(), blocks_.end(), [&](const Block &b) {
+        return b.last_day < from;
+    });
+
+    for (; block != blocks_.end() && block->first_day <= to; ++block)
+        decode_(*block, [&](const DailyStatistic &statistic) {
+            if (statistic.day >= from && statistic.day <= to)
+                visitor(statistic);
+        });
+
+    if (latest_.day >= from && latest_.day <= to)
+        visitor(latest_);
+}
+
+void StatisticsSeries::serialize(std::ostream &out) const {
+    write__(out, static_cast<std::uint8_t>(has_latest_));
+    if (has_latest_)
+        write__(out, latest_);
+
+    write__(out, static_cast<std::uint64_t>(blocks_.size()));
+    for (const auto &block : blocks_) {
+        write__(out, block.first_day);
+        write__(out, block.last_day);
+        write__(out, block.size);
+        for (const auto &column : block.columns)
+            column.serialize(out);
+    }
+}
+
+void StatisticsSeries::deserialize(std::istream &in) {
+    blocks_.clear();
+    open_block_ = false;
+
+    std::uint8_t has_latest;
+    read__(in, has_latest);
+    if (has_latest > 1)
+        throw std::runtime_error("Invalid statistics history");
+    has_latest_ = has_latest != 0;
+    if (has_latest_)
+        read__(in, latest_);
+
+    std::uint64_t blocks;
+    read__(in, blocks);
+
+    for (; blocks > 0; --blocks) {
+        Block block;
+        read__(in, block.first_day);
+        read__(in, block.last_day);
+        read__(in, block.size);
+
+        if (block.size == 0 || block.size > BlockSize || block.first_day > block.last_day)
+            throw std::runtime_error("Invalid statistics history");
+
+        for (auto &column : block.columns)
+            column.deserialize(in, block.size * MAX_BITS_PER_DAY__);
+
+        if (!blocks_.empty() && block.first_day <= blocks_.back().last_day)
+            throw std::runtime_error("Invalid statistics history");
+
+        // decode the block once, so a corrupt one isn't noticed when querying it
+        std::time_t last = block.first_day;
+        bool first = true;
+        decode_(block, [&](const DailyStatistic &statistic) {
+            if (first ? statistic.day != last : statistic.day <= last)
+                throw std::runtime_error("Invalid statistics history");
+            last = statistic.day;
+            first = false;
+        });
+        if (last != block.last_day)
+            throw std::runtime_error("Invalid statistics history");
+
+        blocks_.push_back(std::move(block));
+    }
+
+    if (!blocks_.empty() && (!has_latest_ || latest_.day <= blocks_.back().last_day))
+        throw std::runtime_error("Invalid statistics history");
+}
+
+void StatisticsSeries::encode_(const DailyStatistic &statistic) {
+    if (!open_block_) {
+        blocks_.emplace_back();
+        blocks_.back().first_day = statistic.day;
+        open_block_ = true;
+    }
+
+    auto &block = blocks_.back();
+    const bool first = block.size == 0;
+
+    encode_day_(block.columns[0], encoders_[0], statistic.day, first);
+    encode_value_(block.columns[1], encoders_[1], statistic.host_expavg_credit, first);
+    encode_value_(block.columns[2], encoders_[2], statistic.host_total_credit, first);
+    encode_value_(block.columns[3], encoders_[3], statistic.user_expavg_credit, first);
+    encode_value_(block.columns[4], encoders_[4], statistic.user_total_credit, first);
+
+    block.last_day = statistic.day;
+
+    if (++block.size == BlockSize) {
+        for (auto &column : block.columns)
+            column.shrink_to_fit();
+        open_block_ = false;
+    }
+}
+
+// the first day of a block is stored as is, the following ones as the difference of their deltas:
+// 0 for the same delta, 10 and 20 bits for up to about six days more or less, otherwise 11 and 64 bits
+
+void StatisticsSeries::encode_day_(BitStream &column, ColumnEncoder &encoder, std::time_t day, bool first) {
+    const auto value = static_cast<std::int64_t>(day);
+
+    if (first) {
+        column.write(static_cast<std::uint64_t>(value), 64);
+        encoder.previous_delta = 0;
+    } else {
+        const auto delta = static_cast<std::int64_t>(static_cast<std::uint64_t>(value) - encoder.previous);
+        const auto encoded = zigzag__(static_cast<std::int64_t>(static_cast<std::uint64_t>(delta)
+                                                                - static_cast<std::uint64_t>(encoder.previous_delta)));
+
+        if (encoded == 0) {
+            column.write(0, 1);
+        } else if (encoded < (std::uint64_t(1) << 20)) {
+            column.write(0b10, 2);
+            column.write(encoded, 20);
+        } else {
+            column.write(0b11, 2);
+            column.write(encoded, 64);
+        }
+
+        encoder.previous_delta = delta;
+    }
+
+    encoder.previous = static_cast<std::uint64_t>(value);
+}
+
+std::time_t StatisticsSeries::decode_day_(BitStream::Reader &column, ColumnEncoder &decoder, bool first) {
+    std::int64_t value;
+
+    if (first) {
+        value = static_cast<std::int64_t>(column.read(64));
+        decoder.previous_delta = 0;
+    } else {
+        std::int64_t delta_of_delta = 0;
+        if (column.read(1) != 0)
+            delta_of_delta = unzigzag__(column.read(column.read(1) == 0 ? 20 : 64));
+
+        // wraps around like the encoding instead of overflowing on corrupt data
+        decoder.previous_delta = static_cast<std::int64_t>(static_cast<std::uint64_t>(decoder.previous_delta)
+                                                           + static_cast<std::uint64_t>(delta_of_delta));
+        value = static_cast<std::int64_t>(decoder.previous + static_cast<std::uint64_t>(decoder.previous_delta));
+    }
+
+    decoder.previous = static_cast<std::uint64_t>(value);
+    return static_cast<std::time_t>(value);
+}
+
+// the credits are XORed with the previous value: 0 for the same value, 10 and the meaningful bits
+// if they fit into the window of the previous value, otherwise 11, the leading zeros, the length and the bits
+
+void StatisticsSeries::encode_value_(BitStream &column, ColumnEncoder &encoder, double value, bool first) {
+    const auto bits = bits_of__(value);
+
+    if (first) {
+        column.write(bits, 64);
+        encoder.leading = 0;
+        encoder.meaningful = 0;
+    } else {
+        const auto xored = bits ^ encoder.previous;
+
+        if (xored == 0) {
+            column.write(0, 1);
+        } else {
+            const auto leading = std::min(leading_zeros(xored), 31u);
+            const auto trailing = trailing_zeros(xored);
+
+            if (encoder.meaningful != 0
+                    && leading >= encoder.leading
+                    && trailing >= 64 - encoder.leading - encoder.meaningful) {
+                column.write(0b10, 2);
+                column.write(xored >> (64 - encoder.leading - encoder.meaningful), encoder.meaningful);
+            } else {
+                encoder.leading = leading;
+                encoder.meaningful = 64 - leading - trailing;
+                column.write(0b11, 2);
+                column.write(leading, 5);
+                column.write(encoder.meaningful - 1, 6);
+                column.write(xored >> trailing, encoder.meaningful);
+            }
+        }
+    }
+
+    encoder.previous = bits;
+}
+
+double StatisticsSeries::decode_value_(BitStream::Reader &column, ColumnEncoder &decoder, bool first) {
+    if (first) {
+        decoder.previous = column.read(64);
+        decoder.leading = 0;
+        decoder.meaningful = 0;
+    } else if (column.read(1) != 0) {
+        if (column.read(1) != 0) {
+            decoder.leading = static_cast<unsigned int>(column.read(5));
+            decoder.meaningful = static_cast<unsigned int>(column.read(6)) + 1;
+        } else if (decoder.meaningful == 0) {
+            throw std::runtime_error("Corrupt statistics history");
+        }
+
+        if (decoder.leading + decoder.meaningful > 64)
+            throw std::runtime_error("Corrupt statistics history");
+
+        decoder.previous ^= column.read(decoder.meaningful) << (64 - decoder.leading - decoder.meaningful);
+    }
+
+    return value_of__(decoder.previous);
+}
+
+}}
@@ -0,0 +1,137 @@
+/* libui/src/time_series.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_TIME_SERIES_H_
+#define WOINC_UI_TIME_SERIES_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <iosfwd>
+#include <vector>
+
+#include <woinc/types.h>
+
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+// An append-only sequence of bits, written and read starting with the most significant bit of each value
+class WOINCUI_LOCAL BitStream {
+    public:
+        // appends the lowest count bits of the value, count must be at most 64
+        void write(std::uint64_t value, unsigned int count);
+
+        std::size_t bits() const { return bits_; }
+        std::size_t memory() const { return words_.capacity() * sizeof(std::uint64_t); }
+
+        void shrink_to_fit() { words_.shrink_to_fit(); }
+
+        void serialize(std::ostream &out) const;
+        // throws a std::runtime_error if the stream is invalid or longer than max_bits
+        void deserialize(std::istream &in, std::size_t max_bits);
+
+        // throws a std::runtime_error when reading beyond the end of the stream
+        class Reader {
+            public:
+                explicit Reader(const BitStream &stream) : stream_(stream) {}
+
+                std::uint64_t read(unsigned int count);
+
+            private:
+                const BitStream &stream_;
+                std::size_t position_ = 0;
+        };
+
+    private:
+        std::vector<std::uint64_t> words_;
+        std::size_t bits_ = 0;
+};
+
+// The daily statistics of a project of a host, compressed in columns of blocks of BlockSize days.
+//
+// The days are encoded as delta of deltas, which is a single bit for consecutive days,
+// and the credits by XORing them with the preceding value of their column like in Facebook's Gorilla,
+// which takes a few bits only for the slowly changing values. A block is decoded as a whole,
+// so a range query only decodes the blocks overlapping the range.
+// The latest day is kept uncompressed, because the clients update its values until the day is over.
+class WOINCUI_LOCAL StatisticsSeries {
+    public:
+        static constexpr std::size_t BlockSize = 128;
+
+        // replaces the latest day if it's the same, older days are ignored
+        void append(const DailyStatistic &statistic);
+
+        // drops the blocks which only contain days before the given one
+        void drop_before(std::time_t day);
+
+        bool empty() const { return !has_latest_; }
+        std::time_t first_day() const;
+        std::time_t last_day() const { return latest_.day; }
+        std::size_t size() const;
+        std::size_t memory() const;
+
+        // calls the visitor with the days within [from, to] in order
+        void visit(std::time_t from, std::time_t to, const std::function<void(const DailyStatistic &)> &visitor) const;
+
+        // the open block is sealed when deserializing, so appending afterwards starts a new block
+        void serialize(std::ostream &out) const;
+        void deserialize(std::istream &in);
+
+    private:
+        // the state of the encoder of a column, only needed for the open block
+        struct ColumnEncoder {
+            std::uint64_t previous = 0;
+            std::int64_t previous_delta = 0;
+            unsigned int leading = 0;
+            unsigned int meaningful = 0;
+        };
+
+        struct Block {
+            std::time_t first_day = 0;
+            std::time_t last_day = 0;
+            std::uint32_t size = 0;
+            // the days and the host expavg, host total, user expavg and user total credits
+            std::array<BitStream, 5> columns;
+        };
+
+        void encode_(const DailyStatistic &statistic);
+
+        template<typename Visitor>
+        static void decode_(const Block &block, Visitor visitor);
+
+        static void encode_day_(BitStream &column, ColumnEncoder &encoder, std::time_t day, bool first);
+        static void encode_value_(BitStream &column, ColumnEncoder &encoder, double value, bool first);
+        static std::time_t decode_day_(BitStream::Reader &column, ColumnEncoder &decoder, bool first);
+        static double decode_value_(BitStream::Reader &column, ColumnEncoder &decoder, bool first);
+
+    private:
+        std::deque<Block> blocks_;
+        std::array<ColumnEncoder, 5> encoders_;
+        bool open_block_ = false;
+
+        DailyStatistic latest_{};
+        bool has_latest_ = false;
+};
+
+}}
+
+#endif
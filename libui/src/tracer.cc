@@ -0,0 +1,382 @@
+/* libui/src/tracer.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "tracer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+
+#define WOINC_LOCK_GUARD std::lock_guard<decltype(mutex_)> guard(mutex_)
+
+namespace {
+
+std::atomic<std::uint64_t> tracer_serials__{0};
+
+constexpr std::size_t DEFAULT_CAPACITY__ = 4096;
+
+// the words of an event
+enum : std::size_t {
+    BEGIN,
+    DURATION,
+    NAME,
+    HOST_AND_PHASE,
+    SUBJECT,
+    ARG_NAME,
+    ARG,
+    WORDS
+};
+
+template<typename T>
+std::uint64_t as_word__(T *pointer) {
+    return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(pointer));
+}
+
+const char *as_string__(std::uint64_t word) {
+    return reinterpret_cast<const char *>(static_cast<std::uintptr_t>(word));
+}
+
+void write_string__(std::ostream &out, const char *str) {
+    out << '"';
+    for (; *str != '\0'; ++str) {
+        const auto c = static_cast<unsigned char>(*str);
+        if (c == '"' || c == '\\')
+            out << '\\' << *str;
+        else if (c < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        else
+            out << *str;
+    }
+    out << '"';
+}
+
+// the trace event format expects microseconds
+void write_micros__(std::ostream &out, std::uint64_t nanoseconds) {
+    out << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000;
+}
+
+}
+
+namespace woinc { namespace ui {
+
+const char *trace_name(PeriodicTask task) {
+    switch (task) {
+        case PeriodicTask::GetCCStatus:      return "get_cc_status";
+        case PeriodicTask::GetClientState:   return "get_state";
+        case PeriodicTask::GetDiskUsage:     return "get_disk_usage";
+        case PeriodicTask::GetFileTransfers: return "get_file_transfers";
+        case PeriodicTask::GetMessages:      return "get_messages";
+        case PeriodicTask::GetNotices:       return "get_notices";
+        case PeriodicTask::GetProjectStatus: return "get_project_status";
+        case PeriodicTask::GetStatistics:    return "get_statistics";
+        case PeriodicTask::GetTasks:         return "get_results";
+    }
+    assert(false);
+    return "";
+}
+
+// ---- Tracer::Buffer ----
+
+struct WOINCUI_LOCAL Tracer::Buffer {
+    struct Event {
+        // odd while the event is written, 2 * (n + 1) once the n-th event of the buffer is complete
+        std::atomic<std::uint64_t> sequence{0};
+        std::atomic<std::uint64_t> words[WORDS];
+    };
+
+    Buffer(std::size_t c, std::uint32_t t) : events(new Event[c]), capacity(c), tid(t) {}
+
+    const std::unique_ptr<Event[]> events;
+    const std::size_t capacity;
+    const std::uint32_t tid;
+
+    // the number of events written so far, only written by the owning thread
+    std::atomic<std::uint64_t> head{0};
+    // the events before were cleared
+    std::atomic<std::uint64_t> first{0};
+    // the owning thread has exited, so the buffer may be handed over to a new one
+    std::atomic<bool> retired{false};
+
+    std::mutex name_mutex;
+    std::string name;
+};
+
+// the buffer of the tracer the thread recorded to last
+struct WOINCUI_LOCAL Tracer::ThreadCache {
+    ~ThreadCache() {
+        if (buffer)
+            buffer->retired.store(true, std::memory_order_release);
+    }
+
+    std::uint64_t tracer = 0;
+    std::shared_ptr<Buffer> buffer;
+    std::string name;
+};
+
+// ---- Tracer ----
+
+Tracer::Tracer()
+    : serial_(++tracer_serials__)
+    , epoch_(std::chrono::steady_clock::now())
+    , enabled_(false)
+    , capacity_(DEFAULT_CAPACITY__)
+    , host_names_(1)
+{}
+
+Tracer::~Tracer() = default;
+
+void Tracer::enabled(bool value) {
+    enabled_.store(value);
+}
+
+void Tracer::capacity(std::size_t events) {
+    capacity_.store(std::max<std::size_t>(events, 1));
+}
+
+std::size_t Tracer::capacity() const {
+    return capacity_.load();
+}
+
+Tracer::HostId Tracer::host_id(const std::string &host) {
+    WOINC_LOCK_GUARD;
+
+    auto iter = host_ids_.find(host);
+    if (iter != host_ids_.end())
+        return iter->second;
+
+    auto id = static_cast<HostId>(host_names_.size());
+    host_names_.push_back(host);
+    host_ids_.emplace(host, id);
+    return id;
+}
+
+Tracer::ThreadCache &Tracer::thread_cache_() {
+    thread_local ThreadCache cache;
+    return cache;
+}
+
+void Tracer::thread_name(std::string name) {
+    auto &cache = thread_cache_();
+
+    if (cache.buffer) {
+        std::lock_guard<decltype(cache.buffer->name_mutex)> guard(cache.buffer->name_mutex);
+        cache.buffer->name = name;
+    }
+
+    cache.name = std::move(name);
+}
+
+void Tracer::complete(const char *name, HostId host, const char *subject, TimePoint begin, TimePoint end,
+                      const char *arg_name, std::uint64_t arg) {
+    if (enabled())
+        record_('X', name, host, subject, begin, end, arg_name, arg);
+}
+
+void Tracer::instant(const char *name, HostId host, const char *subject, TimePoint time,
+                     const char *arg_name, std::uint64_t arg) {
+    if (enabled())
+        record_('i', name, host, subject, time, time, arg_name, arg);
+}
+
+Tracer::Buffer &Tracer::buffer_() {
+    auto &cache = thread_cache_();
+
+    if (cache.tracer == serial_)
+        return *cache.buffer;
+
+    WOINC_LOCK_GUARD;
+
+    const auto thread = std::this_thread::get_id();
+    std::shared_ptr<Buffer> buffer;
+
+    // known if the thread switched between tracers or got the id of an exited thread
+    auto known = threads_.find(thread);
+    if (known != threads_.end()) {
+        buffer = known->second;
+    } else {
+        auto retired = std::find_if(buffers_.begin(), buffers_.end(), [](const auto &b) {
+            return b->retired.load(std::memory_order_acquire);
+        });
+
+        if (retired != buffers_.end()) {
+            buffer = *retired;
+            for (auto iter = threads_.begin(); iter != threads_.end(); ++iter) {
+                if (iter->second == buffer) {
+                    threads_.erase(iter);
+                    break;
+                }
+            }
+        } else {
+            buffer = std::make_shared<Buffer>(capacity_.load(), static_cast<std::uint32_t>(buffers_.size() + 1));
+            buffers_.push_back(buffer);
+        }
+
+        threads_.emplace(thread, buffer);
+    }
+
+    if (buffer->retired.load(std::memory_order_acquire)) {
+        // hide the events of the previous thread instead of attributing them to this one
+        buffer->first.store(buffer->head.load());
+        buffer->retired.store(false);
+    }
+
+    {
+        std::lock_guard<decltype(buffer->name_mutex)> name_guard(buffer->name_mutex);
+        buffer->name = cache.name;
+    }
+
+    cache.tracer = serial_;
+    cache.buffer = std::move(buffer);
+
+    return *cache.buffer;
+}
+
+void Tracer::record_(char phase, const char *name, HostId host, const char *subject,
+                     TimePoint begin, TimePoint end, const char *arg_name, std::uint64_t arg) {
+    auto &buffer = buffer_();
+
+    const auto n = buffer.head.load(std::memory_order_relaxed);
+    auto &event = buffer.events[n % buffer.capacity];
+
+    begin = std::max(begin, epoch_);
+    end = std::max(end, begin);
+
+    event.sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto &words = event.words;
+    words[BEGIN].store(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        begin - epoch_).count()), std::memory_order_relaxed);
+    words[DURATION].store(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        end - begin).count()), std::memory_order_relaxed);
+    words[NAME].store(as_word__(name), std::memory_order_relaxed);
+    words[HOST_AND_PHASE].store(static_cast<std::uint64_t>(host) | static_cast<std::uint64_t>(phase) << 32,
+                                std::memory_order_relaxed);
+    words[SUBJECT].store(as_word__(subject), std::memory_order_relaxed);
+    words[ARG_NAME].store(as_word__(arg_name), std::memory_order_relaxed);
+    words[ARG].store(arg, std::memory_order_relaxed);
+
+    event.sequence.store(2 * n + 2, std::memory_order_release);
+    buffer.head.store(n + 1, std::memory_order_release);
+}
+
+void Tracer::write(std::ostream &out) const {
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    std::vector<std::string> host_names;
+    {
+        WOINC_LOCK_GUARD;
+        buffers = buffers_;
+        host_names = host_names_;
+    }
+
+    const auto fill = out.fill();
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first_event = true;
+    auto separate = [&]() {
+        if (!first_event)
+            out << ",\n";
+        first_event = false;
+    };
+
+    for (const auto &buffer : buffers) {
+        std::string name;
+        {
+            std::lock_guard<decltype(buffer->name_mutex)> guard(buffer->name_mutex);
+            name = buffer->name;
+        }
+
+        if (!name.empty()) {
+            separate();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+            write_string__(out, name.c_str());
+            out << "}}";
+        }
+
+        const auto head = buffer->head.load(std::memory_order_acquire);
+        auto n = std::max(buffer->first.load(), head > buffer->capacity ? head - buffer->capacity : 0);
+
+        for (; n < head; ++n) {
+            const auto &event = buffer->events[n % buffer->capacity];
+
+            const auto sequence = event.sequence.load(std::memory_order_acquire);
+            if (sequence != 2 * n + 2)
+                continue;
+
+            std::uint64_t words[WORDS];
+            for (std::size_t i = 0; i < WORDS; ++i)
+                words[i] = event.words[i].load(std::memory_order_relaxed);
+
+            // skip the event if the writer wrapped around and overwrote it meanwhile
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event.sequence.load(std::memory_order_relaxed) != sequence)
+                continue;
+
+            const auto host = static_cast<HostId>(words[HOST_AND_PHASE] & 0xFFFFFFFF);
+            const auto phase = static_cast<char>(words[HOST_AND_PHASE] >> 32);
+
+            separate();
+            out << "{\"name\":";
+            write_string__(out, as_string__(words[NAME]));
+            out << ",\"cat\":\"woinc\",\"ph\":\"" << phase << "\",\"ts\":";
+            write_micros__(out, words[BEGIN]);
+            if (phase == 'X') {
+                out << ",\"dur\":";
+                write_micros__(out, words[DURATION]);
+            } else {
+                out << ",\"s\":\"t\"";
+            }
+            out << ",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{";
+
+            bool first_arg = true;
+            auto arg = [&](const char *key) {
+                if (!first_arg)
+                    out << ',';
+                first_arg = false;
+                out << '"' << key << "\":";
+            };
+
+            if (host != NoHost && host < host_names.size()) {
+                arg("host");
+                write_string__(out, host_names[host].c_str());
+            }
+            if (words[SUBJECT] != 0) {
+                arg("subject");
+                write_string__(out, as_string__(words[SUBJECT]));
+            }
+            if (words[ARG_NAME] != 0) {
+                arg(as_string__(words[ARG_NAME]));
+                out << words[ARG];
+            }
+
+            out << "}}";
+        }
+    }
+
+    out << "]}\n";
+    out.fill(fill);
+}
+
+void Tracer::clear() {
+    WOINC_LOCK_GUARD;
+    for (auto &buffer : buffers_)
+        buffer->first.store(buffer->head.load());
+}
+
+}}
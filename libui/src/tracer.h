@@ -0,0 +1,116 @@
+/* libui/src/tracer.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_TRACER_H_
+#define WOINC_UI_TRACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <woinc/ui/defs.h>
+
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+// the name of the rpc of the task, used as the subject of its trace events
+WOINCUI_LOCAL const char *trace_name(PeriodicTask task);
+
+// Records the steps of the jobs as spans into a ring buffer per thread and writes them as Chrome trace events,
+// which can be loaded into chrome://tracing or https://ui.perfetto.dev.
+//
+// Recording is wait-free: each thread only writes into its own buffer and the readers detect events
+// overwritten while reading them by a sequence number per event. A disabled tracer only costs the check
+// of the flag. The buffers are allocated when a thread records its first event, the buffer of an exited
+// thread is reused by the next new thread. The names and subjects of the events have to be string literals.
+class WOINCUI_LOCAL Tracer {
+    public:
+        typedef std::chrono::steady_clock::time_point TimePoint;
+        typedef std::uint32_t HostId;
+
+        static constexpr HostId NoHost = 0;
+
+        Tracer();
+        ~Tracer();
+
+        Tracer(const Tracer &) = delete;
+        Tracer(Tracer &&) = delete;
+        Tracer &operator=(const Tracer &) = delete;
+        Tracer &operator=(Tracer &&) = delete;
+
+        void enabled(bool value);
+        bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+        // the number of events kept per thread, applies to buffers allocated afterwards
+        void capacity(std::size_t events);
+        std::size_t capacity() const;
+
+        // the ids of the hosts are never released, so they stay valid for the events of removed hosts
+        HostId host_id(const std::string &host);
+
+        // names the calling thread in the trace, e.g. after the host its worker is serving
+        static void thread_name(std::string name);
+
+        // a span from begin to end; the argument is only written if it has a name
+        void complete(const char *name, HostId host, const char *subject, TimePoint begin, TimePoint end,
+                      const char *arg_name = nullptr, std::uint64_t arg = 0);
+        // a point in time
+        void instant(const char *name, HostId host, const char *subject, TimePoint time,
+                     const char *arg_name = nullptr, std::uint64_t arg = 0);
+
+        // writes the recorded events as a JSON object in the Chrome trace event format
+        void write(std::ostream &out) const;
+        void clear();
+
+    private:
+        struct Buffer;
+        struct ThreadCache;
+
+        static ThreadCache &thread_cache_();
+
+        Buffer &buffer_();
+        void record_(char phase, const char *name, HostId host, const char *subject,
+                     TimePoint begin, TimePoint end, const char *arg_name, std::uint64_t arg);
+
+    private:
+        // identifies the tracer in the thread local caches, the address may be reused by a later tracer
+        const std::uint64_t serial_;
+        const TimePoint epoch_;
+
+        std::atomic<bool> enabled_;
+        std::atomic<std::size_t> capacity_;
+
+        mutable std::mutex mutex_;
+        std::vector<std::shared_ptr<Buffer>> buffers_;
+        std::unordered_map<std::thread::id, std::shared_ptr<Buffer>> threads_;
+        std::unordered_map<std::string, HostId> host_ids_;
+        std::vector<std::string> host_names_;
+};
+
+}}
+
+#endif
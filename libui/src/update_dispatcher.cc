@@ -0,0 +1,485 @@
+/* libui/src/update_dispatcher.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "update_dispatcher.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iterator>
+#include <utility>
+
+#define WOINC_LOCK_GUARD std::lock_guard<decltype(mutex_)> guard(mutex_)
+
+namespace {
+
+template<typename Container>
+void append__(Container &dest, Container &src) {
+    dest.insert(dest.end(), std::make_move_iterator(src.begin()), std::make_move_iterator(src.end()));
+}
+
+bool same_day__(const woinc::DailyStatistic &a, const woinc::DailyStatistic &b) {
+    return a.day == b.day
+        && a.host_expavg_credit == b.host_expavg_credit
+        && a.host_total_credit == b.host_total_credit
+        && a.user_expavg_credit == b.user_expavg_credit
+        && a.user_total_credit == b.user_total_credit;
+}
+
+// Reduces the days of each project to the ones which are new or changed compared to the known statistics
+// and returns whether there are any or the projects changed; days the client still reports are usually unchanged.
+bool reduce_to_new_days__(const woinc::Statistics &known, woinc::Statistics &days) {
+    bool changed = known.size() != days.size();
+
+    for (std::size_t i = 0; i < days.size(); ++i) {
+        auto &project = days[i];
+
+        // the client keeps the order of the projects
+        const woinc::ProjectStatistics *known_project = nullptr;
+        if (i < known.size() && known[i].master_url == project.master_url) {
+            known_project = &known[i];
+        } else {
+            auto iter = std::find_if(known.begin(), known.end(), [&](const woinc::ProjectStatistics &p) {
+                return p.master_url == project.master_url;
+            });
+            if (iter != known.end())
+                known_project = &*iter;
+            changed = true;
+        }
+
+        if (known_project == nullptr)
+            continue;
+
+        // the resent days are the latest known ones, so search them from the back
+        const auto &known_days = known_project->daily_statistics;
+        auto &new_days = project.daily_statistics;
+        new_days.erase(std::remove_if(new_days.begin(), new_days.end(), [&](const woinc::DailyStatistic &day) {
+            auto known_day = std::find_if(known_days.rbegin(), known_days.rend(), [&](const woinc::DailyStatistic &d) {
+                return d.day <= day.day;
+            });
+            return known_day != known_days.rend() && same_day__(*known_day, day);
+        }), new_days.end());
+
+        changed = changed || !new_days.empty();
+    }
+
+    return changed;
+}
+
+// Copies the known days of each project in days, drops the ones before the first day still reported by the client
+// and appends the new days, replacing the known ones of the same day. Projects not in days are dropped.
+woinc::Statistics append_days__(const woinc::Statistics &known, const woinc::Statistics &days,
+                                const std::vector<std::time_t> &first_days) {
+    woinc::Statistics statistics;
+    statistics.reserve(days.size());
+
+    for (std::size_t i = 0; i < days.size(); ++i) {
+        const auto &project = days[i];
+
+        auto known_project = i < known.size() && known[i].master_url == project.master_url
+            ? known.begin() + static_cast<std::ptrdiff_t>(i)
+            : std::find_if(known.begin(), known.end(), [&](const woinc::ProjectStatistics &p) {
+                  return p.master_url == project.master_url;
+              });
+
+        if (known_project == known.end()) {
+            statistics.push_back(project);
+            continue;
+        }
+
+        statistics.push_back(*known_project);
+        auto &dest = statistics.back().daily_statistics;
+
+        if (i < first_days.size()) {
+            const auto first_day = first_days[i];
+            dest.erase(dest.begin(), std::find_if(dest.begin(), dest.end(), [&](const woinc::DailyStatistic &d) {
+                return d.day >= first_day;
+            }));
+        }
+
+        for (const auto &day : project.daily_statistics) {
+            if (dest.empty() || dest.back().day < day.day) {
+                dest.push_back(day);
+            } else {
+                auto position = std::lower_bound(dest.begin(), dest.end(), day,
+                                                 [](const woinc::DailyStatistic &a, const woinc::DailyStatistic &b) {
+                    return a.day < b.day;
+                });
+                if (position != dest.end() && position->day == day.day)
+                    *position = day;
+                else
+                    dest.insert(position, day);
+            }
+        }
+    }
+
+    return statistics;
+}
+
+}
+
+namespace woinc { namespace ui {
+
+UpdateDispatcher::UpdateDispatcher(const HandlerRegistry &handler_registry,
+                                   SnapshotStore &snapshots,
+                                   Tracer &tracer)
+    : handler_registry_(handler_registry), snapshots_(snapshots), tracer_(tracer)
+{}
+
+UpdateDispatcher::~UpdateDispatcher() {
+    shutdown();
+}
+
+void UpdateDispatcher::mode(DispatchMode mode) {
+    WOINC_LOCK_GUARD;
+
+    mode_ = mode;
+
+    // the thread keeps running when switching back to the direct mode to deliver the pending updates
+    if (mode_ == DispatchMode::Coalesced && !shutdown_ && !thread_.joinable())
+        thread_ = std::thread([this]() {
+            Tracer::thread_name("update dispatcher");
+            run_();
+        });
+}
+
+DispatchMode UpdateDispatcher::mode() const {
+    WOINC_LOCK_GUARD;
+    return mode_;
+}
+
+void UpdateDispatcher::add_host(const std::string &host, HostMetricsRecorderPtr metrics) {
+    Host known_host;
+    known_host.trace_host = tracer_.host_id(host);
+    known_host.metrics = std::move(metrics);
+
+    WOINC_LOCK_GUARD;
+    hosts_[host] = std::move(known_host);
+}
+
+void UpdateDispatcher::remove_host(const std::string &host) {
+    std::unique_lock<decltype(mutex_)> lock(mutex_);
+
+    hosts_.erase(host);
+    updates_.erase(host);
+    dirty_hosts_.erase(std::remove(dirty_hosts_.begin(), dirty_hosts_.end(), host), dirty_hosts_.end());
+
+    delivered_condition_.wait(lock, [&]() { return delivering_host_ != host; });
+}
+
+void UpdateDispatcher::shutdown() {
+    {
+        WOINC_LOCK_GUARD;
+        shutdown_ = true;
+    }
+
+    condition_.notify_all();
+
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void UpdateDispatcher::dispatch(const std::string &host, TimePoint due, CCStatus &cc_status) {
+    replace_(host, PeriodicTask::GetCCStatus, due, cc_status, &PendingUpdates::cc_status);
+}
+
+void UpdateDispatcher::dispatch(const std::string &host, TimePoint due, ClientState &client_state) {
+    replace_(host, PeriodicTask::GetClientState, due, client_state, &PendingUpdates::client_state);
+}
+
+void UpdateDispatcher::dispatch(const std::string &host, TimePoint due, DiskUsage &disk_usage) {
+    replace_(host, PeriodicTask::GetDiskUsage, due, disk_usage, &PendingUpdates::disk_usage);
+}
+
+void UpdateDispatcher::dispatch(const std::string &host, TimePoint due, FileTransfers &file_transfers) {
+    replace_(host, PeriodicTask::GetFileTransfers, due, file_transfers, &PendingUpdates::file_transfers);
+}
+
+void UpdateDispatcher::dispatch(const std::string &host, TimePoint due, Messages &messages) {
+    // messages are fetched incrementally, so we can't drop pending ones
+    Host known_host;
+    bool deliver = store_(host, PeriodicTask::GetMessages, due, [&](PendingUpdates &updates, bool pending) {
+        if (pending)
+            append__(updates.messages, messages);
+        else
+            std::swap(updates.messages, messages);
+    }, known_host);
+
+    if (deliver)
+        notify_(host, known_host, PeriodicTask::GetMessages, due, [&](PeriodicTaskHandler &handler) {
+            handler.on_update(host, messages);
+        });
+}
+
+void UpdateDispatcher::dispatch(const std::string &host, TimePoint due, Notices &notices, bool refreshed) {
+    // notices are fetched incrementally as well unless the client sent a refreshed list
+    Host known_host;
+    bool deliver = store_(host, PeriodicTask::GetNotices, due, [&](PendingUpdates &updates, bool pending) {
+        if (pending && !refreshed) {
+            append__(updates.notices, notices);
+        } else {
+            std::swap(updates.notices, notices);
+            updates.notices_refreshed = refreshed;
+        }
+    }, known_host);
+
+    if (deliver)
+        notify_(host, known_host, PeriodicTask::GetNotices, due, [&](PeriodicTaskHandler &handler) {
+            handler.on_update(host, notices, refreshed);
+        });
+}
+
+void UpdateDispatcher::dispatch(const std::string &host, TimePoint due, Projects &projects) {
+    replace_(host, PeriodicTask::GetProjectStatus, due, projects, &PendingUpdates::projects);
+}
+
+void UpdateDispatcher::dispatch(const std::string &host, TimePoint due, Statistics &days,
+                                const std::vector<std::time_t> &first_days, bool refreshed) {
+    // only the worker of the host dispatches its statistics, so the snapshot can't change meanwhile
+    auto known = snapshots_.statistics(host);
+
+    Statistics statistics;
+    if (refreshed || !known) {
+        statistics = days;
+    } else if (reduce_to_new_days__(known->value, days)) {
+        statistics = append_days__(known->value, days, first_days);
+    } else {
+        // like an unchanged reply, the days the client dropped meanwhile are dropped along with the next new ones
+        snapshots_.refresh(host, PeriodicTask::GetStatistics);
+        return;
+    }
+
+    snapshots_.publish(host, statistics);
+    dispatch_statistics_(host, due, statistics, days, refreshed);
+}
+
+void UpdateDispatcher::dispatch(const std::string &host, TimePoint due, Tasks &tasks) {
+    replace_(host, PeriodicTask::GetTasks, due, tasks, &PendingUpdates::tasks);
+}
+
+void UpdateDispatcher::unchanged(const std::string &host, PeriodicTask task) {
+    snapshots_.refresh(host, task);
+}
+
+void UpdateDispatcher::restore(const std::string &host, const SnapshotPtr<ClientState> &client_state) {
+    restore_(host, PeriodicTask::GetClientState, client_state, &PendingUpdates::client_state);
+}
+
+void UpdateDispatcher::restore(const std::string &host, const SnapshotPtr<Projects> &projects) {
+    restore_(host, PeriodicTask::GetProjectStatus, projects, &PendingUpdates::projects);
+}
+
+void UpdateDispatcher::restore(const std::string &host, const SnapshotPtr<Statistics> &statistics) {
+    if (!snapshots_.restore(host, statistics))
+        return;
+
+    auto restored = statistics->value;
+    auto days = statistics->value;
+    dispatch_statistics_(host, TimePoint(), restored, days, true);
+}
+
+void UpdateDispatcher::restore(const std::string &host, const SnapshotPtr<Tasks> &tasks) {
+    restore_(host, PeriodicTask::GetTasks, tasks, &PendingUpdates::tasks);
+}
+
+template<typename Store>
+bool UpdateDispatcher::store_(const std::string &host, PeriodicTask task, TimePoint due, Store store,
+                              Host &known_host) {
+    const auto index = static_cast<size_t>(task);
+
+    {
+        WOINC_LOCK_GUARD;
+
+        // the host may have been removed meanwhile
+        auto known = hosts_.find(host);
+        if (known != hosts_.end())
+            known_host = known->second;
+
+        if (shutdown_)
+            return mode_ == DispatchMode::Direct;
+
+        auto updates = updates_.find(host);
+
+        // even in the direct mode we have to queue the update as long as older ones
+        // of this host aren't delivered yet, otherwise the handlers would receive them out of order
+        if (mode_ == DispatchMode::Direct
+                && delivering_host_ != host
+                && (updates == updates_.end() || updates->second.pending.none()))
+            return true;
+
+        if (updates == updates_.end())
+            updates = updates_.emplace(host, PendingUpdates()).first;
+
+        auto &pending = updates->second.pending;
+
+        if (pending.none())
+            dirty_hosts_.push_back(host);
+
+        // the latency of coalesced updates is measured from the oldest one
+        if (!pending.test(index))
+            updates->second.due[index] = due;
+
+        store(updates->second, pending.test(index));
+        pending.set(index);
+    }
+
+    condition_.notify_one();
+
+    return false;
+}
+
+template<typename Entity>
+void UpdateDispatcher::replace_(const std::string &host, PeriodicTask task, TimePoint due, Entity &entity,
+                                Entity PendingUpdates::*slot) {
+    snapshots_.publish(host, entity);
+    dispatch_(host, task, due, entity, slot);
+}
+
+template<typename Entity>
+void UpdateDispatcher::restore_(const std::string &host, PeriodicTask task, const SnapshotPtr<Entity> &snapshot,
+                                Entity PendingUpdates::*slot) {
+    if (!snapshots_.restore(host, snapshot))
+        return;
+
+    // the dispatching may take over the entity
+    auto entity = snapshot->value;
+    dispatch_(host, task, TimePoint(), entity, slot);
+}
+
+template<typename Entity>
+void UpdateDispatcher::dispatch_(const std::string &host, PeriodicTask task, TimePoint due, Entity &entity,
+                                 Entity PendingUpdates::*slot) {
+    Host known_host;
+    bool deliver = store_(host, task, due, [&](PendingUpdates &updates, bool) {
+        std::swap(updates.*slot, entity);
+    }, known_host);
+
+    if (deliver)
+        notify_(host, known_host, task, due, [&](PeriodicTaskHandler &handler) {
+            handler.on_update(host, entity);
+        });
+}
+
+void UpdateDispatcher::dispatch_statistics_(const std::string &host, TimePoint due, Statistics &statistics,
+                                            Statistics &days, bool refreshed) {
+    Host known_host;
+    bool deliver = store_(host, PeriodicTask::GetStatistics, due, [&](PendingUpdates &updates, bool pending) {
+        std::swap(updates.statistics, statistics);
+
+        // the pending days stay complete if they were
+        if (pending && !refreshed) {
+            updates.statistics_days = append_days__(updates.statistics_days, days, {});
+        } else {
+            std::swap(updates.statistics_days, days);
+            updates.statistics_refreshed = refreshed;
+        }
+    }, known_host);
+
+    if (deliver)
+        notify_(host, known_host, PeriodicTask::GetStatistics, due, [&](PeriodicTaskHandler &handler) {
+            handler.on_update(host, statistics);
+            handler.on_update(host, days, refreshed);
+        });
+}
+
+void UpdateDispatcher::deliver_(const std::string &host, const Host &known_host, PendingUpdates &updates) const {
+    auto due = [&](PeriodicTask task) {
+        return updates.due[static_cast<size_t>(task)];
+    };
+
+    auto deliver = [&](PeriodicTask task, const auto &entity) {
+        if (updates.pending.test(static_cast<size_t>(task)))
+            notify_(host, known_host, task, due(task), [&](PeriodicTaskHandler &handler) {
+                handler.on_update(host, entity);
+            });
+    };
+
+    deliver(PeriodicTask::GetCCStatus, updates.cc_status);
+    deliver(PeriodicTask::GetClientState, updates.client_state);
+    deliver(PeriodicTask::GetDiskUsage, updates.disk_usage);
+    deliver(PeriodicTask::GetFileTransfers, updates.file_transfers);
+    deliver(PeriodicTask::GetMessages, updates.messages);
+    deliver(PeriodicTask::GetProjectStatus, updates.projects);
+    deliver(PeriodicTask::GetTasks, updates.tasks);
+
+    if (updates.pending.test(static_cast<size_t>(PeriodicTask::GetStatistics)))
+        notify_(host, known_host, PeriodicTask::GetStatistics, due(PeriodicTask::GetStatistics), [&](PeriodicTaskHandler &handler) {
+            handler.on_update(host, updates.statistics);
+            handler.on_update(host, updates.statistics_days, updates.statistics_refreshed);
+        });
+
+    if (updates.pending.test(static_cast<size_t>(PeriodicTask::GetNotices)))
+        notify_(host, known_host, PeriodicTask::GetNotices, due(PeriodicTask::GetNotices), [&](PeriodicTaskHandler &handler) {
+            handler.on_update(host, updates.notices, updates.notices_refreshed);
+        });
+}
+
+template<typename Notify>
+void UpdateDispatcher::notify_(const std::string &host, const Host &known_host, PeriodicTask task, TimePoint due,
+                               Notify notify) const {
+    auto start = std::chrono::steady_clock::now();
+
+    handler_registry_.for_periodic_task_handler(host, task, notify);
+
+    const auto end = std::chrono::steady_clock::now();
+
+    if (auto &recorder = known_host.metrics) {
+        recorder->record(MetricSeries::HandlerDuration, static_cast<size_t>(task),
+                         static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        if (due != TimePoint())
+            recorder->record(MetricSeries::UpdateLatency, static_cast<size_t>(task),
+                             static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(start - due).count()));
+    }
+
+    if (tracer_.enabled())
+        tracer_.complete("handlers", known_host.trace_host, trace_name(task), start, end);
+}
+
+void UpdateDispatcher::run_() {
+    std::unique_lock<decltype(mutex_)> lock(mutex_);
+
+    while (true) {
+        condition_.wait(lock, [this]() { return shutdown_ || !dirty_hosts_.empty(); });
+
+        if (shutdown_)
+            break;
+
+        delivering_host_ = std::move(dirty_hosts_.front());
+        dirty_hosts_.pop_front();
+
+        auto updates = updates_.find(delivering_host_);
+        assert(updates != updates_.end());
+
+        auto known = hosts_.find(delivering_host_);
+        delivering_known_host_ = known != hosts_.end() ? known->second : Host();
+
+        // take over the pending updates and give back the containers of the last delivery
+        std::swap(updates->second, delivering_);
+        updates->second.pending.reset();
+
+        lock.unlock();
+        deliver_(delivering_host_, delivering_known_host_, delivering_);
+        lock.lock();
+
+        delivering_host_.clear();
+        delivering_known_host_ = Host();
+        delivered_condition_.notify_all();
+    }
+}
+
+}}
@@ -0,0 +1,190 @@
+/* libui/src/update_dispatcher.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_UPDATE_DISPATCHER_H_
+#define WOINC_UI_UPDATE_DISPATCHER_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <woinc/types.h>
+#include <woinc/ui/defs.h>
+
+#include "handler_registry.h"
+#include "metrics_registry.h"
+#include "snapshot_store.h"
+#include "tracer.h"
+#include "visibility.h"
+
+namespace woinc { namespace ui {
+
+// The latest not yet delivered updates of a host, one slot per periodic task
+struct WOINCUI_LOCAL PendingUpdates {
+    PeriodicTaskSet pending;
+    // when the task of the oldest pending update got due
+    std::array<std::chrono::steady_clock::time_point, PERIODIC_TASK_COUNT> due;
+
+    CCStatus cc_status;
+    ClientState client_state;
+    DiskUsage disk_usage;
+    FileTransfers file_transfers;
+    Messages messages;
+    Notices notices;
+    bool notices_refreshed = false;
+    Projects projects;
+    Statistics statistics;
+    // the new days of the statistics, see PeriodicTaskHandler
+    Statistics statistics_days;
+    bool statistics_refreshed = false;
+    Tasks tasks;
+};
+
+// Delivers the results of the periodic tasks to the registered handlers.
+//
+// In DispatchMode::Direct the handlers are called by the calling worker thread.
+// In DispatchMode::Coalesced the update is stored in the slot of the host and entity
+// and delivered by the dispatcher thread, replacing a not yet delivered older update.
+// Messages and notices are incremental, so pending ones are appended instead of replaced.
+// The statistics are fetched incrementally as well, their new days are merged into the known statistics
+// and delivered along with them.
+// All other entities are published to the snapshot store before being dispatched.
+// The time spent in the handlers and the latency from the task getting due until its update is passed to them
+// are recorded to the metrics of the host, the former is traced as well.
+class WOINCUI_LOCAL UpdateDispatcher {
+    public:
+        typedef std::chrono::steady_clock::time_point TimePoint;
+
+        UpdateDispatcher(const HandlerRegistry &handler_registry,
+                         SnapshotStore &snapshots,
+                         Tracer &tracer);
+        ~UpdateDispatcher();
+
+        UpdateDispatcher(const UpdateDispatcher &) = delete;
+        UpdateDispatcher(UpdateDispatcher &&) = delete;
+        UpdateDispatcher &operator=(const UpdateDispatcher &) = delete;
+        UpdateDispatcher &operator=(UpdateDispatcher &&) = delete;
+
+        void mode(DispatchMode mode);
+        DispatchMode mode() const;
+
+        void add_host(const std::string &host, HostMetricsRecorderPtr metrics);
+        // drops the pending updates of the host and waits until an ongoing delivery to it is finished,
+        // must not be called by a periodic task handler
+        void remove_host(const std::string &host);
+
+        void shutdown();
+
+    public: // called by the worker threads; the dispatcher may take over the content of the passed values
+        // due is the time the periodic task got due
+        void dispatch(const std::string &host, TimePoint due, CCStatus &cc_status);
+        void dispatch(const std::string &host, TimePoint due, ClientState &client_state);
+        void dispatch(const std::string &host, TimePoint due, DiskUsage &disk_usage);
+        void dispatch(const std::string &host, TimePoint due, FileTransfers &file_transfers);
+        void dispatch(const std::string &host, TimePoint due, Messages &messages);
+        void dispatch(const std::string &host, TimePoint due, Notices &notices, bool refreshed);
+        void dispatch(const std::string &host, TimePoint due, Projects &projects);
+        // the new or changed days are appended to the known ones, the days before the first day still reported
+        // by the client and the projects not in days are dropped; only the new days are passed on to the handlers
+        // and nothing is published nor delivered if there are none
+        void dispatch(const std::string &host, TimePoint due, Statistics &days,
+                      const std::vector<std::time_t> &first_days, bool refreshed);
+        void dispatch(const std::string &host, TimePoint due, Tasks &tasks);
+
+        // the reply of the task didn't change, so there is nothing to deliver
+        void unchanged(const std::string &host, PeriodicTask task);
+
+    public: // called when adding a host before it's connected
+        // publishes and delivers the snapshots restored from the state file unless the host delivered its own already
+        void restore(const std::string &host, const SnapshotPtr<ClientState> &client_state);
+        void restore(const std::string &host, const SnapshotPtr<Projects> &projects);
+        void restore(const std::string &host, const SnapshotPtr<Statistics> &statistics);
+        void restore(const std::string &host, const SnapshotPtr<Tasks> &tasks);
+
+    private:
+        // looked up once when adding the host, the lookups by name take the locks of the registries
+        struct Host {
+            Tracer::HostId trace_host = Tracer::NoHost;
+            HostMetricsRecorderPtr metrics;
+        };
+
+        // returns true if the caller has to deliver the update directly, the host is set in that case
+        template<typename Store>
+        bool store_(const std::string &host, PeriodicTask task, TimePoint due, Store store, Host &known_host);
+
+        template<typename Entity>
+        void replace_(const std::string &host, PeriodicTask task, TimePoint due, Entity &entity,
+                      Entity PendingUpdates::*slot);
+
+        template<typename Entity>
+        void restore_(const std::string &host, PeriodicTask task, const SnapshotPtr<Entity> &snapshot,
+                      Entity PendingUpdates::*slot);
+
+        // stores or delivers the already published entity, restored ones have no due time
+        template<typename Entity>
+        void dispatch_(const std::string &host, PeriodicTask task, TimePoint due, Entity &entity,
+                       Entity PendingUpdates::*slot);
+
+        // stores or delivers the already published statistics along with their new days
+        void dispatch_statistics_(const std::string &host, TimePoint due, Statistics &statistics, Statistics &days,
+                                  bool refreshed);
+
+        void deliver_(const std::string &host, const Host &known_host, PendingUpdates &updates) const;
+
+        template<typename Notify>
+        void notify_(const std::string &host, const Host &known_host, PeriodicTask task, TimePoint due,
+                     Notify notify) const;
+
+        void run_();
+
+    private:
+        const HandlerRegistry &handler_registry_;
+        SnapshotStore &snapshots_;
+        Tracer &tracer_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable condition_;
+        std::condition_variable delivered_condition_;
+
+        DispatchMode mode_ = DispatchMode::Direct;
+        bool shutdown_ = false;
+
+        std::map<std::string, Host> hosts_;
+        std::map<std::string, PendingUpdates> updates_;
+        std::deque<std::string> dirty_hosts_;
+
+        // only written by the dispatcher thread while holding the mutex
+        std::string delivering_host_;
+        // only accessed by the dispatcher thread
+        Host delivering_known_host_;
+        // only accessed by the dispatcher thread, kept to reuse the capacity of the containers
+        PendingUpdates delivering_;
+
+        std::thread thread_;
+};
+
+}}
+
+#endif
@@ -0,0 +1,162 @@
+/* tests/job_queue_tests.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "test.h"
+#include "woinc_assert.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "job_queue.h"
+
+static void test_fifo();
+static void test_lanes();
+static void test_coalescing();
+static void test_coalescing_keeps_order();
+static void test_stale();
+
+void get_tests(Tests &tests) {
+    tests["001 - Pop in the pushed order"]            = test_fifo;
+    tests["002 - Pop the lanes by priority"]          = test_lanes;
+    tests["003 - Supersede a pending job"]            = test_coalescing;
+    tests["004 - Don't overtake jobs without a key"]  = test_coalescing_keeps_order;
+    tests["005 - Drop stale jobs"]                    = test_stale;
+}
+
+namespace {
+
+using namespace woinc::ui;
+
+struct TestJob : public Job {
+    TestJob(std::string n, JobLane lane = JobLane::Interactive, CoalescingKey key = {})
+        : Job(lane), id(std::move(n)) {
+        coalescing_key(key);
+    }
+
+    void execute(Client &) override {}
+
+    void supersede(Job &older) override {
+        superseded.push_back(static_cast<TestJob &>(older).id);
+    }
+
+    void drop() override {
+        if (on_drop)
+            on_drop();
+    }
+
+    const std::string id;
+    std::vector<std::string> superseded;
+    std::function<void()> on_drop;
+};
+
+JobPtr job__(std::string id, JobLane lane = JobLane::Interactive, CoalescingKey key = {}) {
+    return JobPtr(new TestJob(std::move(id), lane, key));
+}
+
+std::string pop__(JobQueue &queue) {
+    auto job = queue.try_pop();
+    return job ? static_cast<TestJob &>(*job).id : std::string();
+}
+
+}
+
+void test_fifo() {
+    JobQueue queue;
+    queue.push(job__("1"));
+    queue.push(job__("2"));
+    queue.push(job__("3"));
+
+    assert_equals("Size", queue.size(), 3);
+    assert_equals("", pop__(queue), std::string("1"));
+    assert_equals("", pop__(queue), std::string("2"));
+    assert_equals("", pop__(queue), std::string("3"));
+    assert_equals("Pop of an empty queue", pop__(queue), std::string());
+    assert_equals("Size", queue.size(), 0);
+}
+
+void test_lanes() {
+    JobQueue queue;
+    queue.push(job__("bulk", JobLane::Bulk));
+    queue.push(job__("periodic", JobLane::Periodic));
+    queue.push(job__("interactive", JobLane::Interactive));
+
+    assert_equals("", pop__(queue), std::string("interactive"));
+    assert_equals("", pop__(queue), std::string("periodic"));
+    assert_equals("", pop__(queue), std::string("bulk"));
+}
+
+void test_coalescing() {
+    const auto key = make_coalescing_key<TestJob>(1);
+    const auto other_key = make_coalescing_key<TestJob>(2);
+
+    JobQueue queue;
+    queue.push(job__("read1", JobLane::Interactive, key));
+    queue.push(job__("other", JobLane::Interactive, other_key));
+
+    auto read2 = new TestJob("read2", JobLane::Interactive, key);
+    queue.push(JobPtr(read2));
+
+    // collects the pushed jobs, so read2 supersedes read1 before anything is popped
+    assert_equals("", pop__(queue), std::string("other"));
+    assert_equals("Superseded jobs", read2->superseded.size(), 1);
+    assert_equals("Superseded job", read2->superseded.front(), std::string("read1"));
+    assert_equals("", pop__(queue), std::string("read2"));
+    assert_equals("Pop of an empty queue", pop__(queue), std::string());
+    assert_equals("Size", queue.size(), 0);
+}
+
+void test_coalescing_keeps_order() {
+    const auto key = make_coalescing_key<TestJob>();
+
+    JobQueue queue;
+    queue.push(job__("read1", JobLane::Interactive, key));
+    queue.push(job__("write"));
+    queue.push(job__("read2", JobLane::Interactive, key));
+
+    // read2 must not be answered with a reply sent before the write
+    assert_equals("", pop__(queue), std::string("write"));
+    assert_equals("", pop__(queue), std::string("read2"));
+    assert_equals("Pop of an empty queue", pop__(queue), std::string());
+
+    // the same if the jobs are collected one by one
+    queue.push(job__("read1", JobLane::Interactive, key));
+    queue.push(job__("write"));
+    assert_equals("", pop__(queue), std::string("read1"));
+    queue.push(job__("read2", JobLane::Interactive, key));
+    assert_equals("", pop__(queue), std::string("write"));
+    assert_equals("", pop__(queue), std::string("read2"));
+}
+
+void test_stale() {
+    JobQueue queue;
+
+    auto token = CancellationToken::create();
+    auto cancelled = new TestJob("cancelled");
+    cancelled->options(CallOptions(token));
+    bool dropped = false;
+    cancelled->on_drop = [&]() { dropped = true; };
+
+    queue.push(JobPtr(cancelled));
+    queue.push(job__("alive"));
+    token.cancel();
+
+    assert_equals("", pop__(queue), std::string("alive"));
+    assert_true("The cancelled job wasn't dropped", dropped);
+    assert_equals("Size", queue.size(), 0);
+}
@@ -0,0 +1,147 @@
+/* tests/metrics_tests.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "test.h"
+#include "woinc_assert.h"
+
+#include <cstdint>
+#include <limits>
+
+#include <woinc/ui/metrics.h>
+
+static void test_empty();
+static void test_small_values();
+static void test_percentiles_within_bucket();
+static void test_large_values();
+static void test_merge();
+static void test_host_metrics_slots();
+
+void get_tests(Tests &tests) {
+    tests["001 - Empty histogram"]                      = test_empty;
+    tests["002 - Exact values below the sub buckets"]   = test_small_values;
+    tests["003 - Percentiles within the bucket width"]  = test_percentiles_within_bucket;
+    tests["004 - Values up to the largest integer"]     = test_large_values;
+    tests["005 - Merge histograms"]                     = test_merge;
+    tests["006 - Distinct slots of the host metrics"]   = test_host_metrics_slots;
+}
+
+using namespace woinc::ui;
+
+void test_empty() {
+    Histogram histogram;
+
+    assert_equals("Count", histogram.count(), std::uint64_t(0));
+    assert_equals("Min", histogram.min(), std::uint64_t(0));
+    assert_equals("Max", histogram.max(), std::uint64_t(0));
+    assert_equals("Mean", histogram.mean(), 0.);
+    assert_equals("Median", histogram.percentile(50), std::uint64_t(0));
+}
+
+void test_small_values() {
+    Histogram histogram;
+    for (std::uint64_t value = 0; value < Histogram::SubBuckets; ++value)
+        histogram.record(value);
+
+    assert_equals("Count", histogram.count(), std::uint64_t(Histogram::SubBuckets));
+    assert_equals("Min", histogram.min(), std::uint64_t(0));
+    assert_equals("Max", histogram.max(), std::uint64_t(Histogram::SubBuckets - 1));
+    assert_equals("Sum", histogram.sum(), std::uint64_t(Histogram::SubBuckets * (Histogram::SubBuckets - 1) / 2));
+    assert_equals("Median", histogram.percentile(50), std::uint64_t(Histogram::SubBuckets / 2 - 1));
+    assert_equals("Percentile 100", histogram.percentile(100), std::uint64_t(Histogram::SubBuckets - 1));
+    assert_equals("Percentile 0", histogram.percentile(0), std::uint64_t(0));
+}
+
+void test_percentiles_within_bucket() {
+    Histogram histogram;
+    for (std::uint64_t value = 1; value <= 100000; ++value)
+        histogram.record(value * 1000);
+
+    // the reported value is the upper bound of the bucket, at most 1/SubBuckets above the real one
+    for (double percentage : {10., 50., 90., 99., 99.9}) {
+        const auto exact = static_cast<double>(percentage * 1000. * 1000.);
+        const auto reported = static_cast<double>(histogram.percentile(percentage));
+        assert_true("Percentile " + std::to_string(percentage) + " below the real value", reported >= exact);
+        assert_true("Percentile " + std::to_string(percentage) + " too far above the real value",
+                    reported <= exact * (1. + 1. / Histogram::SubBuckets));
+    }
+
+    assert_equals("Percentile 100", histogram.percentile(100), std::uint64_t(100000000));
+}
+
+void test_large_values() {
+    const auto largest = std::numeric_limits<std::uint64_t>::max();
+
+    Histogram histogram;
+    histogram.record(std::uint64_t(1) << 62);
+    histogram.record(std::uint64_t(1) << 63);
+    histogram.record(largest);
+
+    assert_equals("Count", histogram.count(), std::uint64_t(3));
+    assert_equals("Min", histogram.min(), std::uint64_t(1) << 62);
+    assert_equals("Max", histogram.max(), largest);
+    assert_equals("Percentile 100", histogram.percentile(100), largest);
+
+    // 2^63 is the lower bound of its bucket, its upper bound is 2^63 + 2^59 - 1
+    const auto median = histogram.percentile(50);
+    assert_true("Median below 2^63", median >= (std::uint64_t(1) << 63));
+    assert_true("Median above its bucket", median < (std::uint64_t(1) << 63) + (std::uint64_t(1) << 59));
+}
+
+void test_merge() {
+    Histogram a;
+    a.record(1);
+    a.record(1000);
+
+    Histogram b;
+    b.record(5);
+    b.record(1000000);
+
+    Histogram empty;
+    a.merge(empty);
+    assert_equals("Count after merging an empty histogram", a.count(), std::uint64_t(2));
+
+    a.merge(b);
+    assert_equals("Count", a.count(), std::uint64_t(4));
+    assert_equals("Sum", a.sum(), std::uint64_t(1001006));
+    assert_equals("Min", a.min(), std::uint64_t(1));
+    assert_equals("Max", a.max(), std::uint64_t(1000000));
+    assert_equals("Percentile 25", a.percentile(25), std::uint64_t(1));
+    assert_equals("Percentile 50", a.percentile(50), std::uint64_t(5));
+    assert_equals("Percentile 100", a.percentile(100), std::uint64_t(1000000));
+
+    empty.merge(b);
+    assert_equals("Min of a merged empty histogram", empty.min(), std::uint64_t(5));
+
+    a.clear();
+    assert_equals("Count after clearing", a.count(), std::uint64_t(0));
+    assert_equals("Max after clearing", a.max(), std::uint64_t(0));
+}
+
+void test_host_metrics_slots() {
+    HostMetrics metrics;
+
+    metrics.at(MetricSeries::UpdateLatency, HostMetrics::COMMANDS).record(1);
+    metrics.at(MetricSeries::RpcRoundTrip, static_cast<std::size_t>(PeriodicTask::GetTasks)).record(2);
+    metrics.at(MetricSeries::RpcRoundTrip, HostMetrics::COMMANDS).record(3);
+
+    assert_equals("Last slot", metrics.commands(MetricSeries::UpdateLatency).max(), std::uint64_t(1));
+    assert_equals("Last task", metrics.periodic(MetricSeries::RpcRoundTrip, PeriodicTask::GetTasks).max(), std::uint64_t(2));
+    assert_equals("Commands", metrics.commands(MetricSeries::RpcRoundTrip).max(), std::uint64_t(3));
+    assert_equals("Untouched slot", metrics.periodic(MetricSeries::UpdateLatency, PeriodicTask::GetTasks).count(),
+                  std::uint64_t(0));
+}
@@ -0,0 +1,225 @@
+/* tests/periodic_tasks_scheduler_tests.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "test.h"
+#include "woinc_assert.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "clock.h"
+#include "configuration.h"
+#include "handler_registry.h"
+#include "periodic_tasks_scheduler.h"
+#include "tracer.h"
+
+static void test_restored_seqnos_held_back();
+static void test_restored_seqnos_reset_after_restart();
+static void test_failed_validation_retried();
+static void test_nothing_to_restore();
+static void test_hosts_added_and_removed();
+
+void get_tests(Tests &tests) {
+    tests["001 - Restored seqnos wait for the client state"]      = test_restored_seqnos_held_back;
+    tests["002 - Restored seqnos reset if the client restarted"]  = test_restored_seqnos_reset_after_restart;
+    tests["003 - Failed validations are retried"]                 = test_failed_validation_retried;
+    tests["004 - Restoring no seqnos holds nothing back"]         = test_nothing_to_restore;
+    tests["005 - Hosts added and removed between the ticks"]      = test_hosts_added_and_removed;
+}
+
+using namespace woinc::ui;
+using namespace std::chrono_literals;
+
+namespace {
+
+const std::string HOST__ = "host";
+const std::time_t CLIENT_START_TIME__ = 1234567890;
+
+class ManualClock : public Clock {
+    public:
+        TimePoint now() const override { return now_; }
+        void advance(std::chrono::milliseconds duration) { now_ += duration; }
+
+    private:
+        // far enough from the epoch for the scheduler to subtract its intervals
+        TimePoint now_ = TimePoint(std::chrono::hours(24));
+};
+
+struct Scheduled {
+    PeriodicTask task;
+    PeriodicJob::Payload payload;
+};
+
+// a host subscribed to the messages and notices only, whose scheduled tasks are recorded instead of executed
+struct Fixture {
+    Fixture()
+        : context(configuration, handler_registry, tracer,
+                  [this](const std::string &, PeriodicTask task, const PeriodicJob::Payload &payload,
+                         std::chrono::steady_clock::time_point) {
+                      scheduled.push_back({task, payload});
+                  },
+                  clock)
+        , scheduler(context)
+    {
+        handler_registry.register_handler(&handler, PeriodicTaskSubscription{{}, {
+            PeriodicTask::GetMessages, PeriodicTask::GetNotices
+        }});
+
+        ConfigurationTestHook::add_host(configuration, HOST__);
+        configuration.schedule_periodic_tasks(HOST__, true);
+        context.add_host(HOST__);
+    }
+
+    ~Fixture() {
+        handler_registry.deregister_handler(&handler);
+    }
+
+    void restore(int messages_seqno, int notices_seqno) {
+        PeriodicTasksSchedulerContext::State state;
+        state.messages_seqno = messages_seqno;
+        state.notices_seqno = notices_seqno;
+        state.client_start_time = CLIENT_START_TIME__;
+        context.restore(HOST__, state);
+    }
+
+    // ticks the scheduler and returns the tasks it scheduled
+    std::vector<Scheduled> tick() {
+        scheduled.clear();
+        scheduler.tick();
+        return scheduled;
+    }
+
+    void executed(PeriodicTask task, PeriodicJob::Payload payload) {
+        context.executed(HOST__, task, payload);
+    }
+
+    void client_state_received(std::time_t client_start_time) {
+        PeriodicJob::Payload payload;
+        payload.client_start_time = client_start_time;
+        executed(PeriodicTask::GetClientState, payload);
+    }
+
+    Configuration configuration;
+    HandlerRegistry handler_registry;
+    PeriodicTaskHandler handler;
+    Tracer tracer;
+    ManualClock clock;
+    std::vector<Scheduled> scheduled;
+    PeriodicTasksSchedulerContext context;
+    PeriodicTasksScheduler scheduler;
+};
+
+bool contains__(const std::vector<Scheduled> &scheduled, PeriodicTask task) {
+    for (const auto &s : scheduled)
+        if (s.task == task)
+            return true;
+    return false;
+}
+
+int seqno__(const std::vector<Scheduled> &scheduled, PeriodicTask task) {
+    for (const auto &s : scheduled)
+        if (s.task == task)
+            return s.payload.seqno;
+    return -1;
+}
+
+}
+
+void test_restored_seqnos_held_back() {
+    Fixture fixture;
+    fixture.restore(42, 7);
+
+    auto scheduled = fixture.tick();
+    assert_equals("Scheduled tasks while validating", scheduled.size(), 1);
+    assert_true("Client state scheduled without a subscription", contains__(scheduled, PeriodicTask::GetClientState));
+
+    fixture.clock.advance(10s);
+    assert_equals("Scheduled tasks while the client state is pending", fixture.tick().size(), 0);
+
+    fixture.client_state_received(CLIENT_START_TIME__);
+
+    scheduled = fixture.tick();
+    assert_equals("Scheduled tasks after validating", scheduled.size(), 2);
+    assert_equals("Messages seqno", seqno__(scheduled, PeriodicTask::GetMessages), 42);
+    assert_equals("Notices seqno", seqno__(scheduled, PeriodicTask::GetNotices), 7);
+}
+
+void test_restored_seqnos_reset_after_restart() {
+    Fixture fixture;
+    fixture.restore(42, 7);
+
+    fixture.tick();
+    fixture.client_state_received(CLIENT_START_TIME__ + 60);
+
+    auto scheduled = fixture.tick();
+    assert_equals("Messages seqno", seqno__(scheduled, PeriodicTask::GetMessages), 0);
+    assert_equals("Notices seqno", seqno__(scheduled, PeriodicTask::GetNotices), 0);
+}
+
+void test_failed_validation_retried() {
+    Fixture fixture;
+    fixture.restore(42, 7);
+
+    fixture.tick();
+    fixture.client_state_received(0);
+
+    assert_equals("Scheduled tasks right after the failure", fixture.tick().size(), 0);
+
+    // retried as often as the messages would be fetched instead of after the interval of the client state
+    fixture.clock.advance(fixture.configuration.interval(PeriodicTask::GetMessages));
+    auto scheduled = fixture.tick();
+    assert_equals("Scheduled tasks after the interval of the messages", scheduled.size(), 1);
+    assert_true("Client state rescheduled", contains__(scheduled, PeriodicTask::GetClientState));
+
+    fixture.client_state_received(CLIENT_START_TIME__);
+    assert_equals("Messages seqno", seqno__(fixture.tick(), PeriodicTask::GetMessages), 42);
+}
+
+void test_nothing_to_restore() {
+    Fixture fixture;
+    fixture.restore(0, 0);
+
+    auto scheduled = fixture.tick();
+    assert_equals("Scheduled tasks", scheduled.size(), 2);
+    assert_false("Client state scheduled", contains__(scheduled, PeriodicTask::GetClientState));
+}
+
+void test_hosts_added_and_removed() {
+    Fixture fixture;
+    fixture.tick();
+
+    const std::string other = "other";
+    ConfigurationTestHook::add_host(fixture.configuration, other);
+    fixture.configuration.schedule_periodic_tasks(other, true);
+    fixture.context.add_host(other);
+
+    assert_equals("Scheduled tasks of the added host", fixture.tick().size(), 2);
+
+    fixture.context.remove_host(other);
+    ConfigurationTestHook::remove_host(fixture.configuration, other);
+
+    // e.g. a job still running when its host was removed
+    fixture.context.executed(other, PeriodicTask::GetMessages, PeriodicJob::Payload());
+
+    fixture.executed(PeriodicTask::GetMessages, PeriodicJob::Payload());
+    fixture.clock.advance(10s);
+    auto scheduled = fixture.tick();
+    assert_equals("Scheduled tasks after removing the host", scheduled.size(), 1);
+    assert_true("Messages of the remaining host scheduled", contains__(scheduled, PeriodicTask::GetMessages));
+}
@@ -0,0 +1,249 @@
+/* tests/state_file_tests.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "test.h"
+#include "woinc_assert.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+#include "state_file.h"
+
+static void test_missing_file();
+static void test_round_trip();
+static void test_truncated_file();
+static void test_corrupt_header();
+static void test_corrupt_entity();
+
+void get_tests(Tests &tests) {
+    tests["001 - Missing file"]         = test_missing_file;
+    tests["002 - Round trip"]           = test_round_trip;
+    tests["003 - Truncated file"]       = test_truncated_file;
+    tests["004 - Corrupt header"]       = test_corrupt_header;
+    tests["005 - Corrupt entity"]       = test_corrupt_entity;
+}
+
+using namespace woinc::ui;
+
+namespace {
+
+// removes the file when going out of scope
+struct TemporaryPath {
+    TemporaryPath() : path("/tmp/woinc_state_file_tests." + std::to_string(::getpid())) {}
+    ~TemporaryPath() { ::unlink(path.c_str()); }
+
+    const std::string path;
+};
+
+template<typename T>
+SnapshotPtr<T> snapshot__(T value) {
+    auto snapshot = std::make_shared<Snapshot<T>>();
+    snapshot->value = std::move(value);
+    snapshot->time = std::chrono::steady_clock::now();
+    return snapshot;
+}
+
+StateFile::Hosts hosts__() {
+    StateFile::Hosts hosts;
+
+    auto &first = hosts["first"];
+    first.messages_seqno = 42;
+    first.notices_seqno = 7;
+    {
+        woinc::ClientState client_state;
+        client_state.time_stats.client_start_time = 1234567890;
+        first.client_state = snapshot__(std::move(client_state));
+    }
+    {
+        woinc::Project project;
+        project.master_url = "https://project.example/";
+        project.project_name = "Project";
+        project.host_total_credit = 1234.5;
+        first.projects = snapshot__(woinc::Projects{project});
+    }
+    {
+        woinc::ProjectStatistics statistics;
+        statistics.master_url = "https://project.example/";
+        statistics.daily_statistics.push_back({1., 2., 3., 4., 86400});
+        statistics.daily_statistics.push_back({5., 6., 7., 8., 2 * 86400});
+        first.statistics = snapshot__(woinc::Statistics{statistics});
+    }
+    {
+        woinc::Task task;
+        task.name = "task";
+        task.project_url = "https://project.example/";
+        task.report_deadline = 1234567890;
+        task.active_task = std::make_unique<woinc::ActiveTask>();
+        task.active_task->slot = 3;
+        woinc::Tasks tasks;
+        tasks.push_back(std::move(task));
+        first.tasks = snapshot__(std::move(tasks));
+    }
+
+    // only the projects, as the first host in the file they are the first entity after the header
+    auto &other = hosts["another"];
+    other.messages_seqno = 1;
+    {
+        woinc::Project project;
+        project.master_url = "https://other.example/";
+        other.projects = snapshot__(woinc::Projects{project});
+    }
+
+    return hosts;
+}
+
+std::string read__(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void write__(const std::string &path, const std::string &content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+}
+
+void test_missing_file() {
+    TemporaryPath tmp;
+    StateFile file(tmp.path);
+
+    StateFile::HostState state;
+    assert_equals("Hosts", file.size(), 0);
+    assert_false("Restored host", file.restore("first", state));
+}
+
+void test_round_trip() {
+    TemporaryPath tmp;
+    StateFile(tmp.path).save(hosts__());
+
+    StateFile file(tmp.path);
+    assert_equals("Hosts", file.size(), 2);
+
+    StateFile::HostState state;
+    assert_false("Restored unknown host", file.restore("unknown", state));
+    assert_true("Restored first host", file.restore("first", state));
+
+    assert_equals("Messages seqno", state.messages_seqno, 42);
+    assert_equals("Notices seqno", state.notices_seqno, 7);
+
+    assert_true("Client state", static_cast<bool>(state.client_state));
+    assert_true("Client state stale", state.client_state->stale);
+    assert_equals("Client start time", static_cast<long>(state.client_state->value.time_stats.client_start_time),
+                  1234567890L);
+
+    assert_true("Projects", static_cast<bool>(state.projects));
+    assert_equals("Projects size", state.projects->value.size(), 1);
+    assert_equals("Project url", state.projects->value[0].master_url, std::string("https://project.example/"));
+    assert_equals("Project name", state.projects->value[0].project_name, std::string("Project"));
+    assert_equals("Project credit", state.projects->value[0].host_total_credit, 1234.5);
+
+    assert_true("Statistics", static_cast<bool>(state.statistics));
+    assert_equals("Statistics size", state.statistics->value.size(), 1);
+    assert_equals("Days", state.statistics->value[0].daily_statistics.size(), 2);
+    assert_equals("Second day", static_cast<long>(state.statistics->value[0].daily_statistics[1].day), 2L * 86400);
+    assert_equals("Second day credit", state.statistics->value[0].daily_statistics[1].host_total_credit, 6.);
+
+    assert_true("Tasks", static_cast<bool>(state.tasks));
+    assert_equals("Tasks size", state.tasks->value.size(), 1);
+    assert_equals("Task name", state.tasks->value[0].name, std::string("task"));
+    assert_true("Active task", static_cast<bool>(state.tasks->value[0].active_task));
+    assert_equals("Slot", state.tasks->value[0].active_task->slot, 3);
+
+    assert_true("Restored other host", file.restore("another", state));
+    assert_equals("Messages seqno of the other host", state.messages_seqno, 1);
+    assert_false("Unsaved client state", static_cast<bool>(state.client_state));
+    assert_false("Unsaved tasks", static_cast<bool>(state.tasks));
+    assert_equals("Projects of the other host", state.projects->value.size(), 1);
+}
+
+void test_truncated_file() {
+    TemporaryPath tmp;
+    StateFile(tmp.path).save(hosts__());
+
+    const auto content = read__(tmp.path);
+
+    // the index is at the end, so every truncated file is ignored as a whole
+    for (std::size_t size = 0; size < content.size(); size += 7) {
+        write__(tmp.path, content.substr(0, size));
+
+        StateFile file(tmp.path);
+        StateFile::HostState state;
+        assert_equals("Hosts of a file truncated to " + std::to_string(size) + " bytes", file.size(), 0);
+        assert_false("Restored from a file truncated to " + std::to_string(size) + " bytes",
+                     file.restore("first", state));
+    }
+}
+
+void test_corrupt_header() {
+    TemporaryPath tmp;
+    StateFile(tmp.path).save(hosts__());
+
+    const auto content = read__(tmp.path);
+
+    auto corrupt = content;
+    corrupt[0] = 'X';
+    write__(tmp.path, corrupt);
+    assert_equals("Hosts with a corrupt magic", StateFile(tmp.path).size(), 0);
+
+    // the version follows the magic
+    corrupt = content;
+    corrupt[8] = static_cast<char>(corrupt[8] + 1);
+    write__(tmp.path, corrupt);
+    assert_equals("Hosts with another version", StateFile(tmp.path).size(), 0);
+
+    // an index offset pointing into the header
+    corrupt = content;
+    for (std::size_t i = 20; i < 28; ++i)
+        corrupt[i] = 0;
+    write__(tmp.path, corrupt);
+    assert_equals("Hosts with a corrupt index offset", StateFile(tmp.path).size(), 0);
+}
+
+void test_corrupt_entity() {
+    // the magic, version, byte order, layout and the offset and size of the index
+    const std::size_t header_size = 8 + 3 * sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t);
+
+    TemporaryPath tmp;
+    StateFile(tmp.path).save(hosts__());
+
+    // the projects of the first host in the file start with their number,
+    // make it one the remaining data can't hold
+    auto content = read__(tmp.path);
+    for (std::size_t i = 0; i < sizeof(std::uint32_t); ++i)
+        content[header_size + i] = static_cast<char>(0xFF);
+    write__(tmp.path, content);
+
+    StateFile file(tmp.path);
+    assert_equals("Hosts", file.size(), 2);
+
+    StateFile::HostState state;
+    state.messages_seqno = 99;
+    assert_false("Restored the corrupt host", file.restore("another", state));
+    assert_equals("Messages seqno of the corrupt host", state.messages_seqno, 0);
+    assert_false("Projects of the corrupt host", static_cast<bool>(state.projects));
+
+    assert_true("Restored the intact host", file.restore("first", state));
+    assert_equals("Messages seqno of the intact host", state.messages_seqno, 42);
+}
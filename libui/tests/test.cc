@@ -0,0 +1,40 @@
+/* tests/test.cc --
+   Written and Copyright (C) 2017 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "test.h"
+
+int main() {
+    Tests tests;
+    get_tests(tests);
+
+    bool good = true;
+
+    for (auto test : tests) {
+        try {
+            std::cerr << "--- Executing test \"" << test.first << "\" ---" << std::endl;
+            (*test.second)();
+            std::cerr << "Test OK" << std::endl;
+        } catch (const std::runtime_error &e) {
+            std::cerr << "Test failed: " << e.what() << std::endl;
+            good = false;
+        }
+    }
+
+    return good ? 0 : -1;
+}
+
@@ -0,0 +1,265 @@
+/* tests/time_series_tests.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "test.h"
+#include "woinc_assert.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "time_series.h"
+
+static void test_bit_stream();
+static void test_bit_stream_read_beyond_end();
+static void test_round_trip();
+static void test_edge_values();
+static void test_day_gaps();
+static void test_serialize();
+static void test_truncated_input();
+static void test_drop_before();
+
+void get_tests(Tests &tests) {
+    tests["001 - Write and read bits"]                  = test_bit_stream;
+    tests["002 - Read beyond the end of the bits"]      = test_bit_stream_read_beyond_end;
+    tests["003 - Round trip of slowly changing days"]   = test_round_trip;
+    tests["004 - Round trip of edge values"]            = test_edge_values;
+    tests["005 - Round trip of gaps between days"]      = test_day_gaps;
+    tests["006 - Serialize and deserialize"]            = test_serialize;
+    tests["007 - Deserialize truncated input"]          = test_truncated_input;
+    tests["008 - Drop the expired blocks"]              = test_drop_before;
+}
+
+using namespace woinc::ui;
+
+namespace {
+
+const std::time_t DAY__ = 86400;
+
+std::uint64_t bits__(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+woinc::DailyStatistic day__(std::time_t day, double host_expavg, double host_total,
+                            double user_expavg, double user_total) {
+    woinc::DailyStatistic statistic;
+    statistic.day = day;
+    statistic.host_expavg_credit = host_expavg;
+    statistic.host_total_credit = host_total;
+    statistic.user_expavg_credit = user_expavg;
+    statistic.user_total_credit = user_total;
+    return statistic;
+}
+
+std::vector<woinc::DailyStatistic> all__(const StatisticsSeries &series) {
+    std::vector<woinc::DailyStatistic> days;
+    series.visit(std::numeric_limits<std::time_t>::min(), std::numeric_limits<std::time_t>::max(),
+                 [&](const woinc::DailyStatistic &day) { days.push_back(day); });
+    return days;
+}
+
+// compares the credits by their bits, so NaNs and the sign of zeros are checked as well
+void assert_days__(const std::string &msg, const std::vector<woinc::DailyStatistic> &actual,
+                   const std::vector<woinc::DailyStatistic> &wanted) {
+    assert_equals(msg + ": size", actual.size(), wanted.size());
+    for (std::size_t i = 0; i < wanted.size(); ++i) {
+        const auto index = msg + ": day " + std::to_string(i);
+        assert_equals(index, static_cast<long long>(actual[i].day), static_cast<long long>(wanted[i].day));
+        assert_equals(index + " host expavg", bits__(actual[i].host_expavg_credit), bits__(wanted[i].host_expavg_credit));
+        assert_equals(index + " host total", bits__(actual[i].host_total_credit), bits__(wanted[i].host_total_credit));
+        assert_equals(index + " user expavg", bits__(actual[i].user_expavg_credit), bits__(wanted[i].user_expavg_credit));
+        assert_equals(index + " user total", bits__(actual[i].user_total_credit), bits__(wanted[i].user_total_credit));
+    }
+}
+
+StatisticsSeries series__(const std::vector<woinc::DailyStatistic> &days) {
+    StatisticsSeries series;
+    for (const auto &day : days)
+        series.append(day);
+    return series;
+}
+
+std::vector<woinc::DailyStatistic> slowly_changing__(std::size_t count) {
+    std::vector<woinc::DailyStatistic> days;
+    double total = 1000;
+    for (std::size_t i = 0; i < count; ++i) {
+        const double expavg = 100 + static_cast<double>(i % 7);
+        total += expavg;
+        days.push_back(day__(static_cast<std::time_t>(i + 1) * DAY__, expavg, total, expavg * 3, total * 3));
+    }
+    return days;
+}
+
+}
+
+void test_bit_stream() {
+    BitStream stream;
+    stream.write(1, 1);
+    stream.write(0b101, 3);
+    stream.write(0xFFFFFFFFFFFFFFFFull, 64);
+    stream.write(0x123456789ABCDEF0ull, 64);
+    stream.write(0, 0);
+    // only the lowest bits are written
+    stream.write(0xFF, 4);
+    stream.write(0x1FFFF, 17);
+
+    assert_equals("Bits", stream.bits(), 1 + 3 + 64 + 64 + 4 + 17);
+
+    BitStream::Reader reader(stream);
+    assert_equals("1 bit", reader.read(1), std::uint64_t(1));
+    assert_equals("3 bits", reader.read(3), std::uint64_t(0b101));
+    assert_equals("64 bits set", reader.read(64), std::uint64_t(0xFFFFFFFFFFFFFFFFull));
+    assert_equals("64 bits", reader.read(64), std::uint64_t(0x123456789ABCDEF0ull));
+    assert_equals("0 bits", reader.read(0), std::uint64_t(0));
+    assert_equals("4 bits", reader.read(4), std::uint64_t(0xF));
+    assert_equals("17 bits", reader.read(17), std::uint64_t(0x1FFFF));
+}
+
+void test_bit_stream_read_beyond_end() {
+    BitStream stream;
+    stream.write(0b11, 2);
+
+    BitStream::Reader reader(stream);
+    reader.read(1);
+
+    bool thrown = false;
+    try {
+        reader.read(2);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert_true("Read beyond the end", thrown);
+}
+
+void test_round_trip() {
+    // more than two blocks and the uncompressed latest day
+    const auto days = slowly_changing__(2 * StatisticsSeries::BlockSize + 10);
+    const auto series = series__(days);
+
+    assert_equals("Size", series.size(), days.size());
+    assert_equals("First day", static_cast<long long>(series.first_day()), static_cast<long long>(days.front().day));
+    assert_equals("Last day", static_cast<long long>(series.last_day()), static_cast<long long>(days.back().day));
+    assert_days__("All days", all__(series), days);
+
+    // a range within the second block
+    std::vector<woinc::DailyStatistic> range;
+    series.visit(days[150].day, days[160].day, [&](const woinc::DailyStatistic &day) { range.push_back(day); });
+    assert_days__("Range", range, std::vector<woinc::DailyStatistic>(days.begin() + 150, days.begin() + 161));
+}
+
+void test_edge_values() {
+    const double inf = std::numeric_limits<double>::infinity();
+    const double values[] = {
+        0., -0., 1., std::nextafter(1., 2.), -1., inf, -inf, std::numeric_limits<double>::quiet_NaN(),
+        std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+        std::numeric_limits<double>::min(), std::numeric_limits<double>::denorm_min(), 1e300, 1e-300,
+        // XORed with 1e-300 before it all 64 bits are meaningful
+        -std::nextafter(1e-300, 1.)
+    };
+
+    std::vector<woinc::DailyStatistic> days;
+    std::time_t day = DAY__;
+    for (auto a : values) {
+        for (auto b : values) {
+            days.push_back(day__(day, a, b, b, a));
+            day += DAY__;
+        }
+    }
+
+    assert_days__("Edge values", all__(series__(days)), days);
+}
+
+void test_day_gaps() {
+    std::vector<woinc::DailyStatistic> days;
+    // consecutive days, gaps fitting into the short delta of deltas, larger ones, back to consecutive days
+    // and the largest days the encoding supports
+    const std::time_t gaps[] = {DAY__, DAY__, 2 * DAY__, 6 * DAY__, 7 * DAY__, 3650 * DAY__, DAY__, DAY__, 1, 1,
+                                std::numeric_limits<std::time_t>::max() / 4};
+    std::time_t day = -100 * DAY__;
+    for (auto gap : gaps) {
+        days.push_back(day__(day, 1, 2, 3, 4));
+        day += gap;
+    }
+    days.push_back(day__(day, 1, 2, 3, 4));
+
+    assert_days__("Gaps", all__(series__(days)), days);
+}
+
+void test_serialize() {
+    const auto days = slowly_changing__(StatisticsSeries::BlockSize + 5);
+    const auto series = series__(days);
+
+    std::stringstream stream;
+    series.serialize(stream);
+
+    StatisticsSeries read;
+    read.deserialize(stream);
+
+    assert_days__("Deserialized days", all__(read), days);
+
+    // the open block is sealed, so appending starts a new block
+    read.append(day__(days.back().day + DAY__, 1, 2, 3, 4));
+    read.append(day__(days.back().day + 2 * DAY__, 1, 2, 3, 4));
+    assert_equals("Size after appending", read.size(), days.size() + 2);
+    assert_equals("Day after appending", static_cast<long long>(all__(read)[days.size()].day),
+                  static_cast<long long>(days.back().day + DAY__));
+}
+
+void test_truncated_input() {
+    const auto series = series__(slowly_changing__(StatisticsSeries::BlockSize + 5));
+
+    std::stringstream stream;
+    series.serialize(stream);
+    const auto content = stream.str();
+
+    for (std::size_t size = 0; size < content.size(); ++size) {
+        std::istringstream truncated(content.substr(0, size));
+        StatisticsSeries read;
+
+        bool thrown = false;
+        try {
+            read.deserialize(truncated);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        assert_true("Deserialized input truncated to " + std::to_string(size) + " bytes", thrown);
+    }
+}
+
+void test_drop_before() {
+    const auto days = slowly_changing__(3 * StatisticsSeries::BlockSize);
+    auto series = series__(days);
+
+    // the first block is dropped only once all its days are before the given one
+    series.drop_before(days[StatisticsSeries::BlockSize - 1].day);
+    assert_equals("Size keeping the first block", series.size(), days.size());
+
+    series.drop_before(days[StatisticsSeries::BlockSize].day);
+    assert_equals("Size without the first block", series.size(), days.size() - StatisticsSeries::BlockSize);
+    assert_equals("First day", static_cast<long long>(series.first_day()),
+                  static_cast<long long>(days[StatisticsSeries::BlockSize].day));
+    assert_days__("Remaining days", all__(series),
+                  std::vector<woinc::DailyStatistic>(days.begin() + StatisticsSeries::BlockSize, days.end()));
+}
@@ -18,24 +18,32 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cctype>
 #include <chrono>
 #include <cmath>
 #include <ctime>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <queue>
 #include <set>
 #include <sstream>
+#include <stdexcept>
 #include <thread>
 #include <type_traits>
+#include <vector>
 
 #include <woinc/rpc_command.h>
 #include <woinc/rpc_connection.h>
 
+#include "common/daemon_connection.h"
 #include "common/types_to_string.h"
 
 namespace wrpc = woinc::rpc;
@@ -52,6 +60,8 @@ typedef std::queue<std::string> Arguments;
 bool matches(Arguments &args, const std::string &what);
 
 void parse_host(std::string &hostname, std::uint16_t &port);
+int parse_next_as_int(Arguments &args);
+std::string parse_next_as_string(Arguments &args);
 
 [[ noreturn ]] void usage(std::ostream &out, int exit_code);
 [[ noreturn ]] void usage_die();
@@ -59,20 +69,54 @@ void parse_host(std::string &hostname, std::uint16_t &port);
 [[ noreturn ]] void error_die(const std::string &msg);
 void empty_or_die(const Arguments &args);
 
+struct Host {
+    // as given by the user
+    std::string name;
+    std::string hostname;
+    std::uint16_t port = wrpc::Connection::DefaultBOINCPort;
+    std::string password;
+};
+
+Host parse_host_spec(const std::string &spec, const std::string &password);
+void read_hosts(const std::string &path, const std::string &password, std::vector<Host> &hosts);
+
+// The command failed at the host, the message is complete to be printed
+struct HostError : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
 class Client {
     public:
-        Client(std::string hostname, std::uint16_t port, std::string password);
+        // connects to the host through woincd if the daemon_socket isn't empty;
+        // the output of the commands is written to out, the metrics to err
+        Client(const Host &host, std::string daemon_socket, bool print_metrics = false,
+               std::ostream &out = std::cout, std::ostream &err = std::cerr);
+
+        // throws a HostError if the command failed
         void do_cmd(wrpc::Command &cmd);
+        // sends a request answered by woincd itself and returns the content of the tag of its reply,
+        // throws a HostError if not connected through the daemon or the request failed
+        std::string do_daemon_request(const std::string &request, const std::string &tag);
+
+        std::ostream &out() { return out_; }
 
     private:
         void connect_();
         void authorize_();
-        void execute_cmd_or_die_(wrpc::Command &cmd);
+        void execute_cmd_or_throw_(wrpc::Command &cmd);
+        // closes the connection unless the error was reported by the client, the next command reconnects
+        [[ noreturn ]] void fail_(const std::string &msg, bool close = true);
+        void print_metrics_(const wrpc::Command &cmd) const;
 
         const std::string hostname_;
         const std::uint16_t port_;
         const std::string password_;
-        wrpc::Connection connection_;
+        const bool print_metrics_after_rpc_;
+        std::ostream &out_;
+        std::ostream &err_;
+        // woincd keeps its connection to the host authorized
+        const bool via_daemon_;
+        std::unique_ptr<wrpc::Connection> connection_;
         bool connected_ = false;
         bool authed_ = false;
 };
@@ -87,6 +131,17 @@ struct Command {
 typedef std::map<std::string, Command> CommandMap;
 CommandMap command_map();
 
+// runs the command on all hosts, at most parallel ones at the same time; returns the exit code
+int fan_out(const std::vector<Host> &hosts, const Command &command, const std::vector<CommandContext> &contexts,
+            std::size_t parallel, const std::string &daemon_socket, bool print_metrics);
+
+// reads the non-empty lines of a batch file, of stdin for "-", except the comments starting with #
+std::vector<std::string> read_batch(const std::string &path);
+// parses each line of the batch as a command, dies on the first invalid one
+CommandContext parse_batch(const CommandMap &cmds, const std::vector<std::string> &lines);
+// runs the commands of a parsed batch one after the other, throws a HostError if any of them failed
+void execute_batch(Client &client, CommandContext ctx);
+
 }
 
 int main(int argc, char **argv) {
@@ -102,32 +157,76 @@ int main(int argc, char **argv) {
     if (args.empty())
         usage_die();
 
-    // parse hostname
-
-    std::string hostname("localhost");
-    std::uint16_t port = wrpc::Connection::DefaultBOINCPort;
+    // parse the options
 
-    if (matches(args, "--host")) {
-        if (args.empty()) {
-            std::cerr << "Missing hostname after parameter --host" << std::endl;
-            exit(EXIT_FAILURE);
+    std::vector<std::string> host_specs;
+    std::vector<std::string> host_files;
+    std::string password;
+    std::string daemon_socket;
+    std::size_t parallel = 16;
+    bool print_metrics = false;
+
+    while (!args.empty()) {
+        if (matches(args, "--host")) {
+            if (args.empty()) {
+                std::cerr << "Missing hostname after parameter --host" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            host_specs.push_back(args.front());
+            args.pop();
+        } else if (matches(args, "--hosts")) {
+            if (args.empty()) {
+                std::cerr << "Missing file after parameter --hosts" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            host_files.push_back(args.front());
+            args.pop();
+        } else if (matches(args, "--passwd")) {
+            if (args.empty()) {
+                std::cerr << "Missing password after parameter --passwd" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            password = args.front();
+            args.pop();
+        } else if (matches(args, "--parallel")) {
+            if (args.empty()) {
+                std::cerr << "Missing number after parameter --parallel" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            int value = parse_next_as_int(args);
+            if (value <= 0)
+                error_die("The parallelism has to be positive");
+            parallel = static_cast<std::size_t>(value);
+        } else if (matches(args, "--via-daemon")) {
+            // connect via woincd
+            if (!args.empty() && args.front().compare(0, 1, "-") != 0) {
+                daemon_socket = args.front();
+                args.pop();
+            } else {
+                daemon_socket = woinc::ui::common::default_daemon_socket();
+            }
+        } else if (matches(args, "--metrics")) {
+            // print the metrics of the rpcs
+            print_metrics = true;
+        } else {
+            break;
         }
-        hostname = args.front();
-        args.pop();
-        parse_host(hostname, port);
     }
 
-    // parse password
+    std::vector<Host> hosts;
 
-    std::string password;
+    for (const auto &spec : host_specs)
+        hosts.push_back(parse_host_spec(spec, password));
+    for (const auto &path : host_files)
+        read_hosts(path, password, hosts);
 
-    if (matches(args, "--passwd")) {
-        if (args.empty()) {
-            std::cerr << "Missing password after parameter --passwd" << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        password = args.front();
-        args.pop();
+    // several hosts are run in parallel and their output is prefixed, even if a hosts file contains just one
+    const bool fan_out_mode = hosts.size() > 1 || !host_files.empty();
+
+    if (hosts.empty()) {
+        if (!host_files.empty())
+            error_die("No hosts in the given hosts files.");
+        hosts.push_back(parse_host_spec("localhost", password));
     }
 
     // if requested show version and quit
@@ -149,26 +248,58 @@ int main(int argc, char **argv) {
         error_die("Nothing to do, no command given.");
 
     auto cmds{command_map()};
-    auto cmd_iter = cmds.find(args.front());
+    Command command{nullptr, nullptr};
 
-    if (cmd_iter == cmds.end())
-        die_unknown_command(args.front());
+    // parse the command, once for each host because the contexts are consumed by executing them
 
-    args.pop();
+    std::vector<CommandContext> contexts;
+    contexts.reserve(hosts.size());
 
-    // parse the command
+    if (matches(args, "--batch")) {
+        // the commands of the batch are run one after the other over the same connection
+        auto lines = read_batch(args.empty() ? "-" : parse_next_as_string(args));
+        empty_or_die(args);
 
-    CommandContext ctx = cmd_iter->second.parse(args);
-    empty_or_die(args);
+        command.execute = &execute_batch;
+        for (std::size_t i = 0; i < hosts.size(); ++i)
+            contexts.push_back(parse_batch(cmds, lines));
+    } else {
+        auto cmd_iter = cmds.find(args.front());
+
+        if (cmd_iter == cmds.end())
+            die_unknown_command(args.front());
+
+        args.pop();
+
+        command = cmd_iter->second;
+        for (std::size_t i = 0; i < hosts.size(); ++i) {
+            Arguments cmd_args(args);
+            contexts.push_back(command.parse(cmd_args));
+            empty_or_die(cmd_args);
+        }
+    }
 
     // execute the command
 
 #ifndef NDEBUG
-    std::cerr << "[DEBUG] Connect to host " << hostname << " on port " << port << "\n";
+    for (const auto &host : hosts) {
+        std::cerr << "[DEBUG] Connect to host " << host.hostname << " on port " << host.port;
+        if (!daemon_socket.empty())
+            std::cerr << " via woincd at " << daemon_socket;
+        std::cerr << "\n";
+    }
 #endif
 
-    Client client{hostname, port, password};
-    cmd_iter->second.execute(client, ctx);
+    if (fan_out_mode)
+        return fan_out(hosts, command, contexts, parallel, daemon_socket, print_metrics);
+
+    try {
+        Client client{hosts.front(), daemon_socket, print_metrics};
+        command.execute(client, contexts.front());
+    } catch (const HostError &error) {
+        std::cerr << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
 
     return EXIT_SUCCESS;
 }
@@ -182,13 +313,26 @@ namespace {
 
 void usage(std::ostream &out, int exit_code) {
     out << "\n"
-        << "Usage: " << EXEC_NAME__ << " [ --host <host[:port]> ] [ --passwd <password> ] <command>\n"
+        << "Usage: " << EXEC_NAME__ << " [ --host <host[:port]> .. ] [ --hosts <file> ] [ --passwd <password> ]\n"
+        << "       " << std::string(std::char_traits<char>::length(EXEC_NAME__), ' ')
+        << " [ --parallel <n> ] [ --via-daemon [ <socket> ] ] [ --metrics ] <command>\n"
         << "       " << EXEC_NAME__ << " -v|--version -- Show the version of woinccmd\n"
         << "       " << EXEC_NAME__ << " -?|-h|--help -- Show this help\n"
         << R"(
-  host:     The host to connect to, defaults to localhost
+  host:     The host to connect to, defaults to localhost;
+            repeat it to run the command on several hosts
+  hosts:    Run the command on the hosts in the file,
+            one "<host[:port]> [ <password> ]" per line
   password: The password to be used to connect to the host
             if the requested command needs authorization
+  parallel: The number of hosts the command runs on at the same time, defaults to 16;
+            the output of each host is printed once it's done, each line prefixed
+            by the host, and the failed hosts are summarized at the end
+  via-daemon: Send the command through woincd instead of connecting to the host,
+            the daemon answers the reads from its cache and is already authorized;
+            the socket defaults to $XDG_RUNTIME_DIR/woincd.sock
+  metrics:  Print the round trip time, the transferred bytes and the parsing time
+            of the rpcs to stderr
   command:  The command to exectue, see COMMANDS for a list of available commands
 
 COMMANDS:
@@ -225,6 +369,18 @@ COMMANDS:
     mode = always | auto | never
   --set_run_mode mode [ duration ]  set run mode for given duration
     mode = always | auto | never
+
+  ### woincd commands, need --via-daemon ###
+
+  --get_daemon_metrics              show the rpc, queue and handler metrics
+                                    woincd recorded for the host
+
+  ### batch mode ###
+
+  --batch [ file ]                  run the commands in the file, or in stdin if it's missing or "-",
+                                    one per line and over the same connection; the output of the
+                                    n-th command is framed by "@@ begin n <command>" and
+                                    "@@ end n ok" or "@@ end n failed: <error>"
 )";
 #ifdef WOINC_CLI_COMMANDS
     out << R"(
@@ -267,81 +423,133 @@ void error_die(const std::string &msg) {
 
 namespace {
 
-Client::Client(std::string hostname, std::uint16_t port, std::string password)
-    : hostname_(std::move(hostname)), port_(port), password_(std::move(password)) {}
+Client::Client(const Host &host, std::string daemon_socket, bool print_metrics,
+               std::ostream &out, std::ostream &err)
+    : hostname_(host.hostname), port_(host.port), password_(host.password),
+      print_metrics_after_rpc_(print_metrics), out_(out), err_(err), via_daemon_(!daemon_socket.empty()),
+      connection_(via_daemon_
+                  ? std::make_unique<woinc::ui::common::DaemonConnection>(std::move(daemon_socket))
+                  : std::make_unique<wrpc::Connection>()) {}
 
 void Client::do_cmd(wrpc::Command &cmd) {
     if (!connected_)
         connect_();
 
-    if (!authed_ &&
-        (!connection_.is_localhost() || cmd.requires_local_authorization())) {
+    if (!authed_ && !via_daemon_ &&
+        (!connection_->is_localhost() || cmd.requires_local_authorization())) {
         authorize_();
     }
 
-    execute_cmd_or_die_(cmd);
+    execute_cmd_or_throw_(cmd);
+}
+
+std::string Client::do_daemon_request(const std::string &request, const std::string &tag) {
+    if (!via_daemon_)
+        fail_("Error: the command is answered by woincd, please connect with --via-daemon", false);
+
+    if (!connected_)
+        connect_();
+
+    std::ostringstream reply;
+    auto result = connection_->do_rpc(request, reply);
+    if (!result)
+        fail_("Error: could not communicate with woincd: " + result.error);
+
+    const auto content = [&](const std::string &name, std::string &value) {
+        const auto text = reply.str();
+        auto begin = text.find("<" + name + ">");
+        auto end = text.find("</" + name + ">");
+        if (begin == std::string::npos || end == std::string::npos || end < begin)
+            return false;
+        begin += name.size() + 2;
+        value = text.substr(begin, end - begin);
+        return true;
+    };
+
+    std::string value;
+    if (content("error", value))
+        fail_("Error: " + value, false);
+    if (!content(tag, value))
+        fail_("Error: could not interpret the response from woincd");
+
+    return value;
 }
 
 void Client::connect_() {
     assert(!hostname_.empty());
 
-    auto result = connection_.open(hostname_, port_);
+    auto result = connection_->open(hostname_, port_);
     if (!result)
-        error_die("Could not connect to client: " + result.error);
+        fail_("Error: Could not connect to client: " + result.error);
 
     connected_ = true;
 }
 
 void Client::authorize_() {
     if (password_.empty())
-        error_die("Authorization needed, please set password with --passwd");
+        fail_("Error: Authorization needed, please set password with --passwd", false);
 
     wrpc::AuthorizeCommand cmd;
     cmd.request().password = password_;
 
-    execute_cmd_or_die_(cmd);
+    execute_cmd_or_throw_(cmd);
 
-    if (!cmd.response().authorized) {
-        std::cerr << "Authorization failure";
-        if (!cmd.error().empty())
-            std::cerr << ": " << cmd.error();
-        std::cerr << std::endl;
-        connection_.close();
-        exit(EXIT_FAILURE);
-    }
+    if (!cmd.response().authorized)
+        fail_("Authorization failure" + (cmd.error().empty() ? std::string() : ": " + cmd.error()));
 
     authed_ = true;
 }
 
-void Client::execute_cmd_or_die_(wrpc::Command &cmd) {
-    switch (cmd.execute(connection_)) {
+void Client::execute_cmd_or_throw_(wrpc::Command &cmd) {
+    auto status = cmd.execute(*connection_);
+
+    if (print_metrics_after_rpc_)
+        print_metrics_(cmd);
+
+    switch (status) {
         case wrpc::CommandStatus::Ok:
             return;
         case wrpc::CommandStatus::Disconnected:
-            std::cerr << "Error: not connected to BOINC-client\n";
-            break;
+            fail_("Error: not connected to BOINC-client");
         case wrpc::CommandStatus::Unauthorized:
-            std::cerr << "Operation failed: authentication error\n";
-            break;
+            fail_("Operation failed: authentication error");
         case wrpc::CommandStatus::ConnectionError:
-            std::cerr << "Error: could not communicate with BOINC-client: " << cmd.error() << "\n";
-            break;
+            fail_("Error: could not communicate with BOINC-client: " + cmd.error());
         case wrpc::CommandStatus::ClientError:
-            std::cerr << "Error: " << cmd.error() << "\n";
-            break;
+            fail_("Error: " + cmd.error(), false);
         case wrpc::CommandStatus::ParsingError:
             if (cmd.error().empty())
-                std::cerr << "Error: could not interpret the response from the BOINC-client: " << cmd.error() << "\n";
-            else
-                std::cerr << "Error: " << cmd.error() << "\n";
-            break;
+                fail_("Error: could not interpret the response from the BOINC-client: " + cmd.error());
+            fail_("Error: " + cmd.error());
         case wrpc::CommandStatus::LogicError:
-            std::cerr << "Logical error: " << cmd.error() << "\n";
-            break;
+            fail_("Logical error: " + cmd.error(), false);
     }
 
-    connection_.close();
-    exit(EXIT_FAILURE);
+    fail_("Logical error: unknown status of the command");
+}
+
+void Client::fail_(const std::string &msg, bool close) {
+    if (close) {
+        connection_->close();
+        connected_ = false;
+        authed_ = false;
+    }
+    throw HostError(msg);
+}
+
+void Client::print_metrics_(const wrpc::Command &cmd) const {
+    const auto &metrics = cmd.metrics();
+    const auto ms = [](std::uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3)
+        << "RPC metrics: " << metrics.rpcs << (metrics.rpcs == 1 ? " rpc" : " rpcs")
+        << ", round trip " << ms(metrics.round_trip_ns) << " ms"
+        << ", sent " << metrics.bytes_out << " bytes"
+        << ", received " << metrics.bytes_in << " bytes"
+        << ", parsing " << ms(metrics.parse_ns) << " ms\n";
+
+    err_ << out.str();
 }
 
 } // client impl
@@ -382,7 +590,14 @@ std::string time_to_string(time_t t, const char *format = "%c") {
     char buf[128];
     if (!t)
         return "---";
-    auto ret = std::strftime(buf, sizeof(buf), format, std::localtime(&t));
+    // the hosts may be printed in parallel, so use the reentrant variant
+    std::tm tm;
+#if defined(WIN32) || defined(_WIN32)
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    auto ret = std::strftime(buf, sizeof(buf), format, &tm);
     return ret > 0 ? buf : "";
 }
 
@@ -802,6 +1017,196 @@ void print(std::ostream &out, const woinc::ProjectConfig &config) {
 } // printing helpers
 
 
+// ---------------
+// --- fan out ---
+// ---------------
+
+namespace {
+
+void print_prefixed(std::ostream &out, const std::string &prefix, const std::string &text) {
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+        out << prefix << line << NL__;
+}
+
+int fan_out(const std::vector<Host> &hosts, const Command &command, const std::vector<CommandContext> &contexts,
+            std::size_t parallel, const std::string &daemon_socket, bool print_metrics) {
+    std::mutex print_mutex;
+    std::vector<std::string> errors(hosts.size());
+    std::atomic<std::size_t> next_host(0);
+
+    // the output of a host is printed at once when it's done, so the lines of the hosts don't interleave
+    auto work = [&]() {
+        for (auto i = next_host++; i < hosts.size(); i = next_host++) {
+            std::ostringstream out;
+            std::ostringstream err;
+
+            try {
+                Client client{hosts[i], daemon_socket, print_metrics, out, err};
+                command.execute(client, contexts[i]);
+            } catch (const HostError &error) {
+                errors[i] = error.what();
+            }
+
+            const auto prefix = hosts[i].name + ": ";
+
+            std::lock_guard<std::mutex> guard(print_mutex);
+            print_prefixed(std::cout, prefix, out.str());
+            std::cout.flush();
+            print_prefixed(std::cerr, prefix, err.str());
+            if (!errors[i].empty())
+                print_prefixed(std::cerr, prefix, errors[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < std::min(parallel, hosts.size()); ++i)
+        workers.emplace_back(work);
+    for (auto &worker : workers)
+        worker.join();
+
+    const auto failed = static_cast<std::size_t>(std::count_if(errors.cbegin(), errors.cend(),
+                                                               [](const std::string &e) { return !e.empty(); }));
+    if (failed == 0)
+        return EXIT_SUCCESS;
+
+    std::cerr << "\nFailed on " << failed << " of " << hosts.size() << " hosts:\n";
+    for (std::size_t i = 0; i < hosts.size(); ++i)
+        if (!errors[i].empty())
+            std::cerr << INDENT2__ << hosts[i].name << ": " << errors[i] << NL__;
+
+    return EXIT_FAILURE;
+}
+
+} // fan out
+
+
+// -------------
+// --- batch ---
+// -------------
+
+namespace {
+
+struct BatchStep {
+    std::string line;
+    Command command;
+    CommandContext context;
+};
+
+typedef std::vector<BatchStep> Batch;
+
+// splits at whitespace, double quotes group words and a backslash escapes the next character
+Arguments split_batch_line(const std::string &line) {
+    Arguments args;
+    std::string arg;
+    bool in_arg = false;
+    bool quoted = false;
+
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (c == '\\' && i + 1 < line.size()) {
+            arg += line[++i];
+            in_arg = true;
+        } else if (c == '"') {
+            quoted = !quoted;
+            in_arg = true;
+        } else if (!quoted && std::isspace(static_cast<unsigned char>(c))) {
+            if (in_arg)
+                args.push(std::move(arg));
+            arg.clear();
+            in_arg = false;
+        } else {
+            arg += c;
+            in_arg = true;
+        }
+    }
+
+    if (quoted)
+        error_die("Missing closing quote in batch line: " + line);
+    if (in_arg)
+        args.push(std::move(arg));
+
+    return args;
+}
+
+std::vector<std::string> read_batch(const std::string &path) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file)
+            error_die("Could not read the batch file \"" + path + "\"");
+    }
+    std::istream &in = path == "-" ? std::cin : file;
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == line.npos || line[first] == '#')
+            continue;
+        auto last = line.find_last_not_of(" \t\r");
+        lines.push_back(line.substr(first, last - first + 1));
+    }
+
+    return lines;
+}
+
+CommandContext parse_batch(const CommandMap &cmds, const std::vector<std::string> &lines) {
+    auto batch = std::make_unique<Batch>();
+    batch->reserve(lines.size());
+
+    for (const auto &line : lines) {
+        auto args = split_batch_line(line);
+        if (args.empty())
+            continue;
+
+        auto cmd_iter = cmds.find(args.front());
+        if (cmd_iter == cmds.end())
+            die_unknown_command(args.front());
+        args.pop();
+
+        batch->push_back({line, cmd_iter->second, cmd_iter->second.parse(args)});
+        empty_or_die(args);
+    }
+
+    return batch.release();
+}
+
+// The output of each command is framed by
+//   @@ begin <n> <command line>
+//   @@ end <n> ok|failed: <error>
+// so scripts can split it, n counts the commands of the batch from 1 on
+void execute_batch(Client &client, CommandContext ctx) {
+    assert(ctx != nullptr);
+    std::unique_ptr<Batch> batch(static_cast<Batch *>(ctx));
+
+    std::size_t failed = 0;
+
+    for (std::size_t i = 0; i < batch->size(); ++i) {
+        auto &step = (*batch)[i];
+        client.out() << "@@ begin " << (i + 1) << " " << step.line << NL__;
+
+        try {
+            step.command.execute(client, step.context);
+            client.out() << "@@ end " << (i + 1) << " ok" << NL__;
+        } catch (const HostError &error) {
+            ++failed;
+            client.out() << "@@ end " << (i + 1) << " failed: " << error.what() << NL__;
+        }
+
+        // the results are streamed as they come in
+        client.out().flush();
+    }
+
+    if (failed > 0)
+        throw HostError("Error: " + std::to_string(failed) + " of " + std::to_string(batch->size())
+                        + " commands of the batch failed");
+}
+
+} // batch
+
+
 // -----------------------
 // --- parsing helpers ---
 // -----------------------
@@ -847,6 +1252,32 @@ void parse_host(std::string &hostname, std::uint16_t &port) {
     }
 }
 
+Host parse_host_spec(const std::string &spec, const std::string &password) {
+    Host host;
+    host.name = spec;
+    host.hostname = spec;
+    host.password = password;
+    parse_host(host.hostname, host.port);
+    return host;
+}
+
+void read_hosts(const std::string &path, const std::string &password, std::vector<Host> &hosts) {
+    std::ifstream in(path);
+    if (!in)
+        error_die("Could not read the hosts file \"" + path + "\"");
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string spec;
+        if (!(fields >> spec) || spec[0] == '#')
+            continue;
+
+        hosts.push_back(parse_host_spec(spec, password));
+        fields >> hosts.back().password;
+    }
+}
+
 void empty_or_die(const Arguments &args) {
     if (!args.empty())
         die_unknown_command(args.front());
@@ -956,22 +1387,20 @@ void do_get_project_config_cmd(Client &client, CommandContext ctx) {
         auto config = std::move(poll_cmd.response().project_config);
 
         if (config.error_num == 0) {
-            print(std::cout, config);
+            print(client.out(), config);
             return;
         } else if (config.error_num == -204) { // TODO don't hardcode the error code
             // print with forced flush to show progress
-            std::cout << "poll status: operation in progress" << std::endl;
+            client.out() << "poll status: operation in progress" << std::endl;
         } else {
-            std::cout << "poll status: " << config.error_num << std::endl;
-            exit(EXIT_FAILURE);
+            throw HostError("poll status: " + std::to_string(config.error_num));
         }
 
         using namespace std::chrono_literals;
         std::this_thread::sleep_for(1s);
     }
 
-    std::cout << "didn't receive answer in given time\n";
-    exit(EXIT_FAILURE);
+    throw HostError("didn't receive answer in given time");
 }
 
 void do_lookup_account_cmd(Client &client, CommandContext ctx) {
@@ -990,25 +1419,36 @@ void do_lookup_account_cmd(Client &client, CommandContext ctx) {
         auto account = std::move(poll_cmd.response().account_out);
 
         if (account.error_num == 0) {
-            print(std::cout, account);
+            print(client.out(), account);
             return;
         } else if (account.error_num == -204) { // TODO don't hardcode the error code
             // print with forced flush to show progress
-            std::cout << "poll status: operation in progress" << std::endl;
+            client.out() << "poll status: operation in progress" << std::endl;
         } else {
-            std::cout << "poll status: " << account.error_num << std::endl;
-            exit(EXIT_FAILURE);
+            throw HostError("poll status: " + std::to_string(account.error_num));
         }
 
         using namespace std::chrono_literals;
         std::this_thread::sleep_for(1s);
     }
 
-    std::cout << "didn't receive answer in given time\n";
-    exit(EXIT_FAILURE);
+    throw HostError("didn't receive answer in given time");
 }
 } // boinc commands
 
+// ---------------------------
+// --- the woincd commands ---
+// ---------------------------
+
+namespace {
+
+void do_get_daemon_metrics_cmd(Client &client, CommandContext) {
+    client.out() << client.do_daemon_request(woinc::ui::common::daemon_get_metrics_request(),
+                                             woinc::ui::common::DAEMON_GET_METRICS_TAG);
+}
+
+} // woincd commands
+
 // --------------------------
 // --- the woinc commands ---
 // --------------------------
@@ -1210,7 +1650,7 @@ void do_show_tasks_statistics(Client &client) {
         entries.push_back(std::move(entry));
     }
 
-    print_table(std::cout, entries.cbegin(), entries.cend());
+    print_table(client.out(), entries.cbegin(), entries.cend());
 }
 
 void do_sum_remaining_cpu_time(Client &client) {
@@ -1249,7 +1689,7 @@ void do_sum_remaining_cpu_time(Client &client) {
                                      [](const double s, const auto &i) { return s + i.second; });
     entries.push_back({"Sum", duration_to_string(seconds), duration_to_string(seconds / num_cpus)});
 
-    print_table(std::cout, entries.cbegin(), entries.cend());
+    print_table(client.out(), entries.cbegin(), entries.cend());
 }
 
 void do_estimate_times(Client &client) {
@@ -1281,15 +1721,15 @@ void do_estimate_times(Client &client) {
         int lw = 16;
         int rw = static_cast<int>(finished_at_str.length());
 
-        std::cout << NL__ << task.name << NL__ << std::string(task.name.length(), '-') << NL__ << NL__;
-        print_left_col (std::cout, lw, "Estimated time");
-        print_right_col(std::cout, rw, duration_to_string(estimated_time));
-        print_left_col (std::cout, lw, "Already done");
-        print_right_col(std::cout, rw, duration_to_string(active_task.current_cpu_time));
-        print_left_col (std::cout, lw, "Time to finish");
-        print_right_col(std::cout, rw, duration_to_string(estimated_time - active_task.current_cpu_time));
-        print_left_col (std::cout, lw, "Finished at");
-        print_right_col(std::cout, rw, finished_at_str);
+        client.out() << NL__ << task.name << NL__ << std::string(task.name.length(), '-') << NL__ << NL__;
+        print_left_col (client.out(), lw, "Estimated time");
+        print_right_col(client.out(), rw, duration_to_string(estimated_time));
+        print_left_col (client.out(), lw, "Already done");
+        print_right_col(client.out(), rw, duration_to_string(active_task.current_cpu_time));
+        print_left_col (client.out(), lw, "Time to finish");
+        print_right_col(client.out(), rw, duration_to_string(estimated_time - active_task.current_cpu_time));
+        print_left_col (client.out(), lw, "Finished at");
+        print_right_col(client.out(), rw, finished_at_str);
     }
 }
 
@@ -1309,7 +1749,7 @@ void do_get_statistics(Client &client, bool user_mode) {
             << " " << std::right << std::setprecision(2) << std::setw(width) << value << NL__;
     };
 
-    std::cout
+    client.out()
         << "======== Project statistics ========\n"
         << std::fixed;
 
@@ -1333,26 +1773,26 @@ void do_get_statistics(Client &client, bool user_mode) {
                                                   : a.host_total_credit < b.host_total_credit;
                                           });
 
-        std::cout << ++counter << ") -----------\n"
+        client.out() << ++counter << ") -----------\n"
             << indent << "Project: " << project->project_name << NL__
             << indent << "Account: " << project->user_name << NL__;
         if (!project->team_name.empty())
-            std::cout << indent << "Team: " << project->team_name << NL__;
-        std::cout << indent << "Last updated: "
+            client.out() << indent << "Team: " << project->team_name << NL__;
+        client.out() << indent << "Last updated: "
             << std::setprecision(0)
             << std::floor(std::chrono::duration_cast<std::chrono::seconds>(last_updated).count() / (24*3600))
             << " days ago" << NL__;
 
-        std::cout << indent << "Average statistics: " << NL__;
+        client.out() << indent << "Average statistics: " << NL__;
         for (const auto &stats : project_stats.daily_statistics)
-            print_stats_line(std::cout,
+            print_stats_line(client.out(),
                              user_mode ? max_avg->user_expavg_credit : max_avg->host_expavg_credit,
                              stats.day,
                              user_mode ? stats.user_expavg_credit : stats.host_expavg_credit);
 
-        std::cout << indent << "Total statistics: " << NL__;
+        client.out() << indent << "Total statistics: " << NL__;
         for (const auto &stats : project_stats.daily_statistics)
-            print_stats_line(std::cout,
+            print_stats_line(client.out(),
                              user_mode ? max_total->user_total_credit : max_total->user_expavg_credit,
                              stats.day,
                              user_mode ? stats.user_total_credit : stats.host_total_credit);
@@ -1369,7 +1809,7 @@ constexpr auto create_cmd_executor() {
     return [](Client &client, CommandContext ctx) {
         assert(ctx != nullptr);
         client.do_cmd(*static_cast<CMD *>(ctx));
-        print(std::cout, static_cast<CMD *>(ctx)->response());
+        print(client.out(), static_cast<CMD *>(ctx)->response());
         delete static_cast<CMD *>(ctx);
     };
 }
@@ -1396,6 +1836,10 @@ CommandMap command_map() {
             create_cmd_executor<wrpc::FileTransferOpCommand>()
         }},
         { "--get_cc_status", create_cmd_without_request_data<wrpc::GetCCStatusCommand>() },
+        { "--get_daemon_metrics", {
+            [](Arguments &) -> CommandContext { return nullptr; },
+            &do_get_daemon_metrics_cmd
+        }},
         { "--get_disk_usage", create_cmd_without_request_data<wrpc::GetDiskUsageCommand>() },
         { "--get_file_transfers", create_cmd_without_request_data<wrpc::GetFileTransfersCommand>() },
         { "--get_host_info", create_cmd_without_request_data<wrpc::GetHostInfoCommand>() },
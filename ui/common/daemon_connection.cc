@@ -0,0 +1,263 @@
+/* ui/common/daemon_connection.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "common/daemon_connection.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char EOM__ = 0x03;
+constexpr std::size_t BUFFER_SIZE__ = 32 * 1024;
+// the daemon may have to wait for the rpcs to the client before forwarding ours
+constexpr std::chrono::milliseconds DEFAULT_TIMEOUT__ = std::chrono::seconds(60);
+
+std::string errno_to_string__(const char *what) {
+    return std::string(what) + ": " + std::strerror(errno);
+}
+
+}
+
+namespace woinc { namespace ui { namespace common {
+
+std::string default_daemon_socket() {
+    const char *runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir != nullptr && *runtime_dir != '\0')
+        return std::string(runtime_dir) + "/woincd.sock";
+    return "/tmp/woincd-" + std::to_string(getuid()) + ".sock";
+}
+
+std::string daemon_select_host_request(const std::string &hostname, std::uint16_t port) {
+    std::ostringstream request;
+    request << "<boinc_gui_rpc_request>\n"
+        << "<" << DAEMON_SELECT_HOST_TAG << ">\n"
+        << "<host>" << hostname << "</host>\n"
+        << "<port>" << port << "</port>\n"
+        << "</" << DAEMON_SELECT_HOST_TAG << ">\n"
+        << "</boinc_gui_rpc_request>\n";
+    return request.str();
+}
+
+std::string daemon_get_metrics_request() {
+    return std::string("<boinc_gui_rpc_request>\n<") + DAEMON_GET_METRICS_TAG + "/>\n</boinc_gui_rpc_request>\n";
+}
+
+DaemonConnection::DaemonConnection(std::string socket_path)
+    : socket_path_(std::move(socket_path)) {}
+
+DaemonConnection::~DaemonConnection() {
+    close();
+}
+
+woinc::rpc::Connection::Result DaemonConnection::open(const std::string &hostname, std::uint16_t port) {
+    close();
+
+    if (interrupted_)
+        return Result(woinc::rpc::ConnectionStatus::Error, "Interrupted");
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path_.empty() || socket_path_.size() >= sizeof(address.sun_path))
+        return Result(woinc::rpc::ConnectionStatus::Error, "Invalid path of the socket of woincd: \"" + socket_path_ + "\"");
+    std::copy(socket_path_.cbegin(), socket_path_.cend(), address.sun_path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return Result(woinc::rpc::ConnectionStatus::Error, errno_to_string__("Could not create socket"));
+
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        auto error = errno_to_string__(("Could not connect to woincd at " + socket_path_).c_str());
+        ::close(fd);
+        return Result(woinc::rpc::ConnectionStatus::Error, std::move(error));
+    }
+
+    socket_ = fd;
+
+    std::ostringstream reply;
+    auto result = do_rpc(daemon_select_host_request(hostname, port), reply);
+    if (!result)
+        return result;
+
+    const auto content = reply.str();
+    if (content.find("<success/>") == std::string::npos) {
+        close();
+
+        const auto begin = content.find("<error>");
+        const auto end = content.find("</error>");
+        if (begin != std::string::npos && end != std::string::npos && begin < end)
+            return Result(woinc::rpc::ConnectionStatus::Error, content.substr(begin + 7, end - begin - 7));
+        return Result(woinc::rpc::ConnectionStatus::Error, "Unexpected reply of woincd");
+    }
+
+    return Result();
+}
+
+void DaemonConnection::close() {
+    int fd = socket_.exchange(-1);
+    if (fd >= 0)
+        ::close(fd);
+}
+
+woinc::rpc::Connection::Result DaemonConnection::do_rpc(const std::string &request, std::ostream &response) {
+    timeline_ = Timeline();
+    timeline_.started = std::chrono::steady_clock::now();
+
+    if (socket_ < 0)
+        return Result(woinc::rpc::ConnectionStatus::Disconnected);
+
+    auto result = send_(request);
+    if (result)
+        result = send_(std::string(1, EOM__));
+    if (!result)
+        return abort_(std::move(result));
+
+    timeline_.sent = std::chrono::steady_clock::now();
+
+    result = receive_(response);
+    if (!result)
+        return abort_(std::move(result));
+
+    timeline_.completed = std::chrono::steady_clock::now();
+
+    return Result();
+}
+
+void DaemonConnection::deadline(std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+}
+
+void DaemonConnection::interrupt() {
+    interrupted_ = true;
+    int fd = socket_;
+    if (fd >= 0)
+        ::shutdown(fd, SHUT_RDWR);
+}
+
+bool DaemonConnection::is_connected() const {
+    return socket_ >= 0;
+}
+
+bool DaemonConnection::is_localhost() const {
+    return true;
+}
+
+const woinc::rpc::Connection::Timeline &DaemonConnection::timeline() const {
+    return timeline_;
+}
+
+woinc::rpc::Connection::Result DaemonConnection::send_(const std::string &data) {
+    std::size_t sent = 0;
+
+    while (sent < data.size()) {
+        auto result = wait_(POLLOUT);
+        if (!result)
+            return result;
+
+        auto n = ::send(socket_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return Result(woinc::rpc::ConnectionStatus::Error, errno_to_string__("Could not send to woincd"));
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+
+    return Result();
+}
+
+woinc::rpc::Connection::Result DaemonConnection::receive_(std::ostream &out) {
+    char buffer[BUFFER_SIZE__];
+
+    while (true) {
+        auto result = wait_(POLLIN);
+        if (!result)
+            return result;
+
+        auto n = ::recv(socket_, buffer, sizeof(buffer), 0);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return Result(woinc::rpc::ConnectionStatus::Error, errno_to_string__("Could not receive from woincd"));
+        }
+        if (n == 0)
+            return Result(woinc::rpc::ConnectionStatus::Disconnected, "woincd closed the connection");
+
+        if (timeline_.first_byte == std::chrono::steady_clock::time_point::min())
+            timeline_.first_byte = std::chrono::steady_clock::now();
+
+        auto to_write = static_cast<std::streamsize>(n);
+        const bool eom = buffer[to_write - 1] == EOM__;
+        if (eom)
+            --to_write;
+
+        if (!out.write(buffer, to_write))
+            return Result(woinc::rpc::ConnectionStatus::Error);
+
+        if (eom)
+            return Result();
+    }
+}
+
+woinc::rpc::Connection::Result DaemonConnection::wait_(short events) {
+    while (true) {
+        if (interrupted_)
+            return Result(woinc::rpc::ConnectionStatus::Error, "Interrupted");
+
+        auto timeout = DEFAULT_TIMEOUT__;
+        if (deadline_ != std::chrono::steady_clock::time_point::max()) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline_ - std::chrono::steady_clock::now());
+            if (remaining <= std::chrono::milliseconds::zero())
+                return Result(woinc::rpc::ConnectionStatus::Error, "Deadline exceeded");
+            timeout = std::min(timeout, remaining);
+        }
+
+        pollfd fd;
+        fd.fd = socket_;
+        fd.events = events;
+        fd.revents = 0;
+
+        int ready = ::poll(&fd, 1, static_cast<int>(timeout.count()));
+        if (ready > 0)
+            return Result();
+        if (ready == 0)
+            return Result(woinc::rpc::ConnectionStatus::Error, "Timeout while waiting for woincd");
+        if (errno != EINTR)
+            return Result(woinc::rpc::ConnectionStatus::Error, errno_to_string__("Could not wait for woincd"));
+    }
+}
+
+woinc::rpc::Connection::Result DaemonConnection::abort_(Result result) {
+    // the rest of the reply may still arrive, so the connection is out of sync
+    close();
+    return result;
+}
+
+}}}
@@ -0,0 +1,86 @@
+/* ui/common/daemon_connection.h --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef WOINC_UI_COMMON_DAEMON_CONNECTION_H_
+#define WOINC_UI_COMMON_DAEMON_CONNECTION_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <woinc/rpc_connection.h>
+
+namespace woinc { namespace ui { namespace common {
+
+// The unix socket woincd listens on if not told otherwise:
+// $XDG_RUNTIME_DIR/woincd.sock, or /tmp/woincd-<uid>.sock if there is no runtime directory
+std::string default_daemon_socket();
+
+// The first request on a connection to woincd, selecting the host whose client the following rpcs are sent to.
+// It's answered like a GUI-RPC, with <success/> if the daemon is connected to the host or an <error> otherwise.
+constexpr const char *DAEMON_SELECT_HOST_TAG = "woincd_select_host";
+std::string daemon_select_host_request(const std::string &hostname, std::uint16_t port);
+
+// Answered by the daemon itself with a table of the metrics its controller recorded for the selected host,
+// as the content of the element with the same tag.
+constexpr const char *DAEMON_GET_METRICS_TAG = "woincd_get_metrics";
+std::string daemon_get_metrics_request();
+
+// Sends the rpcs to the client of a host through woincd instead of connecting to the client directly.
+// Opening it connects to the socket of the daemon and selects the host by the url and port it was added with.
+// The daemon keeps its connection to the client authorized, so the rpcs don't need to be authorized.
+class DaemonConnection : public woinc::rpc::Connection {
+    public:
+        explicit DaemonConnection(std::string socket_path);
+        ~DaemonConnection() override;
+
+        Result open(const std::string &hostname, std::uint16_t port = DefaultBOINCPort) override;
+        void close() override;
+
+        Result do_rpc(const std::string &request, std::ostream &response) override;
+
+        void deadline(std::chrono::steady_clock::time_point deadline) override;
+        void interrupt() override;
+
+        bool is_connected() const override;
+        // the daemon is always local
+        bool is_localhost() const override;
+
+        const Timeline &timeline() const override;
+
+    private:
+        Result send_(const std::string &data);
+        // receives the rest of the message up to the end of message marker, which isn't written
+        Result receive_(std::ostream &out);
+        // waits until the socket is ready for the events or the deadline passed
+        Result wait_(short events);
+        Result abort_(Result result);
+
+    private:
+        const std::string socket_path_;
+        // atomic to be shut down by interrupt()
+        std::atomic<int> socket_{-1};
+        std::atomic<bool> interrupted_{false};
+        std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+        Timeline timeline_;
+};
+
+}}}
+
+#endif
@@ -0,0 +1,1011 @@
+/* ui/daemon/main.cc --
+   Written and Copyright (C) 2026 by vmc.
+
+   This file is part of woinc.
+
+   woinc is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   woinc is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with woinc. If not, see <http://www.gnu.org/licenses/>. */
+
+// woincd keeps authorized connections to the configured hosts, polls their state with libwoincui
+// and serves local clients like woinccmd over a unix socket, see usage() for the options.
+//
+// The local clients speak GUI-RPC to the daemon, starting with a request selecting the host,
+// see woinc::ui::common::DaemonConnection. The reads are answered from the cached replies of the host
+// if they are recent enough, all other requests are forwarded over the connection of the controller.
+// The replies are cached by the request, so a read is only answered from the cache if it's byte-identical
+// to a polled or previously forwarded one, which holds for the reads of woinccmd and libwoincui.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <woinc/rpc_connection.h>
+#include <woinc/ui/controller.h>
+#include <woinc/ui/metrics.h>
+
+#include "common/daemon_connection.h"
+
+namespace wrpc = woinc::rpc;
+namespace wui = woinc::ui;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+constexpr char EOM__ = 0x03;
+// larger requests aren't sent by the GUI-RPC clients, so those are refused
+constexpr std::size_t MAX_REQUEST_SIZE__ = 1024 * 1024;
+constexpr std::size_t MAX_SESSIONS__ = 256;
+// the polled tasks, the forwarded reads and some incremental polls of messages and notices
+constexpr std::size_t MAX_CACHED_REPLIES__ = 32;
+constexpr std::chrono::seconds FORWARD_TIMEOUT__(30);
+constexpr std::chrono::seconds RETRY_INTERVAL__(30);
+
+// The messages, notices and statistics are polled incrementally, so their replies are useless for the cache
+// and they aren't polled at all
+const std::set<woinc::ui::PeriodicTask> POLLED_TASKS__ = {
+    woinc::ui::PeriodicTask::GetCCStatus, woinc::ui::PeriodicTask::GetClientState,
+    woinc::ui::PeriodicTask::GetDiskUsage, woinc::ui::PeriodicTask::GetFileTransfers,
+    woinc::ui::PeriodicTask::GetProjectStatus, woinc::ui::PeriodicTask::GetTasks
+};
+
+struct HostConfig {
+    std::string url;
+    std::uint16_t port = wrpc::Connection::DefaultBOINCPort;
+    std::string password;
+
+    std::string name() const {
+        return (url.find(':') == std::string::npos ? url : "[" + url + "]") + ":" + std::to_string(port);
+    }
+};
+
+struct Options {
+    std::string socket = woinc::ui::common::default_daemon_socket();
+    std::chrono::seconds interval{10};
+    std::chrono::seconds state_interval{60};
+    std::vector<HostConfig> hosts;
+    bool verbose = false;
+};
+
+volatile std::sig_atomic_t stop__ = 0;
+
+extern "C" void on_signal__(int) {
+    stop__ = 1;
+}
+
+[[ noreturn ]] void usage(std::ostream &out, int exit_code) {
+    out << "Usage: woincd [options] [ <host[:port]> .. ]\n"
+        << "\n"
+        << "Keeps authorized connections to the hosts, polls their state and serves\n"
+        << "local clients like woinccmd --via-daemon over a unix socket.\n"
+        << "\n"
+        << "Hosts:\n"
+        << "  --hosts FILE          read the hosts from the file, one \"<host[:port]> [ <password> ]\" per line\n"
+        << "  --passwd PASSWORD     the password of the hosts given on the command line\n"
+        << "\n"
+        << "Polling:\n"
+        << "  --interval SEC        poll the cc status, file transfers, projects and tasks every SEC seconds (default 10)\n"
+        << "  --state-interval SEC  poll the client state and the disk usage every SEC seconds (default 60)\n"
+        << "                        the polled replies are answered from the cache for twice their interval,\n"
+        << "                        all other reads for the interval\n"
+        << "\n"
+        << "Misc:\n"
+        << "  --socket PATH         the unix socket to listen on (default $XDG_RUNTIME_DIR/woincd.sock)\n"
+        << "  --verbose             log the requests of the local clients to stderr\n";
+    std::exit(exit_code);
+}
+
+[[ noreturn ]] void die(const std::string &msg) {
+    std::cerr << "woincd: " << msg << "\n";
+    std::exit(EXIT_FAILURE);
+}
+
+template<typename T>
+T parse_number__(const std::string &option, const std::string &value) {
+    try {
+        std::size_t end;
+        auto result = std::stoull(value, &end);
+        if (end == value.size() && value.front() != '-' && result <= std::numeric_limits<T>::max())
+            return static_cast<T>(result);
+    } catch (...) {}
+    die("Invalid value \"" + value + "\" of " + option);
+}
+
+HostConfig parse_host__(const std::string &spec) {
+    HostConfig host;
+    host.url = spec;
+
+    std::string port;
+    if (spec.front() == '[') { // ipv6 address with optional port
+        auto idx = spec.rfind(']');
+        if (idx == std::string::npos || idx == 1 || (idx + 1 < spec.size() && spec[idx + 1] != ':'))
+            die("Invalid IPv6 address \"" + spec + "\"");
+        host.url = spec.substr(1, idx - 1);
+        if (idx + 1 < spec.size())
+            port = spec.substr(idx + 2);
+    } else if (spec.find(':') == spec.rfind(':') && spec.find(':') != std::string::npos) {
+        host.url = spec.substr(0, spec.find(':'));
+        port = spec.substr(spec.find(':') + 1);
+    }
+
+    if (!port.empty())
+        host.port = parse_number__<std::uint16_t>(spec, port);
+    if (host.url.empty())
+        die("Invalid host \"" + spec + "\"");
+
+    return host;
+}
+
+void read_hosts__(const std::string &path, std::vector<HostConfig> &hosts) {
+    std::ifstream in(path);
+    if (!in)
+        die("Could not read the hosts file \"" + path + "\"");
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string spec;
+        if (!(fields >> spec) || spec.front() == '#')
+            continue;
+
+        auto host = parse_host__(spec);
+        fields >> host.password;
+        hosts.push_back(std::move(host));
+    }
+}
+
+Options parse_options(int argc, char **argv) {
+    Options options;
+    std::string password;
+    std::vector<HostConfig> command_line_hosts;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string option(argv[i]);
+
+        if (option == "-h" || option == "--help")
+            usage(std::cout, EXIT_SUCCESS);
+        if (option == "--verbose") {
+            options.verbose = true;
+            continue;
+        }
+        if (option.empty() || option.front() != '-') {
+            command_line_hosts.push_back(parse_host__(option));
+            continue;
+        }
+
+        auto value = [&]() -> std::string {
+            if (i + 1 == argc)
+                die("Missing value after " + option);
+            return argv[++i];
+        };
+
+        if (option == "--hosts")               read_hosts__(value(), options.hosts);
+        else if (option == "--passwd")         password = value();
+        else if (option == "--interval")       options.interval = std::chrono::seconds(parse_number__<std::uint32_t>(option, value()));
+        else if (option == "--state-interval") options.state_interval = std::chrono::seconds(parse_number__<std::uint32_t>(option, value()));
+        else if (option == "--socket")         options.socket = value();
+        else usage(std::cerr, EXIT_FAILURE);
+    }
+
+    for (auto &host : command_line_hosts) {
+        host.password = password;
+        options.hosts.push_back(std::move(host));
+    }
+
+    if (options.hosts.empty())
+        die("No hosts given");
+    if (options.interval.count() == 0 || options.state_interval.count() == 0)
+        die("The intervals have to be positive");
+
+    return options;
+}
+
+// ---- requests ----
+
+// the tag of the command within <boinc_gui_rpc_request>
+std::string command__(const std::string &request) {
+    auto begin = request.find("<boinc_gui_rpc_request>");
+    if (begin == std::string::npos)
+        return "";
+    begin = request.find('<', begin + 1);
+    if (begin == std::string::npos)
+        return "";
+    auto end = request.find_first_of("/> \n", ++begin);
+    return end == std::string::npos ? "" : request.substr(begin, end - begin);
+}
+
+std::string content__(const std::string &request, const std::string &tag) {
+    const auto open = "<" + tag + ">";
+    auto begin = request.find(open);
+    if (begin == std::string::npos)
+        return "";
+    begin += open.size();
+    auto end = request.find("</" + tag + ">", begin);
+    return end == std::string::npos ? "" : request.substr(begin, end - begin);
+}
+
+// The commands only reading the state of the client, their replies are cached.
+// The polls of the async operations and the project config are excluded, they'd hide the progress of the operation.
+bool cached_read__(const std::string &command) {
+    if (command == "exchange_versions")
+        return true;
+    return command.compare(0, 4, "get_") == 0
+        && command != "get_project_config"
+        && (command.size() < 5 || command.compare(command.size() - 5, 5, "_poll") != 0);
+}
+
+// the other reads don't change the state of the client, so they don't invalidate the cache
+bool read__(const std::string &command) {
+    return cached_read__(command) || command.compare(0, 4, "get_") == 0 || command == "lookup_account"
+        || command.compare(0, 4, "auth") == 0;
+}
+
+std::string reply__(const std::string &content) {
+    return "<boinc_gui_rpc_reply>\n" + content + "</boinc_gui_rpc_reply>\n";
+}
+
+std::string error_reply__(const std::string &error) {
+    return reply__("<error>" + error + "</error>\n");
+}
+
+// ---- Host ----
+
+class SharedConnection;
+
+// The state of a host shared by the connection of the controller and the sessions of the local clients
+class Host {
+    public:
+        Host(HostConfig config, const Options &options) : config_(std::move(config)), options_(options) {}
+
+        const HostConfig &config() const { return config_; }
+
+        // the cached reply to the request if it isn't older than max_age, otherwise requested from the client
+        wrpc::Connection::Result read(const std::string &request, std::chrono::milliseconds max_age,
+                                      std::shared_ptr<const std::string> &reply, bool &cached);
+        wrpc::Connection::Result forward(const std::string &request, std::shared_ptr<const std::string> &reply);
+
+        // the cached replies are kept for the interval, the polled ones for twice their interval
+        std::chrono::milliseconds max_age(const std::string &command) const;
+
+    public: // called by the connection of the controller while holding the rpc mutex
+        std::mutex &rpc_mutex() { return rpc_mutex_; }
+        // a readded host may connect before the connection of the removed one is destroyed, so there may be two
+        void attach(SharedConnection *connection) { connections_.push_back(connection); }
+        void detach(SharedConnection *connection);
+
+        // caches the reply to a read, other commands invalidate the cache
+        std::shared_ptr<const std::string> replied(const std::string &request, std::string reply);
+
+    private:
+        struct CachedReply {
+            std::shared_ptr<const std::string> reply;
+            Clock::time_point received;
+        };
+
+        std::shared_ptr<const std::string> cached_(const std::string &request, std::chrono::milliseconds max_age) const;
+        wrpc::Connection::Result forward_(const std::string &request, std::shared_ptr<const std::string> &reply);
+
+    private:
+        const HostConfig config_;
+        const Options &options_;
+
+        // serializes the rpcs over the connection, the ones of the controller and the forwarded ones,
+        // and guards the connections; locked before the cache mutex
+        std::mutex rpc_mutex_;
+        // in the order they were attached
+        std::vector<SharedConnection *> connections_;
+
+        mutable std::mutex cache_mutex_;
+        std::map<std::string, CachedReply> cache_;
+};
+
+// The connection of the controller to the client of a host, shared with the sessions forwarding their rpcs over it
+class SharedConnection : public wrpc::Connection {
+    public:
+        explicit SharedConnection(Host &host) : host_(host) {
+            std::lock_guard<std::mutex> guard(host_.rpc_mutex());
+            host_.attach(this);
+        }
+
+        ~SharedConnection() override {
+            std::lock_guard<std::mutex> guard(host_.rpc_mutex());
+            host_.detach(this);
+            connection_.close();
+        }
+
+        Result open(const std::string &hostname, std::uint16_t port) override {
+            std::lock_guard<std::mutex> guard(host_.rpc_mutex());
+            return connection_.open(hostname, port);
+        }
+
+        void close() override {
+            std::lock_guard<std::mutex> guard(host_.rpc_mutex());
+            connection_.close();
+        }
+
+        Result do_rpc(const std::string &request, std::ostream &response) override {
+            std::lock_guard<std::mutex> guard(host_.rpc_mutex());
+
+            std::shared_ptr<const std::string> reply;
+            auto result = exchange(request, reply, deadline_);
+            timeline_ = connection_.timeline();
+
+            if (result && !response.write(reply->data(), static_cast<std::streamsize>(reply->size())))
+                return Result(wrpc::ConnectionStatus::Error);
+
+            return result;
+        }
+
+        void deadline(Clock::time_point deadline) override {
+            deadline_ = deadline;
+        }
+
+        void interrupt() override {
+            connection_.interrupt();
+        }
+
+        bool is_connected() const override {
+            std::lock_guard<std::mutex> guard(host_.rpc_mutex());
+            return connection_.is_connected();
+        }
+
+        bool is_localhost() const override {
+            std::lock_guard<std::mutex> guard(host_.rpc_mutex());
+            return connection_.is_localhost();
+        }
+
+        const Timeline &timeline() const override {
+            return timeline_;
+        }
+
+    public: // called while holding the rpc mutex of the host
+        Result exchange(const std::string &request, std::shared_ptr<const std::string> &reply,
+                        Clock::time_point deadline) {
+            if (!connection_.is_connected())
+                return Result(wrpc::ConnectionStatus::Disconnected, "Not connected to the client");
+
+            std::ostringstream out;
+            connection_.deadline(deadline);
+            auto result = connection_.do_rpc(request, out);
+            if (result)
+                reply = host_.replied(request, out.str());
+
+            return result;
+        }
+
+    private:
+        Host &host_;
+        wrpc::Connection connection_;
+        // the deadline of the rpcs of the controller
+        Clock::time_point deadline_ = Clock::time_point::max();
+        // the timeline of the last rpc of the controller
+        Timeline timeline_;
+};
+
+wrpc::Connection::Result Host::read(const std::string &request, std::chrono::milliseconds max_age,
+                                    std::shared_ptr<const std::string> &reply, bool &cached) {
+    cached = true;
+    if ((reply = cached_(request, max_age)))
+        return wrpc::Connection::Result();
+
+    std::lock_guard<std::mutex> guard(rpc_mutex_);
+
+    // another session may have requested it while we were waiting
+    if ((reply = cached_(request, max_age)))
+        return wrpc::Connection::Result();
+
+    cached = false;
+    return forward_(request, reply);
+}
+
+wrpc::Connection::Result Host::forward(const std::string &request, std::shared_ptr<const std::string> &reply) {
+    std::lock_guard<std::mutex> guard(rpc_mutex_);
+    return forward_(request, reply);
+}
+
+wrpc::Connection::Result Host::forward_(const std::string &request, std::shared_ptr<const std::string> &reply) {
+    // the newest connection first, an older one is about to be destroyed
+    for (auto connection = connections_.rbegin(); connection != connections_.rend(); ++connection) {
+        auto result = (*connection)->exchange(request, reply, Clock::now() + FORWARD_TIMEOUT__);
+        if (result.status != wrpc::ConnectionStatus::Disconnected)
+            return result;
+    }
+    return wrpc::Connection::Result(wrpc::ConnectionStatus::Disconnected, "Not connected to the client");
+}
+
+std::chrono::milliseconds Host::max_age(const std::string &command) const {
+    if (command == "get_cc_status" || command == "get_file_transfers" || command == "get_project_status"
+        || command == "get_results")
+        return 2 * options_.interval;
+    if (command == "get_state" || command == "get_disk_usage")
+        return 2 * options_.state_interval;
+    return options_.interval;
+}
+
+void Host::detach(SharedConnection *connection) {
+    connections_.erase(std::remove(connections_.begin(), connections_.end(), connection), connections_.end());
+
+    std::lock_guard<std::mutex> guard(cache_mutex_);
+    cache_.clear();
+}
+
+std::shared_ptr<const std::string> Host::replied(const std::string &request, std::string reply) {
+    auto shared = std::make_shared<const std::string>(std::move(reply));
+    const auto command = command__(request);
+
+    std::lock_guard<std::mutex> guard(cache_mutex_);
+
+    // an unauthorized connection isn't worth caching
+    if (cached_read__(command) && shared->find("<unauthorized/>") == std::string::npos) {
+        if (cache_.size() >= MAX_CACHED_REPLIES__ && cache_.find(request) == cache_.end()) {
+            auto oldest = std::min_element(cache_.begin(), cache_.end(), [](const auto &a, const auto &b) {
+                return a.second.received < b.second.received;
+            });
+            cache_.erase(oldest);
+        }
+        cache_[request] = CachedReply{shared, Clock::now()};
+    } else if (!read__(command)) {
+        cache_.clear();
+    }
+
+    return shared;
+}
+
+std::shared_ptr<const std::string> Host::cached_(const std::string &request, std::chrono::milliseconds max_age) const {
+    std::lock_guard<std::mutex> guard(cache_mutex_);
+
+    auto cached = cache_.find(request);
+    if (cached == cache_.end() || Clock::now() - cached->second.received > max_age)
+        return nullptr;
+    return cached->second.reply;
+}
+
+typedef std::vector<std::unique_ptr<Host>> Hosts;
+
+// ---- HostLifecycle ----
+
+const char *to_string(wui::Error error) {
+    switch (error) {
+        case wui::Error::Disconnected:    return "disconnected";
+        case wui::Error::Unauthorized:    return "unauthorized";
+        case wui::Error::ConnectionError: return "connection error";
+        case wui::Error::ClientError:     return "client error";
+        case wui::Error::ParsingError:    return "parsing error";
+        case wui::Error::LogicError:      return "logic error";
+    }
+    return "unknown error";
+}
+
+// Logs the life cycle of the hosts and collects the ones which couldn't be connected to be added again later,
+// once connected the controller reconnects them by itself
+class HostLifecycle : public wui::HostHandler {
+    public:
+        explicit HostLifecycle(bool verbose) : verbose_(verbose) {}
+
+        void on_host_connected(const std::string &host) override {
+            std::lock_guard<std::mutex> guard(mutex_);
+            connected_.insert(host);
+            std::cerr << "woincd: connected to " << host << "\n";
+        }
+
+        void on_host_authorized(const std::string &host) override {
+            if (verbose_)
+                std::cerr << "woincd: authorized at " << host << "\n";
+        }
+
+        void on_host_authorization_failed(const std::string &host) override {
+            std::cerr << "woincd: authorization failed at " << host << ", check its password\n";
+        }
+
+        void on_host_error(const std::string &host, wui::Error error) override {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (connected_.find(host) == connected_.end()) {
+                std::cerr << "woincd: could not connect to " << host << ", retrying in "
+                    << RETRY_INTERVAL__.count() << " seconds\n";
+                retries_.emplace(host, Clock::now() + RETRY_INTERVAL__);
+            } else if (verbose_) {
+                std::cerr << "woincd: " << to_string(error) << " at " << host << "\n";
+            }
+        }
+
+        // the hosts to add again
+        std::vector<std::string> due_retries() {
+            std::vector<std::string> due;
+            const auto now = Clock::now();
+
+            std::lock_guard<std::mutex> guard(mutex_);
+            for (auto retry = retries_.begin(); retry != retries_.end();) {
+                if (retry->second <= now) {
+                    due.push_back(retry->first);
+                    retry = retries_.erase(retry);
+                } else {
+                    ++retry;
+                }
+            }
+
+            return due;
+        }
+
+    private:
+        const bool verbose_;
+        std::mutex mutex_;
+        std::set<std::string> connected_;
+        std::map<std::string, Clock::time_point> retries_;
+};
+
+void add_host__(wui::Controller &controller, const Host &host) {
+    const auto &config = host.config();
+    controller.add_host(config.name(), config.url, config.port);
+    if (!config.password.empty())
+        controller.authorize_host(config.name(), config.password);
+    controller.schedule_periodic_tasks(config.name(), true);
+}
+
+// ---- metrics ----
+
+const char *series_name__(wui::MetricSeries series) {
+    switch (series) {
+        case wui::MetricSeries::RpcRoundTrip:    return "rpc round trip";
+        case wui::MetricSeries::BytesOut:        return "bytes out";
+        case wui::MetricSeries::BytesIn:         return "bytes in";
+        case wui::MetricSeries::ParseDuration:   return "parsing";
+        case wui::MetricSeries::QueueWait:       return "queue wait";
+        case wui::MetricSeries::HandlerDuration: return "handlers";
+        case wui::MetricSeries::QueueDepth:      return "queue depth";
+        case wui::MetricSeries::UpdateLatency:   return "update latency";
+    }
+    return "unknown";
+}
+
+bool in_nanoseconds__(wui::MetricSeries series) {
+    return series != wui::MetricSeries::BytesOut && series != wui::MetricSeries::BytesIn
+        && series != wui::MetricSeries::QueueDepth;
+}
+
+const char *task_name__(std::size_t task_or_commands) {
+    if (task_or_commands == wui::HostMetrics::COMMANDS)
+        return "commands";
+
+    switch (static_cast<wui::PeriodicTask>(task_or_commands)) {
+        case wui::PeriodicTask::GetCCStatus:      return "get_cc_status";
+        case wui::PeriodicTask::GetClientState:   return "get_state";
+        case wui::PeriodicTask::GetDiskUsage:     return "get_disk_usage";
+        case wui::PeriodicTask::GetFileTransfers: return "get_file_transfers";
+        case wui::PeriodicTask::GetMessages:      return "get_messages";
+        case wui::PeriodicTask::GetNotices:       return "get_notices";
+        case wui::PeriodicTask::GetProjectStatus: return "get_project_status";
+        case wui::PeriodicTask::GetStatistics:    return "get_statistics";
+        case wui::PeriodicTask::GetTasks:         return "get_tasks";
+    }
+    return "unknown";
+}
+
+// the recorded histograms as a table, the durations in milliseconds
+std::string metrics_reply__(const wui::HostMetrics &metrics) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << std::left
+        << std::setw(16) << "series" << std::setw(20) << "task" << std::right
+        << std::setw(8) << "count" << std::setw(14) << "mean" << std::setw(14) << "p50"
+        << std::setw(14) << "p99" << std::setw(14) << "max" << "\n";
+
+    for (std::size_t s = 0; s < wui::METRIC_SERIES_COUNT; ++s) {
+        const auto series = static_cast<wui::MetricSeries>(s);
+        const double scale = in_nanoseconds__(series) ? 1e6 : 1.;
+
+        for (std::size_t task = 0; task <= wui::HostMetrics::COMMANDS; ++task) {
+            const auto &histogram = task == wui::HostMetrics::COMMANDS
+                ? metrics.commands(series)
+                : metrics.periodic(series, static_cast<wui::PeriodicTask>(task));
+            if (histogram.count() == 0)
+                continue;
+
+            out << std::left << std::setw(16) << series_name__(series) << std::setw(20) << task_name__(task)
+                << std::right << std::setw(8) << histogram.count()
+                << std::setw(14) << histogram.mean() / scale
+                << std::setw(14) << static_cast<double>(histogram.percentile(50)) / scale
+                << std::setw(14) << static_cast<double>(histogram.percentile(99)) / scale
+                << std::setw(14) << static_cast<double>(histogram.max()) / scale << "\n";
+        }
+    }
+
+    const std::string tag = woinc::ui::common::DAEMON_GET_METRICS_TAG;
+    return reply__("<" + tag + ">\n" + out.str() + "</" + tag + ">\n");
+}
+
+// ---- Session ----
+
+// Serves a local client, run by its own thread
+class Session {
+    public:
+        Session(int socket, Hosts &hosts, wui::Controller &controller, const Options &options)
+            : socket_(socket), hosts_(hosts), controller_(controller), options_(options) {}
+
+        ~Session() {
+            ::close(socket_);
+        }
+
+        void run();
+
+        // lets the blocking receive return, callable by any thread
+        void stop() {
+            ::shutdown(socket_, SHUT_RDWR);
+        }
+
+    private:
+        bool receive_(std::string &request);
+        bool send_(const std::string &reply);
+
+        Host *select_host_(const std::string &request, std::string &error) const;
+        std::string serve_(Host &host, const std::string &request);
+
+    private:
+        const int socket_;
+        Hosts &hosts_;
+        wui::Controller &controller_;
+        const Options &options_;
+        // the received bytes after the last request
+        std::string buffer_;
+};
+
+void Session::run() {
+    std::string request;
+    if (!receive_(request))
+        return;
+
+    std::string error;
+    Host *host = select_host_(request, error);
+    if (!send_(host == nullptr ? error_reply__(error) : reply__("<success/>\n")) || host == nullptr)
+        return;
+
+    while (receive_(request)) {
+        if (!send_(serve_(*host, request)))
+            return;
+    }
+}
+
+Host *Session::select_host_(const std::string &request, std::string &error) const {
+    if (command__(request) != woinc::ui::common::DAEMON_SELECT_HOST_TAG) {
+        error = "woincd: missing host selection";
+        return nullptr;
+    }
+
+    const auto url = content__(request, "host");
+    const auto port = content__(request, "port");
+
+    for (auto &host : hosts_)
+        if (host->config().url == url && std::to_string(host->config().port) == port)
+            return host.get();
+
+    error = "woincd: unknown host " + url + " on port " + port;
+    return nullptr;
+}
+
+std::string Session::serve_(Host &host, const std::string &request) {
+    const auto command = command__(request);
+
+    // the daemon authorized the connection already, having access to the socket is enough
+    if (command == "auth1")
+        return reply__("<nonce>woincd</nonce>\n");
+    if (command == "auth2")
+        return reply__("<authorized/>\n");
+
+    // answered by the daemon itself
+    if (command == woinc::ui::common::DAEMON_GET_METRICS_TAG) {
+        try {
+            return metrics_reply__(controller_.metrics(host.config().name()));
+        } catch (...) {
+            // the controller is shutting down
+            return error_reply__("woincd: shutting down");
+        }
+    }
+
+    std::shared_ptr<const std::string> reply;
+    wrpc::Connection::Result result;
+    bool cached = false;
+
+    if (cached_read__(command))
+        result = host.read(request, host.max_age(command), reply, cached);
+    else
+        result = host.forward(request, reply);
+
+    if (options_.verbose)
+        std::cerr << "woincd: " << host.config().name() << " " << command << " "
+            << (cached ? "cached" : result ? "forwarded" : "failed: " + result.error) << "\n";
+
+    if (!result)
+        return error_reply__("woincd: could not communicate with the client"
+                             + (result.error.empty() ? std::string() : ": " + result.error));
+
+    // let the changes of the commands show up in the cache soon
+    if (!read__(command)) {
+        try {
+            for (auto task : {wui::PeriodicTask::GetCCStatus, wui::PeriodicTask::GetFileTransfers,
+                              wui::PeriodicTask::GetProjectStatus, wui::PeriodicTask::GetTasks})
+                controller_.reschedule_now(host.config().name(), task);
+        } catch (...) {
+            // the controller is shutting down
+        }
+    }
+
+    return *reply;
+}
+
+bool Session::receive_(std::string &request) {
+    char buffer[32 * 1024];
+
+    while (true) {
+        auto eom = buffer_.find(EOM__);
+        if (eom != std::string::npos) {
+            request.assign(buffer_, 0, eom);
+            buffer_.erase(0, eom + 1);
+            return true;
+        }
+
+        if (buffer_.size() > MAX_REQUEST_SIZE__)
+            return false;
+
+        auto n = ::recv(socket_, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buffer_.append(buffer, static_cast<std::size_t>(n));
+    }
+}
+
+bool Session::send_(const std::string &reply) {
+    std::string message(reply);
+    message += EOM__;
+
+    std::size_t sent = 0;
+    while (sent < message.size()) {
+        auto n = ::send(socket_, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += static_cast<std::size_t>(n);
+    }
+
+    return true;
+}
+
+// ---- Server ----
+
+// Accepts the local clients and runs their sessions
+class Server {
+    public:
+        Server(Hosts &hosts, wui::Controller &controller, HostLifecycle &lifecycle, const Options &options)
+            : hosts_(hosts), controller_(controller), lifecycle_(lifecycle), options_(options) {}
+
+        ~Server();
+
+        void listen();
+        // serves and retries the unconnected hosts until stopped by a signal
+        void run();
+        // stops the sessions, they are joined by the destructor
+        void stop();
+
+    private:
+        void accept_();
+        void reap_(bool all);
+
+    private:
+        struct Running {
+            std::unique_ptr<Session> session;
+            std::thread thread;
+            std::shared_ptr<std::atomic<bool>> done;
+        };
+
+        void retry_hosts_();
+
+    private:
+        Hosts &hosts_;
+        wui::Controller &controller_;
+        HostLifecycle &lifecycle_;
+        const Options &options_;
+        int socket_ = -1;
+        std::list<Running> sessions_;
+};
+
+Server::~Server() {
+    stop();
+    reap_(true);
+
+    if (socket_ >= 0) {
+        ::close(socket_);
+        ::unlink(options_.socket.c_str());
+    }
+}
+
+void Server::listen() {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (options_.socket.empty() || options_.socket.size() >= sizeof(address.sun_path))
+        die("Invalid path of the socket \"" + options_.socket + "\"");
+    std::copy(options_.socket.cbegin(), options_.socket.cend(), address.sun_path);
+
+    // a socket left by a crashed daemon is replaced, a running daemon isn't
+    struct stat info;
+    if (::lstat(options_.socket.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode))
+            die("\"" + options_.socket + "\" exists and isn't a socket");
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool running = fd >= 0 && ::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+        if (fd >= 0)
+            ::close(fd);
+        if (running)
+            die("Another woincd is listening on \"" + options_.socket + "\"");
+        ::unlink(options_.socket.c_str());
+    }
+
+    socket_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_ < 0)
+        die(std::string("Could not create the socket: ") + std::strerror(errno));
+
+    // the daemon is authorized at the hosts, so only the user may connect
+    auto mask = ::umask(0077);
+    int bound = ::bind(socket_, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+    ::umask(mask);
+
+    if (bound != 0 || ::listen(socket_, 64) != 0)
+        die("Could not listen on \"" + options_.socket + "\": " + std::strerror(errno));
+}
+
+void Server::run() {
+    while (!stop__) {
+        pollfd fd;
+        fd.fd = socket_;
+        fd.events = POLLIN;
+        fd.revents = 0;
+
+        // wake up regularly to notice the signals
+        int ready = ::poll(&fd, 1, 200);
+        if (ready < 0 && errno != EINTR)
+            die(std::string("Could not wait for the clients: ") + std::strerror(errno));
+
+        if (ready > 0)
+            accept_();
+        reap_(false);
+        retry_hosts_();
+    }
+}
+
+void Server::retry_hosts_() {
+    for (const auto &name : lifecycle_.due_retries()) {
+        auto host = std::find_if(hosts_.cbegin(), hosts_.cend(), [&](const auto &h) {
+            return h->config().name() == name;
+        });
+        if (host == hosts_.cend())
+            continue;
+        controller_.remove_host(name);
+        add_host__(controller_, **host);
+    }
+}
+
+void Server::stop() {
+    for (auto &running : sessions_)
+        running.session->stop();
+}
+
+void Server::accept_() {
+    int fd = ::accept4(socket_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    if (sessions_.size() >= MAX_SESSIONS__) {
+        std::cerr << "woincd: too many local clients, refusing another one\n";
+        ::close(fd);
+        return;
+    }
+
+    Running running;
+    running.session = std::make_unique<Session>(fd, hosts_, controller_, options_);
+    running.done = std::make_shared<std::atomic<bool>>(false);
+    running.thread = std::thread([session = running.session.get(), done = running.done]() {
+        session->run();
+        *done = true;
+    });
+
+    sessions_.push_back(std::move(running));
+}
+
+void Server::reap_(bool all) {
+    for (auto running = sessions_.begin(); running != sessions_.end();) {
+        if (all || *running->done) {
+            running->thread.join();
+            running = sessions_.erase(running);
+        } else {
+            ++running;
+        }
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    const auto options = parse_options(argc, argv);
+
+    std::signal(SIGINT, on_signal__);
+    std::signal(SIGTERM, on_signal__);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    Hosts hosts;
+    std::map<std::string, Host *> hosts_by_name;
+    for (const auto &config : options.hosts) {
+        hosts.push_back(std::make_unique<Host>(config, options));
+        if (!hosts_by_name.emplace(config.name(), hosts.back().get()).second)
+            die("Host " + config.name() + " given twice");
+    }
+
+    wui::Controller controller;
+
+    controller.connection_factory([&hosts_by_name](const std::string &host) {
+        return std::make_unique<SharedConnection>(*hosts_by_name.at(host));
+    });
+
+    for (auto task : {wui::PeriodicTask::GetCCStatus, wui::PeriodicTask::GetFileTransfers,
+                      wui::PeriodicTask::GetProjectStatus, wui::PeriodicTask::GetTasks})
+        controller.periodic_task_interval(task, options.interval);
+    for (auto task : {wui::PeriodicTask::GetClientState, wui::PeriodicTask::GetDiskUsage})
+        controller.periodic_task_interval(task, options.state_interval);
+
+    // the replies are cached by the connections, no handler is needed to get the tasks polled
+    controller.snapshot_tasks(POLLED_TASKS__);
+
+    HostLifecycle lifecycle(options.verbose);
+    controller.register_handler(&lifecycle);
+
+    Server server(hosts, controller, lifecycle, options);
+    server.listen();
+
+    for (const auto &host : hosts)
+        add_host__(controller, *host);
+
+    std::cerr << "woincd: serving " << hosts.size() << (hosts.size() == 1 ? " host" : " hosts")
+        << " on " << options.socket << "\n";
+
+    server.run();
+
+    // the sessions waiting for a forwarded rpc are released by the shutdown of the connections
+    server.stop();
+    controller.shutdown();
+
+    return EXIT_SUCCESS;
+}